@@ -1,10 +1,43 @@
 /*
- * Configuration.c - Library for managing configuration reading and saving in the EEPROM memory
+ * Configuration.c - Library for managing configuration reading and saving in flash
  */
 
 
 /*
- * The data structure is as follow
+ * The configuration is saved in a journal file (CONFIGURATION_JOURNAL_FILE) on LittleFS.
+ * Each save appends one record (header + payload below) and the last valid record is the current configuration.
+ * LittleFS spreads the writes over the flash blocks, and the journal is compacted to a single record
+ * from the main loop once it grows over CONFIGURATION_JOURNAL_MAX_SIZE.
+ * Configurations saved in the EEPROM by previous versions are converted once when loaded.
+ */
+
+
+/*
+ * The data structure is as follow (all numbers are little endian)
+ *
+ * Header (ConfigHeader, 12 bytes)
+ *   uint16 magic "xB" to ensure that data is valid
+ *   uint8  version of the layout (CONFIGURATION_VERSION)
+ *   uint8  reserved
+ *   uint16 length of the payload
+ *   uint16 reserved
+ *   uint32 CRC-32 of the 8 previous header bytes followed by the payload
+ * Payload
+ *   uint32 TransmitterId
+ *   uint8  flags (bit 0: Debug enabled)
+ *   string Debug IP Address
+ *   string App engine address
+ *   string hotspot wifi name
+ *   string hotspot wifi password
+ *   uint8  number of saved wifi, followed by the SSID string and password string of each wifi
+ *   string Nightscout address      (optional, added with the upload destinations)
+ *   string Nightscout API secret   (optional)
+ *   string local receiver address  (optional)
+ *   uint8  number of the next Wixel transmitter IDs, followed by each uint32 (optional, added with the Wixel ports)
+ * Every string is a uint8 length followed by the characters (no NUL)
+ * Optional strings missing at the end of the payload are empty, so older records still load
+ *
+ * Older versions saved this structure in the EEPROM, and before that the following structure
  * 
  * 1st character is ¶ to ensure that data is valid
  * 4 next chars are for TransmitterId in uint32_t format
@@ -22,9 +55,25 @@
  */
  
 #include "Configuration.h"
-
-const static char CONFIGURATION_SEPARATOR = '¬';
-const static String DEFAULT_HOTSPOT_NAME = "wifi-xBridge";
+#include "Profiler.h"
+#include "Crc32.h"
+#include "Metrics.h"
+
+const static byte CONFIGURATION_SEPARATOR = 0xAC; // '¬' in the legacy Latin-1 format
+const static char DEFAULT_HOTSPOT_NAME[] = "wifi-xBridge";
+const static uint16_t CONFIGURATION_MAGIC = 0x4278; // "xB"
+const static uint8_t CONFIGURATION_VERSION = 1;
+const static uint8_t CONFIGURATION_FLAG_DEBUG = 0x01;
+const static unsigned int CONFIGURATION_MAX_STRING_LENGTH = 255;
+
+struct ConfigHeader {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t reserved;
+  uint16_t length;
+  uint16_t reserved2;
+  uint32_t crc;
+};
 
 DexcomHelper Configuration::_dexcomHelper;
 
@@ -34,15 +83,109 @@ DexcomHelper Configuration::_dexcomHelper;
 Configuration::Configuration()
 {
   _loaded = false;
+  _dirty = false;
+  _compactionPending = false;
+  _compactionFailed = false;
+  _compactionMillis = 0;
+  _journalSize = 0;
+  _version = 0;
+  _current = &_snapshots[0];
+  _editing = false;
+  _wifiCount = 0;
+}
+
+/*
+ * Configuration::begin
+ * --------------------
+ * This method will load the saved configuration. The file system must be mounted
+ */
+void Configuration::begin() {
+  if (!_loaded) {
+    LoadConfig();
+  }
+}
+
+/*
+ * CopyConfigString
+ * ----------------
+ * Copy a string in a snapshot field, truncated to the size of the field
+ * destination: The snapshot field
+ * value: The string to copy
+ */
+template<size_t size> static void CopyConfigString(char (&destination)[size], const char* value) {
+  size_t length = strnlen(value, size - 1);
+  memcpy(destination, value, length);
+  destination[length] = '\0';
+}
+
+/*
+ * Configuration::editConfig
+ * -------------------------
+ * This method will return the snapshot to change. The first change after a save copies the current
+ * settings in the snapshot not used by the getters, so readers never see a half done change
+ * returns: The snapshot to change
+ */
+BridgeConfig* Configuration::editConfig() {
+  BridgeConfig* edited = _current == &_snapshots[0] ? &_snapshots[1] : &_snapshots[0];
+  if (!_editing) {
+    *edited = *_current;
+    _editing = true;
+  }
+  return edited;
+}
+
+/*
+ * Configuration::publishConfig
+ * ----------------------------
+ * This method will make the changed snapshot the one read by the getters and change the version
+ */
+void Configuration::publishConfig() {
+  if (_editing) {
+    BridgeConfig* edited = editConfig();
+    if (edited->hotSpotName[0] == '\0') {
+      CopyConfigString(edited->hotSpotName, DEFAULT_HOTSPOT_NAME);
+    }
+    // Only a pointer changes, the previous snapshot stays intact until the next change
+    _current = edited;
+    _editing = false;
+  }
+  // The saved wifi are not in the snapshots, their changes need a new version too
+  _version++;
+}
+
+/*
+ * Configuration::setDirty
+ * -----------------------
+ * This method will remember that the configuration changed and needs to be saved
+ */
+void Configuration::setDirty() {
+  _dirty = true;
+}
+
+/*
+ * Configuration::getVersion
+ * -------------------------
+ * This method will return a number that changes every time new settings are saved (restarts at 0 at boot)
+ */
+uint32_t Configuration::getVersion() {
+  return _version;
 }
 /*
  * Configuration::setTransmitterId
  * -------------------------------
- * This method will save the transmitter Id to the EEPROM
+ * This method will save the transmitter Id of one Wixel
+ * port: Number of the Wixel port, from 0 to WIXEL_PORT_COUNT - 1
+ * transmitterId: The transmitter ID in src format, 0 if the port is not used
  */
-void Configuration::setTransmitterId(uint32_t transmitterId) {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  bridgeConfig->transmitterId = transmitterId;
+void Configuration::setTransmitterId(uint8_t port, uint32_t transmitterId) {
+  if (port >= WIXEL_PORT_COUNT) {
+    return;
+  }
+  BridgeConfig* bridgeConfig = editConfig();
+  if (bridgeConfig->transmitterIds[port] != transmitterId) {
+    bridgeConfig->transmitterIds[port] = transmitterId;
+    setDirty();
+  }
 }
 
 /*
@@ -50,9 +193,51 @@ void Configuration::setTransmitterId(uint32_t transmitterId) {
  * ----------------------------------
  * This method will save the App Engine Address
  */
-void Configuration::setAppEngineAddress(String address) {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  bridgeConfig->appEngineAddress = address;
+void Configuration::setAppEngineAddress(const char* address) {
+  BridgeConfig* bridgeConfig = editConfig();
+  if (strcmp(bridgeConfig->appEngineAddress, address) != 0) {
+    CopyConfigString(bridgeConfig->appEngineAddress, address);
+    setDirty();
+  }
+}
+
+/*
+ * Configuration::setNightscoutAddress
+ * -----------------------------------
+ * This method will save the Nightscout address (host[:port])
+ */
+void Configuration::setNightscoutAddress(const char* address) {
+  BridgeConfig* bridgeConfig = editConfig();
+  if (strcmp(bridgeConfig->nightscoutAddress, address) != 0) {
+    CopyConfigString(bridgeConfig->nightscoutAddress, address);
+    setDirty();
+  }
+}
+
+/*
+ * Configuration::setNightscoutSecret
+ * ----------------------------------
+ * This method will save the Nightscout API secret
+ */
+void Configuration::setNightscoutSecret(const char* secret) {
+  BridgeConfig* bridgeConfig = editConfig();
+  if (strcmp(bridgeConfig->nightscoutSecret, secret) != 0) {
+    CopyConfigString(bridgeConfig->nightscoutSecret, secret);
+    setDirty();
+  }
+}
+
+/*
+ * Configuration::setLocalAddress
+ * ------------------------------
+ * This method will save the address of the receiver on the local network (host[:port])
+ */
+void Configuration::setLocalAddress(const char* address) {
+  BridgeConfig* bridgeConfig = editConfig();
+  if (strcmp(bridgeConfig->localAddress, address) != 0) {
+    CopyConfigString(bridgeConfig->localAddress, address);
+    setDirty();
+  }
 }
 
 /*
@@ -60,9 +245,12 @@ void Configuration::setAppEngineAddress(String address) {
  * -----------------------------
  * This method will save the hotspot name
  */
-void Configuration::setHotSpotName(String name) {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  bridgeConfig->hotSpotName = name;
+void Configuration::setHotSpotName(const char* name) {
+  BridgeConfig* bridgeConfig = editConfig();
+  if (strcmp(bridgeConfig->hotSpotName, name) != 0) {
+    CopyConfigString(bridgeConfig->hotSpotName, name);
+    setDirty();
+  }
 }
 
 /*
@@ -70,9 +258,12 @@ void Configuration::setHotSpotName(String name) {
  * -----------------------------
  * This method will save the hotspot password
  */
-void Configuration::setHotSpotPass(String pass) {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  bridgeConfig->hotSpotPassword = pass;
+void Configuration::setHotSpotPass(const char* pass) {
+  BridgeConfig* bridgeConfig = editConfig();
+  if (strcmp(bridgeConfig->hotSpotPassword, pass) != 0) {
+    CopyConfigString(bridgeConfig->hotSpotPassword, pass);
+    setDirty();
+  }
 }
 
 /*
@@ -80,63 +271,84 @@ void Configuration::setHotSpotPass(String pass) {
  * ----------------------------------
  * This method will save the Debug IP Address
  */
-void Configuration::setDebugAddress(String address) {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  bridgeConfig->debugAddress = address;
+void Configuration::setDebugAddress(const char* address) {
+  BridgeConfig* bridgeConfig = editConfig();
+  if (strcmp(bridgeConfig->debugAddress, address) != 0) {
+    CopyConfigString(bridgeConfig->debugAddress, address);
+    setDirty();
+  }
 }
 
 /*
  * Configuration::saveSSID
  * -----------------------
- * This method save a new SSID in EEPROM
- */
-void Configuration::saveSSID(String ssidName, String ssidPassword) {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  Serial.print("Save SSID\r\n");
-  // Create wifi Data Object
-  WifiData* wifiData = (WifiData*)calloc(1, sizeof(WifiData));
-  wifiData->ssid = ssidName;
-  wifiData->password = ssidPassword;
-  // Add to saved wifi list
-  bridgeConfig->wifiList->add(wifiData);
-  Serial.print("New wifi ssid: ");
-  Serial.print(wifiData->ssid);
-  Serial.print("\r\nSize is now:");
-  Serial.print(bridgeConfig->wifiList->size());
-  Serial.print("\r\n");
+ * This method save a new SSID, or the new password of a saved SSID
+ * returns: false if the wifi table is full
+ */
+bool Configuration::saveSSID(const char* ssidName, const char* ssidPassword) {
+  if (!addWifi(ssidName, ssidPassword)) {
+    return false;
+  }
+  setDirty();
+  return true;
+}
+
+/*
+ * Configuration::addWifi
+ * ----------------------
+ * This method will add a wifi to the table, or change its password if it is already there
+ * returns: false if the wifi table is full
+ */
+bool Configuration::addWifi(const char* ssidName, const char* ssidPassword) {
+  int position = findSSID(ssidName);
+  if (position < 0) {
+    if (_wifiCount >= CONFIGURATION_MAX_WIFI) {
+      return false;
+    }
+    position = _wifiCount++;
+    CopyConfigString(_wifiTable[position].ssid, ssidName);
+  }
+  CopyConfigString(_wifiTable[position].password, ssidPassword);
+  return true;
 }
 
 /* 
  * Configuration::deleteSSID
  * -------------------------
- * This method will delete the specified ssid if found
+ * This method will delete the specified ssid if found. The next ones move up to keep the table contiguous
  */
-void Configuration::deleteSSID(String ssidName) {
-  Serial.print("Delete SSID\r\n");
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  for(int i = bridgeConfig->wifiList->size() - 1; i >= 0; i--)
-  {
-    Serial.print("Check ssid no:");
-    Serial.print(i);
-    Serial.print("\r\n");
-    WifiData* wifiData = Configuration::getWifiData(i);
-    if(wifiData->ssid == ssidName) {
-      Serial.print("Needs to be removed\r\n");
-      // remove from the list
-      bridgeConfig->wifiList->remove(i);
-      Serial.print("Removed from list\r\n");
-      free(wifiData);
+void Configuration::deleteSSID(const char* ssidName) {
+  int position = findSSID(ssidName);
+  if (position < 0) {
+    return;
+  }
+  _wifiCount--;
+  memmove(&_wifiTable[position], &_wifiTable[position + 1], (_wifiCount - position) * sizeof(WifiData));
+  setDirty();
+}
+
+/*
+ * Configuration::findSSID
+ * -----------------------
+ * This method will find a saved wifi by its SSID
+ * returns: Its position, -1 if not saved
+ */
+int Configuration::findSSID(const char* ssidName) {
+  for (int i = 0; i < _wifiCount; i++) {
+    if (strncmp(_wifiTable[i].ssid, ssidName, CONFIGURATION_MAX_SSID_LENGTH) == 0) {
+      return i;
     }
   }
+  return -1;
 }
+
 /*
  * Configuration::getWifiData
  * --------------------------
  * This method will get the specified saved Wifi Data
  */
-WifiData* Configuration::getWifiData(int position) {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  return bridgeConfig->wifiList->get(position);
+const WifiData* Configuration::getWifiData(int position) {
+  return &_wifiTable[position];
 }
 
 /*
@@ -145,29 +357,18 @@ WifiData* Configuration::getWifiData(int position) {
  * This method will return the number of saved Wifi
  */
 int Configuration::getWifiCount() {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  LinkedList<WifiData*>* wifiList = bridgeConfig->wifiList;
-  return bridgeConfig->wifiList->size();
+  return _wifiCount;
 }
 
 /*
  * Configuration::getTransmitterId
  * -------------------------------
- * This method will get the transmitter Id from the EEPROM
+ * This method will get the transmitter Id of one Wixel
+ * port: Number of the Wixel port
+ * returns: The transmitter ID in src format, 0 if the port is not used
  */
-uint32_t Configuration::getTransmitterId() {
-  uint32_t transmitterId;
-  //byte value = EEPROM.read(1);
-  //transmitterId = value;
-  EEPROM_readAnything(1, transmitterId);
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  return bridgeConfig->transmitterId;
-  /*
-  uint32_t transmitterId;
-  //byte value = EEPROM.read(1);
-  //transmitterId = value;
-  EEPROM_readAnything(1, transmitterId);
-  return transmitterId;*/
+uint32_t Configuration::getTransmitterId(uint8_t port) {
+  return port < WIXEL_PORT_COUNT ? _current->transmitterIds[port] : 0;
 }
 
 /*
@@ -175,54 +376,54 @@ uint32_t Configuration::getTransmitterId() {
  * ----------------------------------
  * This method will get the Google App Engine Address
  */
-String Configuration::getAppEngineAddress() {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-
-  if(bridgeConfig->appEngineAddress.length() > 0)
-  {
-    return bridgeConfig->appEngineAddress;
-  }
-  else
-  {
-    return "";
-  }
+const char* Configuration::getAppEngineAddress() {
+  return _current->appEngineAddress;
 }
 
 /*
- * Configuration::getHotSpotName
- * -----------------------------
- * This method will return the hotspot name
+ * Configuration::getNightscoutAddress
+ * -----------------------------------
+ * This method will get the Nightscout address
  */
-String Configuration::getHotSpotName() {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
+const char* Configuration::getNightscoutAddress() {
+  return _current->nightscoutAddress;
+}
 
-  if(bridgeConfig->hotSpotName.length() > 0)
-  {
-    return bridgeConfig->hotSpotName;
-  }
-  else
-  {
-    return DEFAULT_HOTSPOT_NAME;
-  }
+/*
+ * Configuration::getNightscoutSecret
+ * ----------------------------------
+ * This method will get the Nightscout API secret
+ */
+const char* Configuration::getNightscoutSecret() {
+  return _current->nightscoutSecret;
 }
 
+/*
+ * Configuration::getLocalAddress
+ * ------------------------------
+ * This method will get the address of the receiver on the local network
+ */
+const char* Configuration::getLocalAddress() {
+  return _current->localAddress;
+}
 
 /*
  * Configuration::getHotSpotName
  * -----------------------------
  * This method will return the hotspot name
  */
-String Configuration::getHotSpotPass() {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
+const char* Configuration::getHotSpotName() {
+  return _current->hotSpotName;
+}
 
-  if(bridgeConfig->hotSpotPassword.length() > 0)
-  {
-    return bridgeConfig->hotSpotPassword;
-  }
-  else
-  {
-    return "";
-  }
+
+/*
+ * Configuration::getHotSpotPass
+ * -----------------------------
+ * This method will return the hotspot password
+ */
+const char* Configuration::getHotSpotPass() {
+  return _current->hotSpotPassword;
 }
 
 /* 
@@ -230,17 +431,8 @@ String Configuration::getHotSpotPass() {
  * ------------------------------
  * This method will get the debug ip address
  */
-String Configuration::getDebugAddress() {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-
-  if(bridgeConfig->debugAddress.length() > 0)
-  {
-    return bridgeConfig->debugAddress;
-  }
-  else
-  {
-    return "";
-  }
+const char* Configuration::getDebugAddress() {
+  return _current->debugAddress;
 }
 
 /*
@@ -249,8 +441,11 @@ String Configuration::getDebugAddress() {
  * This method will set the "Debug" flag true or false
  */
 void Configuration::setIsDebug(bool isDebug) {
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  bridgeConfig->isDebug = isDebug;
+  BridgeConfig* bridgeConfig = editConfig();
+  if (bridgeConfig->isDebug != isDebug) {
+    bridgeConfig->isDebug = isDebug;
+    setDirty();
+  }
 }
 
 /*
@@ -259,42 +454,224 @@ void Configuration::setIsDebug(bool isDebug) {
  * This method will return the "Debug" flag
  */
 bool Configuration::getIsDebug(){
-  BridgeConfig* bridgeConfig = getBridgeConfig();
-  if(bridgeConfig->appEngineAddress.length() > 0)
-  {
-    return bridgeConfig->isDebug;
-  }
-  else
-  {
+  return _current->isDebug;
+}
+
+/*
+ * ReadConfigString
+ * ----------------
+ * Read a length prefixed string from the configuration payload. Strings longer than value are truncated
+ * data: Position in the payload, moved after the string
+ * end: End of the payload
+ * value: Where to save the string
+ * size: Size of value
+ * returns: false if the payload is too short
+ */
+static bool ReadConfigString(const uint8_t* &data, const uint8_t* end, char* value, size_t size) {
+  if (data >= end || data + 1 + data[0] > end) {
     return false;
   }
+  uint8_t length = *data++;
+  size_t copied = length < size ? length : size - 1;
+  memcpy(value, data, copied);
+  value[copied] = '\0';
+  data += length;
+  return true;
 }
 
 /*
- * Configuration::getBridgeConfig
- * ------------------------------
- * This method will get the bridge configuration and load it if neccesary
+ * WriteConfigString
+ * -----------------
+ * Write a length prefixed string to the configuration payload. Strings are truncated to 255 characters
+ * data: Position in the payload, moved after the string
+ * end: End of the available space
+ * value: The string to write
+ * returns: false if there is not enough space
  */
-BridgeConfig* Configuration::getBridgeConfig() {
-  if(!_loaded){
-    _bridgeConfig = LoadConfig();
+static bool WriteConfigString(uint8_t* &data, const uint8_t* end, const char* value) {
+  unsigned int length = strlen(value);
+  if (length > CONFIGURATION_MAX_STRING_LENGTH) {
+    length = CONFIGURATION_MAX_STRING_LENGTH;
+  }
+  if (data + 1 + length > end) {
+    return false;
   }
-  return _bridgeConfig;
+  *data++ = length;
+  memcpy(data, value, length);
+  data += length;
+  return true;
 }
 
-
 /*
  * Configuration::LoadConfig
  * -------------------------
- * This method will load the configuration object from EEPROM
- * returns: The bridge configuration struct
- */
-BridgeConfig* Configuration::LoadConfig() {
-  /*LinkedList<WifiData> *test= new LinkedList<WifiData>();
-  Serial.print( test->size());*/
-  
-  BridgeConfig* config = (BridgeConfig*)calloc(1, sizeof(BridgeConfig));// BridgeConfig();
-  config->wifiList = new LinkedList<WifiData*>();
+ * This method will load the configuration from the journal in the snapshot read by the getters
+ * Configuration saved in the EEPROM by a previous version is converted to the journal
+ */
+void Configuration::LoadConfig() {
+  ProfilerScope profile(PROFILE_LOAD_CONFIG);
+  BridgeConfig* config = editConfig();
+  _loaded = true;
+  if (LoadJournal(config)) {
+    Serial.print("Configuration Valid\r\n");
+    publishConfig();
+    return;
+  }
+  // The EEPROM is only needed to convert the old configuration
+  EEPROM.begin(4096);
+  bool converted = ParseConfig(EEPROM.getConstDataPtr(), EEPROM.length(), config);
+  if (!converted && EEPROM.read(0) == 182) { //'¶'
+    LoadLegacyConfig(config);
+    converted = true;
+  }
+  EEPROM.end();
+  publishConfig();
+  if (converted) {
+    Serial.print("Converting configuration\r\n");
+    _dirty = true;
+    SaveConfig();
+  }
+}
+
+/*
+ * Configuration::ParseConfig
+ * --------------------------
+ * This method will read a configuration record in one pass
+ * record: The header followed by the payload
+ * size: Number of bytes available in record
+ * config: The configuration to fill
+ * returns: false if the record is not a valid configuration in the current format
+ */
+bool Configuration::ParseConfig(const uint8_t* record, unsigned int size, BridgeConfig* config) {
+  ConfigHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, record, sizeof(header));
+  if (header.magic != CONFIGURATION_MAGIC || header.version != CONFIGURATION_VERSION ||
+      sizeof(header) + header.length > size) {
+    return false;
+  }
+  const uint8_t* data = record + sizeof(header);
+  const uint8_t* end = data + header.length;
+  if (Crc32(data, header.length, Crc32(&header, offsetof(ConfigHeader, crc))) != header.crc) {
+    Serial.print("Configuration corrupted\r\n");
+    return false;
+  }
+  if (end - data < 5) {
+    return false;
+  }
+  memcpy(&config->transmitterIds[0], data, 4);
+  data += 4;
+  config->isDebug = (*data++ & CONFIGURATION_FLAG_DEBUG) != 0;
+  if (!ReadConfigString(data, end, config->debugAddress, sizeof(config->debugAddress)) ||
+      !ReadConfigString(data, end, config->appEngineAddress, sizeof(config->appEngineAddress)) ||
+      !ReadConfigString(data, end, config->hotSpotName, sizeof(config->hotSpotName)) ||
+      !ReadConfigString(data, end, config->hotSpotPassword, sizeof(config->hotSpotPassword)) ||
+      data >= end) {
+    return false;
+  }
+  uint8_t wifiCount = *data++;
+  _wifiCount = 0;
+  for (int i = 0; i < wifiCount; i++) {
+    WifiData wifi;
+    if (!ReadConfigString(data, end, wifi.ssid, sizeof(wifi.ssid)) ||
+        !ReadConfigString(data, end, wifi.password, sizeof(wifi.password))) {
+      return false;
+    }
+    // Records of older versions may have more wifi than the table holds
+    addWifi(wifi.ssid, wifi.password);
+  }
+  if (data < end &&
+      (!ReadConfigString(data, end, config->nightscoutAddress, sizeof(config->nightscoutAddress)) ||
+       !ReadConfigString(data, end, config->nightscoutSecret, sizeof(config->nightscoutSecret)) ||
+       !ReadConfigString(data, end, config->localAddress, sizeof(config->localAddress)))) {
+    return false;
+  }
+  if (data < end) {
+    uint8_t transmitterCount = *data++;
+    if (end - data < transmitterCount * 4) {
+      return false;
+    }
+    for (int i = 0; i < transmitterCount; i++) {
+      // IDs of the ports this build doesn't have are ignored
+      if (i + 1 < WIXEL_PORT_COUNT) {
+        memcpy(&config->transmitterIds[i + 1], data, 4);
+      }
+      data += 4;
+    }
+  }
+  return true;
+}
+
+/*
+ * Configuration::LoadJournal
+ * --------------------------
+ * This method will find the last valid record of the journal and load it.
+ * A torn record at the end of the journal (power lost while saving) is ignored and removed by the next compaction
+ * config: The configuration to fill
+ * returns: false if the journal has no valid record
+ */
+bool Configuration::LoadJournal(BridgeConfig* config) {
+  File journal = LittleFS.open(CONFIGURATION_JOURNAL_FILE, "r");
+  if (!journal) {
+    return false;
+  }
+  uint32_t fileSize = journal.size();
+  uint32_t position = 0;
+  uint32_t lastRecordPosition = 0;
+  uint32_t lastRecordSize = 0;
+  ConfigHeader header;
+  while (position + sizeof(header) <= fileSize) {
+    if (!journal.seek(position, SeekSet) ||
+        journal.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != CONFIGURATION_MAGIC || header.version != CONFIGURATION_VERSION ||
+        position + sizeof(header) + header.length > fileSize) {
+      break;
+    }
+    // Check the CRC by small pieces, only the last record is loaded in memory
+    uint32_t crc = Crc32(&header, offsetof(ConfigHeader, crc));
+    uint8_t buffer[32];
+    unsigned int remaining = header.length;
+    while (remaining > 0) {
+      unsigned int toRead = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+      if (journal.read(buffer, toRead) != toRead) {
+        break;
+      }
+      crc = Crc32(buffer, toRead, crc);
+      remaining -= toRead;
+    }
+    if (remaining > 0 || crc != header.crc) {
+      break;
+    }
+    lastRecordPosition = position;
+    lastRecordSize = sizeof(header) + header.length;
+    position += lastRecordSize;
+  }
+  _journalSize = position;
+  _compactionPending = position != fileSize || position > CONFIGURATION_JOURNAL_MAX_SIZE;
+
+  bool loaded = false;
+  if (lastRecordSize > 0) {
+    uint8_t* record = (uint8_t*)malloc(lastRecordSize);
+    if (record != NULL) {
+      loaded = journal.seek(lastRecordPosition, SeekSet) &&
+               journal.read(record, lastRecordSize) == lastRecordSize &&
+               ParseConfig(record, lastRecordSize, config);
+      free(record);
+    }
+  }
+  journal.close();
+  return loaded;
+}
+
+/*
+ * Configuration::LoadLegacyConfig
+ * -------------------------------
+ * This method will read the configuration saved with the '¶' '¬' separated format
+ * config: The configuration to fill
+ */
+void Configuration::LoadLegacyConfig(BridgeConfig* config) {
   String eepromData;
   bool continueReading = true;
   bool separatorFound = false;
@@ -302,209 +679,205 @@ BridgeConfig* Configuration::LoadConfig() {
   bool appEngineRead = false;
   bool hotspotNameRead = false;
   bool hotspotPasswordRead = false;
-  bool debugFlagRead = false;
   bool debugAddressRead = false;
-  char firstChar = EEPROM.read(0);
   String nextSSID = "";
   String nextPassword = "";
-  if (firstChar == 182) { //'¶'
-    Serial.print("Configuration Valid\r\n");
-    // Configuration is valid
-    // Read transmitter ID
-  
-  EEPROM_readAnything(1, config->transmitterId);
-  //config->transmitterId = EEPROM.read(1) | ( (int)EEPROM.read(2) << 8 ) | ( (int)EEPROM.read(3) << 16 ) | ( (int)EEPROM.read(4) << 24 ); 
-  /*Serial.print("Transmitter ID:");
-  Serial.print(config->transmitterId);
-  Serial.print("\r\n");
-  for(int i = 0; i < 4; i++)
-  {
-    Serial.print(EEPROM.read(i+1));
-    Serial.print("\r\n");
-  }*/
-  
-  
-    config->isDebug = EEPROM.read(5) != 0;
-    int i = 6;
-    config->appEngineAddress = "";
-    config->hotSpotName = DEFAULT_HOTSPOT_NAME;
-    config->hotSpotPassword = "";
-    while(continueReading) {
-      byte newChar = EEPROM.read(i);
-      if (!(newChar == 0x00 || newChar == 255 || i == 4095)) // End of configuration
+  _wifiCount = 0;
+  EEPROM_readAnything(1, config->transmitterIds[0]);
+  config->isDebug = EEPROM.read(5) != 0;
+  int i = 6;
+  while(continueReading) {
+    byte newChar = EEPROM.read(i);
+    if (!(newChar == 0x00 || newChar == 255 || i == 4095)) // End of configuration
+    {
+      separatorFound = newChar == CONFIGURATION_SEPARATOR;
+      
+      if (separatorFound)
       {
-        separatorFound = newChar == CONFIGURATION_SEPARATOR;
-        
-        if (separatorFound)
+        if (!appEngineRead)
         {
-          if (!appEngineRead)
-          {
-            appEngineRead = true;
-            config->appEngineAddress = eepromData;
-          }
-          else if (!hotspotNameRead)
-          {
-            hotspotNameRead = true;
-            config->hotSpotName = eepromData;
-          }
-          else if (!hotspotPasswordRead)
+          appEngineRead = true;
+          CopyConfigString(config->appEngineAddress, eepromData.c_str());
+        }
+        else if (!hotspotNameRead)
+        {
+          hotspotNameRead = true;
+          CopyConfigString(config->hotSpotName, eepromData.c_str());
+        }
+        else if (!hotspotPasswordRead)
+        {
+          hotspotPasswordRead = true;
+          CopyConfigString(config->hotSpotPassword, eepromData.c_str());
+        }
+        else if(!debugAddressRead) { 
+          debugAddressRead = true;
+          CopyConfigString(config->debugAddress, eepromData.c_str());
+        }
+        else // Everything else is saved wifi SSID and Passwords
+        {
+          if (readingSSID)
           {
-            hotspotPasswordRead = true;
-            config->hotSpotPassword = eepromData;
+            nextSSID = eepromData;
           }
-          else if(!debugAddressRead) { 
-            debugAddressRead = true;
-            config->debugAddress = eepromData;
-          }
-          else // Everything else is saved wifi SSID and Passwords
+          else
           {
-            if (readingSSID)
-            {
-              nextSSID = eepromData;
-            }
-            else
-            {
-              nextPassword = eepromData;
-              WifiData* newWifi = (WifiData*)calloc(1, sizeof(WifiData));
-              newWifi->ssid = nextSSID;
-              newWifi->password = nextPassword;
-              config->wifiList->add(newWifi);
-            }
-            readingSSID = !readingSSID;
+            nextPassword = eepromData;
+            addWifi(nextSSID.c_str(), nextPassword.c_str());
           }
-          eepromData = ""; // Reset data to read
-        }
-        else
-        {
-          eepromData = eepromData + char(newChar);
+          readingSSID = !readingSSID;
         }
+        eepromData = ""; // Reset data to read
       }
-      else {
-        continueReading = false;
+      else
+      {
+        eepromData += char(newChar);
       }
-      
-      i++;
     }
+    else {
+      continueReading = false;
+    }
+    
+    i++;
   }
-  else
-  {
-    // Configuration is invalid
-    config->appEngineAddress = "";
-    config->hotSpotName = DEFAULT_HOTSPOT_NAME;
-    config->hotSpotPassword = "";
-  }
-  _loaded = true;
-  return config;
 }
 
 /*
- * Configuration::SaveConfig
- * -------------------------
- * This method will save the Data back to the EEPROM
+ * Configuration::SerializeConfig
+ * ------------------------------
+ * This method will write the configuration record (header + payload)
+ * Saved wifi which don't fit in CONFIGURATION_MAX_SIZE are not saved
+ * config: The settings to write
+ * record: Where to write the record, must have CONFIGURATION_MAX_SIZE bytes
+ * returns: The size of the record
  */
-void Configuration::SaveConfig() {
-  BridgeConfig* bridgeConfig = Configuration::getBridgeConfig();
-  int position;
-  WriteEEPROM(0, '¶');
-  uint32_t transmitterId = Configuration::getTransmitterId();
-  /*byte transmitterIdByteArray[4];
-  transmitterIdByteArray[0] = lowByte(transmitterId);
-  transmitterIdByteArray[1] = lowByte(transmitterId >> 8);
-  transmitterIdByteArray[2] = lowByte(transmitterId >> 16);
-  transmitterIdByteArray[3] = lowByte(transmitterId >> 24);
-  for(int i = 0; i < 4; i++)
-  {
-    Serial.print(transmitterIdByteArray[i]);
-    Serial.print("\r\n");
-  }*/
-  /*Configuration::WriteEEPROM(1, transmitterIdByteArray[0]);
-  Configuration::WriteEEPROM(2, transmitterIdByteArray[1]);
-  Configuration::WriteEEPROM(3, transmitterIdByteArray[2]);
-  Configuration::WriteEEPROM(4, transmitterIdByteArray[3]);*/
-  EEPROM_writeAnything(1, transmitterId);
-  Configuration::WriteEEPROM(5, bridgeConfig->isDebug ? 1 : 0);
-  position = 6;
-
-  // Write App engine address
-  if (_bridgeConfig->appEngineAddress.length() > 0) {
-    Configuration::WriteStringToEEPROM(position, bridgeConfig->appEngineAddress);
-    position = position + _bridgeConfig->appEngineAddress.length();
-  }
-  Configuration::WriteEEPROM(position , CONFIGURATION_SEPARATOR);
-  position++;
-  
-  
-  // now write hotspot wifi name
-  if (_bridgeConfig->hotSpotName.length() > 0) {
-    Configuration::WriteStringToEEPROM(position, bridgeConfig->hotSpotName);
-    position = position + bridgeConfig->hotSpotName.length();
-  }
-  Configuration::WriteEEPROM(position , CONFIGURATION_SEPARATOR);
-  position++;
-  // now write hotspot wifi password
-  if (_bridgeConfig->hotSpotPassword.length() > 0) {
-    Configuration::WriteStringToEEPROM(position, bridgeConfig->hotSpotPassword);
-    position = position + bridgeConfig->hotSpotPassword.length();
-  }
-  Configuration::WriteEEPROM(position , CONFIGURATION_SEPARATOR);
-  position++;
-  // now write debug address
-  if (_bridgeConfig->debugAddress.length() > 0) {
-    Configuration::WriteStringToEEPROM(position, bridgeConfig->debugAddress);
-    position = position + bridgeConfig->debugAddress.length();
-  }
-  Configuration::WriteEEPROM(position , CONFIGURATION_SEPARATOR);
-  position++;
+unsigned int Configuration::SerializeConfig(const BridgeConfig* config, uint8_t* record) {
+  uint8_t* payload = record + sizeof(ConfigHeader);
+  uint8_t* data = payload;
+  const uint8_t* end = record + CONFIGURATION_MAX_SIZE;
+
+  memcpy(data, &config->transmitterIds[0], 4);
+  data += 4;
+  *data++ = config->isDebug ? CONFIGURATION_FLAG_DEBUG : 0;
+  WriteConfigString(data, end, config->debugAddress);
+  WriteConfigString(data, end, config->appEngineAddress);
+  WriteConfigString(data, end, config->hotSpotName);
+  WriteConfigString(data, end, config->hotSpotPassword);
+
   // Now write all saved wifi ssid and password
-  
-  int arrayLength = bridgeConfig->wifiList->size();
-  for(int i = 0; i < arrayLength; i ++)
+  uint8_t* wifiCount = data++;
+  *wifiCount = 0;
+  for(int i = 0; i < _wifiCount; i ++)
   {
-    WifiData* wifiData = bridgeConfig->wifiList->get(i);
-    if (wifiData->ssid.length() > 0) {
-      WriteStringToEEPROM(position, wifiData->ssid);
-      position = position + wifiData->ssid.length();
+    const WifiData* wifiData = &_wifiTable[i];
+    uint8_t* wifiStart = data;
+    if (!WriteConfigString(data, end, wifiData->ssid) || !WriteConfigString(data, end, wifiData->password)) {
+      data = wifiStart;
+      break;
     }
-    Configuration::WriteEEPROM(position, CONFIGURATION_SEPARATOR);
-    position++;
-    if (wifiData->password.length() > 0) {
-      WriteStringToEEPROM(position, wifiData->password);
-      position = position + wifiData->password.length();
+    (*wifiCount)++;
+  }
+  WriteConfigString(data, end, config->nightscoutAddress);
+  WriteConfigString(data, end, config->nightscoutSecret);
+  WriteConfigString(data, end, config->localAddress);
+  if (end - data >= 1 + (WIXEL_PORT_COUNT - 1) * 4) {
+    *data++ = WIXEL_PORT_COUNT - 1;
+    for (int i = 1; i < WIXEL_PORT_COUNT; i++) {
+      memcpy(data, &config->transmitterIds[i], 4);
+      data += 4;
     }
-    Configuration::WriteEEPROM(position, CONFIGURATION_SEPARATOR);
-    position++;
   }
-  Configuration::WriteEEPROM(position , 255); // 255 character at the end
-  delay(500); // EEPROM Save + Serial.print sometime generate garbage...
-  EEPROM.commit();
-  delay(500); // EEPROM Save + Serial.print sometime generate garbage...
-  //_loaded = false;
-  //free(bridgeConfig->wifiList);
-  //free(bridgeConfig);
+
+  ConfigHeader header;
+  header.magic = CONFIGURATION_MAGIC;
+  header.version = CONFIGURATION_VERSION;
+  header.reserved = 0;
+  header.length = data - payload;
+  header.reserved2 = 0;
+  header.crc = Crc32(payload, header.length, Crc32(&header, offsetof(ConfigHeader, crc)));
+  memcpy(record, &header, sizeof(header));
+  return sizeof(header) + header.length;
 }
 
 /*
- * Configuration::WriteStringToEEPROM
- * ----------------------------------
- * This method will save a string to the specified EEPROM position
+ * Configuration::SaveConfig
+ * -------------------------
+ * This method will make the changed settings the current ones and append them to the journal
+ * if something changed since the last save
  */
-void Configuration::WriteStringToEEPROM(int position, String data)
-{
-  for(int i = 0; i < data.length(); i++){
-    Configuration::WriteEEPROM(position + i, data.charAt(i));
+void Configuration::SaveConfig() {
+  ProfilerScope profile(PROFILE_SAVE_CONFIG);
+  if (!_dirty) {
+    return;
+  }
+  publishConfig();
+  if (_compactionPending) {
+    // Rewriting the journal saves the configuration too
+    CompactJournal();
+    return;
+  }
+  uint8_t* record = (uint8_t*)malloc(CONFIGURATION_MAX_SIZE);
+  if (record == NULL) {
+    return;
   }
+  unsigned int recordSize = SerializeConfig(_current, record);
+  File journal = LittleFS.open(CONFIGURATION_JOURNAL_FILE, "a");
+  bool saved = journal && journal.write(record, recordSize) == recordSize;
+  if (journal) {
+    journal.close();
+  }
+  free(record);
+  if (saved) {
+    _dirty = false;
+    _journalSize += recordSize;
+  } else {
+    Metrics::count(METRIC_CONFIGURATION_WRITE_FAILURES);
+  }
+  // A failed append may have left a torn record, compaction rewrites the journal
+  _compactionPending = !saved || _journalSize > CONFIGURATION_JOURNAL_MAX_SIZE;
 }
 
 /*
- * Configuration::WriteEEPROM
- * --------------------------
- * This method will save a character to EEPROM if the current caracter is different at this position
+ * Configuration::CompactJournal
+ * -----------------------------
+ * This method will replace the journal by a journal containing only the current configuration
  */
-void Configuration::WriteEEPROM(int position, char data)
-{
-  //if(EEPROM.read(position) != data)
-  //{
-    EEPROM.write(position, data);
-  //}
+void Configuration::CompactJournal() {
+  _compactionMillis = millis();
+  _compactionFailed = true;
+  uint8_t* record = (uint8_t*)malloc(CONFIGURATION_MAX_SIZE);
+  if (record == NULL) {
+    Metrics::count(METRIC_CONFIGURATION_WRITE_FAILURES);
+    return;
+  }
+  unsigned int recordSize = SerializeConfig(_current, record);
+  File journal = LittleFS.open(CONFIGURATION_JOURNAL_TEMP_FILE, "w");
+  bool saved = journal && journal.write(record, recordSize) == recordSize;
+  if (journal) {
+    journal.close();
+  }
+  free(record);
+  // Rename replaces the old journal in one step so a power loss never leaves the bridge without configuration
+  if (saved && LittleFS.rename(CONFIGURATION_JOURNAL_TEMP_FILE, CONFIGURATION_JOURNAL_FILE)) {
+    _journalSize = recordSize;
+    _compactionPending = false;
+    _compactionFailed = false;
+    _dirty = false;
+  } else {
+    Metrics::count(METRIC_CONFIGURATION_WRITE_FAILURES);
+  }
 }
 
+/*
+ * Configuration::loop
+ * -------------------
+ * This method is called by the main program at each "loop" call. Compacts the journal when needed,
+ * at most once every CONFIGURATION_COMPACTION_RETRY_INTERVAL after a failure (full or worn flash)
+ */
+void Configuration::loop() {
+  if (!_compactionPending || !_loaded) {
+    return;
+  }
+  if (!_compactionFailed || millis() - _compactionMillis >= CONFIGURATION_COMPACTION_RETRY_INTERVAL) {
+    CompactJournal();
+  }
+}
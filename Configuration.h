@@ -3,53 +3,105 @@
 
 #include "Arduino.h"
 #include <EEPROM.h>
+#include <LittleFS.h>
 #include "EEPROMAnything.h"
-#include "LinkedList.h"
 #include "DexcomHelper.h"
+#include "WixelProtocol.h"
 
+#define CONFIGURATION_JOURNAL_FILE "/config.jnl"
+#define CONFIGURATION_JOURNAL_TEMP_FILE "/config.tmp"
+// The journal is compacted when it grows over this size
+#define CONFIGURATION_JOURNAL_MAX_SIZE 4096
+// Delay before the main loop tries again a failed compaction (ms)
+#define CONFIGURATION_COMPACTION_RETRY_INTERVAL 60000
+// Maximum size of one configuration record
+#define CONFIGURATION_MAX_SIZE 2560
+// Maximum length of the host names and addresses (without the NUL)
+#define CONFIGURATION_MAX_ADDRESS_LENGTH 127
+#define CONFIGURATION_MAX_SSID_LENGTH 32
+#define CONFIGURATION_MAX_PASSWORD_LENGTH 64
+#define CONFIGURATION_MAX_SECRET_LENGTH 64
+// Number of saved wifi. With the longest values they all fit in CONFIGURATION_MAX_SIZE
+#define CONFIGURATION_MAX_WIFI 16
+
+/*
+ * One saved wifi, kept inline in the wifi table
+ */
 struct WifiData {
-  String ssid = "wifi-xBridge";
-  String password = "";
+  char ssid[CONFIGURATION_MAX_SSID_LENGTH + 1];
+  char password[CONFIGURATION_MAX_PASSWORD_LENGTH + 1];
 };
 
+/*
+ * Snapshot of the settings. Plain data so it can be copied in one assignment
+ */
 struct BridgeConfig {
   bool isDebug = false;
-  String debugAddress = "";
-  uint32_t transmitterId = 0;
-  String appEngineAddress = "";
-  String hotSpotName = "wifi-xBridge";
-  String hotSpotPassword = "";
-  LinkedList<WifiData*> *wifiList = new LinkedList<WifiData*>();
+  uint32_t transmitterIds[WIXEL_PORT_COUNT] = {}; // One per Wixel, 0 if the port is not used
+  char debugAddress[CONFIGURATION_MAX_ADDRESS_LENGTH + 1] = "";
+  char appEngineAddress[CONFIGURATION_MAX_ADDRESS_LENGTH + 1] = "";
+  char nightscoutAddress[CONFIGURATION_MAX_ADDRESS_LENGTH + 1] = "";
+  char nightscoutSecret[CONFIGURATION_MAX_SECRET_LENGTH + 1] = "";
+  char localAddress[CONFIGURATION_MAX_ADDRESS_LENGTH + 1] = "";
+  char hotSpotName[CONFIGURATION_MAX_SSID_LENGTH + 1] = "wifi-xBridge";
+  char hotSpotPassword[CONFIGURATION_MAX_PASSWORD_LENGTH + 1] = "";
 };
 
 class Configuration {
   public:
     Configuration();
-    void Testing();
-    void setTransmitterId(uint32_t transmitterId);
-    void setAppEngineAddress(String address);
-    void setDebugAddress(String address);
+    void begin();
+    void setTransmitterId(uint8_t port, uint32_t transmitterId);
+    void setAppEngineAddress(const char* address);
+    void setNightscoutAddress(const char* address);
+    void setNightscoutSecret(const char* secret);
+    void setLocalAddress(const char* address);
+    void setDebugAddress(const char* address);
     void setIsDebug(bool isDebug);
-    void setHotSpotName(String name);
-    void setHotSpotPass(String pass);
+    void setHotSpotName(const char* name);
+    void setHotSpotPass(const char* pass);
     bool getIsDebug();
-    void saveSSID(String ssidName, String ssidPassword);
-    void deleteSSID(String ssidName);
-    uint32_t getTransmitterId();
-    String getAppEngineAddress();
-    String getDebugAddress();
-    String getHotSpotName();
-    String getHotSpotPass();
+    bool saveSSID(const char* ssidName, const char* ssidPassword);
+    void deleteSSID(const char* ssidName);
+    int findSSID(const char* ssidName);
+    uint32_t getTransmitterId(uint8_t port);
+    const char* getAppEngineAddress();
+    const char* getNightscoutAddress();
+    const char* getNightscoutSecret();
+    const char* getLocalAddress();
+    const char* getDebugAddress();
+    const char* getHotSpotName();
+    const char* getHotSpotPass();
     void SaveConfig();
+    void loop();
+    uint32_t getVersion();
     int getWifiCount();
-    WifiData* getWifiData(int position);
+    const WifiData* getWifiData(int position);
   private:
-    BridgeConfig* LoadConfig();
-    void WriteEEPROM(int position, char data);
-    void WriteStringToEEPROM(int position, String data);
-    BridgeConfig* getBridgeConfig();
+    void LoadConfig();
+    bool LoadJournal(BridgeConfig* config);
+    bool ParseConfig(const uint8_t* record, unsigned int size, BridgeConfig* config);
+    void LoadLegacyConfig(BridgeConfig* config);
+    unsigned int SerializeConfig(const BridgeConfig* config, uint8_t* record);
+    void CompactJournal();
+    BridgeConfig* editConfig();
+    void publishConfig();
+    void setDirty();
+    bool addWifi(const char* ssidName, const char* ssidPassword);
     bool _loaded;
-    BridgeConfig *_bridgeConfig;
+    bool _dirty;
+    bool _compactionPending;
+    bool _compactionFailed;
+    unsigned long _compactionMillis;
+    uint32_t _journalSize;
+    uint32_t _version;
+    // Settings read by the getters, only replaced by publishConfig
+    const BridgeConfig* _current;
+    BridgeConfig _snapshots[2];
+    bool _editing;
+    // Saved wifi, in the order they were added
+    WifiData _wifiTable[CONFIGURATION_MAX_WIFI];
+    uint8_t _wifiCount;
     static DexcomHelper _dexcomHelper;
 };
 
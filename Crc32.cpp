@@ -0,0 +1,25 @@
+/*
+ * Crc32 - CRC-32 (IEEE 802.3) used to validate the data saved in flash
+ */
+#include "Crc32.h"
+
+/*
+ * Function: Crc32
+ * ---------------
+ * Compute the CRC-32 of a buffer. Can be chained by passing the previous result as crc
+ * data: The bytes to check
+ * length: Number of bytes
+ * crc: CRC of the previous bytes (0 to start)
+ * returns: The CRC-32 value
+ */
+uint32_t Crc32(const void* data, size_t length, uint32_t crc) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  crc = ~crc;
+  while (length--) {
+    crc ^= *bytes++;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
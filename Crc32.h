@@ -0,0 +1,8 @@
+#ifndef Crc32_h
+#define Crc32_h
+
+#include "Arduino.h"
+
+uint32_t Crc32(const void* data, size_t length, uint32_t crc = 0);
+
+#endif
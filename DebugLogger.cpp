@@ -0,0 +1,250 @@
+/*
+ * DebugLogger - Library for sending the debug text to the debug server without blocking the sketch
+ *
+ * Text is collected line by line and each complete line is copied in a RAM ring buffer with its
+ * time and level ("12345 D text"). loop() sends what the socket can take on one connection kept
+ * open to the configured debug address. When the ring buffer is full the new line is dropped and
+ * counted, a note with the number of dropped lines is sent once there is room again.
+ */
+#include "DebugLogger.h"
+
+static const char LOG_LEVEL_LETTERS[] = { 'D', 'I', 'W', 'E' };
+
+/*
+ * Constructor
+ */
+DebugLogger::DebugLogger() {
+  _configuration = NULL;
+  _level = LOG_DEBUG;
+  _lineLevel = LOG_DEBUG;
+  _lineLength = 0;
+  _lineMillis = 0;
+  _head = 0;
+  _tail = 0;
+  _used = 0;
+  _host[0] = '\0';
+  _configurationVersion = 0xFFFFFFFF;
+  _connectAttempted = false;
+  _lastConnectAttempt = 0;
+  _droppedLineCount = 0;
+  _unreportedDroppedLineCount = 0;
+}
+
+/*
+ * DebugLogger::setConfiguration
+ * -----------------------------
+ * This method will set the configuration holding the debug flag and the debug server address
+ * configuration: The shared configuration
+ */
+void DebugLogger::setConfiguration(Configuration* configuration) {
+  _configuration = configuration;
+}
+
+/*
+ * DebugLogger::setLevel
+ * ---------------------
+ * This method will set the lowest level kept, lines with a lower level are ignored
+ * level: The lowest level kept
+ */
+void DebugLogger::setLevel(LogLevel level) {
+  _level = level;
+}
+
+/*
+ * DebugLogger::isEnabled
+ * ----------------------
+ * This method will tell if text of the given level would be kept
+ * level: The level of the text
+ * returns: true if debugging is on and the level is kept
+ */
+bool DebugLogger::isEnabled(LogLevel level) {
+  return _configuration != NULL && _configuration->getIsDebug() && level >= _level;
+}
+
+/*
+ * DebugLogger::beginLine
+ * ----------------------
+ * This method will set the level of the current line. Lines are LOG_DEBUG unless told otherwise
+ * level: The level of the current line
+ */
+void DebugLogger::beginLine(LogLevel level) {
+  _lineLevel = level;
+}
+
+/*
+ * DebugLogger::write
+ * ------------------
+ * This method will add one character to the current line, never waiting for the network
+ * character: The character to add
+ * returns: 1 when the character was used
+ */
+size_t DebugLogger::write(uint8_t character) {
+  if (!isEnabled(_lineLevel)) {
+    if (character == '\n') {
+      _lineLevel = LOG_DEBUG;
+    }
+    return 1;
+  }
+  if (character == '\r') {
+    // Lines are sent with \r\n anyway
+    return 1;
+  }
+  if (character == '\n') {
+    commitLine();
+    return 1;
+  }
+  if (_lineLength == 0) {
+    _lineMillis = millis();
+  }
+  _line[_lineLength++] = character;
+  if (_lineLength == DEBUG_LOGGER_LINE_LENGTH) {
+    commitLine();
+  }
+  return 1;
+}
+
+/*
+ * DebugLogger::loop
+ * -----------------
+ * This method will send the buffered lines as far as the connection allows it
+ */
+void DebugLogger::loop() {
+  if (_configuration == NULL || !_configuration->getIsDebug()) {
+    // Debugging turned off, forget about it
+    if (_client.connected()) {
+      _client.stop();
+    }
+    _used = 0;
+    _head = 0;
+    _tail = 0;
+    _lineLength = 0;
+    return;
+  }
+  if (_configuration->getVersion() != _configurationVersion) {
+    _configurationVersion = _configuration->getVersion();
+    const char* debugAddress = _configuration->getDebugAddress();
+    if (strcmp(debugAddress, _host) != 0) {
+      // The debug server moved, the opened connection is of no use
+      _client.stop();
+      _connectAttempted = false;
+      strncpy(_host, debugAddress, DEBUG_LOGGER_MAX_HOST_LENGTH - 1);
+      _host[DEBUG_LOGGER_MAX_HOST_LENGTH - 1] = '\0';
+    }
+  }
+  if (_lineLength > 0 && millis() - _lineMillis > DEBUG_LOGGER_LINE_TIMEOUT) {
+    // Don't keep text that never gets its end of line
+    commitLine();
+  }
+  if (_used == 0 || _host[0] == '\0') {
+    return;
+  }
+  if (!_client.connected() && !connect()) {
+    return;
+  }
+
+  unsigned int budget = _client.availableForWrite();
+  if (budget > DEBUG_LOGGER_FLUSH_BUDGET) {
+    budget = DEBUG_LOGGER_FLUSH_BUDGET;
+  }
+  while (budget > 0 && _used > 0) {
+    // Only the part before the end of the ring buffer can be written at once
+    unsigned int length = DEBUG_LOGGER_BUFFER_SIZE - _tail;
+    if (length > _used) {
+      length = _used;
+    }
+    if (length > budget) {
+      length = budget;
+    }
+    size_t written = _client.write((const uint8_t*)&_buffer[_tail], length);
+    if (written == 0) {
+      break;
+    }
+    _tail = (_tail + written) % DEBUG_LOGGER_BUFFER_SIZE;
+    _used -= written;
+    budget -= written;
+  }
+}
+
+/*
+ * DebugLogger::getDroppedLineCount
+ * --------------------------------
+ * This method will return how many lines were dropped because the buffer was full
+ */
+uint32_t DebugLogger::getDroppedLineCount() {
+  return _droppedLineCount;
+}
+
+/*
+ * DebugLogger::commitLine
+ * -----------------------
+ * This method will copy the current line to the ring buffer or drop it when there is no room
+ */
+void DebugLogger::commitLine() {
+  char prefix[16];
+  char note[40];
+  unsigned int noteLength = 0;
+  if (_unreportedDroppedLineCount > 0) {
+    noteLength = snprintf(note, sizeof(note), "%lu W %lu lines dropped\r\n",
+                          (unsigned long)millis(), (unsigned long)_unreportedDroppedLineCount);
+  }
+  unsigned int prefixLength = snprintf(prefix, sizeof(prefix), "%lu %c ", _lineMillis, LOG_LEVEL_LETTERS[_lineLevel]);
+  if (_used + noteLength + prefixLength + _lineLength + 2 > DEBUG_LOGGER_BUFFER_SIZE) {
+    _droppedLineCount++;
+    _unreportedDroppedLineCount++;
+  }
+  else {
+    if (noteLength > 0) {
+      append(note, noteLength);
+      _unreportedDroppedLineCount = 0;
+    }
+    append(prefix, prefixLength);
+    append(_line, _lineLength);
+    append("\r\n", 2);
+  }
+  _lineLength = 0;
+  _lineLevel = LOG_DEBUG;
+}
+
+/*
+ * DebugLogger::append
+ * -------------------
+ * This method will copy text at the head of the ring buffer
+ * text: The text to copy
+ * length: The length of the text
+ * returns: false if there is not enough room
+ */
+bool DebugLogger::append(const char* text, unsigned int length) {
+  if (_used + length > DEBUG_LOGGER_BUFFER_SIZE) {
+    return false;
+  }
+  for (unsigned int i = 0; i < length; i++) {
+    _buffer[_head] = text[i];
+    _head = (_head + 1) % DEBUG_LOGGER_BUFFER_SIZE;
+  }
+  _used += length;
+  return true;
+}
+
+/*
+ * DebugLogger::connect
+ * --------------------
+ * This method will open the connection with the debug server, at most once every DEBUG_LOGGER_RETRY_INTERVAL
+ * returns: true if the connection is opened
+ */
+bool DebugLogger::connect() {
+  if (WiFi.status() != WL_CONNECTED) {
+    return false;
+  }
+  if (_connectAttempted && millis() - _lastConnectAttempt < DEBUG_LOGGER_RETRY_INTERVAL) {
+    return false;
+  }
+  _connectAttempted = true;
+  _lastConnectAttempt = millis();
+  // Keep the wait short when the debug server isn't listening
+  _client.setTimeout(DEBUG_LOGGER_CONNECT_TIMEOUT);
+  if (!_client.connect(_host, DEBUG_LOGGER_PORT)) {
+    return false;
+  }
+  _client.setNoDelay(false);
+  return true;
+}
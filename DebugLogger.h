@@ -0,0 +1,66 @@
+#ifndef DebugLogger_h
+#define DebugLogger_h
+
+#include <ESP8266WiFi.h>
+#include "Arduino.h"
+#include "Configuration.h"
+
+#define DEBUG_LOGGER_PORT 8001
+// RAM kept for the lines waiting to be sent
+#define DEBUG_LOGGER_BUFFER_SIZE 2048
+// Longer lines are split
+#define DEBUG_LOGGER_LINE_LENGTH 128
+// Delay in milliseconds before an unfinished line is sent anyway
+#define DEBUG_LOGGER_LINE_TIMEOUT 1000
+// Delay in milliseconds between two connection tries to the debug server
+#define DEBUG_LOGGER_RETRY_INTERVAL 10000
+#define DEBUG_LOGGER_CONNECT_TIMEOUT 500
+// Maximum bytes written to the socket by one loop
+#define DEBUG_LOGGER_FLUSH_BUDGET 512
+#define DEBUG_LOGGER_MAX_HOST_LENGTH (CONFIGURATION_MAX_ADDRESS_LENGTH + 1)
+
+enum LogLevel {
+  LOG_DEBUG,
+  LOG_INFO,
+  LOG_WARNING,
+  LOG_ERROR
+};
+
+/*
+ * Debug text sink. Lines are kept in RAM and sent from loop on one long-lived connection
+ */
+class DebugLogger : public Print {
+  public:
+    DebugLogger();
+    void setConfiguration(Configuration* configuration);
+    void setLevel(LogLevel level);
+    bool isEnabled(LogLevel level = LOG_DEBUG);
+    void beginLine(LogLevel level);
+    virtual size_t write(uint8_t character);
+    using Print::write;
+    void loop();
+    uint32_t getDroppedLineCount();
+  private:
+    void commitLine();
+    bool append(const char* text, unsigned int length);
+    bool connect();
+    Configuration* _configuration;
+    WiFiClient _client;
+    LogLevel _level;
+    LogLevel _lineLevel;
+    char _line[DEBUG_LOGGER_LINE_LENGTH];
+    unsigned int _lineLength;
+    unsigned long _lineMillis;
+    char _buffer[DEBUG_LOGGER_BUFFER_SIZE];
+    unsigned int _head;
+    unsigned int _tail;
+    unsigned int _used;
+    char _host[DEBUG_LOGGER_MAX_HOST_LENGTH];
+    uint32_t _configurationVersion;
+    bool _connectAttempted;
+    unsigned long _lastConnectAttempt;
+    uint32_t _droppedLineCount;
+    uint32_t _unreportedDroppedLineCount;
+};
+
+#endif
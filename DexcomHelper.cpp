@@ -1,29 +1,100 @@
 /*
  * DexcomHelper - Library for managing all helper methods for Dexcom
+ *
+ * A transmitter ID is 5 characters, each one is 5 bits of the src value sent by the Wixel (first
+ * character in the highest bits). Both conversions use tables built at compile time and write in
+ * buffers given by the caller, nothing is allocated.
  */
 #include "DexcomHelper.h"
+#include "Profiler.h"
 
- /* All possible values of Dexcom Transmitter ID Characters*/
-char DexcomHelper::SRC_NAME_TABLE[32] = { '0', '1', '2', '3', '4', '5', '6', '7',
+/* All possible values of Dexcom Transmitter ID Characters*/
+static constexpr char SRC_NAME_TABLE[32] = { '0', '1', '2', '3', '4', '5', '6', '7',
               '8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
               'G', 'H', 'J', 'K', 'L', 'M', 'N', 'P',
               'Q', 'R', 'S', 'T', 'U', 'W', 'X', 'Y' };
+
+/* Number of each ASCII character in SRC_NAME_TABLE, -1 if not allowed. Lower case is accepted */
+static constexpr int8_t SRC_NUMBER_TABLE[128] = {
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, 16, 17, -1, 18, 19, 20, 21, 22, -1,
+  23, 24, 25, 26, 27, 28, -1, 29, 30, 31, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, 16, 17, -1, 18, 19, 20, 21, 22, -1,
+  23, 24, 25, 26, 27, 28, -1, 29, 30, 31, -1, -1, -1, -1, -1, -1
+};
+
 /*
- * Function: DexcomSrcToAscii
- * -------------------------
- * Transform the uint32_t value of the Dexcom transmitter back to Ascii format
- * src: The special src value representing the Transmitter ID
+ * IsReverseOf
+ * -----------
+ * Check at compile time that SRC_NUMBER_TABLE gives back the position of every SRC_NAME_TABLE character
+ * and that exactly 32 upper case characters are allowed
  */
-char* DexcomHelper::DexcomSrcToAscii(uint32_t src)
-{
-  char* transmitterId = (char*) malloc(sizeof(char) * 6);
+static constexpr bool IsReverseOf(int position) {
+  return position == 32 ||
+         (SRC_NUMBER_TABLE[(int)SRC_NAME_TABLE[position]] == position && IsReverseOf(position + 1));
+}
+
+static constexpr int CountUpperCaseNumbers(int character) {
+  return character == 128 ? 0 :
+         (character < 'a' && SRC_NUMBER_TABLE[character] >= 0 ? 1 : 0) + CountUpperCaseNumbers(character + 1);
+}
+
+static_assert(IsReverseOf(0), "SRC_NUMBER_TABLE does not match SRC_NAME_TABLE");
+static_assert(CountUpperCaseNumbers(0) == 32, "SRC_NUMBER_TABLE allows characters not in SRC_NAME_TABLE");
+
+/*
+ * EncodeId
+ * --------
+ * Write the 5 characters of a src value and the NUL
+ */
+static inline void EncodeId(uint32_t src, char* transmitterId) {
   transmitterId[0] = SRC_NAME_TABLE[(src >> 20) & 0x1F];
   transmitterId[1] = SRC_NAME_TABLE[(src >> 15) & 0x1F];
   transmitterId[2] = SRC_NAME_TABLE[(src >> 10) & 0x1F];
   transmitterId[3] = SRC_NAME_TABLE[(src >> 5) & 0x1F];
   transmitterId[4] = SRC_NAME_TABLE[(src >> 0) & 0x1F];
   transmitterId[5] = '\0';
-  return transmitterId;
+}
+
+/*
+ * DecodeId
+ * --------
+ * Read the src value of a transmitter ID, src is only written when the ID is valid
+ */
+static inline DexcomIdStatus DecodeId(const char* transmitterId, uint32_t* src) {
+  uint32_t value = 0;
+  for (int i = 0; i < DEXCOM_ID_LENGTH; i++) {
+    unsigned char character = transmitterId[i];
+    if (character == '\0') {
+      return DEXCOM_ID_BAD_LENGTH;
+    }
+    int8_t number = character < 128 ? SRC_NUMBER_TABLE[character] : -1;
+    if (number < 0) {
+      return DEXCOM_ID_BAD_CHARACTER;
+    }
+    value = (value << 5) | number;
+  }
+  if (transmitterId[DEXCOM_ID_LENGTH] != '\0') {
+    return DEXCOM_ID_BAD_LENGTH;
+  }
+  *src = value;
+  return DEXCOM_ID_VALID;
+}
+
+/*
+ * Function: DexcomSrcToAscii
+ * -------------------------
+ * Transform the uint32_t value of the Dexcom transmitter back to Ascii format
+ * src: The special src value representing the Transmitter ID, only the 25 low bits are used
+ * transmitterId: Where to write the Transmitter ID, DEXCOM_ID_LENGTH + 1 characters
+ */
+void DexcomHelper::DexcomSrcToAscii(uint32_t src, char* transmitterId)
+{
+  ProfilerScope profile(PROFILE_DEXCOM_SRC_TO_ASCII);
+  EncodeId(src, transmitterId);
 }
 
 /*
@@ -31,17 +102,47 @@ char* DexcomHelper::DexcomSrcToAscii(uint32_t src)
  * -------------------------
  * Transform the Dexcom Ascii format to Src value (unsigned int32)
  * transmitterId: The transmitter Id to transform
- * returns: The src value corresponding to this DexCom Transmitter ID
+ * src: Where to save the src value corresponding to this DexCom Transmitter ID, unchanged if invalid
+ * returns: DEXCOM_ID_VALID, or why the transmitter Id is not valid
+ */
+DexcomIdStatus DexcomHelper::DexcomAsciiToSrc(const char* transmitterId, uint32_t* src)
+{
+  ProfilerScope profile(PROFILE_DEXCOM_ASCII_TO_SRC);
+  return DecodeId(transmitterId, src);
+}
+
+/*
+ * Function: DexcomSrcToAscii
+ * -------------------------
+ * Transform many src values, without profiling each one
+ * srcs: The src values
+ * transmitterIds: Where to write the Transmitter IDs
+ * count: Number of src values
  */
-uint32_t DexcomHelper::DexcomAsciiToSrc(char* transmitterId)
+void DexcomHelper::DexcomSrcToAscii(const uint32_t* srcs, char (*transmitterIds)[DEXCOM_ID_LENGTH + 1], unsigned int count)
 {
-  uint32_t returnValue = 0;
-  returnValue ^= TransmitterIdCharacterNumber(transmitterId[0]) << 20;
-  returnValue ^= TransmitterIdCharacterNumber((uint32_t)transmitterId[1]) << 15;
-  returnValue ^= TransmitterIdCharacterNumber((uint32_t)transmitterId[2]) << 10;
-  returnValue ^= TransmitterIdCharacterNumber((uint32_t)transmitterId[3]) << 5;
-  returnValue ^= TransmitterIdCharacterNumber((uint32_t)transmitterId[4]) << 0;
-  return returnValue;
+  for (unsigned int i = 0; i < count; i++) {
+    EncodeId(srcs[i], transmitterIds[i]);
+  }
+}
+
+/*
+ * Function: DexcomAsciiToSrc
+ * -------------------------
+ * Transform many Transmitter IDs, without profiling each one. Stops at the first invalid one
+ * transmitterIds: The Transmitter IDs
+ * srcs: Where to save the src values
+ * count: Number of Transmitter IDs
+ * returns: Number of Transmitter IDs transformed, the position of the invalid one if less than count
+ */
+unsigned int DexcomHelper::DexcomAsciiToSrc(const char (*transmitterIds)[DEXCOM_ID_LENGTH + 1], uint32_t* srcs, unsigned int count)
+{
+  for (unsigned int i = 0; i < count; i++) {
+    if (DecodeId(transmitterIds[i], &srcs[i]) != DEXCOM_ID_VALID) {
+      return i;
+    }
+  }
+  return count;
 }
 
 /*
@@ -49,25 +150,36 @@ uint32_t DexcomHelper::DexcomAsciiToSrc(char* transmitterId)
  * --------------------------------------
  * Return the character number of the specifier char
  * character: Transmitter ID character
- * returns: Number of that character in the SRC_NAME_TABLE array
+ * returns: Number of that character in the SRC_NAME_TABLE array, -1 if it is not allowed
  */
-uint32_t DexcomHelper::TransmitterIdCharacterNumber(char character)
+int DexcomHelper::TransmitterIdCharacterNumber(char character)
 {
-  for(int i = 0; i < 32; i++)
-  {
-    if (SRC_NAME_TABLE[i] == character)
-    {
-      return i;
-    }
-  }
+  unsigned char index = character;
+  return index < 128 ? SRC_NUMBER_TABLE[index] : -1;
 }
 
+/*
+ * Function: getStatusText
+ * -----------------------
+ * Return a message for the validation result
+ */
+const char* DexcomHelper::getStatusText(DexcomIdStatus status)
+{
+  switch (status) {
+    case DEXCOM_ID_VALID:
+      return "Valid transmitter ID";
+    case DEXCOM_ID_BAD_LENGTH:
+      return "transmitterId must have 5 characters";
+    default:
+      return "transmitterId has a character not used by Dexcom (I, O, V, Z)";
+  }
+}
 
 /*
  * Function: IntToCharArray
  * ------------------------
  * Transform value from int to a char array [5]
- * 
+ *
  * value: The int value to transform
  * result: The char array to write to
  */
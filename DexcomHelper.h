@@ -3,15 +3,29 @@
 
 #include "Arduino.h"
 
+// Number of characters of a transmitter ID, without the NUL
+#define DEXCOM_ID_LENGTH 5
+// A src value has 5 bits per character
+#define DEXCOM_SRC_MASK 0x1FFFFFF
+
+/*
+ * Result of the transmitter ID validation
+ */
+enum DexcomIdStatus {
+  DEXCOM_ID_VALID,
+  DEXCOM_ID_BAD_LENGTH,
+  DEXCOM_ID_BAD_CHARACTER
+};
+
 class DexcomHelper {
   public:
     void IntToCharArray(unsigned int value, char* result);
-    uint32_t TransmitterIdCharacterNumber(char character);
-    uint32_t DexcomAsciiToSrc(char* transmitterId);
-    char* DexcomSrcToAscii(uint32_t src);
-    
-  private:
-     static char SRC_NAME_TABLE[32];
+    int TransmitterIdCharacterNumber(char character);
+    DexcomIdStatus DexcomAsciiToSrc(const char* transmitterId, uint32_t* src);
+    void DexcomSrcToAscii(uint32_t src, char* transmitterId);
+    unsigned int DexcomAsciiToSrc(const char (*transmitterIds)[DEXCOM_ID_LENGTH + 1], uint32_t* srcs, unsigned int count);
+    void DexcomSrcToAscii(const uint32_t* srcs, char (*transmitterIds)[DEXCOM_ID_LENGTH + 1], unsigned int count);
+    static const char* getStatusText(DexcomIdStatus status);
 };
 
 #endif
@@ -0,0 +1,512 @@
+/*
+ * HttpClient - Library for sending requests to an upload server on a persistent connection without blocking
+ *
+ * IDLE -> [RESOLVING] -> CONNECTING -> SENDING -> AWAITING_HEADERS -> READING_BODY -> DONE
+ * Any step can end in FAILED (connection error or HTTP_CLIENT_RESPONSE_TIMEOUT).
+ * DONE and FAILED stay until finish() is called so the caller can read the status.
+ *
+ * WiFiClient::connect and the name lookup block until they are done, so each one is a step of its own, taken
+ * at different calls to loop, with a short timeout. The server address is kept and only looked up again after
+ * HTTP_CLIENT_ADDRESS_LIFETIME or a failed connection. The caller can hold these steps back (mayConnect) so that
+ * several clients don't block the same loop one after the other.
+ *
+ * The response is read by blocks of HTTP_CLIENT_READ_BUFFER_SIZE and parsed byte by byte: the status line and
+ * the headers go through a line buffer, body bytes are skipped. The request is DONE as soon as the last byte
+ * given by Content-Length or the last chunk is read, so the connection can be reused without waiting.
+ */
+#include "HttpClient.h"
+#include "Metrics.h"
+
+/*
+ * Constructor
+ */
+HttpClient::HttpClient() {
+  _state = HTTP_IDLE;
+  _host[0] = '\0';
+  _port = HTTP_PORT;
+  _addressKnown = false;
+  _addressMillis = 0;
+  _request[0] = '\0';
+  _requestLength = 0;
+  _linePosition = 0;
+  _startMillis = 0;
+  _bodyEncoding = HTTP_BODY_UNTIL_CLOSE;
+  _chunkStep = HTTP_CHUNK_SIZE;
+  _bodyRemaining = 0;
+  _status = -1;
+  _keepAlive = false;
+  _reused = false;
+  _retried = false;
+  _blocked = false;
+  _reuseCount = 0;
+  _reconnectCount = 0;
+  _failedConnectionCount = 0;
+  _timeoutCount = 0;
+}
+
+/*
+ * HttpClient::begin
+ * -----------------
+ * This method will write a request in the request buffer. Call loop until the state is DONE or FAILED
+ * host: The server host name
+ * port: The server port
+ * method: GET or POST
+ * path: The path and query to request
+ * headers: More header lines, each one ending with \r\n, or NULL
+ * body: The body sent with its Content-Length, or NULL
+ * returns: false if a request is already running or if the request is longer than HTTP_CLIENT_MAX_REQUEST_LENGTH
+ */
+bool HttpClient::begin(const char* host, uint16_t port, const char* method, const char* path, const char* headers, const char* body) {
+  if (isBusy()) {
+    return false;
+  }
+  if (strcmp(_host, host) != 0 || _port != port) {
+    // Server changed, the opened connection can't be used
+    stop();
+    strncpy(_host, host, HTTP_CLIENT_MAX_HOST_LENGTH - 1);
+    _host[HTTP_CLIENT_MAX_HOST_LENGTH - 1] = '\0';
+    _port = port;
+    _addressKnown = false;
+  }
+  // RFC 7230: the port is part of the Host header when it is not the default one
+  char portText[7] = "";
+  if (port != HTTP_PORT) {
+    snprintf(portText, sizeof(portText), ":%u", port);
+  }
+  int length = snprintf(_request, sizeof(_request), "%s %s HTTP/1.1\r\nHost: %s%s\r\nConnection: keep-alive\r\n%s",
+                        method, path, host, portText, headers != NULL ? headers : "");
+  if (length >= 0 && length < (int)sizeof(_request)) {
+    if (body != NULL) {
+      length += snprintf(&_request[length], sizeof(_request) - length, "Content-Length: %u\r\n\r\n%s",
+                         (unsigned int)strlen(body), body);
+    }
+    else {
+      length += snprintf(&_request[length], sizeof(_request) - length, "\r\n");
+    }
+  }
+  if (length < 0 || length >= (int)sizeof(_request)) {
+    // Truncated, sending it would break the connection
+    _request[0] = '\0';
+    _requestLength = 0;
+    return false;
+  }
+  _requestLength = length;
+  _status = -1;
+  _retried = false;
+  _startMillis = millis();
+  _state = HTTP_CONNECTING;
+  return true;
+}
+
+/*
+ * HttpClient::loop
+ * ----------------
+ * This method will move the request forward without waiting for the server
+ * mayConnect: false to wait before the name lookup or a new connection, the steps which block
+ * returns: The state of the request
+ */
+HttpRequestState HttpClient::loop(bool mayConnect) {
+  _blocked = false;
+  if (!isBusy()) {
+    return _state;
+  }
+  if (millis() - _startMillis > HTTP_CLIENT_RESPONSE_TIMEOUT) {
+    _timeoutCount++;
+    Metrics::count(METRIC_UPLOAD_TIMEOUTS);
+    fail();
+    return _state;
+  }
+  switch (_state) {
+    case HTTP_RESOLVING:
+      if (!mayConnect) {
+        break;
+      }
+      if (resolve()) {
+        _state = HTTP_CONNECTING;
+      }
+      else {
+        fail();
+      }
+      break;
+    case HTTP_CONNECTING:
+      if (_keepAlive && _client.connected()) {
+        _reused = true;
+        _reuseCount++;
+        _state = HTTP_SENDING;
+      }
+      else if (!_addressKnown || millis() - _addressMillis > HTTP_CLIENT_ADDRESS_LIFETIME) {
+        // Looked up at the next call, the lookup and the connection never block the same loop
+        _state = HTTP_RESOLVING;
+      }
+      else if (!mayConnect) {
+        break;
+      }
+      else if (connect()) {
+        _state = HTTP_SENDING;
+      }
+      else {
+        fail();
+      }
+      break;
+    case HTTP_SENDING:
+      // The request and its body are small enough to fit in one TCP segment
+      if (_client.write((const uint8_t*)_request, _requestLength) != _requestLength) {
+        fail();
+        break;
+      }
+      _linePosition = 0;
+      _bodyEncoding = HTTP_BODY_UNTIL_CLOSE;
+      _bodyRemaining = 0;
+      _state = HTTP_AWAITING_HEADERS;
+      break;
+    case HTTP_AWAITING_HEADERS:
+    case HTTP_READING_BODY:
+      readResponse();
+      break;
+    default:
+      break;
+  }
+  return _state;
+}
+
+/*
+ * HttpClient::resolve
+ * -------------------
+ * This method will look up the server address, at once if the host is an IP address
+ * returns: true if the address is known
+ */
+bool HttpClient::resolve() {
+  _reused = false;
+  _blocked = true;
+  if (WiFi.status() != WL_CONNECTED || !WiFi.hostByName(_host, _address, HTTP_CLIENT_DNS_TIMEOUT)) {
+    _addressKnown = false;
+    _failedConnectionCount++;
+    return false;
+  }
+  _addressKnown = true;
+  _addressMillis = millis();
+  return true;
+}
+
+/*
+ * HttpClient::connect
+ * -------------------
+ * This method will open a new connection to the known server address
+ * returns: true if connected
+ */
+bool HttpClient::connect() {
+  _reused = false;
+  _blocked = true;
+  _client.stop();
+  _keepAlive = false;
+  // Applies to the connection too, the server may be down or the address outdated
+  _client.setTimeout(HTTP_CLIENT_CONNECT_TIMEOUT);
+  if (WiFi.status() != WL_CONNECTED || !_client.connect(_address, _port)) {
+    // Looked up again before the next try
+    _addressKnown = false;
+    _failedConnectionCount++;
+    return false;
+  }
+  _client.setNoDelay(true);
+  _keepAlive = true;
+  _reconnectCount++;
+  Metrics::count(METRIC_UPLOAD_RECONNECTS);
+  return true;
+}
+
+/*
+ * HttpClient::fail
+ * ----------------
+ * This method will close the connection. A reused connection closed by the server is opened again once.
+ */
+void HttpClient::fail() {
+  _client.stop();
+  _keepAlive = false;
+  if (_reused && !_retried && _status < 0 && millis() - _startMillis <= HTTP_CLIENT_RESPONSE_TIMEOUT) {
+    _retried = true;
+    _state = HTTP_CONNECTING;
+    return;
+  }
+  _state = HTTP_FAILED;
+}
+
+/*
+ * HttpClient::readResponse
+ * ------------------------
+ * This method will parse the bytes already received, at most HTTP_CLIENT_LOOP_BUDGET of them
+ */
+void HttpClient::readResponse() {
+  uint8_t buffer[HTTP_CLIENT_READ_BUFFER_SIZE];
+  int budget = HTTP_CLIENT_LOOP_BUDGET;
+  while (budget > 0 && (_state == HTTP_AWAITING_HEADERS || _state == HTTP_READING_BODY)) {
+    int available = _client.available();
+    if (available <= 0) {
+      if (!_client.connected()) {
+        if (_state == HTTP_READING_BODY && _bodyEncoding == HTTP_BODY_UNTIL_CLOSE) {
+          _state = HTTP_DONE;
+        }
+        else {
+          fail();
+        }
+      }
+      return;
+    }
+    int toRead = available < budget ? available : budget;
+    if (toRead > (int)sizeof(buffer)) {
+      toRead = sizeof(buffer);
+    }
+    int read = _client.read(buffer, toRead);
+    if (read <= 0) {
+      return;
+    }
+    budget -= read;
+    if (parse(buffer, read) < (size_t)read && _state == HTTP_DONE) {
+      // Bytes after the end of the response, the next one would start in the middle of them
+      _keepAlive = false;
+    }
+  }
+}
+
+/*
+ * HttpClient::parse
+ * -----------------
+ * This method will move the response parser forward
+ * data: Bytes received
+ * length: Number of bytes received
+ * returns: Number of bytes used, less than length when the response ended or the request failed before the last one
+ */
+size_t HttpClient::parse(const uint8_t* data, size_t length) {
+  size_t position = 0;
+  while (position < length && (_state == HTTP_AWAITING_HEADERS || _state == HTTP_READING_BODY)) {
+    if (_state == HTTP_READING_BODY && (_bodyEncoding != HTTP_BODY_CHUNKED || _chunkStep == HTTP_CHUNK_DATA)) {
+      // The body is not used, its bytes are skipped at once
+      size_t skipped = length - position;
+      if (_bodyEncoding == HTTP_BODY_UNTIL_CLOSE) {
+        position += skipped;
+        continue;
+      }
+      if (skipped > _bodyRemaining) {
+        skipped = _bodyRemaining;
+      }
+      position += skipped;
+      _bodyRemaining -= skipped;
+      if (_bodyRemaining == 0) {
+        if (_bodyEncoding == HTTP_BODY_LENGTH) {
+          _state = HTTP_DONE;
+        }
+        else {
+          _chunkStep = HTTP_CHUNK_DATA_END;
+        }
+      }
+      continue;
+    }
+    char character = data[position++];
+    if (character == '\n') {
+      _line[_linePosition] = '\0';
+      _linePosition = 0;
+      if (_state == HTTP_READING_BODY) {
+        processChunkLine();
+      }
+      else {
+        processLine();
+      }
+    }
+    else if (character != '\r' && _linePosition < HTTP_CLIENT_MAX_LINE_LENGTH - 1) {
+      // Longer lines are truncated
+      _line[_linePosition++] = character;
+    }
+  }
+  return position;
+}
+
+/*
+ * HttpClient::processLine
+ * -----------------------
+ * This method will handle the status line or one header line
+ */
+void HttpClient::processLine() {
+  if (_status < 0) {
+    // HTTP/1.x, a space, three digits then the end of the line or a space before the reason
+    if (strlen(_line) < 12 || strncmp(_line, "HTTP/1.", 7) != 0 || _line[8] != ' ' ||
+        !isdigit((unsigned char)_line[9]) || !isdigit((unsigned char)_line[10]) || !isdigit((unsigned char)_line[11]) ||
+        (_line[12] != '\0' && _line[12] != ' ')) {
+      fail();
+      return;
+    }
+    _status = (_line[9] - '0') * 100 + (_line[10] - '0') * 10 + (_line[11] - '0');
+  }
+  else if (_line[0] == '\0') {
+    endHeaders();
+  }
+  else if (strncasecmp(_line, "Content-Length:", 15) == 0) {
+    // Transfer-Encoding wins over Content-Length
+    if (_bodyEncoding != HTTP_BODY_CHUNKED) {
+      _bodyEncoding = HTTP_BODY_LENGTH;
+      _bodyRemaining = strtoul(&_line[15], NULL, 10);
+    }
+  }
+  else if (strncasecmp(_line, "Transfer-Encoding:", 18) == 0 && strstr(_line, "chunked") != NULL) {
+    _bodyEncoding = HTTP_BODY_CHUNKED;
+  }
+  else if (strncasecmp(_line, "Connection:", 11) == 0 && strstr(_line, "close") != NULL) {
+    _keepAlive = false;
+  }
+}
+
+/*
+ * HttpClient::endHeaders
+ * ----------------------
+ * This method will find how the body ends once the empty line after the headers is read
+ */
+void HttpClient::endHeaders() {
+  if (_status >= 100 && _status < 200) {
+    // 100 Continue: the real response follows
+    _status = -1;
+    _bodyEncoding = HTTP_BODY_UNTIL_CLOSE;
+    return;
+  }
+  if (_status == 204 || _status == 304 || (_bodyEncoding == HTTP_BODY_LENGTH && _bodyRemaining == 0)) {
+    _state = HTTP_DONE;
+    return;
+  }
+  if (_bodyEncoding == HTTP_BODY_UNTIL_CLOSE) {
+    // The connection can't be reused
+    _keepAlive = false;
+  }
+  _chunkStep = HTTP_CHUNK_SIZE;
+  _state = HTTP_READING_BODY;
+}
+
+/*
+ * HttpClient::processChunkLine
+ * ----------------------------
+ * This method will handle a chunk size, the end of a chunk data or a trailer line
+ */
+void HttpClient::processChunkLine() {
+  switch (_chunkStep) {
+    case HTTP_CHUNK_SIZE: {
+      // Chunk extensions after ';' are ignored
+      char* end;
+      unsigned long size = strtoul(_line, &end, 16);
+      if (end == _line) {
+        fail();
+      }
+      else if (size == 0) {
+        _chunkStep = HTTP_CHUNK_TRAILER;
+      }
+      else {
+        _bodyRemaining = size;
+        _chunkStep = HTTP_CHUNK_DATA;
+      }
+      break;
+    }
+    case HTTP_CHUNK_DATA_END:
+      if (_line[0] != '\0') {
+        fail();
+        break;
+      }
+      _chunkStep = HTTP_CHUNK_SIZE;
+      break;
+    case HTTP_CHUNK_TRAILER:
+      if (_line[0] == '\0') {
+        _state = HTTP_DONE;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/*
+ * HttpClient::finish
+ * ------------------
+ * This method will get ready for the next request once the result of this one was read
+ */
+void HttpClient::finish() {
+  if (_state == HTTP_DONE && !_keepAlive) {
+    _client.stop();
+  }
+  _state = HTTP_IDLE;
+}
+
+/*
+ * HttpClient::stop
+ * ----------------
+ * This method will close the connection
+ */
+void HttpClient::stop() {
+  _client.stop();
+  _keepAlive = false;
+}
+
+/*
+ * HttpClient::getState
+ * --------------------
+ * returns: The state of the current request
+ */
+HttpRequestState HttpClient::getState() {
+  return _state;
+}
+
+/*
+ * HttpClient::isBusy
+ * ------------------
+ * returns: true while a request is running
+ */
+bool HttpClient::isBusy() {
+  return _state != HTTP_IDLE && _state != HTTP_DONE && _state != HTTP_FAILED;
+}
+
+/*
+ * HttpClient::hasBlocked
+ * ----------------------
+ * returns: true if the last loop call looked up the server or opened a connection
+ */
+bool HttpClient::hasBlocked() {
+  return _blocked;
+}
+
+/*
+ * HttpClient::getStatus
+ * ---------------------
+ * returns: The HTTP status code of the last response or -1 if it failed
+ */
+int HttpClient::getStatus() {
+  return _state == HTTP_DONE ? _status : -1;
+}
+
+/*
+ * HttpClient::getReuseCount
+ * -------------------------
+ * returns: Number of requests sent on an already opened connection
+ */
+uint32_t HttpClient::getReuseCount() {
+  return _reuseCount;
+}
+
+/*
+ * HttpClient::getReconnectCount
+ * -----------------------------
+ * returns: Number of connections opened
+ */
+uint32_t HttpClient::getReconnectCount() {
+  return _reconnectCount;
+}
+
+/*
+ * HttpClient::getFailedConnectionCount
+ * ------------------------------------
+ * returns: Number of connections that could not be opened
+ */
+uint32_t HttpClient::getFailedConnectionCount() {
+  return _failedConnectionCount;
+}
+
+/*
+ * HttpClient::getTimeoutCount
+ * ---------------------------
+ * returns: Number of requests without a complete response after HTTP_CLIENT_RESPONSE_TIMEOUT
+ */
+uint32_t HttpClient::getTimeoutCount() {
+  return _timeoutCount;
+}
@@ -0,0 +1,114 @@
+#ifndef HttpClient_h
+#define HttpClient_h
+
+#include <ESP8266WiFi.h>
+#include "Arduino.h"
+
+#define HTTP_PORT 80
+// Delay in milliseconds to wait for the server response
+#define HTTP_CLIENT_RESPONSE_TIMEOUT 5000
+// The connection and the name lookup block the main loop, a server which does not answer gives up after this
+#define HTTP_CLIENT_CONNECT_TIMEOUT 1000
+#define HTTP_CLIENT_DNS_TIMEOUT 1000
+// Delay in milliseconds before the address of the server is looked up again
+#define HTTP_CLIENT_ADDRESS_LIFETIME 3600000
+#define HTTP_CLIENT_MAX_HOST_LENGTH 128
+#define HTTP_CLIENT_MAX_LINE_LENGTH 128
+// Size of the request line, the headers and the body, written in one buffer and sent in one write
+#define HTTP_CLIENT_MAX_REQUEST_LENGTH 768
+// Bytes added by the client around the method, path, host, headers and body
+#define HTTP_CLIENT_REQUEST_OVERHEAD 80
+// Maximum number of response bytes handled by each call to loop
+#define HTTP_CLIENT_LOOP_BUDGET 256
+// Response bytes read from the connection at once
+#define HTTP_CLIENT_READ_BUFFER_SIZE 64
+
+/*
+ * All the steps of a request
+ */
+enum HttpRequestState {
+  HTTP_IDLE,
+  HTTP_RESOLVING, // Looking up the server address, only when it is not known
+  HTTP_CONNECTING,
+  HTTP_SENDING,
+  HTTP_AWAITING_HEADERS,
+  HTTP_READING_BODY,
+  HTTP_DONE,
+  HTTP_FAILED
+};
+
+/*
+ * How the end of the response body is found
+ */
+enum HttpBodyEncoding {
+  HTTP_BODY_LENGTH, // Content-Length bytes
+  HTTP_BODY_CHUNKED, // Transfer-Encoding: chunked, ends with an empty chunk
+  HTTP_BODY_UNTIL_CLOSE // No length, ends when the server closes the connection
+};
+
+/*
+ * Where the parser is in a chunked body
+ */
+enum HttpChunkStep {
+  HTTP_CHUNK_SIZE,
+  HTTP_CHUNK_DATA,
+  HTTP_CHUNK_DATA_END,
+  HTTP_CHUNK_TRAILER
+};
+
+/*
+ * Send requests to one server on one HTTP/1.1 keep-alive connection.
+ * A request is started with begin and moves forward a little at each call to loop, so it never blocks the main loop.
+ * Nothing is allocated: the request is written in a fixed buffer and the response is parsed as its bytes arrive.
+ */
+class HttpClient {
+  public:
+    HttpClient();
+    bool begin(const char* host, uint16_t port, const char* method, const char* path, const char* headers, const char* body);
+    HttpRequestState loop(bool mayConnect);
+    HttpRequestState getState();
+    bool isBusy();
+    bool hasBlocked();
+    int getStatus();
+    void finish();
+    void stop();
+    uint32_t getReuseCount();
+    uint32_t getReconnectCount();
+    uint32_t getFailedConnectionCount();
+    uint32_t getTimeoutCount();
+  private:
+    bool resolve();
+    bool connect();
+    void fail();
+    void readResponse();
+    size_t parse(const uint8_t* data, size_t length);
+    void processLine();
+    void processChunkLine();
+    void endHeaders();
+    WiFiClient _client;
+    HttpRequestState _state;
+    char _host[HTTP_CLIENT_MAX_HOST_LENGTH];
+    uint16_t _port;
+    IPAddress _address;
+    bool _addressKnown;
+    unsigned long _addressMillis;
+    char _request[HTTP_CLIENT_MAX_REQUEST_LENGTH];
+    size_t _requestLength;
+    char _line[HTTP_CLIENT_MAX_LINE_LENGTH];
+    unsigned int _linePosition;
+    unsigned long _startMillis;
+    HttpBodyEncoding _bodyEncoding;
+    HttpChunkStep _chunkStep;
+    uint32_t _bodyRemaining;
+    int _status;
+    bool _keepAlive;
+    bool _reused;
+    bool _retried;
+    bool _blocked;
+    uint32_t _reuseCount;
+    uint32_t _reconnectCount;
+    uint32_t _failedConnectionCount;
+    uint32_t _timeoutCount;
+};
+
+#endif
@@ -0,0 +1,319 @@
+/*
+ * JsonParser - Library for reading a flat JSON object without allocating
+ *
+ * Only the members of one object are read: a nested object or array, a value too long for the
+ * caller buffer or any syntax error stops the parsing and hasError() returns true.
+ * Numbers, true, false and null are returned as text with their type.
+ */
+#include "JsonParser.h"
+
+/*
+ * Constructor
+ * text: The JSON text, NUL terminated. Must stay valid while parsing
+ */
+JsonParser::JsonParser(const char* text) {
+  _text = text;
+  rewind();
+}
+
+/*
+ * JsonParser::rewind
+ * ------------------
+ * This method will start again from the first member, so the object can be read twice
+ */
+void JsonParser::rewind() {
+  _position = _text;
+  _started = false;
+  _ended = false;
+  _error = false;
+}
+
+/*
+ * JsonParser::nextMember
+ * ----------------------
+ * This method will read the next member of the object
+ * key: Where to copy the member name
+ * keySize: Size of the key buffer
+ * value: Where to copy the value, unescaped for a string
+ * valueSize: Size of the value buffer
+ * type: Where to save the type of the value
+ * returns: false at the end of the object or on error (see hasError)
+ */
+bool JsonParser::nextMember(char* key, size_t keySize, char* value, size_t valueSize, JsonType* type) {
+  if (_ended || _error) {
+    return false;
+  }
+  skipSpaces();
+  if (!_started) {
+    if (*_position != '{') {
+      return fail();
+    }
+    _position++;
+    _started = true;
+    skipSpaces();
+    if (*_position == '}') {
+      _ended = true;
+      return false;
+    }
+  }
+  else if (*_position == ',') {
+    _position++;
+    skipSpaces();
+  }
+  else if (*_position == '}') {
+    _ended = true;
+    return false;
+  }
+  else {
+    return fail();
+  }
+
+  if (!readString(key, keySize)) {
+    return fail();
+  }
+  skipSpaces();
+  if (*_position != ':') {
+    return fail();
+  }
+  _position++;
+  skipSpaces();
+  if (*_position == '"') {
+    if (!readString(value, valueSize)) {
+      return fail();
+    }
+    *type = JSON_STRING;
+  }
+  else if (!readLiteral(value, valueSize, type)) {
+    return fail();
+  }
+  skipSpaces();
+  if (*_position != ',' && *_position != '}') {
+    return fail();
+  }
+  return true;
+}
+
+/*
+ * JsonParser::hasError
+ * --------------------
+ * This method will tell if the parsing stopped on an error
+ */
+bool JsonParser::hasError() {
+  return _error;
+}
+
+/*
+ * JsonParser::skipSpaces
+ * ----------------------
+ * This method will move after the white spaces
+ */
+void JsonParser::skipSpaces() {
+  while (*_position == ' ' || *_position == '\t' || *_position == '\r' || *_position == '\n') {
+    _position++;
+  }
+}
+
+/*
+ * JsonParser::readString
+ * ----------------------
+ * This method will copy a quoted string, without its quotes and unescaped (\uXXXX to UTF-8)
+ * result: Where to copy the string
+ * size: Size of the result buffer
+ * returns: false if the string is invalid or too long
+ */
+bool JsonParser::readString(char* result, size_t size) {
+  if (*_position != '"') {
+    return false;
+  }
+  _position++;
+  size_t length = 0;
+  if (size > 0) {
+    result[0] = '\0';
+  }
+  while (*_position != '"') {
+    char character = *_position++;
+    if (character == '\0' || (unsigned char)character < 0x20) {
+      return false;
+    }
+    if (character != '\\') {
+      if (!append(result, size, &length, character)) {
+        return false;
+      }
+      continue;
+    }
+    character = *_position++;
+    switch (character) {
+      case '"':
+      case '\\':
+      case '/':
+        break;
+      case 'b': character = '\b'; break;
+      case 'f': character = '\f'; break;
+      case 'n': character = '\n'; break;
+      case 'r': character = '\r'; break;
+      case 't': character = '\t'; break;
+      case 'u': {
+        uint16_t code = 0;
+        for (int i = 0; i < 4; i++) {
+          char digit = *_position++;
+          code <<= 4;
+          if (digit >= '0' && digit <= '9') {
+            code |= digit - '0';
+          }
+          else if (digit >= 'a' && digit <= 'f') {
+            code |= digit - 'a' + 10;
+          }
+          else if (digit >= 'A' && digit <= 'F') {
+            code |= digit - 'A' + 10;
+          }
+          else {
+            return false;
+          }
+        }
+        if (code == 0) {
+          return false;
+        }
+        // Surrogate pairs are not combined, each half is encoded on its own
+        if (code < 0x80) {
+          character = code;
+          break;
+        }
+        if (code < 0x800) {
+          if (!append(result, size, &length, 0xC0 | (code >> 6))) {
+            return false;
+          }
+        }
+        else {
+          if (!append(result, size, &length, 0xE0 | (code >> 12)) ||
+              !append(result, size, &length, 0x80 | ((code >> 6) & 0x3F))) {
+            return false;
+          }
+        }
+        character = 0x80 | (code & 0x3F);
+        break;
+      }
+      default:
+        return false;
+    }
+    if (!append(result, size, &length, character)) {
+      return false;
+    }
+  }
+  _position++;
+  return true;
+}
+
+/*
+ * JsonParser::readLiteral
+ * -----------------------
+ * This method will copy a number, true, false or null
+ * result: Where to copy the value text
+ * size: Size of the result buffer
+ * type: Where to save the type of the value
+ * returns: false if the value is not a literal or is too long
+ */
+bool JsonParser::readLiteral(char* result, size_t size, JsonType* type) {
+  size_t length = 0;
+  if (size > 0) {
+    result[0] = '\0';
+  }
+  while ((*_position >= 'a' && *_position <= 'z') || (*_position >= '0' && *_position <= '9') ||
+         *_position == '-' || *_position == '+' || *_position == '.' || *_position == 'E') {
+    if (!append(result, size, &length, *_position++)) {
+      return false;
+    }
+  }
+  if (length == 0) {
+    // Nested object or array, or garbage
+    return false;
+  }
+  if (strcmp(result, "true") == 0) {
+    *type = JSON_TRUE;
+  }
+  else if (strcmp(result, "false") == 0) {
+    *type = JSON_FALSE;
+  }
+  else if (strcmp(result, "null") == 0) {
+    *type = JSON_NULL;
+  }
+  else if (isNumber(result)) {
+    *type = JSON_NUMBER;
+  }
+  else {
+    return false;
+  }
+  return true;
+}
+
+/*
+ * JsonParser::append
+ * ------------------
+ * This method will add a character at the end of the result, keeping it NUL terminated
+ * returns: false if the buffer is full
+ */
+bool JsonParser::append(char* result, size_t size, size_t* length, char character) {
+  if (*length + 1 >= size) {
+    return false;
+  }
+  result[(*length)++] = character;
+  result[*length] = '\0';
+  return true;
+}
+
+/*
+ * JsonParser::isNumber
+ * --------------------
+ * This method will check a number against the RFC 8259 grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+ * Unlike strtod, it rejects nan, inf, hexadecimal and numbers like 01, .5 or 1.
+ * text: The number text, NUL terminated
+ * returns: true if the whole text is a number
+ */
+bool JsonParser::isNumber(const char* text) {
+  if (*text == '-') {
+    text++;
+  }
+  if (*text == '0') {
+    text++;
+  }
+  else if (*text >= '1' && *text <= '9') {
+    while (*text >= '0' && *text <= '9') {
+      text++;
+    }
+  }
+  else {
+    return false;
+  }
+  if (*text == '.') {
+    text++;
+    if (!(*text >= '0' && *text <= '9')) {
+      return false;
+    }
+    while (*text >= '0' && *text <= '9') {
+      text++;
+    }
+  }
+  if (*text == 'e' || *text == 'E') {
+    text++;
+    if (*text == '+' || *text == '-') {
+      text++;
+    }
+    if (!(*text >= '0' && *text <= '9')) {
+      return false;
+    }
+    while (*text >= '0' && *text <= '9') {
+      text++;
+    }
+  }
+  return *text == '\0';
+}
+
+/*
+ * JsonParser::fail
+ * ----------------
+ * This method will stop the parsing on an error
+ * returns: false, for the caller to return
+ */
+bool JsonParser::fail() {
+  _error = true;
+  return false;
+}
@@ -0,0 +1,38 @@
+#ifndef JsonParser_h
+#define JsonParser_h
+
+#include "Arduino.h"
+
+enum JsonType {
+  JSON_STRING,
+  JSON_NUMBER,
+  JSON_TRUE,
+  JSON_FALSE,
+  JSON_NULL
+};
+
+/*
+ * Reads the members of a flat JSON object one by one, in buffers given by the caller
+ * ex: while (parser.nextMember(key, sizeof(key), value, sizeof(value), &type)) { ... }
+ */
+class JsonParser {
+  public:
+    JsonParser(const char* text);
+    bool nextMember(char* key, size_t keySize, char* value, size_t valueSize, JsonType* type);
+    bool hasError();
+    void rewind();
+  private:
+    void skipSpaces();
+    bool readString(char* result, size_t size);
+    bool readLiteral(char* result, size_t size, JsonType* type);
+    bool append(char* result, size_t size, size_t* length, char character);
+    static bool isNumber(const char* text);
+    bool fail();
+    const char* _text;
+    const char* _position;
+    bool _started;
+    bool _ended;
+    bool _error;
+};
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * JsonWriter - Library for writing JSON in a fixed buffer
+ *
+ * Commas between members and elements are added by the writer. When the buffer is too small
+ * the text is cut, stays NUL terminated and isOverflowed() returns true.
+ */
+#include "JsonWriter.h"
+
+/*
+ * Constructor
+ * buffer: Where to write the JSON
+ * size: Size of the buffer, including the NUL
+ */
+JsonWriter::JsonWriter(char* buffer, size_t size) {
+  _buffer = buffer;
+  _size = size;
+  _length = 0;
+  _overflowed = size == 0;
+  _depth = 0;
+  _first[0] = true;
+  _afterKey = false;
+  if (size > 0) {
+    _buffer[0] = '\0';
+  }
+}
+
+/*
+ * JsonWriter::beginObject
+ * -----------------------
+ * This method will start an object, as a value or as the root
+ */
+void JsonWriter::beginObject() {
+  beginValue();
+  append('{');
+  if (_depth < JSON_WRITER_MAX_DEPTH) {
+    _depth++;
+    _first[_depth] = true;
+  }
+  else {
+    _overflowed = true;
+  }
+}
+
+/*
+ * JsonWriter::endObject
+ * ---------------------
+ * This method will end the current object
+ */
+void JsonWriter::endObject() {
+  append('}');
+  if (_depth > 0) {
+    _depth--;
+  }
+}
+
+/*
+ * JsonWriter::beginArray
+ * ----------------------
+ * This method will start an array, as a value or as the root
+ */
+void JsonWriter::beginArray() {
+  beginValue();
+  append('[');
+  if (_depth < JSON_WRITER_MAX_DEPTH) {
+    _depth++;
+    _first[_depth] = true;
+  }
+  else {
+    _overflowed = true;
+  }
+}
+
+/*
+ * JsonWriter::endArray
+ * --------------------
+ * This method will end the current array
+ */
+void JsonWriter::endArray() {
+  append(']');
+  if (_depth > 0) {
+    _depth--;
+  }
+}
+
+/*
+ * JsonWriter::key
+ * ---------------
+ * This method will write the name of the next member of the current object
+ * name: The member name, written as is (not escaped)
+ */
+void JsonWriter::key(const char* name) {
+  beginValue();
+  append('"');
+  append(name);
+  append("\":");
+  _afterKey = true;
+}
+
+/*
+ * JsonWriter::value
+ * -----------------
+ * This method will write a string value, escaped
+ * text: The string, NULL is written as null
+ */
+void JsonWriter::value(const char* text) {
+  if (text == NULL) {
+    nullValue();
+    return;
+  }
+  beginValue();
+  append('"');
+  for (const char* c = text; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\') {
+      append('\\');
+      append(*c);
+    }
+    else if ((unsigned char)*c < 0x20) {
+      char escaped[7];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+      append(escaped);
+    }
+    else {
+      append(*c);
+    }
+  }
+  append('"');
+}
+
+/*
+ * JsonWriter::value
+ * -----------------
+ * This method will write true or false
+ */
+void JsonWriter::value(bool flag) {
+  beginValue();
+  append(flag ? "true" : "false");
+}
+
+/*
+ * JsonWriter::value
+ * -----------------
+ * This method will write a number
+ */
+void JsonWriter::value(int number) {
+  value((long)number);
+}
+
+void JsonWriter::value(unsigned int number) {
+  value((unsigned long)number);
+}
+
+void JsonWriter::value(long number) {
+  char text[12];
+  snprintf(text, sizeof(text), "%ld", number);
+  beginValue();
+  append(text);
+}
+
+void JsonWriter::value(unsigned long number) {
+  char text[11];
+  snprintf(text, sizeof(text), "%lu", number);
+  beginValue();
+  append(text);
+}
+
+void JsonWriter::value(unsigned long long number) {
+  // 64 bits printf is not available everywhere, digits are written from the end
+  char text[21];
+  int position = sizeof(text) - 1;
+  text[position] = '\0';
+  do {
+    text[--position] = '0' + number % 10;
+    number /= 10;
+  } while (number > 0);
+  beginValue();
+  append(&text[position]);
+}
+
+/*
+ * JsonWriter::nullValue
+ * ---------------------
+ * This method will write null
+ */
+void JsonWriter::nullValue() {
+  beginValue();
+  append("null");
+}
+
+/*
+ * JsonWriter::getText
+ * -------------------
+ * This method will return the JSON written so far
+ */
+const char* JsonWriter::getText() {
+  return _buffer;
+}
+
+/*
+ * JsonWriter::getLength
+ * ---------------------
+ * This method will return the length of the JSON written so far
+ */
+size_t JsonWriter::getLength() {
+  return _length;
+}
+
+/*
+ * JsonWriter::isOverflowed
+ * ------------------------
+ * This method will tell if something could not be written
+ */
+bool JsonWriter::isOverflowed() {
+  return _overflowed;
+}
+
+/*
+ * JsonWriter::beginValue
+ * ----------------------
+ * This method will write the comma before a value or a member name when needed
+ */
+void JsonWriter::beginValue() {
+  if (_afterKey) {
+    // The value of a member, the comma was written before its name
+    _afterKey = false;
+    return;
+  }
+  if (!_first[_depth]) {
+    append(',');
+  }
+  _first[_depth] = false;
+}
+
+/*
+ * JsonWriter::append
+ * ------------------
+ * This method will copy text at the end of the buffer
+ */
+void JsonWriter::append(const char* text) {
+  while (*text != '\0') {
+    append(*text++);
+  }
+}
+
+void JsonWriter::append(char character) {
+  if (_length + 1 >= _size) {
+    _overflowed = true;
+    return;
+  }
+  _buffer[_length++] = character;
+  _buffer[_length] = '\0';
+}
@@ -0,0 +1,45 @@
+#ifndef JsonWriter_h
+#define JsonWriter_h
+
+#include "Arduino.h"
+
+// Objects and arrays nested deeper are not written
+#define JSON_WRITER_MAX_DEPTH 8
+
+/*
+ * Writes JSON in a buffer given by the caller, never allocates
+ * ex: json.beginObject(); json.key("uptime"); json.value(12); json.endObject();
+ */
+class JsonWriter {
+  public:
+    JsonWriter(char* buffer, size_t size);
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    void key(const char* name);
+    void value(const char* text);
+    void value(bool flag);
+    void value(int number);
+    void value(unsigned int number);
+    void value(long number);
+    void value(unsigned long number);
+    void value(unsigned long long number);
+    void nullValue();
+    const char* getText();
+    size_t getLength();
+    bool isOverflowed();
+  private:
+    void beginValue();
+    void append(const char* text);
+    void append(char character);
+    char* _buffer;
+    size_t _size;
+    size_t _length;
+    bool _overflowed;
+    uint8_t _depth;
+    bool _first[JSON_WRITER_MAX_DEPTH + 1];
+    bool _afterKey;
+};
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * Metrics - Library for counting the bridge events and measuring the reading pipeline latencies
+ *
+ * Everything is kept in fixed arrays, an observation is a few additions. printPrometheus writes the
+ * text exposition format: the stages are xbridge_stage_duration_seconds{stage="..."}, the end to end
+ * spans xbridge_reading_latency_seconds{span="..."} and the counters xbridge_*_total.
+ */
+#include "Metrics.h"
+
+HistogramData Metrics::_histograms[METRIC_HISTOGRAM_COUNT];
+uint32_t Metrics::_counters[METRIC_COUNTER_COUNT];
+
+// Upper bounds in microseconds, from a serial frame to a backfilled upload
+const uint32_t Metrics::BUCKET_BOUNDS[METRICS_BUCKET_COUNT] = {
+  100, 1000, 10000, 50000, 100000, 250000, 500000, 1000000,
+  2500000, 5000000, 10000000, 30000000, 60000000, 300000000, 600000000
+};
+
+const char* Metrics::BUCKET_LABELS[METRICS_BUCKET_COUNT] = {
+  "0.0001", "0.001", "0.01", "0.05", "0.1", "0.25", "0.5", "1",
+  "2.5", "5", "10", "30", "60", "300", "600"
+};
+
+// Stages first, spans after METRIC_UART_TO_ACK
+const char* Metrics::HISTOGRAM_LABELS[METRIC_HISTOGRAM_COUNT] = {
+  "stage=\"ManageConnectionStarted\"",
+  "stage=\"ProcessWixelMessage\"",
+  "stage=\"SendMessage\"",
+  "stage=\"WifiConnect\"",
+  "stage=\"SendAppEngineData\"",
+  "stage=\"SendNightscoutData\"",
+  "stage=\"SendLocalData\"",
+  "span=\"uart_to_ack\"",
+  "span=\"frame_to_ack\"",
+  "span=\"ack_to_upload\""
+};
+
+const char* Metrics::COUNTER_NAMES[METRIC_COUNTER_COUNT] = {
+  "xbridge_wixel_frames_total",
+  "xbridge_wixel_bad_frames_total",
+  "xbridge_wixel_frame_timeouts_total",
+  "xbridge_upload_timeouts_total",
+  "xbridge_wifi_reconnects_total",
+  "xbridge_upload_reconnects_total",
+  "xbridge_dropped_uploads_total",
+  "xbridge_wixel_slow_acks_total",
+  "xbridge_duplicate_readings_total",
+  "xbridge_foreign_readings_total",
+  "xbridge_simulated_readings_total",
+  "xbridge_simulated_lost_readings_total",
+  "xbridge_configuration_write_failures_total"
+};
+
+/*
+ * Metrics::observe
+ * ----------------
+ * This method will add one measurement to a histogram
+ * histogram: The stage or span measured
+ * elapsedMicros: The measured time in microseconds
+ */
+void Metrics::observe(MetricHistogram histogram, uint32_t elapsedMicros) {
+  HistogramData* data = &_histograms[histogram];
+  int bucket = 0;
+  while (bucket < METRICS_BUCKET_COUNT && elapsedMicros > BUCKET_BOUNDS[bucket]) {
+    bucket++;
+  }
+  data->buckets[bucket]++;
+  data->totalMicros += elapsedMicros;
+  data->count++;
+}
+
+/*
+ * Metrics::count
+ * --------------
+ * This method will add one to a counter
+ */
+void Metrics::count(MetricCounter counter) {
+  _counters[counter]++;
+}
+
+/*
+ * Metrics::printPrometheus
+ * ------------------------
+ * This method will print the histograms and counters in the Prometheus text format
+ * output: Where to print the metrics
+ */
+void Metrics::printPrometheus(Print &output) {
+  for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+    const char* name = i < METRIC_UART_TO_ACK ? "xbridge_stage_duration_seconds" : "xbridge_reading_latency_seconds";
+    if (i == 0 || i == METRIC_UART_TO_ACK) {
+      output.print("# TYPE ");
+      output.print(name);
+      output.print(" histogram\n");
+    }
+    HistogramData* data = &_histograms[i];
+    uint32_t cumulative = 0;
+    for (int bucket = 0; bucket <= METRICS_BUCKET_COUNT; bucket++) {
+      cumulative += data->buckets[bucket];
+      output.print(name);
+      output.print("_bucket{");
+      output.print(HISTOGRAM_LABELS[i]);
+      output.print(",le=\"");
+      output.print(bucket < METRICS_BUCKET_COUNT ? BUCKET_LABELS[bucket] : "+Inf");
+      output.print("\"} ");
+      output.print(cumulative);
+      output.print("\n");
+    }
+    output.print(name);
+    output.print("_sum{");
+    output.print(HISTOGRAM_LABELS[i]);
+    output.print("} ");
+    printSeconds(output, data->totalMicros);
+    output.print("\n");
+    output.print(name);
+    output.print("_count{");
+    output.print(HISTOGRAM_LABELS[i]);
+    output.print("} ");
+    output.print(data->count);
+    output.print("\n");
+  }
+  for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+    output.print("# TYPE ");
+    output.print(COUNTER_NAMES[i]);
+    output.print(" counter\n");
+    output.print(COUNTER_NAMES[i]);
+    output.print(" ");
+    output.print(_counters[i]);
+    output.print("\n");
+  }
+}
+
+/*
+ * Metrics::printSeconds
+ * ---------------------
+ * This method will print a time in seconds with the microseconds, without floating point
+ */
+void Metrics::printSeconds(Print &output, uint64_t micros) {
+  char text[24];
+  snprintf(text, sizeof(text), "%lu.%06lu", (unsigned long)(micros / 1000000), (unsigned long)(micros % 1000000));
+  output.print(text);
+}
+
+/*
+ * Constructor
+ */
+MetricsScope::MetricsScope(MetricHistogram histogram) {
+  _histogram = histogram;
+  _startMicros = micros();
+}
+
+/*
+ * Destructor, record the measurement
+ */
+MetricsScope::~MetricsScope() {
+  Metrics::observe(_histogram, micros() - _startMicros);
+}
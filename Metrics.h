@@ -0,0 +1,83 @@
+#ifndef Metrics_h
+#define Metrics_h
+
+#include "Arduino.h"
+
+// Number of latency buckets, without the +Inf one
+#define METRICS_BUCKET_COUNT 15
+
+/*
+ * All latency histograms, the stages of the reading pipeline then the end to end spans
+ */
+enum MetricHistogram {
+  METRIC_MANAGE_CONNECTION_STARTED,
+  METRIC_PROCESS_WIXEL_MESSAGE,
+  METRIC_SEND_MESSAGE,
+  METRIC_WIFI_CONNECT, // Association and address, measured by the wifi manager
+  METRIC_SEND_APP_ENGINE_DATA, // From the request start to the App Engine response
+  METRIC_SEND_NIGHTSCOUT_DATA, // From the request start to the Nightscout response
+  METRIC_SEND_LOCAL_DATA, // From the request start to the local receiver response
+  METRIC_UART_TO_ACK, // From the first byte of a data frame to its acknowledge
+  METRIC_FRAME_TO_ACK, // From the last byte of a data frame to its acknowledge sent on the wire
+  METRIC_ACK_TO_UPLOAD, // From the acknowledge to the response of the last upload destination, backfill included
+  METRIC_HISTOGRAM_COUNT
+};
+
+/*
+ * All event counters
+ */
+enum MetricCounter {
+  METRIC_FRAMES,
+  METRIC_BAD_FRAMES, // Garbage length, unknown message or wrong size
+  METRIC_FRAME_TIMEOUTS, // Frame never completed
+  METRIC_UPLOAD_TIMEOUTS,
+  METRIC_WIFI_RECONNECTS,
+  METRIC_UPLOAD_RECONNECTS,
+  METRIC_DROPPED_UPLOADS, // Readings overwritten in the queue or rejected by an upload destination
+  METRIC_SLOW_ACKS, // Acknowledges sent later than WIXEL_ACK_TARGET_MICROS
+  METRIC_DUPLICATE_READINGS, // Readings sent again by the Wixel, acknowledged but not uploaded
+  METRIC_FOREIGN_READINGS, // Readings of another transmitter, dropped
+  METRIC_SIMULATED_READINGS, // Different readings sent by the Wixel simulator
+  METRIC_SIMULATED_LOST_READINGS, // Simulated readings never acknowledged
+  METRIC_CONFIGURATION_WRITE_FAILURES, // Journal appends and compactions that did not complete
+  METRIC_COUNTER_COUNT
+};
+
+struct HistogramData {
+  uint32_t buckets[METRICS_BUCKET_COUNT + 1] = {}; // Not cumulative, last one is +Inf
+  uint64_t totalMicros = 0;
+  uint32_t count = 0;
+};
+
+/*
+ * Counters and fixed bucket latency histograms, served in the Prometheus text format
+ */
+class Metrics {
+  public:
+    static void observe(MetricHistogram histogram, uint32_t elapsedMicros);
+    static void count(MetricCounter counter);
+    static void printPrometheus(Print &output);
+  private:
+    static void printSeconds(Print &output, uint64_t micros);
+    static HistogramData _histograms[METRIC_HISTOGRAM_COUNT];
+    static uint32_t _counters[METRIC_COUNTER_COUNT];
+    static const uint32_t BUCKET_BOUNDS[METRICS_BUCKET_COUNT];
+    static const char* BUCKET_LABELS[METRICS_BUCKET_COUNT];
+    static const char* HISTOGRAM_LABELS[METRIC_HISTOGRAM_COUNT];
+    static const char* COUNTER_NAMES[METRIC_COUNTER_COUNT];
+};
+
+/*
+ * Measure the time of an operation from construction until the end of the scope
+ * ex: MetricsScope metrics(METRIC_SEND_MESSAGE);
+ */
+class MetricsScope {
+  public:
+    MetricsScope(MetricHistogram histogram);
+    ~MetricsScope();
+  private:
+    MetricHistogram _histogram;
+    unsigned long _startMicros;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * Profiler - Library for measuring the time and heap used by the bridge operations on the device
+ */
+#include "Profiler.h"
+
+ProfileStats Profiler::_stats[PROFILE_OPERATION_COUNT];
+
+const char* Profiler::OPERATION_NAMES[PROFILE_OPERATION_COUNT] = {
+  "ManageConnectionStarted",
+  "ProcessWixelMessage",
+  "Configuration::LoadConfig",
+  "Configuration::SaveConfig",
+  "WebServer::handleRoot",
+  "DexcomHelper::DexcomSrcToAscii",
+  "DexcomHelper::DexcomAsciiToSrc"
+};
+
+/*
+ * Profiler::record
+ * ----------------
+ * This method will add one measurement to the operation statistics
+ * operation: The operation measured
+ * startMicros: micros() when the operation started
+ * startFreeHeap: Free heap when the operation started
+ */
+void Profiler::record(ProfiledOperation operation, unsigned long startMicros, uint32_t startFreeHeap) {
+  uint32_t elapsed = micros() - startMicros;
+  ProfileStats* stats = &_stats[operation];
+  stats->count++;
+  stats->totalMicros += elapsed;
+  if (elapsed > stats->maxMicros) {
+    stats->maxMicros = elapsed;
+  }
+  stats->heapRetained += (int32_t)startFreeHeap - (int32_t)ESP.getFreeHeap();
+}
+
+/*
+ * Profiler::printReport
+ * ---------------------
+ * This method will print one line per operation with the count, average time, max time and heap retained
+ * output: Where to print the report
+ */
+void Profiler::printReport(Print &output) {
+  output.print("operation count avg_us max_us heap_retained_per_op\n");
+  for (int i = 0; i < PROFILE_OPERATION_COUNT; i++) {
+    ProfileStats* stats = &_stats[i];
+    output.print(OPERATION_NAMES[i]);
+    output.print(" ");
+    output.print(stats->count);
+    output.print(" ");
+    output.print(stats->count > 0 ? stats->totalMicros / stats->count : 0);
+    output.print(" ");
+    output.print(stats->maxMicros);
+    output.print(" ");
+    output.print(stats->count > 0 ? stats->heapRetained / (int32_t)stats->count : 0);
+    output.print("\n");
+  }
+  output.print("free_heap ");
+  output.print(ESP.getFreeHeap());
+  output.print("\n");
+}
+
+/*
+ * Profiler::reset
+ * ---------------
+ * This method will clear all the statistics
+ */
+void Profiler::reset() {
+  for (int i = 0; i < PROFILE_OPERATION_COUNT; i++) {
+    _stats[i] = ProfileStats();
+  }
+}
+
+/*
+ * Constructor
+ */
+ProfilerScope::ProfilerScope(ProfiledOperation operation) {
+  _operation = operation;
+  _startFreeHeap = ESP.getFreeHeap();
+  _startMicros = micros();
+}
+
+/*
+ * Destructor, record the measurement
+ */
+ProfilerScope::~ProfilerScope() {
+  Profiler::record(_operation, _startMicros, _startFreeHeap);
+}
@@ -0,0 +1,51 @@
+#ifndef Profiler_h
+#define Profiler_h
+
+#include "Arduino.h"
+
+/*
+ * All operations measured by the profiler
+ */
+enum ProfiledOperation {
+  PROFILE_MANAGE_CONNECTION_STARTED,
+  PROFILE_PROCESS_WIXEL_MESSAGE,
+  PROFILE_LOAD_CONFIG,
+  PROFILE_SAVE_CONFIG,
+  PROFILE_HANDLE_ROOT,
+  PROFILE_DEXCOM_SRC_TO_ASCII,
+  PROFILE_DEXCOM_ASCII_TO_SRC,
+  PROFILE_OPERATION_COUNT
+};
+
+struct ProfileStats {
+  uint32_t count = 0;
+  uint32_t totalMicros = 0;
+  uint32_t maxMicros = 0;
+  int32_t heapRetained = 0; // Heap bytes still allocated when the operations returned
+};
+
+class Profiler {
+  public:
+    static void record(ProfiledOperation operation, unsigned long startMicros, uint32_t startFreeHeap);
+    static void printReport(Print &output);
+    static void reset();
+  private:
+    static ProfileStats _stats[PROFILE_OPERATION_COUNT];
+    static const char* OPERATION_NAMES[PROFILE_OPERATION_COUNT];
+};
+
+/*
+ * Measure the time and heap of an operation from construction until the end of the scope
+ * ex: ProfilerScope profile(PROFILE_LOAD_CONFIG);
+ */
+class ProfilerScope {
+  public:
+    ProfilerScope(ProfiledOperation operation);
+    ~ProfilerScope();
+  private:
+    ProfiledOperation _operation;
+    unsigned long _startMicros;
+    uint32_t _startFreeHeap;
+};
+
+#endif
@@ -0,0 +1,301 @@
+/*
+ * RadioScheduler - Library for turning the radio off between two Wixel frames
+ *
+ * The Wixel frames come on the serial port whether the radio is on or not, the radio is only needed
+ * to upload them. The period and phase of the data packets and of the beacons of each Wixel are learned
+ * from their arrival times. Once RADIO_SCHEDULER_MIN_CONSISTENT frames in a row came on time on every Wixel
+ * sending readings, the radio is turned off after each upload and turned back on RADIO_SCHEDULER_WAKE_LEAD
+ * before the first expected frame of all of them, so the wifi manager has rejoined when the reading must
+ * be uploaded.
+ * A frame that comes while the radio is off is a missed deadline: the radio is turned on at once and
+ * the cadences of that Wixel are learned again.
+ */
+#include "RadioScheduler.h"
+
+/*
+ * Constructor
+ */
+RadioScheduler::RadioScheduler() {
+  _wifiManager = NULL;
+  _radioOn = true;
+  _bootMillis = 0;
+  _startMillis = 0;
+  _lastFrameMillis = 0;
+  _wakeMillis = 0;
+  _lastAccountingMillis = 0;
+  _awakeMillis = 0;
+  _sleepCount = 0;
+  _missedDeadlineCount = 0;
+}
+
+/*
+ * RadioScheduler::setWifiManager
+ * ------------------------------
+ * This method will set the wifi manager suspended while the radio is off
+ * wifiManager: The wifi manager
+ */
+void RadioScheduler::setWifiManager(WifiManager* wifiManager) {
+  _wifiManager = wifiManager;
+}
+
+/*
+ * RadioScheduler::onDataPacket
+ * ----------------------------
+ * This method is called when a data packet comes from a Wixel
+ * port: Number of the Wixel port
+ */
+void RadioScheduler::onDataPacket(uint8_t port) {
+  if (port < WIXEL_PORT_COUNT) {
+    onFrame(_dataCadences, port);
+  }
+}
+
+/*
+ * RadioScheduler::onBeacon
+ * ------------------------
+ * This method is called when a beacon comes from a Wixel
+ * port: Number of the Wixel port
+ */
+void RadioScheduler::onBeacon(uint8_t port) {
+  if (port < WIXEL_PORT_COUNT) {
+    onFrame(_beaconCadences, port);
+  }
+}
+
+/*
+ * RadioScheduler::loop
+ * --------------------
+ * This method is called by the main program at each "loop" call. Turns the radio off or on when it is time
+ * radioNeeded: true while something waits for the network (readings to upload, debugging...)
+ */
+void RadioScheduler::loop(bool radioNeeded) {
+  unsigned long now = millis();
+  updateAwakeTime(now);
+  if (!_radioOn) {
+    if ((long)(now - _wakeMillis) >= 0) {
+      wake();
+    }
+    return;
+  }
+  if (radioNeeded || now - _bootMillis < RADIO_SCHEDULER_HOTSPOT_WINDOW ||
+      now - _lastFrameMillis < RADIO_SCHEDULER_SETTLE_TIME || WiFi.softAPgetStationNum() > 0) {
+    return;
+  }
+  // Wake for the first of the next data packets and the next beacons of all the Wixels
+  bool readingsKnown = false;
+  unsigned long expected = 0;
+  for (int i = 0; i < WIXEL_PORT_COUNT; i++) {
+    unsigned long frameExpected;
+    const FrameCadence &data = _dataCadences[i];
+    if (data.seen && now - data.lastMillis < RADIO_SCHEDULER_SILENT_TIME) {
+      if (!getNextExpected(data, now, &frameExpected)) {
+        // Never sleep without knowing when the readings of every Wixel come
+        return;
+      }
+      if (!readingsKnown || (long)(frameExpected - expected) < 0) {
+        expected = frameExpected;
+      }
+      readingsKnown = true;
+    }
+  }
+  if (!readingsKnown) {
+    return;
+  }
+  for (int i = 0; i < WIXEL_PORT_COUNT; i++) {
+    unsigned long frameExpected;
+    if (getNextExpected(_beaconCadences[i], now, &frameExpected) && (long)(frameExpected - expected) < 0) {
+      expected = frameExpected;
+    }
+  }
+  unsigned long wakeMillis = expected - RADIO_SCHEDULER_WAKE_LEAD;
+  if ((long)(wakeMillis - now) >= RADIO_SCHEDULER_MIN_SLEEP) {
+    sleep(wakeMillis);
+  }
+}
+
+/*
+ * RadioScheduler::isRadioOn
+ * -------------------------
+ * This method will tell if the radio is on
+ */
+bool RadioScheduler::isRadioOn() {
+  return _radioOn;
+}
+
+/*
+ * RadioScheduler::printReport
+ * ---------------------------
+ * This method will print the learned cadences, the radio on duty cycle and the missed deadlines since boot or reset
+ * output: Where to print the report
+ */
+void RadioScheduler::printReport(Print &output) {
+  unsigned long now = millis();
+  updateAwakeTime(now);
+  uint32_t totalMillis = now - _startMillis;
+  for (uint8_t i = 0; i < WIXEL_PORT_COUNT; i++) {
+    printCadence(output, i, "data", _dataCadences[i]);
+    printCadence(output, i, "beacon", _beaconCadences[i]);
+  }
+  output.print("radio_on ");
+  output.print(_radioOn ? 1 : 0);
+  output.print("\nradio_on_ms ");
+  output.print(_awakeMillis);
+  output.print("\ntotal_ms ");
+  output.print(totalMillis);
+  output.print("\nradio_on_percent ");
+  output.print(totalMillis > 0 ? (uint32_t)((uint64_t)_awakeMillis * 100 / totalMillis) : 100);
+  output.print("\nsleeps ");
+  output.print(_sleepCount);
+  output.print("\nmissed_deadlines ");
+  output.print(_missedDeadlineCount);
+  output.print("\n");
+}
+
+/*
+ * RadioScheduler::reset
+ * ---------------------
+ * This method will restart the radio on time and missed deadline counts from now
+ */
+void RadioScheduler::reset() {
+  _startMillis = millis();
+  _lastAccountingMillis = _startMillis;
+  _awakeMillis = 0;
+  _sleepCount = 0;
+  _missedDeadlineCount = 0;
+}
+
+/*
+ * RadioScheduler::printCadence
+ * ----------------------------
+ * This method will print the learned period of one kind of frame of a Wixel, the keys start with its port (from 1)
+ * output: Where to print the report
+ * port: Number of the Wixel port
+ * kind: data or beacon
+ * cadence: The cadence to print
+ */
+void RadioScheduler::printCadence(Print &output, uint8_t port, const char* kind, const FrameCadence &cadence) {
+  output.print("port");
+  output.print(port + 1);
+  output.print("_");
+  output.print(kind);
+  output.print("_period_ms ");
+  output.print(cadence.periodMillis);
+  output.print("\nport");
+  output.print(port + 1);
+  output.print("_");
+  output.print(kind);
+  output.print("_on_time_in_row ");
+  output.print(cadence.consistentCount);
+  output.print("\n");
+}
+
+/*
+ * RadioScheduler::onFrame
+ * -----------------------
+ * This method will learn the arrival time of a frame and turn the radio on if the frame came too early
+ * cadences: The cadences of this kind of frame, one per Wixel
+ * port: Number of the Wixel port which sent the frame
+ */
+void RadioScheduler::onFrame(FrameCadence* cadences, uint8_t port) {
+  unsigned long now = millis();
+  updateAwakeTime(now);
+  if (!_radioOn) {
+    _missedDeadlineCount++;
+    // The other Wixels were on time, only this one is learned again
+    _dataCadences[port].consistentCount = 0;
+    _beaconCadences[port].consistentCount = 0;
+    wake();
+  }
+  learn(cadences[port], now);
+  _lastFrameMillis = now;
+}
+
+/*
+ * RadioScheduler::learn
+ * ---------------------
+ * This method will update the period of a kind of frame. Missed frames are allowed: an interval close to
+ * several periods counts as on time
+ * cadence: The cadence to update
+ * now: Arrival time of the frame
+ */
+void RadioScheduler::learn(FrameCadence &cadence, unsigned long now) {
+  if (cadence.seen) {
+    unsigned long interval = now - cadence.lastMillis;
+    unsigned long periods = (interval + cadence.periodMillis / 2) / cadence.periodMillis;
+    long error = (long)(interval - periods * cadence.periodMillis);
+    if (periods > 0 && abs(error) < RADIO_SCHEDULER_TOLERANCE) {
+      // Follow the transmitter clock drift slowly
+      cadence.periodMillis += error / (long)periods / 8;
+      cadence.consistentCount++;
+    }
+    else {
+      cadence.consistentCount = 0;
+    }
+  }
+  cadence.seen = true;
+  cadence.lastMillis = now;
+}
+
+/*
+ * RadioScheduler::getNextExpected
+ * -------------------------------
+ * This method will compute when the next frame of a kind should come
+ * cadence: The cadence of this kind of frame
+ * now: Current time
+ * expected: Where to save the expected time
+ * returns: false if the cadence is not known well enough. expected is in the past while a frame is late
+ */
+bool RadioScheduler::getNextExpected(const FrameCadence &cadence, unsigned long now, unsigned long* expected) {
+  if (!cadence.seen || cadence.consistentCount < RADIO_SCHEDULER_MIN_CONSISTENT) {
+    return false;
+  }
+  unsigned long next = cadence.lastMillis + cadence.periodMillis;
+  // A frame late by less than the tolerance may still come, after that the Wixel missed it
+  while ((long)(next + RADIO_SCHEDULER_TOLERANCE - now) < 0) {
+    next += cadence.periodMillis;
+  }
+  *expected = next;
+  return true;
+}
+
+/*
+ * RadioScheduler::updateAwakeTime
+ * -------------------------------
+ * This method will add the time since the last call to the radio on time when the radio is on
+ * now: Current time
+ */
+void RadioScheduler::updateAwakeTime(unsigned long now) {
+  if (_radioOn) {
+    _awakeMillis += now - _lastAccountingMillis;
+  }
+  _lastAccountingMillis = now;
+}
+
+/*
+ * RadioScheduler::sleep
+ * ---------------------
+ * This method will turn the radio off (station and hotspot) until wakeMillis
+ * wakeMillis: When to turn the radio back on
+ */
+void RadioScheduler::sleep(unsigned long wakeMillis) {
+  if (_wifiManager != NULL) {
+    _wifiManager->suspend();
+  }
+  WiFi.forceSleepBegin();
+  _radioOn = false;
+  _wakeMillis = wakeMillis;
+  _sleepCount++;
+}
+
+/*
+ * RadioScheduler::wake
+ * --------------------
+ * This method will turn the radio back on and let the wifi manager rejoin with the cached lease
+ */
+void RadioScheduler::wake() {
+  WiFi.forceSleepWake();
+  _radioOn = true;
+  if (_wifiManager != NULL) {
+    _wifiManager->resume();
+  }
+}
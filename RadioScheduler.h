@@ -0,0 +1,72 @@
+#ifndef RadioScheduler_h
+#define RadioScheduler_h
+
+#include <ESP8266WiFi.h>
+#include "Arduino.h"
+#include "WifiManager.h"
+#include "WixelProtocol.h"
+
+// The Dexcom transmitter sends one reading every 5 minutes
+#define RADIO_SCHEDULER_DEFAULT_PERIOD 300000
+// A frame is on time when it arrives this many milliseconds around the expected time
+#define RADIO_SCHEDULER_TOLERANCE 15000
+// Number of on time frames in a row before the radio is turned off between frames
+#define RADIO_SCHEDULER_MIN_CONSISTENT 3
+// The link is brought up this many milliseconds before the expected frame (fast rejoin takes about 1s)
+#define RADIO_SCHEDULER_WAKE_LEAD 10000
+// The radio stays on at least this many milliseconds after a frame to upload it
+#define RADIO_SCHEDULER_SETTLE_TIME 20000
+// The radio is not turned off for less than this many milliseconds
+#define RADIO_SCHEDULER_MIN_SLEEP 30000
+// A Wixel silent for this many milliseconds (unplugged, transmitter out of range) is not waited for anymore
+#define RADIO_SCHEDULER_SILENT_TIME 3600000
+// The hotspot stays on this many milliseconds after boot so the bridge can be configured
+#define RADIO_SCHEDULER_HOTSPOT_WINDOW 600000
+
+/*
+ * What was learned about one kind of frame
+ */
+struct FrameCadence {
+  bool seen = false;
+  unsigned long lastMillis = 0;
+  unsigned long periodMillis = RADIO_SCHEDULER_DEFAULT_PERIOD;
+  uint32_t consistentCount = 0; // On time frames in a row
+};
+
+/*
+ * Turns the radio off between the Wixel frames and back on just before the next one.
+ * Each Wixel has its own transmitter, so its own cadences
+ */
+class RadioScheduler {
+  public:
+    RadioScheduler();
+    void setWifiManager(WifiManager* wifiManager);
+    void onDataPacket(uint8_t port);
+    void onBeacon(uint8_t port);
+    void loop(bool radioNeeded);
+    bool isRadioOn();
+    void printReport(Print &output);
+    void reset();
+  private:
+    void learn(FrameCadence &cadence, unsigned long now);
+    bool getNextExpected(const FrameCadence &cadence, unsigned long now, unsigned long* expected);
+    void onFrame(FrameCadence* cadences, uint8_t port);
+    void printCadence(Print &output, uint8_t port, const char* kind, const FrameCadence &cadence);
+    void updateAwakeTime(unsigned long now);
+    void sleep(unsigned long wakeMillis);
+    void wake();
+    WifiManager* _wifiManager;
+    FrameCadence _dataCadences[WIXEL_PORT_COUNT];
+    FrameCadence _beaconCadences[WIXEL_PORT_COUNT];
+    bool _radioOn;
+    unsigned long _bootMillis;
+    unsigned long _startMillis;
+    unsigned long _lastFrameMillis;
+    unsigned long _wakeMillis;
+    unsigned long _lastAccountingMillis;
+    uint32_t _awakeMillis;
+    uint32_t _sleepCount;
+    uint32_t _missedDeadlineCount;
+};
+
+#endif
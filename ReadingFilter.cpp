@@ -0,0 +1,75 @@
+/*
+ * ReadingFilter - Library for dropping the useless readings before they are queued
+ *
+ * The Wixel sends a reading again when it misses our ACK, and it relays every Dexcom transmitter it hears.
+ * A reading is a duplicate when a reading with the same src ID, raw and filtered values was received
+ * less than READING_FILTER_WINDOW ago. Duplicates are still acknowledged, they are only not uploaded again.
+ */
+#include "ReadingFilter.h"
+#include "Metrics.h"
+
+/*
+ * Constructor
+ */
+ReadingFilter::ReadingFilter() {
+  _recentCount = 0;
+  _nextPosition = 0;
+  _duplicateCount = 0;
+  _foreignCount = 0;
+}
+
+/*
+ * ReadingFilter::check
+ * --------------------
+ * This method will tell if a reading must be queued and remember it if so
+ * record: The reading received from the Wixel
+ * transmitterId: The transmitter configured for this Wixel, 0 if none (every reading is kept)
+ * returns: READING_FILTER_NEW if the reading must be queued, else why it is dropped
+ */
+ReadingFilterResult ReadingFilter::check(const RawRecord &record, uint32_t transmitterId) {
+  uint32_t srcId = record.dex_src_id & DEXCOM_SRC_MASK;
+  transmitterId &= DEXCOM_SRC_MASK;
+  if (transmitterId != 0 && srcId != transmitterId) {
+    _foreignCount++;
+    Metrics::count(METRIC_FOREIGN_READINGS);
+    return READING_FILTER_FOREIGN;
+  }
+  unsigned long now = millis();
+  for (unsigned int i = 0; i < _recentCount; i++) {
+    const RecentReading &recent = _recent[i];
+    if (recent.srcId == srcId && recent.raw == record.raw && recent.filtered == record.filtered &&
+        now - recent.receivedMillis < READING_FILTER_WINDOW) {
+      _duplicateCount++;
+      Metrics::count(METRIC_DUPLICATE_READINGS);
+      return READING_FILTER_DUPLICATE;
+    }
+  }
+  RecentReading &recent = _recent[_nextPosition];
+  recent.srcId = srcId;
+  recent.raw = record.raw;
+  recent.filtered = record.filtered;
+  recent.receivedMillis = now;
+  _nextPosition = (_nextPosition + 1) % READING_FILTER_CACHE_SIZE;
+  if (_recentCount < READING_FILTER_CACHE_SIZE) {
+    _recentCount++;
+  }
+  return READING_FILTER_NEW;
+}
+
+/*
+ * ReadingFilter::getDuplicateCount
+ * --------------------------------
+ * returns: Number of readings sent again by the Wixel and not uploaded again
+ */
+uint32_t ReadingFilter::getDuplicateCount() {
+  return _duplicateCount;
+}
+
+/*
+ * ReadingFilter::getForeignCount
+ * ------------------------------
+ * returns: Number of readings of other transmitters dropped
+ */
+uint32_t ReadingFilter::getForeignCount() {
+  return _foreignCount;
+}
@@ -0,0 +1,50 @@
+#ifndef ReadingFilter_h
+#define ReadingFilter_h
+
+#include "Arduino.h"
+#include "DexcomHelper.h"
+#include "WixelProtocol.h"
+
+// Number of recent readings remembered to find the ones sent again by the Wixel
+#define READING_FILTER_CACHE_SIZE 8
+// Same values within this many milliseconds are the same reading, shorter than the 5 minutes between two readings
+#define READING_FILTER_WINDOW 240000
+
+/*
+ * What to do with a reading received from the Wixel
+ */
+enum ReadingFilterResult {
+  READING_FILTER_NEW, // Queue and upload it
+  READING_FILTER_DUPLICATE, // Sent again because our ACK was missed, already queued
+  READING_FILTER_FOREIGN // From another transmitter than the configured one
+};
+
+/*
+ * One reading remembered by the filter
+ */
+struct RecentReading {
+  uint32_t srcId = 0;
+  uint32_t raw = 0;
+  uint32_t filtered = 0;
+  unsigned long receivedMillis = 0;
+};
+
+/*
+ * Drops the readings of other transmitters and the readings sent again by the Wixel before they are queued.
+ * The recent readings are kept in a fixed ring, the oldest one is replaced
+ */
+class ReadingFilter {
+  public:
+    ReadingFilter();
+    ReadingFilterResult check(const RawRecord &record, uint32_t transmitterId);
+    uint32_t getDuplicateCount();
+    uint32_t getForeignCount();
+  private:
+    RecentReading _recent[READING_FILTER_CACHE_SIZE];
+    unsigned int _recentCount;
+    unsigned int _nextPosition;
+    uint32_t _duplicateCount;
+    uint32_t _foreignCount;
+};
+
+#endif
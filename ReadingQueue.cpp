@@ -0,0 +1,373 @@
+/*
+ * ReadingQueue - Library for keeping the readings in flash until they are uploaded
+ *
+ * The log file has READING_QUEUE_CAPACITY slots. A reading with sequence N is saved in slot N % READING_QUEUE_CAPACITY
+ * so when the queue is full the oldest reading is overwritten.
+ * The state file keeps the boot id and, for each sink, the sequence of the last uploaded reading.
+ * millis() restarts at each boot, so a reading keeps the wall clock time of its capture once SNTP is known
+ * and a reading of a previous boot captured before that has no date anymore.
+ * A disabled sink does not hold readings: its position follows the newest reading.
+ */
+#include "ReadingQueue.h"
+#include "Metrics.h"
+#include "Crc32.h"
+
+/*
+ * Constructor
+ */
+ReadingQueue::ReadingQueue() {
+  _logFileName[0] = '\0';
+  _stateFileName[0] = '\0';
+  _started = false;
+  _bootId = 0;
+  _lastPushedSequence = 0;
+  for (int i = 0; i < READING_QUEUE_MAX_SINKS; i++) {
+    _lastSentSequence[i] = 0;
+  }
+  // Every sink keeps its saved position until it is disabled
+  _enabledSinks = (1 << READING_QUEUE_MAX_SINKS) - 1;
+  _droppedCount = 0;
+}
+
+/*
+ * ReadingQueue::begin
+ * -------------------
+ * This method will find the readings not uploaded yet. The file system must be mounted
+ * number: Number of the queue, one per Wixel. The first one keeps the files of the single Wixel versions
+ * returns: true if the queue can be used
+ */
+bool ReadingQueue::begin(uint8_t number) {
+  if (number == 0) {
+    strcpy(_logFileName, READING_QUEUE_FILE);
+    strcpy(_stateFileName, READING_QUEUE_STATE_FILE);
+  }
+  else {
+    snprintf(_logFileName, sizeof(_logFileName), "/readings%u.log", number + 1);
+    snprintf(_stateFileName, sizeof(_stateFileName), "/readings%u.pos", number + 1);
+  }
+  File stateFile = LittleFS.open(_stateFileName, "r");
+  if (stateFile) {
+    uint32_t state[READING_QUEUE_MAX_SINKS + 2];
+    int read = stateFile.read((uint8_t*)state, sizeof(state));
+    if (read == sizeof(state) && Crc32(state, sizeof(state) - 4) == state[READING_QUEUE_MAX_SINKS + 1]) {
+      _bootId = state[0];
+      for (int i = 0; i < READING_QUEUE_MAX_SINKS; i++) {
+        _lastSentSequence[i] = state[i + 1];
+      }
+    }
+    else if (read == 12 && Crc32(state, 8) == state[2]) {
+      // Saved before the sinks, everything was sent to App Engine only
+      _bootId = state[0];
+      for (int i = 0; i < READING_QUEUE_MAX_SINKS; i++) {
+        _lastSentSequence[i] = state[1];
+      }
+    }
+    stateFile.close();
+  }
+  _bootId++;
+
+  // A log of another slot size (saved before the readings had their wall clock time) is created again
+  File savedLogFile = LittleFS.open(_logFileName, "r");
+  bool logValid = savedLogFile && savedLogFile.size() == READING_QUEUE_CAPACITY * sizeof(QueuedReading);
+  if (savedLogFile) {
+    savedLogFile.close();
+  }
+  if (!logValid) {
+    // Create every slot once so the log never needs to grow
+    File logFile = LittleFS.open(_logFileName, "w");
+    if (!logFile) {
+      return false;
+    }
+    QueuedReading emptyReading;
+    memset(&emptyReading, 0, sizeof(emptyReading));
+    for (int i = 0; i < READING_QUEUE_CAPACITY; i++) {
+      logFile.write((const uint8_t*)&emptyReading, sizeof(emptyReading));
+    }
+    logFile.close();
+  }
+
+  // The newest reading is the one with the highest sequence
+  File logFile = LittleFS.open(_logFileName, "r");
+  if (!logFile) {
+    return false;
+  }
+  QueuedReading reading;
+  for (uint32_t slot = 0; slot < READING_QUEUE_CAPACITY; slot++) {
+    if (readSlot(logFile, slot, reading) && reading.sequence > _lastPushedSequence) {
+      _lastPushedSequence = reading.sequence;
+    }
+  }
+  logFile.close();
+  for (int i = 0; i < READING_QUEUE_MAX_SINKS; i++) {
+    if (_lastSentSequence[i] > _lastPushedSequence) {
+      _lastSentSequence[i] = _lastPushedSequence;
+    }
+    if (_lastPushedSequence - _lastSentSequence[i] > READING_QUEUE_CAPACITY) {
+      _lastSentSequence[i] = _lastPushedSequence - READING_QUEUE_CAPACITY;
+    }
+  }
+  _started = writeState();
+  return _started;
+}
+
+/*
+ * ReadingQueue::readSlot
+ * ----------------------
+ * This method will read one slot of the log
+ * returns: true if the slot contains a valid reading
+ */
+bool ReadingQueue::readSlot(File &file, uint32_t slot, QueuedReading &reading) {
+  if (!file.seek(slot * sizeof(QueuedReading), SeekSet) ||
+      file.read((uint8_t*)&reading, sizeof(reading)) != sizeof(reading)) {
+    return false;
+  }
+  return reading.sequence != 0 && reading.crc == Crc32(&reading, offsetof(QueuedReading, crc));
+}
+
+/*
+ * ReadingQueue::writeState
+ * ------------------------
+ * This method will save the boot id and the last uploaded sequence of each sink
+ */
+bool ReadingQueue::writeState() {
+  uint32_t state[READING_QUEUE_MAX_SINKS + 2];
+  state[0] = _bootId;
+  for (int i = 0; i < READING_QUEUE_MAX_SINKS; i++) {
+    state[i + 1] = _lastSentSequence[i];
+  }
+  state[READING_QUEUE_MAX_SINKS + 1] = Crc32(state, sizeof(state) - 4);
+  File stateFile = LittleFS.open(_stateFileName, "w");
+  if (!stateFile) {
+    return false;
+  }
+  bool written = stateFile.write((const uint8_t*)state, sizeof(state)) == sizeof(state);
+  stateFile.close();
+  return written;
+}
+
+/*
+ * ReadingQueue::push
+ * ------------------
+ * This method will save a new reading captured now at the end of the queue
+ * record: The reading received from the Wixel
+ * returns: false if the reading could not be saved
+ */
+bool ReadingQueue::push(const RawRecord &record) {
+  if (!_started) {
+    return false;
+  }
+  QueuedReading reading;
+  memset(&reading, 0, sizeof(reading));
+  reading.sequence = _lastPushedSequence + 1;
+  reading.bootId = _bootId;
+  reading.captureMillis = millis();
+  time_t now = time(NULL);
+  reading.captureEpoch = now >= (time_t)READING_QUEUE_MIN_EPOCH ? (uint32_t)now : 0;
+  reading.record = record;
+  reading.crc = Crc32(&reading, offsetof(QueuedReading, crc));
+
+  File logFile = LittleFS.open(_logFileName, "r+");
+  if (!logFile) {
+    return false;
+  }
+  bool written = logFile.seek((reading.sequence % READING_QUEUE_CAPACITY) * sizeof(QueuedReading), SeekSet) &&
+                 logFile.write((const uint8_t*)&reading, sizeof(reading)) == sizeof(reading);
+  logFile.close();
+  if (!written) {
+    return false;
+  }
+  _lastPushedSequence = reading.sequence;
+  bool dropped = false;
+  for (int i = 0; i < READING_QUEUE_MAX_SINKS; i++) {
+    if (!isSinkEnabled(i)) {
+      _lastSentSequence[i] = _lastPushedSequence;
+    }
+    else if (_lastPushedSequence - _lastSentSequence[i] > READING_QUEUE_CAPACITY) {
+      // The oldest reading was overwritten before this sink got it
+      _lastSentSequence[i] = _lastPushedSequence - READING_QUEUE_CAPACITY;
+      dropped = true;
+    }
+  }
+  if (dropped) {
+    _droppedCount++;
+    Metrics::count(METRIC_DROPPED_UPLOADS);
+  }
+  return true;
+}
+
+/*
+ * ReadingQueue::peek
+ * ------------------
+ * This method will read the oldest readings not uploaded yet by a sink, in capture order.
+ * The corrupted slots at the front of the sink queue are dropped, the copy stops at the next one
+ * sink: The upload destination
+ * readings: Where to copy the readings
+ * maxCount: Size of the readings array
+ * returns: Number of readings copied
+ */
+unsigned int ReadingQueue::peek(uint8_t sink, QueuedReading* readings, unsigned int maxCount) {
+  unsigned int count = 0;
+  if (!_started || size(sink) == 0) {
+    return 0;
+  }
+  File logFile = LittleFS.open(_logFileName, "r");
+  if (!logFile) {
+    return 0;
+  }
+  unsigned int skipped = 0;
+  for (uint32_t sequence = _lastSentSequence[sink] + 1; sequence <= _lastPushedSequence && count < maxCount; sequence++) {
+    if (readSlot(logFile, sequence % READING_QUEUE_CAPACITY, readings[count]) && readings[count].sequence == sequence) {
+      count++;
+    }
+    else if (count == 0) {
+      // A corrupted slot never becomes readable: acknowledged so the sink does not wait for it forever
+      _lastSentSequence[sink] = sequence;
+      skipped++;
+    }
+    else {
+      // Acknowledged once the readings before it are uploaded
+      break;
+    }
+  }
+  logFile.close();
+  if (skipped > 0) {
+    _droppedCount += skipped;
+    for (unsigned int i = 0; i < skipped; i++) {
+      Metrics::count(METRIC_DROPPED_UPLOADS);
+    }
+    writeState();
+  }
+  return count;
+}
+
+/*
+ * ReadingQueue::acknowledge
+ * -------------------------
+ * This method will remove from the queue of a sink every reading up to the specified one
+ * sink: The upload destination
+ * reading: The last reading uploaded
+ */
+void ReadingQueue::acknowledge(uint8_t sink, const QueuedReading &reading) {
+  if (reading.sequence <= _lastSentSequence[sink] || reading.sequence > _lastPushedSequence) {
+    return;
+  }
+  _lastSentSequence[sink] = reading.sequence;
+  writeState();
+}
+
+/*
+ * ReadingQueue::setSinkEnabled
+ * ----------------------------
+ * This method will start or stop keeping the readings for a sink. An enabled sink starts with the next reading,
+ * a sink enabled since the boot keeps its saved position
+ * sink: The upload destination
+ * enabled: true if the sink uploads readings
+ */
+void ReadingQueue::setSinkEnabled(uint8_t sink, bool enabled) {
+  if (enabled == isSinkEnabled(sink)) {
+    return;
+  }
+  if (enabled) {
+    _enabledSinks |= 1 << sink;
+  }
+  else {
+    _enabledSinks &= ~(1 << sink);
+  }
+  // Disabled sinks follow the newest reading, so they are always up to date when enabled again
+  _lastSentSequence[sink] = _lastPushedSequence;
+}
+
+/*
+ * ReadingQueue::isSinkEnabled
+ * ---------------------------
+ * returns: true if the readings are kept for this sink
+ */
+bool ReadingQueue::isSinkEnabled(uint8_t sink) {
+  return (_enabledSinks & (1 << sink)) != 0;
+}
+
+/*
+ * ReadingQueue::size
+ * ------------------
+ * returns: Number of readings waiting to be uploaded by at least one enabled sink
+ */
+unsigned int ReadingQueue::size() {
+  unsigned int largest = 0;
+  for (int i = 0; i < READING_QUEUE_MAX_SINKS; i++) {
+    unsigned int sinkSize = size(i);
+    if (sinkSize > largest) {
+      largest = sinkSize;
+    }
+  }
+  return largest;
+}
+
+/*
+ * ReadingQueue::size
+ * ------------------
+ * sink: The upload destination
+ * returns: Number of readings waiting to be uploaded by this sink, 0 if it is disabled
+ */
+unsigned int ReadingQueue::size(uint8_t sink) {
+  return isSinkEnabled(sink) ? _lastPushedSequence - _lastSentSequence[sink] : 0;
+}
+
+/*
+ * ReadingQueue::getSentSequence
+ * -----------------------------
+ * returns: Sequence of the last reading uploaded by a sink
+ */
+uint32_t ReadingQueue::getSentSequence(uint8_t sink) {
+  return _lastSentSequence[sink];
+}
+
+/*
+ * ReadingQueue::getBootId
+ * -----------------------
+ * returns: Number of this boot, saved with the readings to compute their age
+ */
+uint32_t ReadingQueue::getBootId() {
+  return _bootId;
+}
+
+/*
+ * ReadingQueue::isDated
+ * ---------------------
+ * This method will tell if the capture time of a reading can be known. A reading of a previous boot
+ * captured before SNTP answered has lost it, millis() restarted since
+ * returns: false if the reading will never have a date
+ */
+bool ReadingQueue::isDated(const QueuedReading &reading) {
+  return reading.bootId == _bootId || reading.captureEpoch != 0;
+}
+
+/*
+ * ReadingQueue::getCaptureAge
+ * ---------------------------
+ * This method will tell how long ago the reading was captured. Readings of this boot use millis(),
+ * readings of a previous boot their wall clock time, which needs SNTP to have answered in this boot too
+ * reading: The reading
+ * age: Where to write the age of the reading in milliseconds
+ * returns: false if the age is not known, see isDated to know if it will be
+ */
+bool ReadingQueue::getCaptureAge(const QueuedReading &reading, unsigned long* age) {
+  if (reading.bootId == _bootId) {
+    *age = millis() - reading.captureMillis;
+    return true;
+  }
+  time_t now = time(NULL);
+  if (reading.captureEpoch == 0 || now < (time_t)READING_QUEUE_MIN_EPOCH) {
+    return false;
+  }
+  *age = now > (time_t)reading.captureEpoch ? (unsigned long)(now - reading.captureEpoch) * 1000 : 0;
+  return true;
+}
+
+/*
+ * ReadingQueue::getDroppedCount
+ * -----------------------------
+ * returns: Number of readings overwritten or corrupted before they could be uploaded
+ */
+uint32_t ReadingQueue::getDroppedCount() {
+  return _droppedCount;
+}
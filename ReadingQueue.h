@@ -0,0 +1,64 @@
+#ifndef ReadingQueue_h
+#define ReadingQueue_h
+
+#include <LittleFS.h>
+#include "Arduino.h"
+#include "WixelProtocol.h"
+
+// One day of readings at one reading every 5 minutes
+#define READING_QUEUE_CAPACITY 288
+// Files of the first queue, the next ones have their number added: /readings2.log, /readings2.pos...
+#define READING_QUEUE_FILE "/readings.log"
+#define READING_QUEUE_STATE_FILE "/readings.pos"
+#define READING_QUEUE_MAX_FILE_NAME_LENGTH 24
+// Number of upload destinations, each one has its own position in the queue
+#define READING_QUEUE_MAX_SINKS 3
+// time() is set by SNTP once the wifi is joined, it is the wall clock once it is later than this
+#define READING_QUEUE_MIN_EPOCH 1500000000UL
+
+/*
+ * A reading waiting to be uploaded as saved in flash
+ */
+struct QueuedReading {
+  uint32_t sequence; // 0 means the slot was never used
+  uint32_t bootId; // Boot when the reading was captured
+  uint32_t captureMillis; // millis() when the reading was captured
+  uint32_t captureEpoch; // time() when the reading was captured, 0 if SNTP had not answered yet
+  RawRecord record;
+  uint32_t crc;
+};
+
+/*
+ * Persistent ring log of the readings of one Wixel not uploaded yet.
+ * Every upload destination (sink) reads the same log from its own position
+ */
+class ReadingQueue {
+  public:
+    ReadingQueue();
+    bool begin(uint8_t number);
+    bool push(const RawRecord &record);
+    unsigned int peek(uint8_t sink, QueuedReading* readings, unsigned int maxCount);
+    void acknowledge(uint8_t sink, const QueuedReading &reading);
+    void setSinkEnabled(uint8_t sink, bool enabled);
+    bool isSinkEnabled(uint8_t sink);
+    unsigned int size();
+    unsigned int size(uint8_t sink);
+    uint32_t getSentSequence(uint8_t sink);
+    uint32_t getBootId();
+    bool isDated(const QueuedReading &reading);
+    bool getCaptureAge(const QueuedReading &reading, unsigned long* age);
+    uint32_t getDroppedCount();
+  private:
+    bool readSlot(File &file, uint32_t slot, QueuedReading &reading);
+    bool writeState();
+    char _logFileName[READING_QUEUE_MAX_FILE_NAME_LENGTH];
+    char _stateFileName[READING_QUEUE_MAX_FILE_NAME_LENGTH];
+    bool _started;
+    uint32_t _bootId;
+    uint32_t _lastPushedSequence;
+    uint32_t _lastSentSequence[READING_QUEUE_MAX_SINKS];
+    uint8_t _enabledSinks;
+    uint32_t _droppedCount;
+};
+
+#endif
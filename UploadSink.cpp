@@ -0,0 +1,429 @@
+/*
+ * UploadSink - Library for uploading the queued readings to one destination without blocking
+ *
+ * Readings are sent oldest first, by batches of UPLOAD_SINK_BATCH_SIZE, one request per reading.
+ * With several Wixels each batch comes from one reading queue, the next batch from the next queue with readings,
+ * so a Wixel with a long backlog does not delay the readings of the other ones.
+ * The upload stops at the first reading that could not be sent and starts again after UPLOAD_SINK_RETRY_INTERVAL
+ * or when a new reading is captured. When the server keeps failing the interval doubles at each try, up to
+ * UPLOAD_SINK_MAX_RETRY_INTERVAL, and new readings wait for it too. The position in the queue is saved once per batch.
+ */
+#include "UploadSink.h"
+
+/*
+ * Constructor
+ */
+UploadSink::UploadSink() {
+  _id = 0;
+  _name = "";
+  _format = UPLOAD_FORMAT_RECEIVER;
+  _histogram = METRIC_SEND_APP_ENGINE_DATA;
+  _queueCount = 0;
+  _batchQueue = 0;
+  _nextQueue = 0;
+  _host[0] = '\0';
+  _port = HTTP_PORT;
+  _headers[0] = '\0';
+  _batchCount = 0;
+  _batchSent = 0;
+  _uploadRequested = false;
+  _lastAttemptMillis = 0;
+  _failureCount = 0;
+  _startMicros = 0;
+  _responded = false;
+  _lastStatus = -1;
+  _uploadedQueue = 0;
+  _hasUploadedReading = false;
+  for (int i = 0; i < WIXEL_PORT_COUNT; i++) {
+    _readingQueues[i] = NULL;
+    _uploadedSequence[i] = 0;
+  }
+}
+
+/*
+ * UploadSink::begin
+ * -----------------
+ * This method will set what the sink is. The sink stays disabled until it has an address
+ * id: Position of the sink in the reading queues
+ * name: Name used in the status and debug text
+ * format: How the readings are written for this sink
+ * histogram: Where the request durations are measured
+ * readingQueues: The reading queue of each Wixel, started already
+ * queueCount: Number of reading queues, at most WIXEL_PORT_COUNT
+ */
+void UploadSink::begin(uint8_t id, const char* name, UploadFormat format, MetricHistogram histogram,
+                       ReadingQueue* const* readingQueues, uint8_t queueCount) {
+  _id = id;
+  _name = name;
+  _format = format;
+  _histogram = histogram;
+  _queueCount = queueCount < WIXEL_PORT_COUNT ? queueCount : WIXEL_PORT_COUNT;
+  for (int i = 0; i < _queueCount; i++) {
+    _readingQueues[i] = readingQueues[i];
+    _uploadedSequence[i] = _readingQueues[i]->getSentSequence(_id);
+  }
+}
+
+/*
+ * UploadSink::parseAddress
+ * ------------------------
+ * This method will split an upload address in its host and port. The client only speaks plain HTTP
+ * address: host[:port], an http:// prefix and a path are ignored. Empty for no server
+ * host: Where to write the host, HTTP_CLIENT_MAX_HOST_LENGTH bytes
+ * port: Where to write the port, HTTP_PORT when the address has none
+ * returns: false if the address has another scheme, a host too long or a bad port
+ */
+bool UploadSink::parseAddress(const char* address, char* host, uint16_t* port) {
+  host[0] = '\0';
+  *port = HTTP_PORT;
+  if (strncmp(address, "http://", 7) == 0) {
+    address += 7;
+  }
+  else if (strstr(address, "://") != NULL) {
+    // https:// and the others
+    return false;
+  }
+  size_t length = strcspn(address, ":/");
+  if (length >= HTTP_CLIENT_MAX_HOST_LENGTH || (length == 0 && address[0] != '\0')) {
+    return false;
+  }
+  if (address[length] == ':') {
+    char* end;
+    unsigned long value = strtoul(&address[length + 1], &end, 10);
+    if (!isdigit(address[length + 1]) || value == 0 || value > 65535 || (*end != '\0' && *end != '/')) {
+      return false;
+    }
+    *port = value;
+  }
+  memcpy(host, address, length);
+  host[length] = '\0';
+  return true;
+}
+
+/*
+ * UploadSink::setAddress
+ * ----------------------
+ * This method will change the server, the current request ends on the previous one.
+ * An empty or unusable address disables the sink and its readings are not kept anymore
+ * address: host[:port], an http:// prefix and a path are ignored
+ */
+void UploadSink::setAddress(const char* address) {
+  if (!parseAddress(address, _host, &_port)) {
+    // Never send the readings to a host made of the wrong part of the address
+    _host[0] = '\0';
+    _port = HTTP_PORT;
+  }
+  for (int i = 0; i < _queueCount; i++) {
+    _readingQueues[i]->setSinkEnabled(_id, isEnabled());
+  }
+}
+
+/*
+ * UploadSink::setHeaders
+ * ----------------------
+ * This method will change the header lines added to each request
+ * headers: Header lines, each one ending with \r\n
+ */
+void UploadSink::setHeaders(const char* headers) {
+  strncpy(_headers, headers, sizeof(_headers) - 1);
+  _headers[sizeof(_headers) - 1] = '\0';
+}
+
+/*
+ * UploadSink::loop
+ * ----------------
+ * This method will move the current request forward, handle its response and get the next reading to send
+ * canConnect: false while there is no wifi, the queued readings wait
+ * mayBlock: false to hold back the server lookup and the connection, see HttpClient::loop
+ * returns: The reading to send now with send or postpone, NULL if there is nothing to send
+ */
+const QueuedReading* UploadSink::loop(bool canConnect, bool mayBlock) {
+  _responded = false;
+  _hasUploadedReading = false;
+  HttpRequestState state = _client.loop(mayBlock);
+  if (state == HTTP_DONE || state == HTTP_FAILED) {
+    _responded = true;
+    _lastStatus = _client.getStatus();
+    _client.finish();
+    Metrics::observe(_histogram, micros() - _startMicros);
+    // Server errors are retried later, a rejected reading would be rejected again
+    if (_lastStatus > 0 && _lastStatus < 500) {
+      _failureCount = 0;
+      if (_lastStatus >= 400) {
+        Metrics::count(METRIC_DROPPED_UPLOADS);
+      }
+      if (_batchSent < _batchCount) {
+        // Copied, the batch is read again from the queue below
+        _uploadedReading = _batch[_batchSent];
+        _uploadedQueue = _batchQueue;
+        _hasUploadedReading = true;
+        if (_uploadedReading.sequence > _uploadedSequence[_batchQueue]) {
+          _uploadedSequence[_batchQueue] = _uploadedReading.sequence;
+        }
+        _batchSent++;
+      }
+    }
+    else {
+      _failureCount++;
+      endBatch(true);
+      return NULL;
+    }
+  }
+  if (_client.isBusy()) {
+    return NULL;
+  }
+
+  if (_batchSent == _batchCount) {
+    endBatch(false);
+    if (!isEnabled() || getQueuedCount() == 0) {
+      _uploadRequested = false;
+      return NULL;
+    }
+    if (millis() - _lastAttemptMillis < getRetryInterval() &&
+        (!_uploadRequested || _failureCount >= UPLOAD_SINK_DOWN_FAILURES)) {
+      return NULL;
+    }
+    if (!canConnect) {
+      // Readings wait in flash until the wifi manager joins a network
+      return NULL;
+    }
+    _uploadRequested = true;
+    for (int i = 0; i < _queueCount && _batchCount == 0; i++) {
+      // Round robin over the queues with readings
+      uint8_t queue = (_nextQueue + i) % _queueCount;
+      _batchCount = _readingQueues[queue]->peek(_id, _batch, UPLOAD_SINK_BATCH_SIZE);
+      _batchQueue = queue;
+    }
+    _nextQueue = (_batchQueue + 1) % _queueCount;
+    if (_batchCount == 0) {
+      return NULL;
+    }
+  }
+  return &_batch[_batchSent];
+}
+
+/*
+ * UploadSink::send
+ * ----------------
+ * This method will start the request of the reading given by loop
+ * method: GET or POST
+ * path: The path and query to request
+ * body: The body, NULL for a GET
+ * returns: false if the request could not be started, the batch is retried later
+ */
+bool UploadSink::send(const char* method, const char* path, const char* body) {
+  _startMicros = micros();
+  if (!_client.begin(_host, _port, method, path, _headers[0] != '\0' ? _headers : NULL, body)) {
+    endBatch(true);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * UploadSink::sendDirect
+ * ----------------------
+ * This method will send a reading which is not in the queue, when it could not be saved
+ * queue: The reading queue of the Wixel which sent the reading
+ * reading: The reading, with the sequence 0 so it is never acknowledged
+ * returns: false if the sink is disabled or busy
+ */
+bool UploadSink::sendDirect(uint8_t queue, const QueuedReading &reading) {
+  if (!isEnabled() || isBusy() || queue >= _queueCount) {
+    return false;
+  }
+  _batchQueue = queue;
+  _batch[0] = reading;
+  _batchCount = 1;
+  _batchSent = 0;
+  return true;
+}
+
+/*
+ * UploadSink::postpone
+ * --------------------
+ * This method will keep the reading given by loop for the next try, when it can't be written now
+ */
+void UploadSink::postpone() {
+  endBatch(true);
+}
+
+/*
+ * UploadSink::skip
+ * ----------------
+ * This method will drop the reading given by loop, when it can never be written (its date is lost).
+ * It is removed from the queue of this sink with the uploaded readings of the batch
+ */
+void UploadSink::skip() {
+  if (_batchSent < _batchCount) {
+    Metrics::count(METRIC_DROPPED_UPLOADS);
+    if (_batch[_batchSent].sequence > _uploadedSequence[_batchQueue]) {
+      _uploadedSequence[_batchQueue] = _batch[_batchSent].sequence;
+    }
+    _batchSent++;
+  }
+}
+
+/*
+ * UploadSink::requestUpload
+ * -------------------------
+ * This method will upload the queued readings without waiting for the retry interval
+ */
+void UploadSink::requestUpload() {
+  _uploadRequested = true;
+}
+
+/*
+ * UploadSink::endBatch
+ * --------------------
+ * This method will remove the uploaded readings of the current batch from the queue of this sink
+ * retryLater: true if the upload failed and should wait UPLOAD_SINK_RETRY_INTERVAL
+ */
+void UploadSink::endBatch(bool retryLater) {
+  if (_batchSent > 0) {
+    // One flash write for the whole batch
+    _readingQueues[_batchQueue]->acknowledge(_id, _batch[_batchSent - 1]);
+  }
+  _batchCount = 0;
+  _batchSent = 0;
+  if (retryLater) {
+    _uploadRequested = false;
+    _lastAttemptMillis = millis();
+  }
+}
+
+/*
+ * UploadSink::getRetryInterval
+ * ----------------------------
+ * returns: The delay in milliseconds before the next try, longer after each failed one
+ */
+unsigned long UploadSink::getRetryInterval() {
+  unsigned long interval = UPLOAD_SINK_RETRY_INTERVAL;
+  for (uint32_t i = 1; i < _failureCount && interval < UPLOAD_SINK_MAX_RETRY_INTERVAL; i++) {
+    interval *= 2;
+  }
+  return interval < UPLOAD_SINK_MAX_RETRY_INTERVAL ? interval : UPLOAD_SINK_MAX_RETRY_INTERVAL;
+}
+
+/*
+ * UploadSink::hasResponse
+ * -----------------------
+ * returns: true if the last loop call ended a request, its status is getLastStatus
+ */
+bool UploadSink::hasResponse() {
+  return _responded;
+}
+
+/*
+ * UploadSink::getUploadedReading
+ * ------------------------------
+ * returns: The reading the last loop call got a final answer for, NULL if none
+ */
+const QueuedReading* UploadSink::getUploadedReading() {
+  return _hasUploadedReading ? &_uploadedReading : NULL;
+}
+
+/*
+ * UploadSink::getUploadedQueue
+ * ----------------------------
+ * returns: The reading queue of the reading given by getUploadedReading
+ */
+uint8_t UploadSink::getUploadedQueue() {
+  return _uploadedQueue;
+}
+
+/*
+ * UploadSink::getUploadedSequence
+ * -------------------------------
+ * queue: The reading queue
+ * returns: Sequence of the last reading of this queue uploaded, saved in the queue or not
+ */
+uint32_t UploadSink::getUploadedSequence(uint8_t queue) {
+  uint32_t savedSequence = _readingQueues[queue]->getSentSequence(_id);
+  return _uploadedSequence[queue] > savedSequence ? _uploadedSequence[queue] : savedSequence;
+}
+
+/*
+ * UploadSink::getBatchQueue
+ * -------------------------
+ * returns: The reading queue of the reading given by loop
+ */
+uint8_t UploadSink::getBatchQueue() {
+  return _batchQueue;
+}
+
+/*
+ * UploadSink::getQueuedCount
+ * --------------------------
+ * returns: Number of readings waiting for this sink in all the queues
+ */
+unsigned int UploadSink::getQueuedCount() {
+  unsigned int count = 0;
+  for (int i = 0; i < _queueCount; i++) {
+    count += _readingQueues[i]->size(_id);
+  }
+  return count;
+}
+
+/*
+ * UploadSink::getLastStatus
+ * -------------------------
+ * returns: The HTTP status of the last response, -1 if it failed or nothing was sent yet
+ */
+int UploadSink::getLastStatus() {
+  return _lastStatus;
+}
+
+/*
+ * UploadSink::isEnabled
+ * ---------------------
+ * returns: true if the sink has an address
+ */
+bool UploadSink::isEnabled() {
+  return _host[0] != '\0';
+}
+
+/*
+ * UploadSink::isBusy
+ * ------------------
+ * returns: true while a request or a batch is running
+ */
+bool UploadSink::isBusy() {
+  return _client.isBusy() || _batchSent < _batchCount;
+}
+
+/*
+ * UploadSink::getId
+ * -----------------
+ * returns: Position of the sink in the reading queue
+ */
+uint8_t UploadSink::getId() {
+  return _id;
+}
+
+/*
+ * UploadSink::getName
+ * -------------------
+ * returns: Name used in the status and debug text
+ */
+const char* UploadSink::getName() {
+  return _name;
+}
+
+/*
+ * UploadSink::getFormat
+ * ---------------------
+ * returns: How the readings are written for this sink
+ */
+UploadFormat UploadSink::getFormat() {
+  return _format;
+}
+
+/*
+ * UploadSink::getClient
+ * ---------------------
+ * returns: The connection of this sink, for its counters
+ */
+HttpClient* UploadSink::getClient() {
+  return &_client;
+}
@@ -0,0 +1,92 @@
+#ifndef UploadSink_h
+#define UploadSink_h
+
+#include "Arduino.h"
+#include "HttpClient.h"
+#include "ReadingQueue.h"
+#include "Metrics.h"
+
+// Number of queued readings sent before saving the queue position
+#define UPLOAD_SINK_BATCH_SIZE 8
+// Delay in milliseconds between two tries to upload the queued readings
+#define UPLOAD_SINK_RETRY_INTERVAL 30000
+// The delay doubles at each failed try in a row, up to this one
+#define UPLOAD_SINK_MAX_RETRY_INTERVAL 300000
+// Failed tries in a row after which new readings wait for the retry too, the server is likely down
+#define UPLOAD_SINK_DOWN_FAILURES 2
+// More header lines sent with each request
+#define UPLOAD_SINK_MAX_HEADERS_LENGTH 96
+
+/*
+ * How the readings are written for a sink
+ */
+enum UploadFormat {
+  UPLOAD_FORMAT_RECEIVER, // Parakeet receiver.cgi GET
+  UPLOAD_FORMAT_NIGHTSCOUT, // JSON entries POST to /api/v1/entries
+  UPLOAD_FORMAT_COUNT
+};
+
+/*
+ * One upload destination: its own connection, its own position in each reading queue and its own batch.
+ * loop gives the next reading to send, the caller writes it in the sink format and calls send
+ */
+class UploadSink {
+  public:
+    UploadSink();
+    static bool parseAddress(const char* address, char* host, uint16_t* port);
+    void begin(uint8_t id, const char* name, UploadFormat format, MetricHistogram histogram,
+               ReadingQueue* const* readingQueues, uint8_t queueCount);
+    void setAddress(const char* address);
+    void setHeaders(const char* headers);
+    const QueuedReading* loop(bool canConnect, bool mayBlock);
+    bool send(const char* method, const char* path, const char* body);
+    bool sendDirect(uint8_t queue, const QueuedReading &reading);
+    void postpone();
+    void skip();
+    void requestUpload();
+    bool hasResponse();
+    const QueuedReading* getUploadedReading();
+    uint8_t getUploadedQueue();
+    uint32_t getUploadedSequence(uint8_t queue);
+    uint8_t getBatchQueue();
+    unsigned int getQueuedCount();
+    int getLastStatus();
+    bool isEnabled();
+    bool isBusy();
+    uint8_t getId();
+    const char* getName();
+    UploadFormat getFormat();
+    HttpClient* getClient();
+  private:
+    void endBatch(bool retryLater);
+    unsigned long getRetryInterval();
+    uint8_t _id;
+    const char* _name;
+    UploadFormat _format;
+    MetricHistogram _histogram;
+    ReadingQueue* _readingQueues[WIXEL_PORT_COUNT];
+    uint8_t _queueCount;
+    // Queue of the current batch, and the one looked at first for the next batch
+    uint8_t _batchQueue;
+    uint8_t _nextQueue;
+    HttpClient _client;
+    char _host[HTTP_CLIENT_MAX_HOST_LENGTH];
+    uint16_t _port;
+    char _headers[UPLOAD_SINK_MAX_HEADERS_LENGTH];
+    QueuedReading _batch[UPLOAD_SINK_BATCH_SIZE];
+    unsigned int _batchCount;
+    unsigned int _batchSent;
+    bool _uploadRequested;
+    unsigned long _lastAttemptMillis;
+    // Tries without any answer or with a server error, in a row
+    uint32_t _failureCount;
+    unsigned long _startMicros;
+    bool _responded;
+    int _lastStatus;
+    QueuedReading _uploadedReading;
+    uint8_t _uploadedQueue;
+    bool _hasUploadedReading;
+    uint32_t _uploadedSequence[WIXEL_PORT_COUNT];
+};
+
+#endif
@@ -0,0 +1,414 @@
+/*
+ * Uploader - Library for sending the readings to every configured destination at the same time
+ *
+ * Sinks: App Engine (Parakeet receiver.cgi GET), Nightscout (POST /api/v1/entries) and a local receiver
+ * on the LAN (same JSON as Nightscout, any HTTP server accepting the POST will do).
+ * The sinks share the reading queues (one per Wixel), each one from its own position, and are all moved forward at each loop
+ * so the upload of a reading takes as long as the slowest sink, not the sum of them.
+ * The server lookup and the connection block the main loop, so only one sink may take one of them per loop call,
+ * round robin, and a server which is down costs at most HTTP_CLIENT_CONNECT_TIMEOUT per loop call.
+ * A reading is written once per format and the text is reused by every sink of that format.
+ */
+#include <Hash.h>
+#include "Uploader.h"
+
+/*
+ * Constructor
+ */
+Uploader::Uploader() {
+  _configuration = NULL;
+  _queueCount = 0;
+  _wifiManager = NULL;
+  _debugLogger = NULL;
+  _configurationVersion = 0;
+  _nextConnectSink = 0;
+  _receiverPath[0] = '\0';
+  _receiverPrefixLength = 0;
+  _nightscoutBody[0] = '\0';
+  for (int i = 0; i < UPLOAD_FORMAT_COUNT; i++) {
+    _serializedValid[i] = false;
+    _serializedQueue[i] = 0;
+    _serializedSequence[i] = 0;
+    _serializedCaptureMillis[i] = 0;
+  }
+  _anchorEpochMillis = 0;
+  _anchorMillis = 0;
+}
+
+void Uploader::setConfiguration(Configuration* configuration) {
+  _configuration = configuration;
+}
+
+/*
+ * Uploader::addReadingQueue
+ * -------------------------
+ * This method will upload the readings of one more Wixel, called for each Wixel before begin
+ * readingQueue: The reading queue of the Wixel, its number is the order of the calls
+ */
+void Uploader::addReadingQueue(ReadingQueue* readingQueue) {
+  if (_queueCount < WIXEL_PORT_COUNT) {
+    _readingQueues[_queueCount++] = readingQueue;
+  }
+}
+
+void Uploader::setWifiManager(WifiManager* wifiManager) {
+  _wifiManager = wifiManager;
+}
+
+void Uploader::setDebugLogger(DebugLogger* debugLogger) {
+  _debugLogger = debugLogger;
+}
+
+/*
+ * Uploader::begin
+ * ---------------
+ * This method will create the sinks from the configuration. The reading queues must be started
+ */
+void Uploader::begin() {
+  _sinks[UPLOAD_SINK_APP_ENGINE].begin(UPLOAD_SINK_APP_ENGINE, "appEngine", UPLOAD_FORMAT_RECEIVER,
+                                       METRIC_SEND_APP_ENGINE_DATA, _readingQueues, _queueCount);
+  _sinks[UPLOAD_SINK_NIGHTSCOUT].begin(UPLOAD_SINK_NIGHTSCOUT, "nightscout", UPLOAD_FORMAT_NIGHTSCOUT,
+                                       METRIC_SEND_NIGHTSCOUT_DATA, _readingQueues, _queueCount);
+  _sinks[UPLOAD_SINK_LOCAL].begin(UPLOAD_SINK_LOCAL, "local", UPLOAD_FORMAT_NIGHTSCOUT,
+                                  METRIC_SEND_LOCAL_DATA, _readingQueues, _queueCount);
+  updateSinks();
+  // Nightscout entries have the date of the reading, SNTP starts when the wifi is joined
+  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+}
+
+/*
+ * Uploader::updateSinks
+ * ---------------------
+ * This method will give the configured addresses and the Nightscout API secret to the sinks
+ */
+void Uploader::updateSinks() {
+  _configurationVersion = _configuration->getVersion();
+  _sinks[UPLOAD_SINK_APP_ENGINE].setAddress(_configuration->getAppEngineAddress());
+  _sinks[UPLOAD_SINK_NIGHTSCOUT].setAddress(_configuration->getNightscoutAddress());
+  _sinks[UPLOAD_SINK_LOCAL].setAddress(_configuration->getLocalAddress());
+
+  char headers[UPLOAD_SINK_MAX_HEADERS_LENGTH] = "Content-Type: application/json\r\n";
+  _sinks[UPLOAD_SINK_LOCAL].setHeaders(headers);
+  const char* secret = _configuration->getNightscoutSecret();
+  if (secret[0] != '\0') {
+    // Nightscout expects the SHA-1 of the secret in hexadecimal
+    uint8_t hash[20];
+    sha1((const uint8_t*)secret, strlen(secret), hash);
+    size_t length = strlen(headers);
+    length += snprintf(&headers[length], sizeof(headers) - length, "api-secret: ");
+    for (int i = 0; i < 20; i++) {
+      length += snprintf(&headers[length], sizeof(headers) - length, "%02x", hash[i]);
+    }
+    snprintf(&headers[length], sizeof(headers) - length, "\r\n");
+  }
+  _sinks[UPLOAD_SINK_NIGHTSCOUT].setHeaders(headers);
+}
+
+/*
+ * Uploader::loop
+ * --------------
+ * This method is called at each loop and moves every sink forward without blocking
+ */
+void Uploader::loop() {
+  if (_configuration->getVersion() != _configurationVersion) {
+    updateSinks();
+  }
+  bool canConnect = _wifiManager->isConnected();
+  bool mayBlock = true;
+  uint8_t firstSink = _nextConnectSink;
+  for (int n = 0; n < UPLOAD_SINK_COUNT; n++) {
+    uint8_t i = (firstSink + n) % UPLOAD_SINK_COUNT;
+    UploadSink &sink = _sinks[i];
+    const QueuedReading* reading = sink.loop(canConnect, mayBlock);
+    if (sink.getClient()->hasBlocked()) {
+      // The other sinks wait for the next loop call, the next one gets the first turn
+      mayBlock = false;
+      _nextConnectSink = (i + 1) % UPLOAD_SINK_COUNT;
+    }
+    if (sink.hasResponse()) {
+      logResponse(sink);
+    }
+    const QueuedReading* uploaded = sink.getUploadedReading();
+    uint8_t queue = sink.getUploadedQueue();
+    unsigned long captureAge;
+    if (uploaded != NULL && uploaded->sequence != 0 && isUploadedEverywhere(queue, uploaded->sequence) &&
+        _readingQueues[queue]->getCaptureAge(*uploaded, &captureAge)) {
+      // Readings are acknowledged to the Wixel when captured. Clamped to 32 bits, it is over the last bucket anyway
+      Metrics::observe(METRIC_ACK_TO_UPLOAD, captureAge < 4000000 ? captureAge * 1000 : 4000000000UL);
+    }
+    if (reading != NULL) {
+      sendReading(sink, *reading);
+    }
+  }
+}
+
+/*
+ * Uploader::sendReading
+ * ---------------------
+ * This method will start the request of one reading for a sink
+ * sink: The sink which asked for the reading
+ * reading: The reading to send
+ */
+void Uploader::sendReading(UploadSink &sink, const QueuedReading &reading) {
+  const char* text = serialize(sink.getFormat(), sink.getBatchQueue(), reading);
+  if (text == NULL) {
+    if (_readingQueues[sink.getBatchQueue()]->isDated(reading)) {
+      // Date not known yet
+      sink.postpone();
+    }
+    else {
+      // Both formats need the capture date, a guessed one would put the reading at the wrong time
+      _debugLogger->beginLine(LOG_WARNING);
+      if (_debugLogger->isEnabled()) {
+        _debugLogger->print("Reading of a previous boot without date dropped\r\n");
+      }
+      sink.skip();
+    }
+    return;
+  }
+  if (_debugLogger->isEnabled()) {
+    _debugLogger->print("Sending to ");
+    _debugLogger->print(sink.getName());
+    _debugLogger->print(": ");
+    _debugLogger->print(text);
+    _debugLogger->print("\r\n");
+  }
+  if (sink.getFormat() == UPLOAD_FORMAT_RECEIVER) {
+    sink.send("GET", text, NULL);
+  }
+  else {
+    sink.send("POST", "/api/v1/entries", text);
+  }
+}
+
+/*
+ * Uploader::serialize
+ * -------------------
+ * This method will write a reading in a format, or reuse the text already written for it.
+ * The ts value of the receiver path is the age of the reading, it is written again at each call
+ * format: The sink format
+ * queue: The reading queue of the reading, sequences are counted per queue
+ * reading: The reading to write
+ * returns: The receiver.cgi path or the Nightscout body, NULL if the date of the reading is not known
+ */
+const char* Uploader::serialize(UploadFormat format, uint8_t queue, const QueuedReading &reading) {
+  char* text = format == UPLOAD_FORMAT_RECEIVER ? _receiverPath : _nightscoutBody;
+  unsigned long captureAge;
+  if (!_readingQueues[queue]->getCaptureAge(reading, &captureAge)) {
+    return NULL;
+  }
+  const RawRecord &record = reading.record;
+  // Readings sent directly all have the sequence 0, they are never reused
+  bool written = _serializedValid[format] && reading.sequence != 0 && _serializedQueue[format] == queue &&
+                 _serializedSequence[format] == reading.sequence &&
+                 _serializedCaptureMillis[format] == reading.captureMillis;
+  if (format == UPLOAD_FORMAT_RECEIVER) {
+    if (!written) {
+      _receiverPrefixLength = snprintf(_receiverPath, sizeof(_receiverPath),
+                                       "/receiver.cgi?zi=%lu&pc=0&lv=%lu&lf=%lu&db=%u&ts=",
+                                       (unsigned long)record.dex_src_id, (unsigned long)record.raw,
+                                       (unsigned long)record.filtered, record.dex_battery);
+    }
+    // ts is the age of the reading in milliseconds, the receiver computes the capture date time
+    snprintf(&_receiverPath[_receiverPrefixLength], sizeof(_receiverPath) - _receiverPrefixLength,
+             "%lu&bp=%u&bm=3755&ct=22&gl=0", captureAge, record.my_battery);
+  }
+  else if (!written) {
+    uint64_t date;
+    if (!getCaptureDate(queue, reading, &date)) {
+      return NULL;
+    }
+    char transmitterId[DEXCOM_ID_LENGTH + 1];
+    _dexcomHelper.DexcomSrcToAscii(record.dex_src_id, transmitterId);
+    JsonWriter json(_nightscoutBody, sizeof(_nightscoutBody));
+    json.beginArray();
+    json.beginObject();
+    json.key("device");
+    json.value("wifi-xBridge");
+    json.key("type");
+    json.value("raw");
+    // The capture date does not change, the body can be sent again as it is
+    json.key("date");
+    json.value((unsigned long long)date);
+    json.key("unfiltered");
+    json.value((unsigned long)record.raw);
+    json.key("filtered");
+    json.value((unsigned long)record.filtered);
+    json.key("battery");
+    json.value((unsigned int)record.dex_battery);
+    json.key("uploaderBattery");
+    json.value((unsigned int)record.my_battery);
+    json.key("transmitterId");
+    json.value(transmitterId);
+    json.endObject();
+    json.endArray();
+  }
+  _serializedValid[format] = reading.sequence != 0;
+  _serializedQueue[format] = queue;
+  _serializedSequence[format] = reading.sequence;
+  _serializedCaptureMillis[format] = reading.captureMillis;
+  return text;
+}
+
+/*
+ * Uploader::getCaptureDate
+ * ------------------------
+ * This method will tell the wall clock time of a capture. time() only counts seconds, so it is taken once and
+ * followed with millis(): a reading written again for another sink gets the very same date
+ * queue: The reading queue of the reading
+ * reading: The reading
+ * date: Where to write the capture time in milliseconds since 1970
+ * returns: false if SNTP did not answer yet
+ */
+bool Uploader::getCaptureDate(uint8_t queue, const QueuedReading &reading, uint64_t* date) {
+  unsigned long currentMillis = millis();
+  if (_anchorEpochMillis == 0 || currentMillis - _anchorMillis > UPLOADER_CLOCK_ANCHOR_LIFETIME) {
+    time_t now = time(NULL);
+    if (now < (time_t)READING_QUEUE_MIN_EPOCH) {
+      return false;
+    }
+    _anchorEpochMillis = (uint64_t)now * 1000;
+    _anchorMillis = currentMillis;
+  }
+  if (reading.bootId == _readingQueues[queue]->getBootId()) {
+    *date = _anchorEpochMillis + (int32_t)(reading.captureMillis - _anchorMillis);
+  }
+  else {
+    // millis() of a previous boot, only the wall clock of the capture is known
+    *date = (uint64_t)reading.captureEpoch * 1000;
+  }
+  return true;
+}
+
+/*
+ * Uploader::isUploadedEverywhere
+ * ------------------------------
+ * returns: true if every enabled sink got a final answer for the reading of this queue
+ */
+bool Uploader::isUploadedEverywhere(uint8_t queue, uint32_t sequence) {
+  for (int i = 0; i < UPLOAD_SINK_COUNT; i++) {
+    if (_sinks[i].isEnabled() && _sinks[i].getUploadedSequence(queue) < sequence) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Uploader::logResponse
+ * ---------------------
+ * This method will send the result of a request to the debug logger
+ */
+void Uploader::logResponse(UploadSink &sink) {
+  int status = sink.getLastStatus();
+  if (status < 0 || status >= 500) {
+    _debugLogger->beginLine(LOG_WARNING);
+  }
+  if (!_debugLogger->isEnabled()) {
+    return;
+  }
+  HttpClient* client = sink.getClient();
+  _debugLogger->print(sink.getName());
+  _debugLogger->print(" response status: ");
+  _debugLogger->print(status);
+  _debugLogger->print("\r\nConnection reused: ");
+  _debugLogger->print(client->getReuseCount());
+  _debugLogger->print(" reconnected: ");
+  _debugLogger->print(client->getReconnectCount());
+  _debugLogger->print(" failed: ");
+  _debugLogger->print(client->getFailedConnectionCount());
+  _debugLogger->print(" timeouts: ");
+  _debugLogger->print(client->getTimeoutCount());
+  _debugLogger->print(" readings kept: ");
+  _debugLogger->print(sink.getQueuedCount());
+  _debugLogger->print("\r\n");
+}
+
+/*
+ * Uploader::requestUpload
+ * -----------------------
+ * This method will upload the queued readings now, called when a reading is captured
+ */
+void Uploader::requestUpload() {
+  for (int i = 0; i < UPLOAD_SINK_COUNT; i++) {
+    _sinks[i].requestUpload();
+  }
+}
+
+/*
+ * Uploader::sendDirect
+ * --------------------
+ * This method will send a reading which could not be saved in the queue to the idle sinks
+ * queue: The reading queue of the Wixel which sent the reading
+ * record: The reading received from the Wixel
+ * returns: true if at least one sink will send it
+ */
+bool Uploader::sendDirect(uint8_t queue, const RawRecord &record) {
+  if (queue >= _queueCount) {
+    return false;
+  }
+  QueuedReading reading;
+  memset(&reading, 0, sizeof(reading));
+  reading.bootId = _readingQueues[queue]->getBootId();
+  reading.captureMillis = millis();
+  reading.record = record;
+  bool started = false;
+  for (int i = 0; i < UPLOAD_SINK_COUNT; i++) {
+    started = _sinks[i].sendDirect(queue, reading) || started;
+  }
+  return started;
+}
+
+/*
+ * Uploader::isBusy
+ * ----------------
+ * returns: true while a sink is sending
+ */
+bool Uploader::isBusy() {
+  for (int i = 0; i < UPLOAD_SINK_COUNT; i++) {
+    if (_sinks[i].isBusy()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Uploader::size
+ * --------------
+ * returns: Number of readings of all the Wixels waiting to be uploaded by at least one sink
+ */
+unsigned int Uploader::size() {
+  unsigned int count = 0;
+  for (int i = 0; i < _queueCount; i++) {
+    count += _readingQueues[i]->size();
+  }
+  return count;
+}
+
+/*
+ * Uploader::writeJson
+ * -------------------
+ * This method will write the state of the sinks:
+ * [{"name":"appEngine","enabled":true,"busy":false,"queued":0,"status":200},...]
+ * json: Where to write the sinks
+ */
+void Uploader::writeJson(JsonWriter &json) {
+  json.beginArray();
+  for (int i = 0; i < UPLOAD_SINK_COUNT; i++) {
+    UploadSink &sink = _sinks[i];
+    json.beginObject();
+    json.key("name");
+    json.value(sink.getName());
+    json.key("enabled");
+    json.value(sink.isEnabled());
+    json.key("busy");
+    json.value(sink.isBusy());
+    json.key("queued");
+    json.value(sink.getQueuedCount());
+    json.key("status");
+    json.value(sink.getLastStatus());
+    json.endObject();
+  }
+  json.endArray();
+}
@@ -0,0 +1,79 @@
+#ifndef Uploader_h
+#define Uploader_h
+
+#include "Arduino.h"
+#include "Configuration.h"
+#include "ReadingQueue.h"
+#include "WifiManager.h"
+#include "DebugLogger.h"
+#include "DexcomHelper.h"
+#include "JsonWriter.h"
+#include "UploadSink.h"
+
+#define UPLOAD_SINK_APP_ENGINE 0
+#define UPLOAD_SINK_NIGHTSCOUT 1
+#define UPLOAD_SINK_LOCAL 2
+#define UPLOAD_SINK_COUNT 3
+// Size of the receiver.cgi path and query
+#define UPLOADER_MAX_PATH_LENGTH 192
+// Size of the Nightscout entries body
+#define UPLOADER_MAX_BODY_LENGTH 256
+// Milliseconds the wall clock taken from time() is followed with millis(), within the signed 32 bits range of millis()
+#define UPLOADER_CLOCK_ANCHOR_LIFETIME 1036800000UL
+
+static_assert(UPLOAD_SINK_COUNT <= READING_QUEUE_MAX_SINKS, "The reading queue has a position for each sink");
+static_assert(HTTP_CLIENT_MAX_HOST_LENGTH + UPLOADER_MAX_PATH_LENGTH + UPLOAD_SINK_MAX_HEADERS_LENGTH +
+              UPLOADER_MAX_BODY_LENGTH + HTTP_CLIENT_REQUEST_OVERHEAD <= HTTP_CLIENT_MAX_REQUEST_LENGTH,
+              "The longest reading request fits in the HTTP client buffer");
+
+/*
+ * Sends every reading to App Engine, Nightscout and the local receiver at the same time.
+ * Each sink moves forward on its own connection, a reading is written once per format
+ */
+class Uploader {
+  public:
+    Uploader();
+    void setConfiguration(Configuration* configuration);
+    void addReadingQueue(ReadingQueue* readingQueue);
+    void setWifiManager(WifiManager* wifiManager);
+    void setDebugLogger(DebugLogger* debugLogger);
+    void begin();
+    void loop();
+    void requestUpload();
+    bool sendDirect(uint8_t queue, const RawRecord &record);
+    bool isBusy();
+    unsigned int size();
+    void writeJson(JsonWriter &json);
+  private:
+    void updateSinks();
+    void sendReading(UploadSink &sink, const QueuedReading &reading);
+    const char* serialize(UploadFormat format, uint8_t queue, const QueuedReading &reading);
+    bool getCaptureDate(uint8_t queue, const QueuedReading &reading, uint64_t* date);
+    bool isUploadedEverywhere(uint8_t queue, uint32_t sequence);
+    void logResponse(UploadSink &sink);
+    Configuration* _configuration;
+    // One per Wixel
+    ReadingQueue* _readingQueues[WIXEL_PORT_COUNT];
+    uint8_t _queueCount;
+    WifiManager* _wifiManager;
+    DebugLogger* _debugLogger;
+    DexcomHelper _dexcomHelper;
+    UploadSink _sinks[UPLOAD_SINK_COUNT];
+    uint32_t _configurationVersion;
+    // Sink given the next lookup or connection, one per loop call
+    uint8_t _nextConnectSink;
+    // Last written reading of each format, shared by the sinks using it
+    char _receiverPath[UPLOADER_MAX_PATH_LENGTH];
+    // Length of the receiver path before its ts value, the part kept from one send to the next
+    int _receiverPrefixLength;
+    char _nightscoutBody[UPLOADER_MAX_BODY_LENGTH];
+    bool _serializedValid[UPLOAD_FORMAT_COUNT];
+    uint8_t _serializedQueue[UPLOAD_FORMAT_COUNT];
+    uint32_t _serializedSequence[UPLOAD_FORMAT_COUNT];
+    uint32_t _serializedCaptureMillis[UPLOAD_FORMAT_COUNT];
+    // Wall clock in milliseconds at millis() _anchorMillis, 0 until SNTP answered
+    uint64_t _anchorEpochMillis;
+    unsigned long _anchorMillis;
+};
+
+#endif
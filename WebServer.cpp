@@ -3,10 +3,22 @@
  */
 
 #include "WebServer.h"
+#include <StreamString.h>
+#include "Profiler.h"
+#include "Metrics.h"
+#include "Crc32.h"
 
 ESP8266WebServer WebServer::_webServer(80);
-Configuration WebServer::_configuration;
+Configuration* WebServer::_configuration;
+WifiManager* WebServer::_wifiManager;
+RadioScheduler* WebServer::_radioScheduler;
+Uploader* WebServer::_uploader;
 DexcomHelper WebServer::_dexcomHelper;
+WifiScanner WebServer::_wifiScanner;
+char WebServer::_stylesheetETag[WEB_SERVER_ETAG_LENGTH];
+char WebServer::_javascriptETag[WEB_SERVER_ETAG_LENGTH];
+uint32_t WebServer::_bootNonce;
+char WebServer::_jsonBuffer[WEB_SERVER_JSON_BUFFER_SIZE];
 /*
  * Constructor
  */
@@ -15,30 +27,20 @@ WebServer::WebServer(){
   //WebServer::ACCESS_POINT_PWD = "";
 }
 
-void WebServer::setConfiguration(Configuration configuration) {
+void WebServer::setConfiguration(Configuration* configuration) {
   WebServer::_configuration = configuration;
 }
 
-/*
- * WebServer::padding
- * ------------------
- * This method is used to pad a number with '0' to make sure it is a specific length
- * number: The number to pad with '0'
- * width: The length the number should have
- */
-String WebServer::padding( int number, byte width ) {
-  String response = "";
-  int currentMax = 10;
-  int currentChar = 0;
-  for (byte i=1; i<width; i++){
-    if (number < currentMax) {
-      response += "0";
-      currentChar++;
-    }
-    currentMax *= 10;
-  } 
-  response += number;
-  return response;    
+void WebServer::setWifiManager(WifiManager* wifiManager) {
+  WebServer::_wifiManager = wifiManager;
+}
+
+void WebServer::setRadioScheduler(RadioScheduler* radioScheduler) {
+  WebServer::_radioScheduler = radioScheduler;
+}
+
+void WebServer::setUploader(Uploader* uploader) {
+  WebServer::_uploader = uploader;
 }
 
 /*
@@ -48,18 +50,22 @@ String WebServer::padding( int number, byte width ) {
  */
 void WebServer::start(){
   WebServer::StartAccessPoint();
-  IPAddress myIP = WiFi.softAPIP();
+  // Changes the root page ETag at each boot
+  _bootNonce = ESP.random();
+  const char* headerKeys[] = { "If-None-Match" };
+  WebServer::_webServer.collectHeaders(headerKeys, 1);
   WebServer::_webServer.on("/", std::bind(&WebServer::handleRoot, this));
   WebServer::_webServer.on("/Test", std::bind(&WebServer::handleTest, this));
-  WebServer::_webServer.on("/savetransmitterid", std::bind(&WebServer::handleSaveTransmitterId, this));
-  WebServer::_webServer.on("/saveappengineaddress", std::bind(&WebServer::handleSaveAppEngineAddress, this));
-  WebServer::_webServer.on("/savehotspotconfig", std::bind(&WebServer::handleSaveHotSpotConfig, this));
-  WebServer::_webServer.on("/savedebugconfig", std::bind(&WebServer::handleSaveDebugConfig, this));
-  WebServer::_webServer.on("/savessid", std::bind(&WebServer::handleSaveSSID, this));
-  WebServer::_webServer.on("/remove", std::bind(&WebServer::handleRemoveSSID, this));
-  WebServer::_webServer.on("/scanwifi", std::bind(&WebServer::handleScanWifi, this));
+  WebServer::_webServer.on("/api/scan", std::bind(&WebServer::handleScanWifi, this));
+  WebServer::_webServer.on("/api/status", HTTP_GET, std::bind(&WebServer::handleStatus, this));
+  WebServer::_webServer.on("/api/config", HTTP_GET, std::bind(&WebServer::handleGetConfig, this));
+  WebServer::_webServer.on("/api/config", HTTP_POST, std::bind(&WebServer::handleSetConfig, this));
   WebServer::_webServer.on("/style.css", std::bind(&WebServer::handleStylesheet, this));
   WebServer::_webServer.on("/script.js", std::bind(&WebServer::handleJavascript, this));
+  WebServer::_webServer.on("/profile", std::bind(&WebServer::handleProfile, this));
+  WebServer::_webServer.on("/wifistats", std::bind(&WebServer::handleWifiStats, this));
+  WebServer::_webServer.on("/radiostats", std::bind(&WebServer::handleRadioStats, this));
+  WebServer::_webServer.on("/metrics", HTTP_GET, std::bind(&WebServer::handleMetrics, this));
   //WebServer::_webServer.onNotFound(std::bind(&WebServer::handleNotFound, this));
   WebServer::_webServer.begin();
 }
@@ -68,13 +74,7 @@ void WebServer::start(){
  * This method will use the saved configuration to start an AccessPoint
  */
 void WebServer::StartAccessPoint() {
-  String hotspotName = WebServer::_configuration.getHotSpotName();
-  String hotspotPass = WebServer::_configuration.getHotSpotPass();
-  char* hotspotNameArray;
-  char* hotspotPassArray;
-  hotspotName.toCharArray(hotspotNameArray, hotspotName.length() + 1);
-  hotspotPass.toCharArray(hotspotPassArray, hotspotPass.length() + 1);
-  WiFi.softAP(hotspotNameArray, hotspotPassArray);
+  WiFi.softAP(WebServer::_configuration->getHotSpotName(), WebServer::_configuration->getHotSpotPass());
 }
 
 /*
@@ -84,328 +84,721 @@ void WebServer::StartAccessPoint() {
  */
 void WebServer::loop() {
   WebServer::_webServer.handleClient();
+  WebServer::_wifiScanner.loop();
 }
 
 /*
  * WebServer::getDexcomId
  * ----------------------
- * This method will get the Transmitter in EEPROM and return it
- * returns: Dexcom Transmitter Id
+ * This method will get the saved Transmitter ID of a Wixel
+ * port: Number of the Wixel port
+ * transmitterId: Where to write the Dexcom Transmitter Id, DEXCOM_ID_LENGTH + 1 characters, empty if the next
+ *                Wixel ports are not used
  */
-String WebServer::getDexcomId() {
-  uint32_t transmitterId = WebServer::_configuration.getTransmitterId();
-  char textNbChar [5];
-  _dexcomHelper.IntToCharArray(transmitterId, textNbChar);
-  return WebServer::_dexcomHelper.DexcomSrcToAscii(transmitterId);
+void WebServer::getDexcomId(uint8_t port, char* transmitterId) {
+  uint32_t src = WebServer::_configuration->getTransmitterId(port);
+  if (port > 0 && src == 0) {
+    transmitterId[0] = '\0';
+    return;
+  }
+  WebServer::_dexcomHelper.DexcomSrcToAscii(src, transmitterId);
 }
 
 /*
- * WebServer::redirect
- * -------------------
- * This method will send a redirect to the client
- * url: Url to redirect to
+ * WebServer::getTransmitterPort
+ * -----------------------------
+ * This method will find the Wixel port of a transmitter ID setting
+ * key: transmitterId for the first Wixel, transmitterId2 for the second one...
+ * returns: The port number, -1 if the key is not a transmitter ID of an existing port
  */
-void WebServer::redirect(String url) {
-  String header = "HTTP/1.1 301 OK\r\nSet-Cookie: ESPSESSIONID=0\r\nLocation: " + url + "\r\nCache-Control: no-cache\r\n\r\n";
-  WebServer::_webServer.sendContent(header);
+int WebServer::getTransmitterPort(const char* key) {
+  if (strncmp(key, "transmitterId", 13) != 0) {
+    return -1;
+  }
+  if (key[13] == '\0') {
+    return 0;
+  }
+  if (key[13] >= '2' && key[13] < '1' + WIXEL_PORT_COUNT && key[14] == '\0') {
+    return key[13] - '1';
+  }
+  return -1;
 }
 
 /*
- * handleSaveTransmitterId
- * -----------------------
- * This page will save the provided Transmitter ID to EEPROM
+ * WebServer::handleNotFound
+ * -------------------------
+ * This method will filter page not found
+ * If /test/[SSID] is called, it will try to connect to the server and report success or failure
  */
-void WebServer::handleSaveTransmitterId() {
-  uint32_t transmitterIdSource;
-  if (WebServer::_webServer.hasArg("TransmitterId")) {
-    String transmitterId = WebServer::_webServer.arg("TransmitterId");
-    char transmitterCharList[6];
-    transmitterId.toCharArray(transmitterCharList, 6);
-    transmitterIdSource = WebServer::_dexcomHelper.DexcomAsciiToSrc((char*)transmitterCharList);
-    WebServer::_configuration.setTransmitterId(transmitterIdSource);
-    WebServer::_configuration.SaveConfig();
-  }
-  //char textNbChar [5];
-  //_dexcomHelper.IntToCharArray(transmitterIdSource, textNbChar);
-  WebServer::redirect("/?TransmitterSaved=1");// + String(textNbChar));
-}
+/*void WebServer::handleNotFound() {
+  if (WebServer::_webServer.uri().startsWith("/test")) {
+    // Answer to test calls
+    WebServer::handleTest(WebServer::_webServer.uri().substring(6));
+  }
+  else {
+    // 404
+    WebServer::_webServer.send(404, "text/html", "Sorry, " + WebServer::_webServer.uri() + " was not found");
+  }
+}*/
+
 
 /*
- * WebServer::handleSaveSSID
- * -------------------------
- * This page will save the SSID / password pair in EEPROM
+ * WebServer::handleTest
+ * ---------------------
+ * This page will handle the test wifi connection
  */
-void WebServer::handleSaveSSID() {
-  if (WebServer::_webServer.hasArg("ssid_name")) {
-    String ssidName = WebServer::_webServer.arg("ssid_name");
-    String ssidPassword = WebServer::_webServer.arg("ssid_password");
-    WebServer::_configuration.saveSSID(ssidName, ssidPassword);
-    WebServer::_configuration.SaveConfig();
-  }
-  WebServer::redirect("/?ssidSaved=1");
+void WebServer::handleTest() { 
+  String response = "Connection Failed";
+  
+  WebServer::_webServer.send(200, "text/html", response);
 }
 
 /*
- * WebServer::handleRemoveSSID
- * ---------------------------
- * This method will remove the specified ssid
+ * WebServer::handleProfile
+ * ------------------------
+ * This page will return the time and heap measured for each profiled operation
+ * Calling /profile?reset=1 will clear the measurements
  */
-void WebServer::handleRemoveSSID() {
-    if (WebServer::_webServer.hasArg("ssid")) {
-    String ssidName = WebServer::_webServer.arg("ssid");
-    WebServer::_configuration.deleteSSID(ssidName);
-    WebServer::_configuration.SaveConfig();
+void WebServer::handleProfile() {
+  StreamString response;
+  Profiler::printReport(response);
+  if (WebServer::_webServer.hasArg("reset")) {
+    Profiler::reset();
   }
-  WebServer::redirect("/?ssidDeleted=1");
+  WebServer::_webServer.send(200, "text/plain", response);
 }
 
 /*
- * WebServer::handleSaveHotSpotConfig
- * ----------------------------------
- * This method will save the hotspot configuration
+ * WebServer::handleWifiStats
+ * --------------------------
+ * This page will return the connection statistics of each saved wifi
  */
-void WebServer::handleSaveHotSpotConfig() {
-  bool needToSave = false;
-  if (WebServer::_webServer.hasArg("name") && WebServer::_webServer.hasArg("pass")) {
-    String name = WebServer::_webServer.arg("name");
-    String pass = WebServer::_webServer.arg("pass");
-    
-    WebServer::_configuration.setHotSpotName(name);
-    WebServer::_configuration.setHotSpotPass(pass);
-    WebServer::_configuration.SaveConfig();
-    // Restart hotspot with new configurations
-    WebServer::StartAccessPoint();
+void WebServer::handleWifiStats() {
+  StreamString response;
+  if (WebServer::_wifiManager != NULL) {
+    WebServer::_wifiManager->printReport(response);
   }
-  WebServer::redirect("/?HotSpotSaved=1");
+  WebServer::_webServer.send(200, "text/plain", response);
 }
 
 /*
- * WebServer::handleSaveDebugConfig
- * --------------------------------
- * This page will save the debug configuration
+ * WebServer::handleRadioStats
+ * ---------------------------
+ * This page will return the learned reading cadence, the radio on duty cycle and the missed deadlines
+ * Calling /radiostats?reset=1 will clear the counts
  */
-void WebServer::handleSaveDebugConfig() {
-  bool needToSave = false;
-  if (WebServer::_webServer.hasArg("enabled")) {
-    bool enabled = WebServer::_webServer.arg("enabled") == "1";
-    
-    WebServer::_configuration.setIsDebug(enabled);
-    needToSave = true;
-  }
-  if (WebServer::_webServer.hasArg("ip")) {
-    String ipAddress = WebServer::_webServer.arg("ip");
-    
-    WebServer::_configuration.setDebugAddress(ipAddress);
-    needToSave = true;
-  }
-  if (needToSave) {
-    WebServer::_configuration.SaveConfig();
-  }
-  WebServer::redirect("/?DebugSaved=1");
+void WebServer::handleRadioStats() {
+  StreamString response;
+  if (WebServer::_radioScheduler != NULL) {
+    WebServer::_radioScheduler->printReport(response);
+    if (WebServer::_webServer.hasArg("reset")) {
+      WebServer::_radioScheduler->reset();
+    }
+  }
+  WebServer::_webServer.send(200, "text/plain", response);
 }
 
 /*
- * WebServer::handleSaveAppEngineAddress
- * -------------------------------------
- * This page will save the app engine address specified
+ * Print sending what is printed as chunks of the current response, so a long text is never built in memory
  */
-void WebServer::handleSaveAppEngineAddress() {
-  if (WebServer::_webServer.hasArg("Address")) {
-    String address = WebServer::_webServer.arg("Address");
-    WebServer::_configuration.setAppEngineAddress(address);
-    WebServer::_configuration.SaveConfig();
+class ChunkedPrint : public Print {
+  public:
+    ChunkedPrint(ESP8266WebServer &webServer) : _webServer(webServer) {
+      _length = 0;
+    }
+    size_t write(uint8_t character) {
+      _buffer[_length++] = character;
+      if (_length == WEB_SERVER_CHUNK_SIZE) {
+        flush();
+      }
+      return 1;
+    }
+    void flush() {
+      if (_length > 0) {
+        _buffer[_length] = '\0';
+        _webServer.sendContent(_buffer);
+        _length = 0;
+      }
+    }
+  private:
+    ESP8266WebServer &_webServer;
+    char _buffer[WEB_SERVER_CHUNK_SIZE + 1];
+    size_t _length;
+};
+
+/*
+ * WebServer::handleMetrics
+ * ------------------------
+ * This page will return the counters and latency histograms (see Metrics) and a few gauges in the
+ * Prometheus text format, streamed with chunked transfer encoding
+ */
+void WebServer::handleMetrics() {
+  WebServer::_webServer.sendHeader("Cache-Control", "no-cache");
+  WebServer::_webServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  WebServer::_webServer.send(200, "text/plain; version=0.0.4", "");
+  ChunkedPrint output(WebServer::_webServer);
+  Metrics::printPrometheus(output);
+  output.print("# TYPE xbridge_uptime_seconds gauge\nxbridge_uptime_seconds ");
+  output.print(millis() / 1000);
+  output.print("\n# TYPE xbridge_free_heap_bytes gauge\nxbridge_free_heap_bytes ");
+  output.print(ESP.getFreeHeap());
+  output.print("\n");
+  if (WebServer::_uploader != NULL) {
+    output.print("# TYPE xbridge_queued_readings gauge\nxbridge_queued_readings ");
+    output.print(WebServer::_uploader->size());
+    output.print("\n");
+  }
+  if (WebServer::_radioScheduler != NULL) {
+    output.print("# TYPE xbridge_radio_on gauge\nxbridge_radio_on ");
+    output.print(WebServer::_radioScheduler->isRadioOn() ? 1 : 0);
+    output.print("\n");
   }
-  WebServer::redirect("/?AppEngineSaved=1");
+  output.flush();
+  // Empty chunk ends the response
+  WebServer::_webServer.sendContent("");
 }
+
 /*
- * WebServer::handleNotFound
+ * WebServer::handleScanWifi
  * -------------------------
- * This method will filter page not found
- * If /test/[SSID] is called, it will try to connect to the server and report success or failure
+ * This web method will return the last wifi scan results in JSON (see WifiScanner) and start
+ * a new scan in the background when they are too old. The page asks again while "scanning" is 1
  */
-/*void WebServer::handleNotFound() {
-  if (WebServer::_webServer.uri().startsWith("/test")) {
-    // Answer to test calls
-    WebServer::handleTest(WebServer::_webServer.uri().substring(6));
+void WebServer::handleScanWifi() {
+  WebServer::_wifiScanner.requestScan();
+  JsonWriter json(_jsonBuffer, sizeof(_jsonBuffer));
+  WebServer::_wifiScanner.writeJson(json);
+  WebServer::sendJson(200, json);
+}
+
+/*
+ * WebServer::handleStatus
+ * -----------------------
+ * This web method will return the state of the bridge in JSON:
+ * {"uptime":12,"freeHeap":30000,"wifi":{"state":2,"connected":true,"ssid":"home","rssi":-61,"ip":"192.168.1.20"},
+ *  "radioOn":true,"queuedReadings":0,"uploads":[{"name":"appEngine",...}],"configVersion":3}
+ * uptime is in seconds, wifi state is a WifiManagerState
+ */
+void WebServer::handleStatus() {
+  JsonWriter json(_jsonBuffer, sizeof(_jsonBuffer));
+  json.beginObject();
+  json.key("uptime");
+  json.value(millis() / 1000);
+  json.key("freeHeap");
+  json.value(ESP.getFreeHeap());
+  json.key("wifi");
+  json.beginObject();
+  if (WebServer::_wifiManager != NULL) {
+    bool connected = WebServer::_wifiManager->isConnected();
+    json.key("state");
+    json.value((int)WebServer::_wifiManager->getState());
+    json.key("connected");
+    json.value(connected);
+    json.key("ssid");
+    json.value(WebServer::_wifiManager->getSsid());
+    if (connected) {
+      IPAddress localIp = WiFi.localIP();
+      char ip[16];
+      snprintf(ip, sizeof(ip), "%u.%u.%u.%u", localIp[0], localIp[1], localIp[2], localIp[3]);
+      json.key("rssi");
+      json.value((long)WiFi.RSSI());
+      json.key("ip");
+      json.value(ip);
+    }
   }
-  else {
-    // 404
-    WebServer::_webServer.send(404, "text/html", "Sorry, " + WebServer::_webServer.uri() + " was not found");
+  json.endObject();
+  if (WebServer::_radioScheduler != NULL) {
+    json.key("radioOn");
+    json.value(WebServer::_radioScheduler->isRadioOn());
   }
-}*/
-
+  if (WebServer::_uploader != NULL) {
+    json.key("queuedReadings");
+    json.value(WebServer::_uploader->size());
+    json.key("uploads");
+    WebServer::_uploader->writeJson(json);
+  }
+  json.key("configVersion");
+  json.value((unsigned long)WebServer::_configuration->getVersion());
+  json.endObject();
+  WebServer::sendJson(200, json);
+}
 
 /*
- * WebServer::handleTest
- * ---------------------
- * This page will handle the test wifi connection
+ * WebServer::handleGetConfig
+ * --------------------------
+ * This web method will return the configuration in JSON (see writeConfig)
  */
-void WebServer::handleTest() { 
-  String response = "Connection Failed";
-  
-  WebServer::_webServer.send(200, "text/html", response);
+void WebServer::handleGetConfig() {
+  JsonWriter json(_jsonBuffer, sizeof(_jsonBuffer));
+  WebServer::writeConfig(json);
+  WebServer::sendJson(200, json);
 }
 
 /*
- * WebServer::handleScanWifi
- * -------------------------
- * This web method will return result of a Wifi Scan
+ * WebServer::handleSetConfig
+ * --------------------------
+ * This web method will change the settings given in the JSON body and keep the others. Members:
+ * transmitterId (transmitterId2... for the next Wixels, empty if not used), appEngineAddress, nightscoutAddress, nightscoutSecret, localAddress, debug (true/false),
+ * debugAddress, hotSpotName, hotSpotPassword, addSsid with addSsidPassword, removeSsid.
+ * Every member is checked before the first one is applied, so a bad request changes nothing.
+ * The configuration is saved once and returned as for GET, or {"error":"..."} with 400/413
  */
-void WebServer::handleScanWifi() {
-  String response;
-  int n = WiFi.scanNetworks();
-  if (n == 0)
-  {
-    response = "No network found...";
-  }
-  else
-  {
-    response = "<table>\n\
- <tr>\n\
-    <th align=\"left\">SSID</th>\n\
-    <th></th>\n\
-    <th></th>\n\
-  </tr>\n";
-  for (int i = 0; i < n; ++i)
-  {
-    String textSecurity = "";
-    switch(WiFi.encryptionType(i))
-    {
-      case ENC_TYPE_WEP:
-      case ENC_TYPE_TKIP:
-      case ENC_TYPE_CCMP:
-      case ENC_TYPE_AUTO:
-        textSecurity = "*";
-        break;
-      case ENC_TYPE_NONE:
-        textSecurity = "";
-        break;
+void WebServer::handleSetConfig() {
+  // Parsed in place, arg returns a reference to the body kept by the server
+  const String& body = WebServer::_webServer.arg("plain");
+  if (body.length() > WEB_SERVER_MAX_BODY_LENGTH) {
+    WebServer::sendError(413, "Body too large");
+    return;
+  }
+  JsonParser parser(body.c_str());
+  char key[WEB_SERVER_MAX_KEY_LENGTH + 1];
+  char value[CONFIGURATION_MAX_ADDRESS_LENGTH + 1];
+  char ssidPassword[CONFIGURATION_MAX_PASSWORD_LENGTH + 1] = "";
+  JsonType type;
+  // First pass: check everything, keep the password of the added SSID whatever its position
+  while (parser.nextMember(key, sizeof(key), value, sizeof(value), &type)) {
+    const char* error = WebServer::checkConfigMember(key, value, type);
+    if (error != NULL) {
+      WebServer::sendError(400, error);
+      return;
     }
-    int rssi = WiFi.RSSI(i);
-    String barClass = "";
-    if(rssi > -60)
-    {
-      barClass = "good five-bars";
+    if (strcmp(key, "addSsidPassword") == 0) {
+      strcpy(ssidPassword, value);
     }
-    else if (rssi > -70)
-    {
-      barClass = "good four-bars";
+  }
+  if (parser.hasError()) {
+    WebServer::sendError(400, "Invalid JSON");
+    return;
+  }
+
+  // Second pass: apply
+  bool hotSpotChanged = false;
+  parser.rewind();
+  while (parser.nextMember(key, sizeof(key), value, sizeof(value), &type)) {
+    if (WebServer::getTransmitterPort(key) >= 0) {
+      // Empty for a Wixel port not used
+      uint32_t transmitterId = 0;
+      WebServer::_dexcomHelper.DexcomAsciiToSrc(value, &transmitterId);
+      WebServer::_configuration->setTransmitterId(WebServer::getTransmitterPort(key), transmitterId);
     }
-    else if (rssi > -80)
-    {
-      barClass = "ok three-bars";
+    else if (strcmp(key, "appEngineAddress") == 0) {
+      WebServer::_configuration->setAppEngineAddress(value);
     }
-    else if (rssi > -90)
-    {
-      barClass = "bad two-bars";
+    else if (strcmp(key, "nightscoutAddress") == 0) {
+      WebServer::_configuration->setNightscoutAddress(value);
     }
-    else
-    {
-      barClass = "bad one-bar";
+    else if (strcmp(key, "nightscoutSecret") == 0) {
+      WebServer::_configuration->setNightscoutSecret(value);
+    }
+    else if (strcmp(key, "localAddress") == 0) {
+      WebServer::_configuration->setLocalAddress(value);
+    }
+    else if (strcmp(key, "debug") == 0) {
+      WebServer::_configuration->setIsDebug(type == JSON_TRUE);
+    }
+    else if (strcmp(key, "debugAddress") == 0) {
+      WebServer::_configuration->setDebugAddress(value);
+    }
+    else if (strcmp(key, "hotSpotName") == 0) {
+      hotSpotChanged = hotSpotChanged || strcmp(value, WebServer::_configuration->getHotSpotName()) != 0;
+      WebServer::_configuration->setHotSpotName(value);
+    }
+    else if (strcmp(key, "hotSpotPassword") == 0) {
+      hotSpotChanged = hotSpotChanged || strcmp(value, WebServer::_configuration->getHotSpotPass()) != 0;
+      WebServer::_configuration->setHotSpotPass(value);
+    }
+    else if (strcmp(key, "addSsid") == 0) {
+      WebServer::_configuration->saveSSID(value, ssidPassword);
+    }
+    else if (strcmp(key, "removeSsid") == 0) {
+      WebServer::_configuration->deleteSSID(value);
     }
-    
-    response += "  <tr>\n\
-    <td>" + WiFi.SSID(i) + textSecurity + "</td>\n\
-    <td>\n\
-      <div class=\"signal-bars mt1 sizing-box " + barClass + "\">\n\
-        <div class=\"first-bar bar\"></div>\n\
-        <div class=\"second-bar bar\"></div>\n\
-        <div class=\"third-bar bar\"></div>\n\
-        <div class=\"fourth-bar bar\"></div>\n\
-        <div class=\"fifth-bar bar\"></div>\n\
-      </div>\n\
-    </td>\n\
-    <td align=\"right\"><a href=\"javascript:OpenSSIDPopup('" + WiFi.SSID(i) + "');\" class=\"button\">Add</a></td>\n\
-  </tr>\n";
-  }
-  /*<tr>\n\
-    <td>Drake (S)</td>\n\
-    <td>\n\
-      <div class=\"signal-bars mt1 sizing-box good four-bars\">\n\
-        <div class=\"first-bar bar\"></div>\n\
-        <div class=\"second-bar bar\"></div>\n\
-        <div class=\"third-bar bar\"></div>\n\
-        <div class=\"fourth-bar bar\"></div>\n\
-        <div class=\"fifth-bar bar\"></div>\n\
-      </div>\n\
-    </td>\n\
-    <td align=\"right\"><a href=\"javascript:OpenSSIDPopup('Drake');\" class=\"button\">Add</a></td>\n\
-  </tr>\n\
-  <tr>\n\
-    <td>Monique</td>\n\
-    <td>\n\
-      <div class=\"signal-bars mt1 sizing-box bad one-bar\">\n\
-        <div class=\"first-bar bar\"></div>\n\
-        <div class=\"second-bar bar\"></div>\n\
-        <div class=\"third-bar bar\"></div>\n\
-        <div class=\"fourth-bar bar\"></div>\n\
-        <div class=\"fifth-bar bar\"></div>\n\
-      </div>\n\
-    </td>\n\
-    <td align=\"right\"><a href=\"javascript:OpenSSIDPopup('Monique');\" class=\"button\">Add</a></td>\n\
-  </tr>\n\*/
-    response += "</table>";
   }
-  WebServer::_webServer.send(200, "text/html", response);
+  WebServer::_configuration->SaveConfig();
+
+  JsonWriter json(_jsonBuffer, sizeof(_jsonBuffer));
+  WebServer::writeConfig(json);
+  WebServer::sendJson(200, json);
+  if (hotSpotChanged) {
+    // Restart hotspot with new configurations, after answering as the client may be on it
+    WebServer::StartAccessPoint();
+  }
 }
 
 /*
- * WebServer::handleRoot
- * ---------------------
- * This method handle a request to the root '/' webpage
+ * WebServer::checkConfigMember
+ * ----------------------------
+ * This method will check one member of a /api/config body
+ * key: The member name
+ * value: The member value as text
+ * type: The member value type
+ * returns: NULL if the member can be applied, the error message otherwise
  */
-void WebServer::handleRoot() {
-  int sec = millis() / 1000;
-  int min = sec / 60;
-  int hr = min / 60;
-  String uptime = "";
-  uptime += WebServer::padding(hr, 2);
-  uptime += ":";
-  uptime += WebServer::padding(min % 60, 2);
-  uptime += ":";
-  uptime += WebServer::padding(sec % 60, 2);
-
-  String configuredWifiText;
-  int wifiCount = WebServer::_configuration.getWifiCount();
-  if (wifiCount > 0) {
-    configuredWifiText = "<table>\n\
-        <tr>\n\
-          <th align=\"left\">SSID</th>\n\
-          <th></th>\n\
-        </tr>\n";
-    for(int i = 0; i < wifiCount; i++)
-    {
-      WifiData* wifiData = WebServer::_configuration.getWifiData(i);
-      configuredWifiText = configuredWifiText + "<tr>\n\
-          <td>" + wifiData->ssid + "</td>\n\
-          <td align=\"right\">\n\
-            <a href=\"javascript:TestSSID('" + wifiData->ssid + "'); \" class=\"button\">Test</a>\n\
-            <a href=\"javascript:RemoveSSID('" + wifiData->ssid + "');\" class=\"button\">Delete</a>\n\
-          </td>\n\
-        </tr>\n";
+const char* WebServer::checkConfigMember(const char* key, const char* value, JsonType type) {
+  size_t maxLength;
+  if (strcmp(key, "debug") == 0) {
+    return type == JSON_TRUE || type == JSON_FALSE ? NULL : "debug must be true or false";
+  }
+  int transmitterPort = WebServer::getTransmitterPort(key);
+  if (transmitterPort >= 0) {
+    uint32_t transmitterId;
+    DexcomIdStatus status = WebServer::_dexcomHelper.DexcomAsciiToSrc(value, &transmitterId);
+    if (type == JSON_STRING && status != DEXCOM_ID_VALID && (transmitterPort == 0 || value[0] != '\0')) {
+      return DexcomHelper::getStatusText(status);
     }
-    configuredWifiText = configuredWifiText + "</table>\n";
+    maxLength = DEXCOM_ID_LENGTH;
+  }
+  else if (strcmp(key, "appEngineAddress") == 0 || strcmp(key, "debugAddress") == 0 ||
+           strcmp(key, "nightscoutAddress") == 0 || strcmp(key, "localAddress") == 0) {
+    maxLength = CONFIGURATION_MAX_ADDRESS_LENGTH;
+  }
+  else if (strcmp(key, "nightscoutSecret") == 0) {
+    maxLength = CONFIGURATION_MAX_SECRET_LENGTH;
+  }
+  else if (strcmp(key, "hotSpotName") == 0 || strcmp(key, "addSsid") == 0 || strcmp(key, "removeSsid") == 0) {
+    maxLength = CONFIGURATION_MAX_SSID_LENGTH;
+  }
+  else if (strcmp(key, "hotSpotPassword") == 0 || strcmp(key, "addSsidPassword") == 0) {
+    maxLength = CONFIGURATION_MAX_PASSWORD_LENGTH;
   }
   else {
-    configuredWifiText = "No Wifi configured";
+    return "Unknown setting";
   }
+  if (type != JSON_STRING) {
+    return "String expected";
+  }
+  if (strlen(value) > maxLength) {
+    return "Value too long";
+  }
+  if (strcmp(key, "appEngineAddress") == 0 || strcmp(key, "nightscoutAddress") == 0 ||
+      strcmp(key, "localAddress") == 0) {
+    char host[HTTP_CLIENT_MAX_HOST_LENGTH];
+    uint16_t port;
+    if (!UploadSink::parseAddress(value, host, &port)) {
+      return "Address must be host[:port] or http://host[:port], https is not supported";
+    }
+  }
+  if (strcmp(key, "hotSpotName") == 0 && value[0] == '\0') {
+    return "hotSpotName can not be empty";
+  }
+  if (strcmp(key, "addSsid") == 0 && WebServer::_configuration->findSSID(value) < 0 &&
+      WebServer::_configuration->getWifiCount() >= CONFIGURATION_MAX_WIFI) {
+    return "Too many wifi saved";
+  }
+  return NULL;
+}
 
-  String chkDebugCheckedText = "";
-  if (WebServer::_configuration.getIsDebug()) {
-    chkDebugCheckedText = " checked";
+/*
+ * WebServer::writeConfig
+ * ----------------------
+ * This method will write the configuration in JSON. The wifi passwords and the Nightscout secret are never sent:
+ * {"transmitterId":"6ABCD","transmitterId2":"","appEngineAddress":"...","nightscoutAddress":"...","nightscoutSecretSet":true,
+ *  "localAddress":"...","debug":false,"debugAddress":"...","hotSpotName":"wifi-xBridge","hotSpotPassword":"",
+ *  "wifi":["home","work"]}
+ * json: Where to write the configuration
+ */
+void WebServer::writeConfig(JsonWriter &json) {
+  json.beginObject();
+  char transmitterId[DEXCOM_ID_LENGTH + 1];
+  WebServer::getDexcomId(0, transmitterId);
+  json.key("transmitterId");
+  json.value(transmitterId);
+  for (uint8_t port = 1; port < WIXEL_PORT_COUNT; port++) {
+    char key[16];
+    snprintf(key, sizeof(key), "transmitterId%u", port + 1);
+    WebServer::getDexcomId(port, transmitterId);
+    json.key(key);
+    json.value(transmitterId);
   }
-  
-  String response = "<html>\n\
+  json.key("appEngineAddress");
+  json.value(WebServer::_configuration->getAppEngineAddress());
+  json.key("nightscoutAddress");
+  json.value(WebServer::_configuration->getNightscoutAddress());
+  json.key("nightscoutSecretSet");
+  json.value(WebServer::_configuration->getNightscoutSecret()[0] != '\0');
+  json.key("localAddress");
+  json.value(WebServer::_configuration->getLocalAddress());
+  json.key("debug");
+  json.value(WebServer::_configuration->getIsDebug());
+  json.key("debugAddress");
+  json.value(WebServer::_configuration->getDebugAddress());
+  json.key("hotSpotName");
+  json.value(WebServer::_configuration->getHotSpotName());
+  json.key("hotSpotPassword");
+  json.value(WebServer::_configuration->getHotSpotPass());
+  json.key("wifi");
+  json.beginArray();
+  int wifiCount = WebServer::_configuration->getWifiCount();
+  for (int i = 0; i < wifiCount; i++) {
+    json.value(WebServer::_configuration->getWifiData(i)->ssid);
+  }
+  json.endArray();
+  json.endObject();
+}
+
+/*
+ * WebServer::sendJson
+ * -------------------
+ * This method will send the JSON written in the buffer, never cached. A cut JSON is replaced by an error
+ * code: The HTTP status code
+ * json: The JSON to send
+ */
+void WebServer::sendJson(int code, JsonWriter &json) {
+  if (json.isOverflowed()) {
+    WebServer::sendError(500, "Response too large");
+    return;
+  }
+  WebServer::_webServer.sendHeader("Cache-Control", "no-cache");
+  WebServer::_webServer.send(code, "application/json", json.getText());
+}
+
+/*
+ * WebServer::sendError
+ * --------------------
+ * This method will send {"error":"message"}
+ * code: The HTTP status code
+ * message: The error message
+ */
+void WebServer::sendError(int code, const char* message) {
+  char buffer[96];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject();
+  json.key("error");
+  json.value(message);
+  json.endObject();
+  WebServer::_webServer.sendHeader("Cache-Control", "no-cache");
+  WebServer::_webServer.send(code, "application/json", json.getText());
+}
+
+/*
+ * Static files, their ETag is computed from their content on the first request
+ */
+static const char STYLESHEET[] PROGMEM = "body { font-family: Arial, sans-serif; background-color: #9EDFFF;  }h1 { color:  3377FF; margin-left: 20px;  font-size: 30px;  text-align: center; text-shadow:    -1px -1px 1px #666666,    2px 2px 1px #333333;}.innerPage{  background-color: white;  border: 1px solid black;  padding: 8px; box-shadow: 10px 10px 5px #5888C8;  //color: #9E8042; margin: 0 auto; border: 2px solid #000080;  border-radius: 10px/10px; text-align: center;}h2 {  color: #000080; }h2.First {   margin-top: 4px;}table {  border-collapse: collapse;  width:100%; color: #800000; margin-bottom: 15px}th, td {  padding-top: 15px;  padding-bottom: 15px; border-bottom: 1px solid #ddd;}.button {  font-size: 1em;  padding: 10px;  border: 2px solid #000080;  border-radius: 20px/50px;  text-decoration: none;  cursor: pointer;  transition: all 0.3s ease-out;  margin: 5px;}.button:hover {  background: #9EDFFF;}.overlay {  position: fixed;  top: 0;  bottom: 0;  left: 0;  right: 0;  background: rgba(0, 0, 0, 0.7);  transition: opacity 500ms;  visibility: hidden;  opacity: 0;  z-index: 999;}.overlay:target {  visibility: visible;  opacity: 1;}.popup {  margin: 70px auto;  padding: 20px;  background: #fff;  border-radius: 5px;  width: 30%;  position: relative;  transition: all 5s ease-in-out;  text-align: center;  }.popup h2 {  margin-top: 0;  color: #333;  font-family: Tahoma, Arial, sans-serif;  }.popup .close {  position: absolute;  top: 20px;  right: 30px;  transition: all 200ms;  font-size: 30px;  font-weight: bold;  text-decoration: none;  color: #333;}.popup .close:hover {  color: #3377FF;}.popup .content {  max-height: 90%;  overflow: auto;}@media screen and (max-width: 700px){  .popup{  width: 90%;  }}.textbox { border: 5px solid white;  -webkit-box-shadow:     inset 0 0 8px  rgba(0,0,0,0.1),     0 0 16px rgba(0,0,0,0.1);   -moz-box-shadow:    inset 0 0 8px  rgba(0,0,0,0.1),     0 0 16px rgba(0,0,0,0.1);   box-shadow:     inset 0 0 8px  rgba(0,0,0,0.1),     0 0 16px rgba(0,0,0,0.1);   padding: 15px;  background: rgba(255,255,255,0.5);  margin: 0 0 7px 0;  font-size: 20px;  width:100%;}.label {  font-size: 1.17em;  font-weight: bold;}.wifi-symbol {  display: none;}.wifi-symbol [foo], .wifi-symbol {  position: absolute;  display: inline-block;  width: 20px;  height: 20px;  margin-top: -72px;  margin-left: 60px;  -ms-transform: rotate(-45deg) translate(-100px);  -moz-transform: rotate(-45deg) translate(-100px);  -o-transform: rotate(-45deg) translate(-100px);  -webkit-transform: rotate(-45deg) translate(-100px);  transform: rotate(-45deg) translate(-100px);}.wifi-symbol .wifi-circle {  box-sizing: border-box;  -moz-box-sizing: border-box;  display: block;  width: 100%;  height: 100%;  font-size: 2.86px;  position: absolute;  bottom: 0;  left: 0;  border-color: #000055;  border-style: solid;  border-width: 1em 1em 0 0;  -webkit-border-radius: 0 100% 0 0;  border-radius: 0 100% 0 0;  opacity: 0;  -o-animation: wifianimation 3s infinite;  -moz-animation: wifianimation 3s infinite;  -webkit-animation: wifianimation 3s infinite;  animation: wifianimation 3s infinite;}.wifi-symbol .wifi-circle.first {  -o-animation-delay: 800ms;  -moz-animation-delay: 800ms;  -webkit-animation-delay: 800ms;  animation-delay: 800ms;}.wifi-symbol .wifi-circle.second {  width: 5em;  height: 5em;  -o-animation-delay: 400ms;  -moz-animation-delay: 400ms;  -webkit-animation-delay: 400ms;  animation-delay: 400ms;}.wifi-symbol .wifi-circle.third {  width: 3em;  height: 3em;}.wifi-symbol .wifi-circle.fourth {  width: 1em;  height: 1em;  opacity: 1;  background-color: #000055;  -o-animation: none;  -moz-animation: none;  -webkit-animation: none;  animation: none;}@-o-keyframes wifianimation {  0% {    opacity: 0.4;  }  5% {    opactiy: 1;  }  6% {    opactiy: 0.1;  }  100% {    opactiy: 0.1;  }}@-moz-keyframes wifianimation {  0% {    opacity: 0.4;  }  5% {    opactiy: 1;  }  6% {    opactiy: 0.1;  }  100% {    opactiy: 0.1;  }}@-webkit-keyframes wifianimation {  0% {    opacity: 0.4;  }  5% {    opactiy: 1;  }  6% {    opactiy: 0.1;  }  100% {    opactiy: 0.1;  }}* {  box-sizing: border-box;}.sizing-box {  height: 20px;  width: 80px;}.signal-bars {  display: inline-block;}.signal-bars .bar {  width: 14%;  margin-left: 0%;  min-height: 20%;  display: inline-block;}.signal-bars .bar.first-bar {  height: 20%;}.signal-bars .bar.second-bar {  height: 40%;}.signal-bars .bar.third-bar {  height: 60%;}.signal-bars .bar.fourth-bar {  height: 80%;}.signal-bars .bar.fifth-bar {  height: 99%;}.good .bar {  background-color: #16a085;  border: thin solid #12816b;}.bad .bar {  background-color: #e74c3c;  border: thin solid #a82315;}.ok .bar {  background-color: #f1c40f;  border: thin solid #d0a90c;}.four-bars .bar.fifth-bar,.three-bars .bar.fifth-bar,.three-bars .bar.fourth-bar,.one-bar .bar:not(.first-bar),.two-bars .bar:not(.first-bar):not(.second-bar) {  background-color: #fafafa;  border: thin solid #f3f3f3;}";
+
+static const char JAVASCRIPT[] PROGMEM = "function OpenSSIDPopup(ssid)\n\
+{\n\
+ var popup = document.getElementById(\"popup\");\n\
+  var ssid_name = document.getElementById(\"ssid_name\");\n\
+  var ssid_name_text = document.getElementById(\"ssid_name_text\");\n\
+  var ssid_password = document.getElementById(\"ssid_password\");\n\
+  ssid_name.value = ssid;\n\
+  ssid_name_text.innerHTML = ssid;\n\
+  ssid_password.value = \"\";\n\
+  popup.style.visibility = \"visible\";\n\
+  popup.style.opacity = 1;\n\
+}\n\
+\n\
+function SendConfig(changes, onSaved) {\n\
+  var xhttp = new XMLHttpRequest();\n\
+  xhttp.open(\"POST\", \"api/config\", true);\n\
+  xhttp.setRequestHeader(\"Content-Type\", \"application/json\");\n\
+  xhttp.onreadystatechange = function () {\n\
+    if(xhttp.readyState === XMLHttpRequest.DONE){\n\
+      var response = xhttp.responseText ? JSON.parse(xhttp.responseText) : {error: \"No answer\"};\n\
+      if (xhttp.status === 200) {\n\
+        RenderConfiguredWifi(response.wifi);\n\
+        if (onSaved) {\n\
+          onSaved(response);\n\
+        }\n\
+      }\n\
+      else {\n\
+        alert(\"Not saved: \" + response.error);\n\
+      }\n\
+    };\n\
+  };\n\
+  xhttp.send(JSON.stringify(changes));\n\
+}\n\
+\n\
+function SaveTransmitterId() {\n\
+  var changes = {transmitterId: document.getElementById(\"txtTransmitterId\").value};\n\
+  for (var port = 2; document.getElementById(\"txtTransmitterId\" + port); port++) {\n\
+    changes[\"transmitterId\" + port] = document.getElementById(\"txtTransmitterId\" + port).value;\n\
+  }\n\
+  SendConfig(changes, function (config) {\n\
+    alert(\"Dexcom ID saved\");\n\
+  });\n\
+}\n\
+\n\
+function SaveAppEngineAddress() {\n\
+  SendConfig({appEngineAddress: document.getElementById(\"txtAppEngineAddress\").value}, function (config) {\n\
+    alert(\"App Engine address saved\");\n\
+  });\n\
+}\n\
+\n\
+function SaveNightscoutConfig() {\n\
+  var changes = {nightscoutAddress: document.getElementById(\"txtNightscoutAddress\").value};\n\
+  var secret = document.getElementById(\"txtNightscoutSecret\").value;\n\
+  if (secret) {\n\
+    changes.nightscoutSecret = secret;\n\
+  }\n\
+  SendConfig(changes, function (config) {\n\
+    alert(\"Nightscout configuration saved\");\n\
+  });\n\
+}\n\
+\n\
+function SaveLocalAddress() {\n\
+  SendConfig({localAddress: document.getElementById(\"txtLocalAddress\").value}, function (config) {\n\
+    alert(\"Local receiver address saved\");\n\
+  });\n\
+}\n\
+\n\
+function SaveHotSpotConfig() {\n\
+  var hotspotName = document.getElementById(\"txtHotSpotName\").value;\n\
+  var hotspotPassword = document.getElementById(\"txtHotSpotPassword\").value;\n\
+  SendConfig({hotSpotName: hotspotName, hotSpotPassword: hotspotPassword}, function (config) {\n\
+    alert(\"Hot spot saved, it restarts now\");\n\
+  });\n\
+}\n\
+\n\
+function SaveDebugConfig() {\n\
+  var debugEnabled = document.getElementById(\"chkDebug\").checked;\n\
+  var debugAddress = document.getElementById(\"txtDebugAddress\").value;\n\
+  SendConfig({debug: debugEnabled, debugAddress: debugAddress}, function (config) {\n\
+    alert(\"Debug configuration saved\");\n\
+  });\n\
+}\n\
+\n\
+function SaveSSID() {\n\
+  var ssid_name = document.getElementById(\"ssid_name\");\n\
+  var ssid_password = document.getElementById(\"ssid_password\");\n\
+  SendConfig({addSsid: ssid_name.value, addSsidPassword: ssid_password.value}, ClosePopup);\n\
+}\n\
+\n\
+function ClosePopup() {\n\
+  var popup = document.getElementById(\"popup\");\n\
+  popup.style.visibility = \"hidden\";\n\
+  popup.style.opacity = 0;\n\
+}\n\
+\n\
+function RemoveSSID(ssid)\n\
+{\n\
+  if (confirm(\"Do you really want to remove \" + ssid)) {\n\
+    SendConfig({removeSsid: ssid});\n\
+  }\n\
+}\n\
+\n\
+function RenderConfiguredWifi(wifi) {\n\
+  var divConfiguredWifi = document.getElementById(\"configuredWifi\");\n\
+  if (wifi.length == 0) {\n\
+    divConfiguredWifi.innerHTML = \"No Wifi configured\";\n\
+    return;\n\
+  }\n\
+  var table = document.createElement(\"table\");\n\
+  table.innerHTML = \"<tr><th align=\\\"left\\\">SSID</th><th></th></tr>\";\n\
+  for (var i = 0; i < wifi.length; i++) {\n\
+    var row = table.insertRow(-1);\n\
+    row.insertCell(-1).textContent = wifi[i];\n\
+    var buttonCell = row.insertCell(-1);\n\
+    buttonCell.align = \"right\";\n\
+    var test = document.createElement(\"a\");\n\
+    test.className = \"button\";\n\
+    test.href = \"javascript:void(0)\";\n\
+    test.textContent = \"Test\";\n\
+    test.onclick = TestSSID.bind(null, wifi[i]);\n\
+    buttonCell.appendChild(test);\n\
+    var remove = document.createElement(\"a\");\n\
+    remove.className = \"button\";\n\
+    remove.href = \"javascript:void(0)\";\n\
+    remove.textContent = \"Delete\";\n\
+    remove.onclick = RemoveSSID.bind(null, wifi[i]);\n\
+    buttonCell.appendChild(remove);\n\
+  }\n\
+  divConfiguredWifi.innerHTML = \"\";\n\
+  divConfiguredWifi.appendChild(table);\n\
+}\n\
+\n\
+function TestSSID(ssid) {\n\
+  var xhttp = new XMLHttpRequest();\n\
+  xhttp.open(\"GET\", \"test/\" + ssid, true);\n\
+  xhttp.onreadystatechange = function () {\n\
+    if(xhttp.readyState === XMLHttpRequest.DONE && xhttp.status === 200){\n\
+      alert(xhttp.responseText);\n\
+      console.log(xhttp.responseText);\n\
+    };\n\
+  };\n\
+  xhttp.send();\n\
+}\n\
+\n\
+\n\
+function ScanWifi() {\n\
+  var divScannedWifi = document.getElementById(\"scannedWifi\");\n\
+  var xhttp = new XMLHttpRequest();\n\
+  xhttp.open(\"GET\", \"api/scan\", true);\n\
+  xhttp.onreadystatechange = function () {\n\
+    if(xhttp.readyState === XMLHttpRequest.DONE && xhttp.status === 200){\n\
+      var scan = JSON.parse(xhttp.responseText);\n\
+      if (scan.scanning && scan.networks.length == 0) {\n\
+        divScannedWifi.innerHTML = \"Scanning...\";\n\
+      }\n\
+      else {\n\
+        RenderScannedWifi(divScannedWifi, scan.networks);\n\
+      }\n\
+      if (scan.scanning) {\n\
+        // Results are ready in a few seconds\n\
+        setTimeout(ScanWifi, 1000);\n\
+      }\n\
+    };\n\
+  };\n\
+  xhttp.send();\n\
+  location.hash = \"#scannedWifi\";\n\
+}\n\
+\n\
+function RenderScannedWifi(divScannedWifi, networks) {\n\
+  if (networks.length == 0) {\n\
+    divScannedWifi.innerHTML = \"No network found...\";\n\
+    return;\n\
+  }\n\
+  var bars = [\"first-bar\", \"second-bar\", \"third-bar\", \"fourth-bar\", \"fifth-bar\"];\n\
+  var table = document.createElement(\"table\");\n\
+  table.innerHTML = \"<tr><th align=\\\"left\\\">SSID</th><th></th><th></th></tr>\";\n\
+  for (var i = 0; i < networks.length; i++) {\n\
+    // [ssid, rssi, secure]\n\
+    var ssid = networks[i][0];\n\
+    var rssi = networks[i][1];\n\
+    var barClass = rssi > -60 ? \"good five-bars\" : rssi > -70 ? \"good four-bars\" : rssi > -80 ? \"ok three-bars\" : rssi > -90 ? \"bad two-bars\" : \"bad one-bar\";\n\
+    var row = table.insertRow(-1);\n\
+    row.insertCell(-1).textContent = ssid + (networks[i][2] ? \"*\" : \"\");\n\
+    var signal = document.createElement(\"div\");\n\
+    signal.className = \"signal-bars mt1 sizing-box \" + barClass;\n\
+    for (var j = 0; j < bars.length; j++) {\n\
+      var bar = document.createElement(\"div\");\n\
+      bar.className = bars[j] + \" bar\";\n\
+      signal.appendChild(bar);\n\
+    }\n\
+    row.insertCell(-1).appendChild(signal);\n\
+    var addCell = row.insertCell(-1);\n\
+    addCell.align = \"right\";\n\
+    var add = document.createElement(\"a\");\n\
+    add.className = \"button\";\n\
+    add.href = \"javascript:void(0)\";\n\
+    add.textContent = \"Add\";\n\
+    add.onclick = OpenSSIDPopup.bind(null, ssid);\n\
+    addCell.appendChild(add);\n\
+  }\n\
+  divScannedWifi.innerHTML = \"\";\n\
+  divScannedWifi.appendChild(table);\n\
+}\n\
+";
+
+/*
+ * Static parts of the root '/' webpage, sent between the dynamic values by handleRoot
+ */
+// Start of the head, up to the stylesheet version
+static const char ROOT_PAGE_STYLESHEET[] PROGMEM = "<html>\n\
  <head>\n\
-    <link rel=\"stylesheet\" type=\"text/css\" href=\"style.css\">\n\
-    <script src=\"script.js\"></script>\n\
+    <link rel=\"stylesheet\" type=\"text/css\" href=\"style.css?v=";
+// Up to the javascript version
+static const char ROOT_PAGE_JAVASCRIPT[] PROGMEM = "\">\n\
+    <script src=\"script.js?v=";
+// Rest of the head, SSID popup and title, up to the uptime
+static const char ROOT_PAGE_HEADER[] PROGMEM = "\"></script>\n\
     <meta name=\"viewport\" content=\"width=device-width, initial-scale=1\" /> \n\
     <title>wifi-xBridge Configuration Page</title>\n\
   </head>\n\
   <body>\n\
     <div id=\"popup\" class=\"overlay\">\n\
       <div class=\"popup\">\n\
-        <form method=\"post\" action=\"savessid\" id=\"frmSaveSSID\">\n\
+        <form id=\"frmSaveSSID\" onsubmit=\"SaveSSID(); return false;\">\n\
           <h2>Add a new SSID</h2>\n\
           <a class=\"close\" href=\"javascript:ClosePopup();\">&times;</a>\n\
           <div class=\"content\">\n\
@@ -429,32 +822,70 @@ void WebServer::handleRoot() {
     <h1>wifi-xBridge Configuration Page</h1>\n\
     <div class=\"innerPage\">\n\
       <h2 class=\"first\">Uptime</h2>\n\
-      " + uptime + "\n\
+      ";
+// Up to the hotspot name
+static const char ROOT_PAGE_HOTSPOT_NAME[] PROGMEM = "\n\
       <h2>Hot Spot</h2>\n\
       <p>\n\
-      <h3>Name</h3><input type=\"text\" id=\"txtHotSpotName\" class=\"textbox\" value=\"" + WebServer::_configuration.getHotSpotName() + "\"><br>\n\
-      <h3>Password</h3> <input type=\"text\" id=\"txtHotSpotPassword\" class=\"textbox\" value=\"" + WebServer::_configuration.getHotSpotPass() + "\">\n\
+      <h3>Name</h3><input type=\"text\" id=\"txtHotSpotName\" class=\"textbox\" value=\"";
+// Up to the hotspot password
+static const char ROOT_PAGE_HOTSPOT_PASSWORD[] PROGMEM = "\"><br>\n\
+      <h3>Password</h3> <input type=\"text\" id=\"txtHotSpotPassword\" class=\"textbox\" value=\"";
+// Up to the transmitter ID
+static const char ROOT_PAGE_TRANSMITTER_ID[] PROGMEM = "\">\n\
       </p>\n\
       <p>\n\
       <a href=\"javascript:SaveHotSpotConfig();\" class=\"button\">Save</a><br/><br/>\n\
       </p>\n\
       <h2>Dexcom ID</h2>\n\
       <p>\n\
-      <input type=\"text\" id=\"txtTransmitterId\" class=\"textbox\" value=\"" + WebServer::getDexcomId() + "\">\n\
+      <h3>Wixel 1</h3><input type=\"text\" id=\"txtTransmitterId\" class=\"textbox\" value=\"";
+// Up to the number of the next Wixel
+static const char ROOT_PAGE_NEXT_TRANSMITTER_NUMBER[] PROGMEM = "\"><br>\n\
+      <h3>Wixel ";
+// Up to the number in the input id of the next Wixel
+static const char ROOT_PAGE_NEXT_TRANSMITTER_INPUT[] PROGMEM = "</h3><input type=\"text\" id=\"txtTransmitterId";
+// Up to the transmitter ID of the next Wixel
+static const char ROOT_PAGE_NEXT_TRANSMITTER_ID[] PROGMEM = "\" class=\"textbox\" placeholder=\"Not used\" value=\"";
+// Up to the App Engine address
+static const char ROOT_PAGE_APP_ENGINE_ADDRESS[] PROGMEM = "\">\n\
       </p>\n\
       <p>\n\
       <a href=\"javascript:SaveTransmitterId();\" class=\"button\">Save</a><br/><br/>\n\
       </p>\n\
       <h2>Google App Engine Address</h2>\n\
       <p>\n\
-      <input type=\"text\" id=\"txtAppEngineAddress\" class=\"textbox\" value=\"" + WebServer::_configuration.getAppEngineAddress() + "\">\n\
+      <input type=\"text\" id=\"txtAppEngineAddress\" class=\"textbox\" value=\"";
+// Up to the Nightscout address
+static const char ROOT_PAGE_NIGHTSCOUT_ADDRESS[] PROGMEM = "\">\n\
       </p>\n\
       <p>\n\
       <a href=\"javascript:SaveAppEngineAddress();\" class=\"button\">Save</a><br/><br/>\n\
       </p>\n\
-      <h2>Configured Wifi</h2>\n"\
-      + configuredWifiText + "\
-      \n\
+      <h2>Nightscout</h2>\n\
+      <p>\n\
+      <h3>Address</h3><input type=\"text\" id=\"txtNightscoutAddress\" class=\"textbox\" value=\"";
+// Up to the local receiver address, the API secret is never sent back
+static const char ROOT_PAGE_LOCAL_ADDRESS[] PROGMEM = "\">\n\
+      <h3>API Secret</h3><input type=\"password\" id=\"txtNightscoutSecret\" class=\"textbox\" placeholder=\"Unchanged\">\n\
+      </p>\n\
+      <p>\n\
+      <a href=\"javascript:SaveNightscoutConfig();\" class=\"button\">Save</a><br/><br/>\n\
+      </p>\n\
+      <h2>Local Receiver Address</h2>\n\
+      <p>\n\
+      <input type=\"text\" id=\"txtLocalAddress\" class=\"textbox\" value=\"";
+// Up to the configured wifi table
+static const char ROOT_PAGE_CONFIGURED_WIFI[] PROGMEM = "\">\n\
+      </p>\n\
+      <p>\n\
+      <a href=\"javascript:SaveLocalAddress();\" class=\"button\">Save</a><br/><br/>\n\
+      </p>\n\
+      <h2>Configured Wifi</h2>\n\
+      <div id=\"configuredWifi\">\n";
+// Up to the debug checkbox state
+static const char ROOT_PAGE_DEBUG_ENABLED[] PROGMEM = "\
+      </div>\n\
       <br/><h2>Configure new Wifi</h2>\n\
         <a name=\"scannedWifi\" class=\"button\" href=\"javascript:ScanWifi()\">\n\
           <div style=\"width:20px; height:20px;display: inline-block; z-index: -1;\">\n\
@@ -472,11 +903,15 @@ void WebServer::handleRoot() {
         <h2>Debugging</h2>\n\
         <h3>Debug Enabled</h3>\n\
         <p>\n\
-        <input type=\"checkbox\" id=\"chkDebug\"" + chkDebugCheckedText + ">\n\
+        <input type=\"checkbox\" id=\"chkDebug\"";
+// Up to the debug address
+static const char ROOT_PAGE_DEBUG_ADDRESS[] PROGMEM = ">\n\
         </p>\n\
         <h3>Debug IP Address</h3>\n\
         <p>\n\
-        <input type=\"text\" id=\"txtDebugAddress\" class=\"textbox\" value=\"" + WebServer::_configuration.getDebugAddress() +  "\">\n\
+        <input type=\"text\" id=\"txtDebugAddress\" class=\"textbox\" value=\"";
+// End of the page
+static const char ROOT_PAGE_FOOTER[] PROGMEM = "\">\n\
         </p>\n\
         <p>\n\
         <a href=\"javascript:SaveDebugConfig();\" class=\"button\">Save</a><br/><br/>\n\
@@ -484,108 +919,190 @@ void WebServer::handleRoot() {
     </div>\n\
   </body>\n\
 </html>";
-  
-  WebServer::_webServer.send(200, "text/html", response);
-}
+static const char ROOT_PAGE_WIFI_TABLE_HEADER[] PROGMEM = "<table>\n\
+        <tr>\n\
+          <th align=\"left\">SSID</th>\n\
+          <th></th>\n\
+        </tr>\n";
+static const char ROOT_PAGE_WIFI_ROW_SSID[] PROGMEM = "<tr>\n\
+          <td>";
+static const char ROOT_PAGE_WIFI_ROW_TEST[] PROGMEM = "</td>\n\
+          <td align=\"right\">\n\
+            <a href=\"javascript:TestSSID('";
+static const char ROOT_PAGE_WIFI_ROW_REMOVE[] PROGMEM = "'); \" class=\"button\">Test</a>\n\
+            <a href=\"javascript:RemoveSSID('";
+static const char ROOT_PAGE_WIFI_ROW_END[] PROGMEM = "');\" class=\"button\">Delete</a>\n\
+          </td>\n\
+        </tr>\n";
+static const char ROOT_PAGE_WIFI_TABLE_FOOTER[] PROGMEM = "</table>\n";
+static const char ROOT_PAGE_NO_WIFI[] PROGMEM = "No Wifi configured";
 
 /*
  * WebServer::handleRoot
  * ---------------------
+ * This method handle a request to the root '/' webpage
+ * The page is streamed with chunked transfer encoding: static parts come from PROGMEM and
+ * dynamic values are sent as they are read, so the page is never built in memory.
+ * The ETag changes with the configuration, at each boot and each minute (for the uptime), so the
+ * browser can reuse its copy when nothing changed
+ */
+void WebServer::handleRoot() {
+  ProfilerScope profile(PROFILE_HANDLE_ROOT);
+  unsigned long sec = millis() / 1000;
+  // Room for the hours of the largest unsigned long, uptime goes past 99 hours
+  char uptime[24];
+  snprintf(uptime, sizeof(uptime), "%02lu:%02lu:%02lu", sec / 3600, (sec / 60) % 60, sec % 60);
+
+  char etag[WEB_SERVER_ETAG_LENGTH * 3];
+  snprintf(etag, sizeof(etag), "\"%08x-%x-%lx\"", (unsigned int)_bootNonce, (unsigned int)WebServer::_configuration->getVersion(), sec / 60);
+  WebServer::_webServer.sendHeader("ETag", etag);
+  WebServer::_webServer.sendHeader("Cache-Control", "no-cache");
+  if (WebServer::isNotModified(etag)) {
+    WebServer::_webServer.send(304);
+    return;
+  }
+
+  // Static files are linked with their ETag as version, the 8 hex digits between its quotes
+  char version[9];
+  memcpy(version, WebServer::getContentETag(STYLESHEET, _stylesheetETag) + 1, 8);
+  version[8] = '\0';
+
+  WebServer::_webServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  WebServer::_webServer.send(200, "text/html", "");
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_STYLESHEET);
+  WebServer::_webServer.sendContent(version);
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_JAVASCRIPT);
+  memcpy(version, WebServer::getContentETag(JAVASCRIPT, _javascriptETag) + 1, 8);
+  WebServer::_webServer.sendContent(version);
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_HEADER);
+  WebServer::_webServer.sendContent(uptime);
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_HOTSPOT_NAME);
+  WebServer::_webServer.sendContent(WebServer::_configuration->getHotSpotName());
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_HOTSPOT_PASSWORD);
+  WebServer::_webServer.sendContent(WebServer::_configuration->getHotSpotPass());
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_TRANSMITTER_ID);
+  char transmitterId[DEXCOM_ID_LENGTH + 1];
+  WebServer::getDexcomId(0, transmitterId);
+  WebServer::_webServer.sendContent(transmitterId);
+  for (uint8_t port = 1; port < WIXEL_PORT_COUNT; port++) {
+    char number[4];
+    snprintf(number, sizeof(number), "%u", port + 1);
+    WebServer::_webServer.sendContent_P(ROOT_PAGE_NEXT_TRANSMITTER_NUMBER);
+    WebServer::_webServer.sendContent(number);
+    WebServer::_webServer.sendContent_P(ROOT_PAGE_NEXT_TRANSMITTER_INPUT);
+    WebServer::_webServer.sendContent(number);
+    WebServer::_webServer.sendContent_P(ROOT_PAGE_NEXT_TRANSMITTER_ID);
+    WebServer::getDexcomId(port, transmitterId);
+    WebServer::_webServer.sendContent(transmitterId);
+  }
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_APP_ENGINE_ADDRESS);
+  WebServer::_webServer.sendContent(WebServer::_configuration->getAppEngineAddress());
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_NIGHTSCOUT_ADDRESS);
+  WebServer::_webServer.sendContent(WebServer::_configuration->getNightscoutAddress());
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_LOCAL_ADDRESS);
+  WebServer::_webServer.sendContent(WebServer::_configuration->getLocalAddress());
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_CONFIGURED_WIFI);
+
+  int wifiCount = WebServer::_configuration->getWifiCount();
+  if (wifiCount > 0) {
+    WebServer::_webServer.sendContent_P(ROOT_PAGE_WIFI_TABLE_HEADER);
+    for(int i = 0; i < wifiCount; i++)
+    {
+      const WifiData* wifiData = WebServer::_configuration->getWifiData(i);
+      WebServer::_webServer.sendContent_P(ROOT_PAGE_WIFI_ROW_SSID);
+      WebServer::_webServer.sendContent(wifiData->ssid);
+      WebServer::_webServer.sendContent_P(ROOT_PAGE_WIFI_ROW_TEST);
+      WebServer::_webServer.sendContent(wifiData->ssid);
+      WebServer::_webServer.sendContent_P(ROOT_PAGE_WIFI_ROW_REMOVE);
+      WebServer::_webServer.sendContent(wifiData->ssid);
+      WebServer::_webServer.sendContent_P(ROOT_PAGE_WIFI_ROW_END);
+    }
+    WebServer::_webServer.sendContent_P(ROOT_PAGE_WIFI_TABLE_FOOTER);
+  }
+  else {
+    WebServer::_webServer.sendContent_P(ROOT_PAGE_NO_WIFI);
+  }
+
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_DEBUG_ENABLED);
+  if (WebServer::_configuration->getIsDebug()) {
+    WebServer::_webServer.sendContent(" checked");
+  }
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_DEBUG_ADDRESS);
+  WebServer::_webServer.sendContent(WebServer::_configuration->getDebugAddress());
+  WebServer::_webServer.sendContent_P(ROOT_PAGE_FOOTER);
+  // Empty chunk ends the response
+  WebServer::_webServer.sendContent("");
+}
+
+/*
+ * WebServer::getContentETag
+ * -------------------------
+ * This method will compute the ETag of a static file once and keep it
+ * content: The file content in PROGMEM
+ * etag: Where the ETag is kept, computed when empty
+ * returns: The ETag
+ */
+const char* WebServer::getContentETag(PGM_P content, char* etag) {
+  if (etag[0] == '\0') {
+    char buffer[64];
+    uint32_t crc = 0;
+    size_t length = strlen_P(content);
+    for (size_t position = 0; position < length; position += sizeof(buffer)) {
+      size_t toRead = length - position < sizeof(buffer) ? length - position : sizeof(buffer);
+      memcpy_P(buffer, content + position, toRead);
+      crc = Crc32(buffer, toRead, crc);
+    }
+    snprintf(etag, WEB_SERVER_ETAG_LENGTH, "\"%08x\"", (unsigned int)crc);
+  }
+  return etag;
+}
+
+/*
+ * WebServer::isNotModified
+ * ------------------------
+ * This method will check if the browser already has this version of the page
+ * etag: The ETag of the current version
+ * returns: true if the request If-None-Match header matches
+ */
+bool WebServer::isNotModified(const char* etag) {
+  return WebServer::_webServer.hasHeader("If-None-Match") && WebServer::_webServer.header("If-None-Match") == etag;
+}
+
+/*
+ * WebServer::sendStaticContent
+ * ----------------------------
+ * This method will send a static file from PROGMEM with a long lived cache, or 304 if the browser has it.
+ * The root page links the static files with their ETag so a new firmware is never hidden by the cache
+ * content: The file content in PROGMEM
+ * contentType: The file MIME type
+ * etag: The ETag of the file
+ */
+void WebServer::sendStaticContent(PGM_P content, const char* contentType, const char* etag) {
+  WebServer::_webServer.sendHeader("ETag", etag);
+  WebServer::_webServer.sendHeader("Cache-Control", "public, max-age=31536000");
+  if (WebServer::isNotModified(etag)) {
+    WebServer::_webServer.send(304);
+    return;
+  }
+  WebServer::_webServer.send_P(200, contentType, content);
+}
+
+/*
+ * WebServer::handleStylesheet
+ * ---------------------------
  * This method handle a request to the stylesheet '/style.css' webpage
  */
 void WebServer::handleStylesheet() {
-  String response = "";
-  response += "body { font-family: Arial, sans-serif; background-color: #9EDFFF;  }h1 { color:  3377FF; margin-left: 20px;  font-size: 30px;  text-align: center; text-shadow:    -1px -1px 1px #666666,    2px 2px 1px #333333;}.innerPage{  background-color: white;  border: 1px solid black;  padding: 8px; box-shadow: 10px 10px 5px #5888C8;  //color: #9E8042; margin: 0 auto; border: 2px solid #000080;  border-radius: 10px/10px; text-align: center;}h2 {  color: #000080; }h2.First {   margin-top: 4px;}table {  border-collapse: collapse;  width:100%; color: #800000; margin-bottom: 15px}th, td {  padding-top: 15px;  padding-bottom: 15px; border-bottom: 1px solid #ddd;}.button {  font-size: 1em;  padding: 10px;  border: 2px solid #000080;  border-radius: 20px/50px;  text-decoration: none;  cursor: pointer;  transition: all 0.3s ease-out;  margin: 5px;}.button:hover {  background: #9EDFFF;}.overlay {  position: fixed;  top: 0;  bottom: 0;  left: 0;  right: 0;  background: rgba(0, 0, 0, 0.7);  transition: opacity 500ms;  visibility: hidden;  opacity: 0;  z-index: 999;}.overlay:target {  visibility: visible;  opacity: 1;}.popup {  margin: 70px auto;  padding: 20px;  background: #fff;  border-radius: 5px;  width: 30%;  position: relative;  transition: all 5s ease-in-out;  text-align: center;  }.popup h2 {  margin-top: 0;  color: #333;  font-family: Tahoma, Arial, sans-serif;  }.popup .close {  position: absolute;  top: 20px;  right: 30px;  transition: all 200ms;  font-size: 30px;  font-weight: bold;  text-decoration: none;  color: #333;}.popup .close:hover {  color: #3377FF;}.popup .content {  max-height: 90%;  overflow: auto;}@media screen and (max-width: 700px){  .popup{  width: 90%;  }}.textbox { border: 5px solid white;  -webkit-box-shadow:     inset 0 0 8px  rgba(0,0,0,0.1),     0 0 16px rgba(0,0,0,0.1);   -moz-box-shadow:    inset 0 0 8px  rgba(0,0,0,0.1),     0 0 16px rgba(0,0,0,0.1);   box-shadow:     inset 0 0 8px  rgba(0,0,0,0.1),     0 0 16px rgba(0,0,0,0.1);   padding: 15px;  background: rgba(255,255,255,0.5);  margin: 0 0 7px 0;  font-size: 20px;  width:100%;}.label {  font-size: 1.17em;  font-weight: bold;}.wifi-symbol {  display: none;}.wifi-symbol [foo], .wifi-symbol {  position: absolute;  display: inline-block;  width: 20px;  height: 20px;  margin-top: -72px;  margin-left: 60px;  -ms-transform: rotate(-45deg) translate(-100px);  -moz-transform: rotate(-45deg) translate(-100px);  -o-transform: rotate(-45deg) translate(-100px);  -webkit-transform: rotate(-45deg) translate(-100px);  transform: rotate(-45deg) translate(-100px);}.wifi-symbol .wifi-circle {  box-sizing: border-box;  -moz-box-sizing: border-box;  display: block;  width: 100%;  height: 100%;  font-size: 2.86px;  position: absolute;  bottom: 0;  left: 0;  border-color: #000055;  border-style: solid;  border-width: 1em 1em 0 0;  -webkit-border-radius: 0 100% 0 0;  border-radius: 0 100% 0 0;  opacity: 0;  -o-animation: wifianimation 3s infinite;  -moz-animation: wifianimation 3s infinite;  -webkit-animation: wifianimation 3s infinite;  animation: wifianimation 3s infinite;}.wifi-symbol .wifi-circle.first {  -o-animation-delay: 800ms;  -moz-animation-delay: 800ms;  -webkit-animation-delay: 800ms;  animation-delay: 800ms;}.wifi-symbol .wifi-circle.second {  width: 5em;  height: 5em;  -o-animation-delay: 400ms;  -moz-animation-delay: 400ms;  -webkit-animation-delay: 400ms;  animation-delay: 400ms;}.wifi-symbol .wifi-circle.third {  width: 3em;  height: 3em;}.wifi-symbol .wifi-circle.fourth {  width: 1em;  height: 1em;  opacity: 1;  background-color: #000055;  -o-animation: none;  -moz-animation: none;  -webkit-animation: none;  animation: none;}@-o-keyframes wifianimation {  0% {    opacity: 0.4;  }  5% {    opactiy: 1;  }  6% {    opactiy: 0.1;  }  100% {    opactiy: 0.1;  }}@-moz-keyframes wifianimation {  0% {    opacity: 0.4;  }  5% {    opactiy: 1;  }  6% {    opactiy: 0.1;  }  100% {    opactiy: 0.1;  }}@-webkit-keyframes wifianimation {  0% {    opacity: 0.4;  }  5% {    opactiy: 1;  }  6% {    opactiy: 0.1;  }  100% {    opactiy: 0.1;  }}* {  box-sizing: border-box;}.sizing-box {  height: 20px;  width: 80px;}.signal-bars {  display: inline-block;}.signal-bars .bar {  width: 14%;  margin-left: 0%;  min-height: 20%;  display: inline-block;}.signal-bars .bar.first-bar {  height: 20%;}.signal-bars .bar.second-bar {  height: 40%;}.signal-bars .bar.third-bar {  height: 60%;}.signal-bars .bar.fourth-bar {  height: 80%;}.signal-bars .bar.fifth-bar {  height: 99%;}.good .bar {  background-color: #16a085;  border: thin solid #12816b;}.bad .bar {  background-color: #e74c3c;  border: thin solid #a82315;}.ok .bar {  background-color: #f1c40f;  border: thin solid #d0a90c;}.four-bars .bar.fifth-bar,.three-bars .bar.fifth-bar,.three-bars .bar.fourth-bar,.one-bar .bar:not(.first-bar),.two-bars .bar:not(.first-bar):not(.second-bar) {  background-color: #fafafa;  border: thin solid #f3f3f3;}";
-  WebServer::_webServer.send(200, "text/css", response);
+  WebServer::sendStaticContent(STYLESHEET, "text/css", WebServer::getContentETag(STYLESHEET, _stylesheetETag));
 }
 
 /*
- * WebServer::handleRoot
- * ---------------------
+ * WebServer::handleJavascript
+ * ---------------------------
  * This method handle a request to the javascript '/script.js' webpage
  */
 void WebServer::handleJavascript() {
-  String response = "function OpenSSIDPopup(ssid)\n\
-{\n\
- var popup = document.getElementById(\"popup\");\n\
-  var ssid_name = document.getElementById(\"ssid_name\");\n\
-  var ssid_name_text = document.getElementById(\"ssid_name_text\");\n\
-  var ssid_password = document.getElementById(\"ssid_password\");\n\
-  ssid_name.value = ssid;\n\
-  ssid_name_text.innerHTML = ssid;\n\
-  ssid_password.value = \"\";\n\
-  popup.style.visibility = \"visible\";\n\
-  popup.style.opacity = 1;\n\
-}\n\
-\n\
-function SaveTransmitterId() {\n\
-  document.location.href='/savetransmitterid?TransmitterId=' + document.getElementById(\"TransmitterId\").value;\n\
-}\n\
-\n\
-function SaveAppEngineAddress() {\n\
-  document.location.href='/saveappengineaddress?Address=' + document.getElementById(\"txtAppEngineAddress\").value;\n\
-}\n\
-\n\
-function SaveHotSpotConfig() {\n\
-  var hotspotName = document.getElementById(\"txtHotSpotName\").value;\n\
-  var hotspotPassword = document.getElementById(\"txtHotSpotPassword\").value;\n\
-  document.location.href='/savehotspotconfig?name=' + hotspotName + '&pass=' + hotspotPassword;\n\
-}\n\
-\n\
-function SaveDebugConfig() {\n\
-  var debugEnabled = document.getElementById(\"chkDebug\").checked ? \"1\" : \"0\";\n\
-  var debugAddress = document.getElementById(\"txtDebugAddress\").value;\n\
-  document.location.href='/savedebugconfig?enabled=' + debugEnabled + '&ip=' + debugAddress;\n\
-}\n\
-\n\
-function SaveSSID() {\n\
-  var ssid_name = document.getElementById(\"ssid_name\");\n\
-  var ssid_password = document.getElementById(\"ssid_password\");\n\
-  var frmSaveSSID = document.getElementById(\"frmSaveSSID\");\n\
-  frmSaveSSID.submit();\n\
-}\n\
-\n\
-function ClosePopup() {\n\
-  var popup = document.getElementById(\"popup\");\n\
-  popup.style.visibility = \"hidden\";\n\
-  popup.style.opacity = 0;\n\
-}\n\
-\n\
-function RemoveSSID(ssid)\n\
-{\n\
-  if (confirm(\"Do you really want to remove \" + ssid)) {\n\
-    document.location.href='remove?ssid=' + ssid;\n\
-  }\n\
-}\n\
-\n\
-function TestSSID(ssid) {\n\
-  var xhttp = new XMLHttpRequest();\n\
-  xhttp.open(\"GET\", \"test/\" + ssid, true);\n\
-  xhttp.onreadystatechange = function () {\n\
-    if(xhttp.readyState === XMLHttpRequest.DONE && xhttp.status === 200){\n\
-      alert(xhttp.responseText);\n\
-      console.log(xhttp.responseText);\n\
-    };\n\
-  };\n\
-  xhttp.send();\n\
-}\n\
-\n\
-\n\
-function ScanWifi() {\n\
-  var xhttp = new XMLHttpRequest();\n\
-  xhttp.open(\"GET\", \"scanwifi\", true);\n\
-  xhttp.onreadystatechange = function () {\n\
-    if(xhttp.readyState === XMLHttpRequest.DONE && xhttp.status === 200){\n\
-      var divScannedWifi = document.getElementById(\"scannedWifi\");\n\
-      divScannedWifi.innerHTML = xhttp.responseText;\n\
-    };\n\
-  };\n\
-  xhttp.send();\n\
-  location.hash = \"#scannedWifi\";\n\
-  \n\
-}\n\
-";
-  WebServer::_webServer.send(200, "text/javascript", response);
+  WebServer::sendStaticContent(JAVASCRIPT, "text/javascript", WebServer::getContentETag(JAVASCRIPT, _javascriptETag));
 }
 
 
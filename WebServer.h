@@ -6,7 +6,23 @@
 #include "Arduino.h"
 #include "Configuration.h"
 #include "DexcomHelper.h"
+#include "WifiManager.h"
+#include "RadioScheduler.h"
+#include "WifiScanner.h"
+#include "Uploader.h"
+#include "JsonWriter.h"
+#include "JsonParser.h"
 
+// Quoted 8 hex digits
+#define WEB_SERVER_ETAG_LENGTH 11
+// Size of the buffer the API answers are written in
+#define WEB_SERVER_JSON_BUFFER_SIZE 1536
+// Larger /api/config bodies are refused
+#define WEB_SERVER_MAX_BODY_LENGTH 1024
+// Longest member name accepted by /api/config
+#define WEB_SERVER_MAX_KEY_LENGTH 24
+// Size of the chunks of the /metrics response
+#define WEB_SERVER_CHUNK_SIZE 512
 
 
 class WebServer {
@@ -14,26 +30,44 @@ class WebServer {
     WebServer();
     void start();
     void loop();
-    void setConfiguration(Configuration configuration);
+    void setConfiguration(Configuration* configuration);
+    void setWifiManager(WifiManager* wifiManager);
+    void setRadioScheduler(RadioScheduler* radioScheduler);
+    void setUploader(Uploader* uploader);
   private:
-    String getDexcomId();
+    void getDexcomId(uint8_t port, char* transmitterId);
+    int getTransmitterPort(const char* key);
     void handleRoot();
     //void handleNotFound();
     void handleStylesheet();
     void handleJavascript();
     void handleScanWifi();
     void handleTest();
-    void handleSaveTransmitterId();
-    void handleSaveDebugConfig();
-    void handleSaveHotSpotConfig();
-    void handleSaveSSID();
-    void handleRemoveSSID();
-    void handleSaveAppEngineAddress();
-    void redirect(String url);
-    String padding(int number, byte width);
+    void handleProfile();
+    void handleWifiStats();
+    void handleRadioStats();
+    void handleMetrics();
+    void handleStatus();
+    void handleGetConfig();
+    void handleSetConfig();
+    const char* checkConfigMember(const char* key, const char* value, JsonType type);
+    void writeConfig(JsonWriter &json);
+    void sendJson(int code, JsonWriter &json);
+    void sendError(int code, const char* message);
+    const char* getContentETag(PGM_P content, char* etag);
+    bool isNotModified(const char* etag);
+    void sendStaticContent(PGM_P content, const char* contentType, const char* etag);
     static ESP8266WebServer _webServer;
-    static Configuration _configuration;
+    static Configuration* _configuration;
+    static WifiManager* _wifiManager;
+    static RadioScheduler* _radioScheduler;
+    static Uploader* _uploader;
     static DexcomHelper _dexcomHelper;
+    static WifiScanner _wifiScanner;
+    static char _stylesheetETag[WEB_SERVER_ETAG_LENGTH];
+    static char _javascriptETag[WEB_SERVER_ETAG_LENGTH];
+    static uint32_t _bootNonce;
+    static char _jsonBuffer[WEB_SERVER_JSON_BUFFER_SIZE];
     void StartAccessPoint();
     
 };
@@ -0,0 +1,419 @@
+/*
+ * WifiManager - Library for keeping the station connected to the configured wifi without blocking
+ *
+ * Each round first rejoins the last network with the cached BSSID and channel (no scan). The cached address is
+ * reused too (no DHCP) for WIFI_MANAGER_ADDRESS_LIFETIME after DHCP gave it, then DHCP is asked again,
+ * then tries every configured network once, best score first, until one connects.
+ * When the whole round fails the next one starts after WIFI_MANAGER_RETRY_INTERVAL
+ * or as soon as the configuration changes.
+ */
+#include "WifiManager.h"
+#include "Metrics.h"
+#include "Crc32.h"
+
+/*
+ * Constructor
+ */
+WifiManager::WifiManager() {
+  _configuration = NULL;
+  _state = WIFI_MANAGER_IDLE;
+  _configurationVersion = 0;
+  memset(&_lease, 0, sizeof(_lease));
+  _leaseValid = false;
+  _fastAttempt = false;
+  _fastTried = false;
+  _staticAttempt = false;
+  _dhcpKnown = false;
+  _dhcpMillis = 0;
+  _attemptSsid[0] = '\0';
+  _triedMask = 0;
+  _attemptStartMillis = 0;
+  _roundEndMillis = 0;
+  _lastRssiMillis = 0;
+  _fastConnectCount = 0;
+  _disconnectCount = 0;
+}
+
+/*
+ * WifiManager::setConfiguration
+ * -----------------------------
+ * This method will set the configuration holding the saved wifi
+ * configuration: The shared configuration
+ */
+void WifiManager::setConfiguration(Configuration* configuration) {
+  _configuration = configuration;
+}
+
+/*
+ * WifiManager::begin
+ * ------------------
+ * This method will load the cached lease and start the first round. The file system must be mounted
+ */
+void WifiManager::begin() {
+  // The SDK would write the credentials in flash at every WiFi.begin
+  WiFi.persistent(false);
+  // Reconnections are done by loop so they can use the ranking
+  WiFi.setAutoReconnect(false);
+  File leaseFile = LittleFS.open(WIFI_MANAGER_LEASE_FILE, "r");
+  if (leaseFile) {
+    _leaseValid = leaseFile.read((uint8_t*)&_lease, sizeof(_lease)) == sizeof(_lease) &&
+                  Crc32(&_lease, offsetof(WifiLease, crc)) == _lease.crc;
+    leaseFile.close();
+  }
+  if (_configuration != NULL) {
+    _configurationVersion = _configuration->getVersion();
+  }
+  startRound();
+}
+
+/*
+ * WifiManager::loop
+ * -----------------
+ * This method is called by the main program at each "loop" call. Checks the running association
+ * returns: The state of the connection
+ */
+WifiManagerState WifiManager::loop() {
+  if (_configuration == NULL) {
+    return _state;
+  }
+  if (_configuration->getVersion() != _configurationVersion) {
+    _configurationVersion = _configuration->getVersion();
+    if (_state == WIFI_MANAGER_IDLE || _state == WIFI_MANAGER_WAITING) {
+      // A network may have been added, no need to wait
+      startRound();
+    }
+  }
+  switch (_state) {
+    case WIFI_MANAGER_CONNECTING: {
+      wl_status_t status = WiFi.status();
+      unsigned long timeout = _fastAttempt ? WIFI_MANAGER_FAST_CONNECT_TIMEOUT : WIFI_MANAGER_CONNECT_TIMEOUT;
+      if (status == WL_CONNECTED) {
+        endAttempt(true);
+      }
+      else if (status == WL_CONNECT_FAILED || millis() - _attemptStartMillis > timeout) {
+        endAttempt(false);
+        if (!startNextAttempt()) {
+          _state = WIFI_MANAGER_WAITING;
+          _roundEndMillis = millis();
+        }
+      }
+      break;
+    }
+    case WIFI_MANAGER_CONNECTED:
+      if (WiFi.status() != WL_CONNECTED) {
+        _disconnectCount++;
+        Metrics::count(METRIC_WIFI_RECONNECTS);
+        startRound();
+      }
+      else if (_staticAttempt && millis() - _dhcpMillis >= WIFI_MANAGER_ADDRESS_LIFETIME) {
+        // A static address is never renewed, rejoin to get it from DHCP again
+        WiFi.disconnect();
+        startRound();
+      }
+      else if (millis() - _lastRssiMillis > WIFI_MANAGER_RSSI_INTERVAL) {
+        _lastRssiMillis = millis();
+        getStats(_attemptSsid)->lastRssi = WiFi.RSSI();
+      }
+      break;
+    case WIFI_MANAGER_WAITING:
+      if (millis() - _roundEndMillis > WIFI_MANAGER_RETRY_INTERVAL) {
+        startRound();
+      }
+      break;
+    case WIFI_MANAGER_IDLE:
+    case WIFI_MANAGER_SUSPENDED:
+      break;
+  }
+  return _state;
+}
+
+/*
+ * WifiManager::suspend
+ * --------------------
+ * This method will stop the connection attempts until resume is called, before the radio is turned off
+ */
+void WifiManager::suspend() {
+  if (_state == WIFI_MANAGER_CONNECTING) {
+    endAttempt(false);
+  }
+  _state = WIFI_MANAGER_SUSPENDED;
+}
+
+/*
+ * WifiManager::resume
+ * -------------------
+ * This method will rejoin a network after the radio was turned back on, the cached lease is tried first
+ */
+void WifiManager::resume() {
+  if (_state == WIFI_MANAGER_SUSPENDED) {
+    startRound();
+  }
+}
+
+/*
+ * WifiManager::isConnected
+ * ------------------------
+ * This method will tell if the station has an address on a configured network
+ */
+bool WifiManager::isConnected() {
+  return _state == WIFI_MANAGER_CONNECTED;
+}
+
+/*
+ * WifiManager::getState
+ * ---------------------
+ * This method will return the state of the connection
+ */
+WifiManagerState WifiManager::getState() {
+  return _state;
+}
+
+/*
+ * WifiManager::getSsid
+ * --------------------
+ * This method will return the SSID of the network joined, empty when not connected
+ */
+const char* WifiManager::getSsid() {
+  return _state == WIFI_MANAGER_CONNECTED ? _attemptSsid : "";
+}
+
+/*
+ * WifiManager::getFastConnectCount
+ * --------------------------------
+ * This method will return how many times the cached lease was enough to join the network
+ */
+uint32_t WifiManager::getFastConnectCount() {
+  return _fastConnectCount;
+}
+
+/*
+ * WifiManager::printReport
+ * ------------------------
+ * This method will print one line per known SSID with its connection statistics
+ * output: Where to print the report
+ */
+void WifiManager::printReport(Print &output) {
+  output.print("ssid attempts successes failures_in_row last_connect_ms avg_connect_ms rssi score\n");
+  for (int i = 0; i < WIFI_MANAGER_MAX_NETWORKS; i++) {
+    WifiNetworkStats* stats = &_stats[i];
+    if (stats->ssid[0] == '\0') {
+      continue;
+    }
+    output.print(stats->ssid);
+    output.print(" ");
+    output.print(stats->attemptCount);
+    output.print(" ");
+    output.print(stats->successCount);
+    output.print(" ");
+    output.print(stats->consecutiveFailureCount);
+    output.print(" ");
+    output.print(stats->lastConnectMillis);
+    output.print(" ");
+    output.print(stats->successCount > 0 ? stats->totalConnectMillis / stats->successCount : 0);
+    output.print(" ");
+    output.print(stats->lastRssi);
+    output.print(" ");
+    output.print(getScore(stats->ssid));
+    output.print("\n");
+  }
+  output.print("state ");
+  output.print(_state);
+  output.print("\nfast_connects ");
+  output.print(_fastConnectCount);
+  output.print("\ndisconnects ");
+  output.print(_disconnectCount);
+  output.print("\n");
+}
+
+/*
+ * WifiManager::startRound
+ * -----------------------
+ * This method will start trying the configured networks from the best one
+ */
+void WifiManager::startRound() {
+  _triedMask = 0;
+  _fastTried = false;
+  if (_configuration == NULL || _configuration->getWifiCount() == 0) {
+    _state = WIFI_MANAGER_IDLE;
+    return;
+  }
+  if (!startNextAttempt()) {
+    _state = WIFI_MANAGER_WAITING;
+    _roundEndMillis = millis();
+  }
+}
+
+/*
+ * WifiManager::startNextAttempt
+ * -----------------------------
+ * This method will start the association with the next network of the round without waiting for it
+ * returns: false if every configured network was tried in this round
+ */
+bool WifiManager::startNextAttempt() {
+  int wifiCount = _configuration->getWifiCount();
+  if (!_fastTried) {
+    _fastTried = true;
+    int position = _leaseValid ? _configuration->findSSID(_lease.ssid) : -1;
+    if (position >= 0) {
+      // The address is only reused on the network that gave it, and not for longer than the router may keep it.
+      // After a restart the lease age is unknown so DHCP is asked, the cached BSSID and channel still avoid the scan
+      const WifiData* wifiData = _configuration->getWifiData(position);
+      _staticAttempt = _dhcpKnown && millis() - _dhcpMillis < WIFI_MANAGER_ADDRESS_LIFETIME;
+      if (_staticAttempt) {
+        WiFi.config(IPAddress(_lease.localIp), IPAddress(_lease.gateway), IPAddress(_lease.subnetMask), IPAddress(_lease.dns));
+      }
+      else {
+        WiFi.config(IPAddress(), IPAddress(), IPAddress());
+      }
+      WiFi.begin(_lease.ssid, wifiData->password, _lease.channel, _lease.bssid);
+      strcpy(_attemptSsid, _lease.ssid);
+      _fastAttempt = true;
+      _attemptStartMillis = millis();
+      _state = WIFI_MANAGER_CONNECTING;
+      getStats(_attemptSsid)->attemptCount++;
+      return true;
+    }
+  }
+
+  int bestIndex = -1;
+  int bestScore = 0;
+  for (int i = 0; i < wifiCount; i++) {
+    if (_triedMask & (1UL << i)) {
+      continue;
+    }
+    int score = getScore(_configuration->getWifiData(i)->ssid);
+    if (bestIndex < 0 || score > bestScore) {
+      bestIndex = i;
+      bestScore = score;
+    }
+  }
+  if (bestIndex < 0) {
+    return false;
+  }
+  _triedMask |= 1UL << bestIndex;
+  const WifiData* wifiData = _configuration->getWifiData(bestIndex);
+  // Back to DHCP after a fast attempt
+  WiFi.config(IPAddress(), IPAddress(), IPAddress());
+  WiFi.begin(wifiData->ssid, wifiData->password);
+  strcpy(_attemptSsid, wifiData->ssid);
+  _fastAttempt = false;
+  _staticAttempt = false;
+  _attemptStartMillis = millis();
+  _state = WIFI_MANAGER_CONNECTING;
+  getStats(_attemptSsid)->attemptCount++;
+  return true;
+}
+
+/*
+ * WifiManager::endAttempt
+ * -----------------------
+ * This method will update the statistics of the network tried
+ * connected: true if the station got connected
+ */
+void WifiManager::endAttempt(bool connected) {
+  WifiNetworkStats* stats = getStats(_attemptSsid);
+  if (connected) {
+    uint32_t connectMillis = millis() - _attemptStartMillis;
+    stats->successCount++;
+    stats->consecutiveFailureCount = 0;
+    stats->lastConnectMillis = connectMillis;
+    Metrics::observe(METRIC_WIFI_CONNECT, connectMillis * 1000);
+    stats->totalConnectMillis += connectMillis;
+    stats->lastRssi = WiFi.RSSI();
+    _lastRssiMillis = millis();
+    if (_fastAttempt) {
+      _fastConnectCount++;
+    }
+    if (!_staticAttempt) {
+      _dhcpKnown = true;
+      _dhcpMillis = millis();
+    }
+    _state = WIFI_MANAGER_CONNECTED;
+    saveLease();
+  }
+  else {
+    stats->consecutiveFailureCount++;
+    if (_fastAttempt) {
+      // The cached lease is not good anymore
+      _leaseValid = false;
+    }
+    WiFi.disconnect();
+  }
+}
+
+/*
+ * WifiManager::saveLease
+ * ----------------------
+ * This method will save the joined network and address in flash when they changed
+ */
+void WifiManager::saveLease() {
+  WifiLease lease;
+  memset(&lease, 0, sizeof(lease));
+  strcpy(lease.ssid, _attemptSsid);
+  memcpy(lease.bssid, WiFi.BSSID(), sizeof(lease.bssid));
+  lease.channel = WiFi.channel();
+  lease.localIp = WiFi.localIP();
+  lease.gateway = WiFi.gatewayIP();
+  lease.subnetMask = WiFi.subnetMask();
+  lease.dns = WiFi.dnsIP();
+  lease.crc = Crc32(&lease, offsetof(WifiLease, crc));
+  if (_leaseValid && memcmp(&lease, &_lease, sizeof(lease)) == 0) {
+    return;
+  }
+  _lease = lease;
+  _leaseValid = true;
+  File leaseFile = LittleFS.open(WIFI_MANAGER_LEASE_FILE, "w");
+  if (leaseFile) {
+    leaseFile.write((const uint8_t*)&_lease, sizeof(_lease));
+    leaseFile.close();
+  }
+}
+
+/*
+ * WifiManager::getStats
+ * ---------------------
+ * This method will find the statistics of a SSID. The least recently used entry is replaced when the SSID is new
+ * ssid: The SSID
+ * returns: The statistics of the SSID
+ */
+WifiNetworkStats* WifiManager::getStats(const char* ssid) {
+  WifiNetworkStats* oldest = &_stats[0];
+  for (int i = 0; i < WIFI_MANAGER_MAX_NETWORKS; i++) {
+    if (strcmp(_stats[i].ssid, ssid) == 0) {
+      _stats[i].lastUsedMillis = millis();
+      return &_stats[i];
+    }
+    if (_stats[i].ssid[0] == '\0' || _stats[i].lastUsedMillis < oldest->lastUsedMillis) {
+      oldest = &_stats[i];
+    }
+  }
+  *oldest = WifiNetworkStats();
+  strncpy(oldest->ssid, ssid, CONFIGURATION_MAX_SSID_LENGTH);
+  oldest->ssid[CONFIGURATION_MAX_SSID_LENGTH] = '\0';
+  oldest->lastUsedMillis = millis();
+  return oldest;
+}
+
+/*
+ * WifiManager::getScore
+ * ---------------------
+ * This method will rank a SSID from its past connections and its last signal strength. Unknown SSID score 0
+ * ssid: The SSID
+ * returns: The score, higher is better
+ */
+int WifiManager::getScore(const char* ssid) {
+  for (int i = 0; i < WIFI_MANAGER_MAX_NETWORKS; i++) {
+    WifiNetworkStats* stats = &_stats[i];
+    if (strcmp(stats->ssid, ssid) != 0) {
+      continue;
+    }
+    int score = (stats->successCount < 20 ? stats->successCount : 20) * 4;
+    score -= stats->consecutiveFailureCount * 10;
+    if (stats->lastRssi < 0) {
+      // -90 dBm adds 5, -50 dBm adds 25
+      score += (stats->lastRssi + 100) / 2;
+    }
+    return score;
+  }
+  return 0;
+}
@@ -0,0 +1,106 @@
+#ifndef WifiManager_h
+#define WifiManager_h
+
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include "Arduino.h"
+#include "Configuration.h"
+
+#define WIFI_MANAGER_LEASE_FILE "/wifi.lease"
+// Number of SSID with connection statistics
+#define WIFI_MANAGER_MAX_NETWORKS 8
+// Delay in milliseconds given to one association
+#define WIFI_MANAGER_CONNECT_TIMEOUT 10000
+// Delay in milliseconds given to a rejoin with the cached BSSID, channel and address
+#define WIFI_MANAGER_FAST_CONNECT_TIMEOUT 3000
+// Delay in milliseconds after a DHCP lease during which its address is reused without asking DHCP again
+#define WIFI_MANAGER_ADDRESS_LIFETIME 3600000
+// Delay in milliseconds between two rounds when no configured network could be joined
+#define WIFI_MANAGER_RETRY_INTERVAL 30000
+// Delay in milliseconds between two signal strength readings while connected
+#define WIFI_MANAGER_RSSI_INTERVAL 60000
+
+// The networks tried in a round are kept in a 32 bits mask
+static_assert(CONFIGURATION_MAX_WIFI <= 32, "Too many saved wifi for the round mask");
+
+enum WifiManagerState {
+  WIFI_MANAGER_IDLE, // No network configured
+  WIFI_MANAGER_CONNECTING,
+  WIFI_MANAGER_CONNECTED,
+  WIFI_MANAGER_WAITING, // Every network failed, waiting for WIFI_MANAGER_RETRY_INTERVAL
+  WIFI_MANAGER_SUSPENDED // Radio turned off, see suspend()
+};
+
+/*
+ * Connection statistics of one SSID
+ */
+struct WifiNetworkStats {
+  char ssid[CONFIGURATION_MAX_SSID_LENGTH + 1] = "";
+  uint32_t attemptCount = 0;
+  uint32_t successCount = 0;
+  uint32_t consecutiveFailureCount = 0;
+  uint32_t lastConnectMillis = 0; // Time to associate and get an address the last time
+  uint32_t totalConnectMillis = 0;
+  int32_t lastRssi = 0; // 0 when never seen
+  uint32_t lastUsedMillis = 0;
+};
+
+/*
+ * Last network joined, saved in flash to rejoin without scanning nor waiting for DHCP
+ */
+struct WifiLease {
+  char ssid[CONFIGURATION_MAX_SSID_LENGTH + 1];
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint32_t localIp;
+  uint32_t gateway;
+  uint32_t subnetMask;
+  uint32_t dns;
+  uint32_t crc;
+};
+
+/*
+ * Keeps the station connected to the best configured network without blocking the sketch
+ */
+class WifiManager {
+  public:
+    WifiManager();
+    void setConfiguration(Configuration* configuration);
+    void begin();
+    WifiManagerState loop();
+    void suspend();
+    void resume();
+    bool isConnected();
+    WifiManagerState getState();
+    const char* getSsid();
+    uint32_t getFastConnectCount();
+    void printReport(Print &output);
+  private:
+    void startRound();
+    bool startNextAttempt();
+    void endAttempt(bool connected);
+    void saveLease();
+    WifiNetworkStats* getStats(const char* ssid);
+    int getScore(const char* ssid);
+    Configuration* _configuration;
+    WifiManagerState _state;
+    uint32_t _configurationVersion;
+    WifiNetworkStats _stats[WIFI_MANAGER_MAX_NETWORKS];
+    WifiLease _lease;
+    bool _leaseValid;
+    bool _fastAttempt;
+    bool _fastTried;
+    bool _staticAttempt; // The attempt reuses the cached address instead of DHCP
+    bool _dhcpKnown;
+    unsigned long _dhcpMillis; // Last address given by DHCP in this boot
+    char _attemptSsid[CONFIGURATION_MAX_SSID_LENGTH + 1];
+    // Configured networks already tried in this round
+    uint32_t _triedMask;
+    unsigned long _attemptStartMillis;
+    unsigned long _roundEndMillis;
+    unsigned long _lastRssiMillis;
+    uint32_t _fastConnectCount;
+    uint32_t _disconnectCount;
+};
+
+#endif
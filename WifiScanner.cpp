@@ -0,0 +1,140 @@
+/*
+ * WifiScanner - Library for scanning the wifi without blocking the sketch
+ *
+ * The scan is started by requestScan and checked by loop, the SDK results are copied in a fixed table
+ * and freed right away. An SSID seen on several access points is kept once.
+ * writeJson writes {"scanning":0,"age":12,"networks":[["ssid",-61,1],...]}: age in seconds and one
+ * [ssid, rssi, secure] array per network, strongest first.
+ */
+#include "WifiScanner.h"
+
+/*
+ * Constructor
+ */
+WifiScanner::WifiScanner() {
+  _scanning = false;
+  _hasResults = false;
+  _scanMillis = 0;
+  _networkCount = 0;
+}
+
+/*
+ * WifiScanner::requestScan
+ * ------------------------
+ * This method will start a scan unless one is running or the last results are still fresh
+ */
+void WifiScanner::requestScan() {
+  if (_scanning || (_hasResults && millis() - _scanMillis < WIFI_SCANNER_TTL)) {
+    return;
+  }
+  _scanning = WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING;
+}
+
+/*
+ * WifiScanner::loop
+ * -----------------
+ * This method is called by the web server at each "loop" call. Saves the results when the scan is over
+ */
+void WifiScanner::loop() {
+  if (!_scanning) {
+    return;
+  }
+  int count = WiFi.scanComplete();
+  if (count == WIFI_SCAN_RUNNING) {
+    return;
+  }
+  _scanning = false;
+  if (count >= 0) {
+    saveResults(count);
+  }
+  WiFi.scanDelete();
+}
+
+/*
+ * WifiScanner::isScanning
+ * -----------------------
+ * This method will tell if a scan is running
+ */
+bool WifiScanner::isScanning() {
+  return _scanning;
+}
+
+/*
+ * WifiScanner::writeJson
+ * ----------------------
+ * This method will write the last results in JSON
+ * json: Where to write the results
+ */
+void WifiScanner::writeJson(JsonWriter &json) {
+  json.beginObject();
+  json.key("scanning");
+  json.value(_scanning ? 1 : 0);
+  json.key("age");
+  json.value(_hasResults ? (millis() - _scanMillis) / 1000 : 0UL);
+  json.key("networks");
+  json.beginArray();
+  for (int i = 0; i < _networkCount; i++) {
+    json.beginArray();
+    json.value(_networks[i].ssid);
+    json.value((int)_networks[i].rssi);
+    json.value(_networks[i].secure ? 1 : 0);
+    json.endArray();
+  }
+  json.endArray();
+  json.endObject();
+}
+
+/*
+ * WifiScanner::saveResults
+ * ------------------------
+ * This method will copy the SDK scan results, one entry per SSID sorted by signal strength
+ * count: Number of access points found
+ */
+void WifiScanner::saveResults(int count) {
+  _networkCount = 0;
+  for (int i = 0; i < count; i++) {
+    String ssid = WiFi.SSID(i);
+    if (ssid.length() == 0) {
+      // Hidden network
+      continue;
+    }
+    int rssi = WiFi.RSSI(i);
+    bool secure = WiFi.encryptionType(i) != ENC_TYPE_NONE;
+    int position = 0;
+    while (position < _networkCount && strcmp(_networks[position].ssid, ssid.c_str()) != 0) {
+      position++;
+    }
+    if (position < _networkCount) {
+      // Same SSID on another access point
+      ScannedWifi* network = &_networks[position];
+      if (rssi <= network->rssi) {
+        network->secure = network->secure || secure;
+        continue;
+      }
+      secure = secure || network->secure;
+      // Stronger, removed to be inserted again at its new place
+      memmove(network, network + 1, (_networkCount - position - 1) * sizeof(ScannedWifi));
+      _networkCount--;
+    }
+    // Keep the table sorted, the weakest network is dropped when it is full
+    int insert = _networkCount;
+    while (insert > 0 && _networks[insert - 1].rssi < rssi) {
+      insert--;
+    }
+    if (insert >= WIFI_SCANNER_MAX_NETWORKS) {
+      continue;
+    }
+    int moved = _networkCount < WIFI_SCANNER_MAX_NETWORKS ? _networkCount - insert : _networkCount - insert - 1;
+    memmove(&_networks[insert + 1], &_networks[insert], moved * sizeof(ScannedWifi));
+    if (_networkCount < WIFI_SCANNER_MAX_NETWORKS) {
+      _networkCount++;
+    }
+    ScannedWifi* network = &_networks[insert];
+    strncpy(network->ssid, ssid.c_str(), CONFIGURATION_MAX_SSID_LENGTH);
+    network->ssid[CONFIGURATION_MAX_SSID_LENGTH] = '\0';
+    network->rssi = rssi;
+    network->secure = secure;
+  }
+  _hasResults = true;
+  _scanMillis = millis();
+}
@@ -0,0 +1,42 @@
+#ifndef WifiScanner_h
+#define WifiScanner_h
+
+#include <ESP8266WiFi.h>
+#include "Arduino.h"
+#include "Configuration.h"
+#include "JsonWriter.h"
+
+// Number of different SSID kept from a scan, the strongest ones
+#define WIFI_SCANNER_MAX_NETWORKS 24
+// Delay in milliseconds during which the last scan results are served without scanning again
+#define WIFI_SCANNER_TTL 30000
+
+/*
+ * One SSID seen by the scan, with the strongest signal of all its access points
+ */
+struct ScannedWifi {
+  char ssid[CONFIGURATION_MAX_SSID_LENGTH + 1];
+  int8_t rssi;
+  bool secure;
+};
+
+/*
+ * Scans the wifi in the background and keeps the results for WIFI_SCANNER_TTL
+ */
+class WifiScanner {
+  public:
+    WifiScanner();
+    void requestScan();
+    void loop();
+    bool isScanning();
+    void writeJson(JsonWriter &json);
+  private:
+    void saveResults(int count);
+    bool _scanning;
+    bool _hasResults;
+    unsigned long _scanMillis;
+    ScannedWifi _networks[WIFI_SCANNER_MAX_NETWORKS];
+    int _networkCount;
+};
+
+#endif
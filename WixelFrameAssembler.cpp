@@ -0,0 +1,140 @@
+/*
+ * WixelFrameAssembler - Library for assembling the frames received from the Wixel without allocating memory
+ *
+ * A frame is: length byte (including itself), message type, message content
+ */
+#include "WixelFrameAssembler.h"
+#include "Metrics.h"
+
+/*
+ * Constructor
+ */
+WixelFrameAssembler::WixelFrameAssembler() {
+  _droppedFrameCount = 0;
+  _lastReception = 0;
+  _frameStartMicros = 0;
+  _frameCompleteMicros = 0;
+  reset();
+}
+
+/*
+ * WixelFrameAssembler::reset
+ * --------------------------
+ * This method will wait for the length byte of the next frame
+ */
+void WixelFrameAssembler::reset() {
+  _state = FRAME_WAITING_LENGTH;
+  _frameLength = 0;
+  _framePosition = 0;
+}
+
+/*
+ * WixelFrameAssembler::readFrame
+ * ------------------------------
+ * This method will read every byte already available on the stream until a frame is complete.
+ * Bytes of the next frame are left in the stream for the next call.
+ * stream: The serial port connected to the Wixel
+ * returns: true when a complete frame is available with getFrame
+ */
+bool WixelFrameAssembler::readFrame(Stream &stream) {
+  if (_state == FRAME_COMPLETE) {
+    // Previous frame was handed out already
+    reset();
+  }
+  int available = stream.available();
+  if (available <= 0) {
+    return false;
+  }
+  unsigned long currentMillis = millis();
+  if (_state == FRAME_READING && currentMillis - _lastReception > WIXEL_FRAME_TIMEOUT) {
+    // The rest of the frame never came, start over with this byte
+    _droppedFrameCount++;
+    Metrics::count(METRIC_FRAME_TIMEOUTS);
+    reset();
+  }
+  _lastReception = currentMillis;
+
+  while (available > 0) {
+    if (_state == FRAME_WAITING_LENGTH) {
+      int length = stream.read();
+      available--;
+      if (length < 2 || length > WIXEL_MAX_FRAME_LENGTH) {
+        // 0 length message...impossible skip. Too long messages are garbage
+        if (length > 0) {
+          _droppedFrameCount++;
+          Metrics::count(METRIC_BAD_FRAMES);
+        }
+        continue;
+      }
+      _frameStartMicros = micros();
+      _frame[0] = length;
+      _frameLength = length;
+      _framePosition = 1;
+      _state = FRAME_READING;
+    }
+    else {
+      unsigned int toRead = _frameLength - _framePosition;
+      if (toRead > (unsigned int)available) {
+        toRead = available;
+      }
+      unsigned int read = stream.readBytes(&_frame[_framePosition], toRead);
+      _framePosition += read;
+      available -= read;
+      if (_framePosition == _frameLength) {
+        _frameCompleteMicros = micros();
+        _state = FRAME_COMPLETE;
+        return true;
+      }
+      if (read < toRead) {
+        // Stream timeout, keep the partial frame for the next call
+        return false;
+      }
+    }
+  }
+  return false;
+}
+
+/*
+ * WixelFrameAssembler::getFrame
+ * -----------------------------
+ * returns: The last complete frame. Valid until the next call to readFrame
+ */
+const unsigned char* WixelFrameAssembler::getFrame() {
+  return _frame;
+}
+
+/*
+ * WixelFrameAssembler::getFrameLength
+ * -----------------------------------
+ * returns: The length of the last complete frame
+ */
+unsigned int WixelFrameAssembler::getFrameLength() {
+  return _frameLength;
+}
+
+/*
+ * WixelFrameAssembler::getFrameStartMicros
+ * ----------------------------------------
+ * returns: micros() when the length byte of the last frame was read
+ */
+unsigned long WixelFrameAssembler::getFrameStartMicros() {
+  return _frameStartMicros;
+}
+
+/*
+ * WixelFrameAssembler::getFrameCompleteMicros
+ * -------------------------------------------
+ * returns: micros() when the last byte of the last frame was read
+ */
+unsigned long WixelFrameAssembler::getFrameCompleteMicros() {
+  return _frameCompleteMicros;
+}
+
+/*
+ * WixelFrameAssembler::getDroppedFrameCount
+ * -----------------------------------------
+ * returns: Number of frames dropped because they were too long or incomplete
+ */
+uint32_t WixelFrameAssembler::getDroppedFrameCount() {
+  return _droppedFrameCount;
+}
@@ -0,0 +1,40 @@
+#ifndef WixelFrameAssembler_h
+#define WixelFrameAssembler_h
+
+#include "Arduino.h"
+
+// Biggest frame we accept from the Wixel (Data packet is 0x11 bytes)
+#define WIXEL_MAX_FRAME_LENGTH 32
+// Delay in milliseconds for maximum time between reception of two bytes of the same frame
+#define WIXEL_FRAME_TIMEOUT 2000
+
+/*
+ * Assemble the length prefixed frames sent by the Wixel in a preallocated buffer
+ */
+class WixelFrameAssembler {
+  public:
+    WixelFrameAssembler();
+    bool readFrame(Stream &stream);
+    const unsigned char* getFrame();
+    unsigned int getFrameLength();
+    uint32_t getDroppedFrameCount();
+    unsigned long getFrameStartMicros();
+    unsigned long getFrameCompleteMicros();
+  private:
+    enum FrameState {
+      FRAME_WAITING_LENGTH,
+      FRAME_READING,
+      FRAME_COMPLETE
+    };
+    void reset();
+    FrameState _state;
+    unsigned char _frame[WIXEL_MAX_FRAME_LENGTH];
+    unsigned int _frameLength;
+    unsigned int _framePosition;
+    unsigned long _lastReception;
+    unsigned long _frameStartMicros;
+    unsigned long _frameCompleteMicros;
+    uint32_t _droppedFrameCount;
+};
+
+#endif
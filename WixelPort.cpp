@@ -0,0 +1,139 @@
+/*
+ * WixelPort - Library for keeping apart the frames and the readings of each Wixel connected to the bridge
+ *
+ * Each Wixel has its own serial port, frame assembler, duplicate filter and reading queue, so a
+ * half received frame or a resent reading of one Wixel never mixes with the other ones.
+ */
+#include "WixelPort.h"
+
+/*
+ * Constructor
+ */
+WixelPort::WixelPort() {
+  _number = 0;
+  _stream = NULL;
+  _lastAckMicros = 0;
+}
+
+/*
+ * WixelPort::begin
+ * ----------------
+ * This method will open the reading queue of the port. The file system must be mounted
+ * number: Number of the port, from 0 to WIXEL_PORT_COUNT - 1
+ * stream: The serial port connected to the Wixel, started already
+ * returns: false if the reading queue can't be used
+ */
+bool WixelPort::begin(uint8_t number, Stream* stream) {
+  _number = number;
+  _stream = stream;
+  return _readingQueue.begin(number);
+}
+
+/*
+ * WixelPort::isDataAvailable
+ * --------------------------
+ * returns: true if bytes from the Wixel are waiting on the serial port
+ */
+bool WixelPort::isDataAvailable() {
+  return _stream != NULL && _stream->available() > 0;
+}
+
+/*
+ * WixelPort::readFrame
+ * --------------------
+ * This method will read the bytes available until a frame is complete
+ * returns: true when a complete frame is available with getFrame
+ */
+bool WixelPort::readFrame() {
+  return _stream != NULL && _frameAssembler.readFrame(*_stream);
+}
+
+/*
+ * WixelPort::getFrame
+ * -------------------
+ * returns: The last complete frame, length byte included
+ */
+const unsigned char* WixelPort::getFrame() {
+  return _frameAssembler.getFrame();
+}
+
+/*
+ * WixelPort::getFrameLength
+ * -------------------------
+ * returns: Number of bytes of the last complete frame
+ */
+unsigned int WixelPort::getFrameLength() {
+  return _frameAssembler.getFrameLength();
+}
+
+/*
+ * WixelPort::acknowledgeDataPacket
+ * --------------------------------
+ * This method will send the ACK as soon as a valid data packet is complete, the Wixel sleeps when it gets it.
+ * The ACK is flushed so the measure is the time until it is on the wire
+ * returns: true if the last frame was a valid data packet and the ACK was sent
+ */
+bool WixelPort::acknowledgeDataPacket() {
+  const unsigned char* message = _frameAssembler.getFrame();
+  if (message[1] != WIXEL_COMM_RX_DATA_PACKET ||
+      _frameAssembler.getFrameLength() != WixelFrameLength(WIXEL_COMM_RX_DATA_PACKET)) {
+    return false;
+  }
+  if (!WixelSend(*_stream, (uint8_t)WIXEL_COMM_TX_ACKNOWLEDGE_DATA_PACKET)) {
+    return false;
+  }
+  _stream->flush();
+  _lastAckMicros = micros();
+  unsigned long frameToAck = getAckDelay();
+  Metrics::observe(METRIC_UART_TO_ACK, _lastAckMicros - _frameAssembler.getFrameStartMicros());
+  Metrics::observe(METRIC_FRAME_TO_ACK, frameToAck);
+  if (frameToAck > WIXEL_ACK_TARGET_MICROS) {
+    Metrics::count(METRIC_SLOW_ACKS);
+  }
+  return true;
+}
+
+/*
+ * WixelPort::getAckDelay
+ * ----------------------
+ * returns: Microseconds from the end of the last data packet to its ACK on the wire
+ */
+unsigned long WixelPort::getAckDelay() {
+  return _lastAckMicros - _frameAssembler.getFrameCompleteMicros();
+}
+
+/*
+ * WixelPort::getNumber
+ * --------------------
+ * returns: Number of the port, the transmitter ID of the configuration with the same number is used
+ */
+uint8_t WixelPort::getNumber() {
+  return _number;
+}
+
+/*
+ * WixelPort::getStream
+ * --------------------
+ * returns: The serial port connected to the Wixel
+ */
+Stream* WixelPort::getStream() {
+  return _stream;
+}
+
+/*
+ * WixelPort::getReadingFilter
+ * ---------------------------
+ * returns: The recent readings of this Wixel
+ */
+ReadingFilter* WixelPort::getReadingFilter() {
+  return &_readingFilter;
+}
+
+/*
+ * WixelPort::getReadingQueue
+ * --------------------------
+ * returns: The readings of this Wixel not uploaded yet
+ */
+ReadingQueue* WixelPort::getReadingQueue() {
+  return &_readingQueue;
+}
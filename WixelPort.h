@@ -0,0 +1,43 @@
+#ifndef WixelPort_h
+#define WixelPort_h
+
+#include "Arduino.h"
+#include "WixelProtocol.h"
+#include "WixelFrameAssembler.h"
+#include "ReadingFilter.h"
+#include "ReadingQueue.h"
+#include "Metrics.h"
+
+// SoftwareSerial pins of the second Wixel (D5 and D6 on a NodeMCU)
+#define WIXEL_PORT_2_RX_PIN 14
+#define WIXEL_PORT_2_TX_PIN 12
+
+/*
+ * One Wixel: the serial port it is connected to, its frames, its recent readings and its reading queue.
+ * The transmitter ID of the port is in the configuration
+ */
+class WixelPort {
+  public:
+    WixelPort();
+    bool begin(uint8_t number, Stream* stream);
+    bool isDataAvailable();
+    bool readFrame();
+    const unsigned char* getFrame();
+    unsigned int getFrameLength();
+    bool acknowledgeDataPacket();
+    unsigned long getAckDelay();
+    uint8_t getNumber();
+    Stream* getStream();
+    ReadingFilter* getReadingFilter();
+    ReadingQueue* getReadingQueue();
+  private:
+    uint8_t _number;
+    Stream* _stream;
+    WixelFrameAssembler _frameAssembler;
+    ReadingFilter _readingFilter;
+    ReadingQueue _readingQueue;
+    // micros() when the last ACK was on the wire
+    unsigned long _lastAckMicros;
+};
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef WixelProtocol_h
+#define WixelProtocol_h
+
+#include "Arduino.h"
+
+/*
+ * Protocol descriptions:
+Data Packet - Bridge to App.  Sends the Dexcom transmitter data, and the bridge battery volts.
+  0x11  - length of packet.
+  0x00  - Packet type (00 means data packet)
+  uint32  - Dexcom Raw value.
+  uint32  - Dexcom Filtered value.
+  uint8 - Dexcom battery value.
+  uint16  - Bridge battery value.
+  uint32  - Dexcom encoded TXID the bridge is filtering on.
+  
+Data Acknowledge Packet - App to Bridge.  Sends an ack of the Data Packet and tells the wixel to go to sleep.
+  0x02  - length of packet.
+  0xF0  - Packet type (F0 means acknowleged, go to sleep)
+  
+TXID packet - App to Bridge.  Sends the TXID the App wants the bridge to filter on.  In response to a Data packet or beacon packet being wrong.
+  0x06  - Length of the packet.
+  0x01  - Packet Type (01 means TXID packet).
+  uint32  - Dexcom encoded TXID.
+  
+Beacon Packet - Bridge to App.  Sends the TXID it is filtering on to the app, so it can set it if it is wrong.
+                Sent when the wixel wakes up, or as acknowledgement of a TXID packet.
+  0x07  - Length of the packet.
+  0xF1  - Packet type (F1 means Beacon or TXID acknowledge)
+  uint32  - Dexcom encoded TXID.
+  uint8 - Protocol level of the bridge (DEXBRIDGE_PROTO_LEVEL)
+
+Debug, BLE sleep and LED packets - App to Bridge.  Flip a flag of the bridge.
+  0x02  - Length of the packet.
+  0x64, 0x42 or 0x4C - Packet type
+
+The data packet the Wixel really sends has a uint8 bridge battery value followed by a uint8 function byte
+after the TXID (0x11 bytes in total), see WixelDataPayload.
+All numbers are little endian.
+ */
+// All RX Message (From Wixel)
+#define WIXEL_COMM_RX_DATA_PACKET 0x00 // The Wixel send this message when it receive Dexcom packet
+#define WIXEL_COMM_RX_SEND_BEACON 0xF1 // The Wixel send this message when it wants to know if the Transmitter ID is ok
+
+// All TX Message (To Wixel)
+#define WIXEL_COMM_TX_ACKNOWLEDGE_DATA_PACKET 0xF0 // This message send and acknowledge packet to allow Wixel to go in sleep mode
+#define WIXEL_COMM_TX_SEND_TRANSMITTER_ID 0x01 // This message send the Transmitter ID to the Wixel
+#define WIXEL_COMM_TX_SEND_DEBUG 0x64 // This message ask the Wixel to flip the Debug flag ON or OFF
+#define WIXEL_COMM_TX_SLEEP_BLE 0x42 // This message ask the Wixel to flip the BLE Sleeping flag ON or OFF
+#define WIXEL_COMM_TX_DO_LED 0x4C // This message ask the Wixel to flip the Led Sleeping flag ON or OFF
+
+// The Wixel stays awake until the data packet is acknowledged, microseconds from the complete frame to the ACK on the wire
+#define WIXEL_ACK_TARGET_MICROS 5000
+
+// Number of Wixels connected to the bridge, the first one on Serial and the next ones on SoftwareSerial
+#define WIXEL_PORT_COUNT 2
+
+#define DEXBRIDGE_PROTO_LEVEL 0x01
+
+
+typedef struct Dexcom_Packet_Struct
+{
+  uint8_t len;
+  uint32_t  dest_addr;
+  uint32_t  src_addr;
+  uint8_t port;
+  uint8_t device_info;
+  uint8_t txId;
+  uint16_t  raw;
+  uint16_t  filtered;
+  uint8_t battery;
+  uint8_t unknown;
+  uint8_t checksum;
+  int8_t  RSSI;
+  uint8_t LQI;
+} Dexcom_packet;
+
+// structure of a raw record we receive from the Wixel.
+typedef struct Wixel_RawRecord_Struct
+{
+  uint32_t  raw;  //"raw" BGL value.
+  uint32_t  filtered; //"filtered" BGL value 
+  uint8_t dex_battery;  //battery value
+  uint8_t my_battery; //xBridge battery value
+  uint32_t  dex_src_id;   //raw TXID of the Dexcom Transmitter
+  //int8  RSSI; //RSSI level of the transmitter, used to determine if it is in range.
+  //uint8 txid; //ID of this transmission.  Essentially a sequence from 0-63
+  uint8_t function; // Byte representing the xBridge code funcitonality.  01 = this level.
+} RawRecord;
+
+/*
+ * Payloads as they are on the wire, after the length and type bytes. Frames are copied in and out
+ * of them with one memcpy, which is only right on a little endian CPU like the ESP8266
+ */
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "The Wixel payloads are little endian");
+
+struct __attribute__((packed)) WixelDataPayload {
+  uint32_t raw;
+  uint32_t filtered;
+  uint8_t dexBattery;
+  uint8_t bridgeBattery;
+  uint32_t dexSrcId;
+  uint8_t function;
+};
+static_assert(sizeof(WixelDataPayload) == 15, "Data packet payload is 15 bytes");
+static_assert(offsetof(WixelDataPayload, filtered) == 4 && offsetof(WixelDataPayload, dexBattery) == 8 &&
+              offsetof(WixelDataPayload, dexSrcId) == 10 && offsetof(WixelDataPayload, function) == 14,
+              "Data packet payload layout");
+
+struct __attribute__((packed)) WixelBeaconPayload {
+  uint32_t dexSrcId;
+  uint8_t protocolLevel;
+};
+static_assert(sizeof(WixelBeaconPayload) == 5, "Beacon packet payload is 5 bytes");
+
+struct __attribute__((packed)) WixelTransmitterIdPayload {
+  uint32_t dexSrcId;
+};
+static_assert(sizeof(WixelTransmitterIdPayload) == 4, "TXID packet payload is 4 bytes");
+
+/*
+ * Description of one message type
+ */
+struct WixelMessageDescriptor {
+  uint8_t type;
+  uint8_t length; // Whole frame, length and type bytes included
+  const char* name;
+};
+
+// Bytes before the payload: length and type
+#define WIXEL_FRAME_HEADER_LENGTH 2
+#define WIXEL_MESSAGE_COUNT 7
+
+static constexpr WixelMessageDescriptor WIXEL_MESSAGES[WIXEL_MESSAGE_COUNT] = {
+  { WIXEL_COMM_RX_DATA_PACKET, WIXEL_FRAME_HEADER_LENGTH + sizeof(WixelDataPayload), "data" },
+  { WIXEL_COMM_RX_SEND_BEACON, WIXEL_FRAME_HEADER_LENGTH + sizeof(WixelBeaconPayload), "beacon" },
+  { WIXEL_COMM_TX_SEND_TRANSMITTER_ID, WIXEL_FRAME_HEADER_LENGTH + sizeof(WixelTransmitterIdPayload), "txid" },
+  { WIXEL_COMM_TX_ACKNOWLEDGE_DATA_PACKET, WIXEL_FRAME_HEADER_LENGTH, "ack" },
+  { WIXEL_COMM_TX_SEND_DEBUG, WIXEL_FRAME_HEADER_LENGTH, "debug" },
+  { WIXEL_COMM_TX_SLEEP_BLE, WIXEL_FRAME_HEADER_LENGTH, "ble sleep" },
+  { WIXEL_COMM_TX_DO_LED, WIXEL_FRAME_HEADER_LENGTH, "led" }
+};
+
+/*
+ * WixelFrameLength
+ * ----------------
+ * Length of the frames of a message type, usable at compile time
+ * returns: 0 for an unknown type
+ */
+constexpr uint8_t WixelFrameLength(uint8_t type, unsigned int position = 0) {
+  return position == WIXEL_MESSAGE_COUNT ? 0 :
+         WIXEL_MESSAGES[position].type == type ? WIXEL_MESSAGES[position].length : WixelFrameLength(type, position + 1);
+}
+
+/*
+ * WixelMessageName
+ * ----------------
+ * Name of a message type for the debug text
+ */
+constexpr const char* WixelMessageName(uint8_t type, unsigned int position = 0) {
+  return position == WIXEL_MESSAGE_COUNT ? "unknown" :
+         WIXEL_MESSAGES[position].type == type ? WIXEL_MESSAGES[position].name : WixelMessageName(type, position + 1);
+}
+
+/*
+ * Message type of each payload
+ */
+template<typename Payload> struct WixelPayloadType;
+template<> struct WixelPayloadType<WixelDataPayload> { static constexpr uint8_t TYPE = WIXEL_COMM_RX_DATA_PACKET; };
+template<> struct WixelPayloadType<WixelBeaconPayload> { static constexpr uint8_t TYPE = WIXEL_COMM_RX_SEND_BEACON; };
+template<> struct WixelPayloadType<WixelTransmitterIdPayload> { static constexpr uint8_t TYPE = WIXEL_COMM_TX_SEND_TRANSMITTER_ID; };
+
+/*
+ * WixelDecode
+ * -----------
+ * Copy the payload of a frame, the frame must have exactly the length of its type
+ * frame: The frame, starting with the length byte
+ * frameLength: Number of bytes in frame
+ * payload: Where to copy the payload
+ * returns: false if the frame is not a message of this payload type or has a wrong length
+ */
+template<typename Payload> bool WixelDecode(const unsigned char* frame, unsigned int frameLength, Payload* payload) {
+  static_assert(WixelFrameLength(WixelPayloadType<Payload>::TYPE) == WIXEL_FRAME_HEADER_LENGTH + sizeof(Payload),
+                "Payload does not match its message descriptor");
+  if (frameLength != WIXEL_FRAME_HEADER_LENGTH + sizeof(Payload) || frame[0] != frameLength ||
+      frame[1] != WixelPayloadType<Payload>::TYPE) {
+    return false;
+  }
+  memcpy(payload, frame + WIXEL_FRAME_HEADER_LENGTH, sizeof(Payload));
+  return true;
+}
+
+/*
+ * WixelSend
+ * ---------
+ * Send a complete frame with one write
+ * output: The serial port connected to the Wixel
+ * payload: The message payload
+ * returns: true if the whole frame was written
+ */
+template<typename Payload> bool WixelSend(Print &output, const Payload &payload) {
+  static_assert(WixelFrameLength(WixelPayloadType<Payload>::TYPE) == WIXEL_FRAME_HEADER_LENGTH + sizeof(Payload),
+                "Payload does not match its message descriptor");
+  uint8_t frame[WIXEL_FRAME_HEADER_LENGTH + sizeof(Payload)];
+  frame[0] = sizeof(frame);
+  frame[1] = WixelPayloadType<Payload>::TYPE;
+  memcpy(frame + WIXEL_FRAME_HEADER_LENGTH, &payload, sizeof(Payload));
+  return output.write(frame, sizeof(frame)) == sizeof(frame);
+}
+
+/*
+ * WixelSend
+ * ---------
+ * Send a message without payload (ack, debug, BLE sleep, LED) with one write
+ * output: The serial port connected to the Wixel
+ * type: The message type
+ * returns: false if the type needs a payload or the frame was not written
+ */
+inline bool WixelSend(Print &output, uint8_t type) {
+  if (WixelFrameLength(type) != WIXEL_FRAME_HEADER_LENGTH) {
+    return false;
+  }
+  uint8_t frame[WIXEL_FRAME_HEADER_LENGTH] = { WIXEL_FRAME_HEADER_LENGTH, type };
+  return output.write(frame, sizeof(frame)) == sizeof(frame);
+}
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * WixelSimulator - Library for feeding a port with simulated Wixel traffic
+ *
+ * The bridge reads the simulator like the serial port of a real Wixel, so the whole path is exercised:
+ * frame assembly, ACK, filter, queue and the uploads. Bytes are produced when the bridge asks for them,
+ * on the millis() clock. The outcome is in /metrics: xbridge_simulated_readings_total against the
+ * ack_to_upload count and xbridge_simulated_lost_readings_total, the ACK and upload latency histograms
+ * and the bad frame and timeout counters.
+ */
+#include "WixelSimulator.h"
+
+// First simulated raw value, each new reading adds one so no two readings are the same
+#define WIXEL_SIMULATOR_FIRST_RAW 100000
+#define WIXEL_SIMULATOR_MAX_GARBAGE 4
+
+static_assert(2 * WIXEL_FRAME_HEADER_LENGTH + sizeof(WixelBeaconPayload) + WIXEL_SIMULATOR_MAX_GARBAGE +
+              sizeof(WixelDataPayload) <= WIXEL_SIMULATOR_BUFFER_SIZE, "A beacon, garbage and a reading fit the buffer");
+
+/*
+ * Constructor
+ */
+WixelSimulator::WixelSimulator() {
+  _started = false;
+  _bufferLength = 0;
+  _bufferPosition = 0;
+  _receivedLength = 0;
+  memset(&_reading, 0, sizeof(_reading));
+  _waitingAck = false;
+  _sendCount = 0;
+  _nextReadingMillis = 0;
+  _lastSendMillis = 0;
+  _readingCount = 0;
+  _acknowledgedCount = 0;
+  _lostCount = 0;
+}
+
+/*
+ * WixelSimulator::begin
+ * ---------------------
+ * This method will start the traffic, the first reading is sent right away
+ * scenario: Rate and kind of traffic to send
+ */
+void WixelSimulator::begin(const WixelScenario &scenario) {
+  _scenario = scenario;
+  _started = scenario.period > 0;
+  _nextReadingMillis = millis();
+}
+
+/*
+ * WixelSimulator::available
+ * -------------------------
+ * returns: Number of bytes the simulated Wixel has sent and the bridge has not read yet
+ */
+int WixelSimulator::available() {
+  generate();
+  return _bufferLength - _bufferPosition;
+}
+
+/*
+ * WixelSimulator::read
+ * --------------------
+ * returns: The next byte sent by the simulated Wixel, -1 if none
+ */
+int WixelSimulator::read() {
+  generate();
+  if (_bufferPosition == _bufferLength) {
+    return -1;
+  }
+  return _buffer[_bufferPosition++];
+}
+
+/*
+ * WixelSimulator::peek
+ * --------------------
+ * returns: The next byte sent by the simulated Wixel without reading it, -1 if none
+ */
+int WixelSimulator::peek() {
+  generate();
+  if (_bufferPosition == _bufferLength) {
+    return -1;
+  }
+  return _buffer[_bufferPosition];
+}
+
+/*
+ * WixelSimulator::write
+ * ---------------------
+ * This method will take one byte sent by the bridge. An ACK ends the resends of the current reading
+ * and a TXID packet changes the transmitter of the next readings, like on a real Wixel
+ * data: The byte sent by the bridge
+ * returns: 1, the byte is always taken
+ */
+size_t WixelSimulator::write(uint8_t data) {
+  if (_receivedLength == 0 && (data < WIXEL_FRAME_HEADER_LENGTH || data > WIXEL_MAX_FRAME_LENGTH)) {
+    return 1;
+  }
+  _received[_receivedLength++] = data;
+  if (_receivedLength < _received[0]) {
+    return 1;
+  }
+  WixelTransmitterIdPayload transmitterId;
+  if (_received[1] == WIXEL_COMM_TX_ACKNOWLEDGE_DATA_PACKET && _waitingAck) {
+    _waitingAck = false;
+    _acknowledgedCount++;
+  } else if (WixelDecode(_received, _receivedLength, &transmitterId)) {
+    _scenario.transmitterId = transmitterId.dexSrcId;
+  }
+  _receivedLength = 0;
+  return 1;
+}
+
+/*
+ * WixelSimulator::flush
+ * ---------------------
+ * Nothing to wait for, the bytes written are handled at once
+ */
+void WixelSimulator::flush() {
+}
+
+/*
+ * WixelSimulator::getReadingCount
+ * -------------------------------
+ * returns: Number of different readings sent
+ */
+uint32_t WixelSimulator::getReadingCount() {
+  return _readingCount;
+}
+
+/*
+ * WixelSimulator::getAcknowledgedCount
+ * ------------------------------------
+ * returns: Number of readings acknowledged by the bridge
+ */
+uint32_t WixelSimulator::getAcknowledgedCount() {
+  return _acknowledgedCount;
+}
+
+/*
+ * WixelSimulator::getLostCount
+ * ----------------------------
+ * returns: Number of readings sent WIXEL_SIMULATOR_MAX_SENDS times without an ACK
+ */
+uint32_t WixelSimulator::getLostCount() {
+  return _lostCount;
+}
+
+/*
+ * WixelSimulator::generate
+ * ------------------------
+ * This method will send the reading again when its ACK is late, or a new reading when the period is over.
+ * Nothing is added until the bridge has read the bytes already sent
+ */
+void WixelSimulator::generate() {
+  if (!_started || _bufferPosition < _bufferLength) {
+    return;
+  }
+  unsigned long now = millis();
+  if (_waitingAck) {
+    if (now - _lastSendMillis < WIXEL_SIMULATOR_RESEND_TIMEOUT) {
+      return;
+    }
+    if (_sendCount < WIXEL_SIMULATOR_MAX_SENDS) {
+      _bufferLength = 0;
+      _bufferPosition = 0;
+      sendReading();
+      return;
+    }
+    _waitingAck = false;
+    _lostCount++;
+    Metrics::count(METRIC_SIMULATED_LOST_READINGS);
+  }
+  if ((long)(now - _nextReadingMillis) < 0) {
+    return;
+  }
+  // A late reading is not caught up, the next one is a whole period after it
+  _nextReadingMillis = now + _scenario.period;
+  _reading.raw = WIXEL_SIMULATOR_FIRST_RAW + _readingCount;
+  _reading.filtered = _reading.raw - 100;
+  _reading.dexBattery = 214;
+  _reading.bridgeBattery = 100;
+  _reading.dexSrcId = _scenario.transmitterId;
+  _reading.function = DEXBRIDGE_PROTO_LEVEL;
+  _readingCount++;
+  Metrics::count(METRIC_SIMULATED_READINGS);
+  _sendCount = 0;
+  _waitingAck = true;
+  _bufferLength = 0;
+  _bufferPosition = 0;
+  if ((uint8_t)random(100) < _scenario.beaconPercent) {
+    WixelBeaconPayload beacon;
+    beacon.dexSrcId = _scenario.transmitterId;
+    beacon.protocolLevel = DEXBRIDGE_PROTO_LEVEL;
+    queueFrame(WIXEL_COMM_RX_SEND_BEACON, &beacon, sizeof(beacon), sizeof(beacon));
+  }
+  sendReading();
+}
+
+/*
+ * WixelSimulator::sendReading
+ * ---------------------------
+ * This method will add the current reading after the bytes waiting, with garbage before it or cut short
+ * as the scenario asks
+ */
+void WixelSimulator::sendReading() {
+  if ((uint8_t)random(100) < _scenario.garbagePercent) {
+    long garbage = random(1, WIXEL_SIMULATOR_MAX_GARBAGE + 1);
+    while (garbage-- > 0) {
+      _buffer[_bufferLength++] = (uint8_t)random(256);
+    }
+  }
+  uint8_t sentLength = sizeof(_reading);
+  if ((uint8_t)random(100) < _scenario.truncatedPercent) {
+    sentLength = (uint8_t)random(sizeof(_reading));
+  }
+  queueFrame(WIXEL_COMM_RX_DATA_PACKET, &_reading, sizeof(_reading), sentLength);
+  _sendCount++;
+  _lastSendMillis = millis();
+}
+
+/*
+ * WixelSimulator::queueFrame
+ * --------------------------
+ * This method will add a frame to the bytes waiting to be read
+ * type: Message type
+ * payload: The payload as on the wire
+ * payloadLength: Size of the payload, the length byte of the frame is computed with it
+ * sentLength: Bytes of the payload really sent, less than payloadLength for a truncated frame
+ */
+void WixelSimulator::queueFrame(uint8_t type, const void* payload, uint8_t payloadLength, uint8_t sentLength) {
+  _buffer[_bufferLength++] = WIXEL_FRAME_HEADER_LENGTH + payloadLength;
+  _buffer[_bufferLength++] = type;
+  memcpy(&_buffer[_bufferLength], payload, sentLength);
+  _bufferLength += sentLength;
+}
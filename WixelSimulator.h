@@ -0,0 +1,73 @@
+#ifndef WixelSimulator_h
+#define WixelSimulator_h
+
+#include "Arduino.h"
+#include "WixelProtocol.h"
+#include "WixelFrameAssembler.h"
+#include "Metrics.h"
+
+// Milliseconds between two simulated readings given to the second port, 0 keeps the real second Wixel.
+// Set as a build flag so the sources are not edited: -DWIXEL_SIMULATOR_PERIOD=300000 in compiler.cpp.extra_flags
+// of the Arduino IDE (arduino-cli --build-property) or with cmake -DXBRIDGE_WIXEL_SIMULATOR_PERIOD=300000
+#ifndef WIXEL_SIMULATOR_PERIOD
+#define WIXEL_SIMULATOR_PERIOD 0
+#endif
+// Milliseconds the simulated Wixel waits for the ACK before sending the reading again, longer than
+// WIXEL_FRAME_TIMEOUT so a truncated frame is dropped by the assembler before the reading comes again
+#define WIXEL_SIMULATOR_RESEND_TIMEOUT 3000
+// Sends of one reading before it is counted as lost
+#define WIXEL_SIMULATOR_MAX_SENDS 3
+// Bytes the simulated Wixel can have waiting, a data packet with garbage before it
+#define WIXEL_SIMULATOR_BUFFER_SIZE 32
+
+/*
+ * What the simulated Wixel sends. Garbage and truncation apply to each send of a data packet
+ */
+struct WixelScenario {
+  unsigned long period = WIXEL_SIMULATOR_PERIOD;
+  uint32_t transmitterId = 0; // Encoded Dexcom src ID put in the readings and beacons
+  uint8_t garbagePercent = 5; // A few random bytes before the frame
+  uint8_t truncatedPercent = 5; // Only the start of the frame, the assembler must drop it
+  uint8_t beaconPercent = 10; // A beacon before a new reading, like a Wixel waking up
+};
+
+/*
+ * Stands in for a Wixel on a port: sends readings, beacons, garbage and truncated frames at the
+ * scenario rate and checks the ACKs it gets back, like the real one resends a reading until it is acknowledged
+ */
+class WixelSimulator : public Stream {
+  public:
+    WixelSimulator();
+    void begin(const WixelScenario &scenario);
+    int available();
+    int read();
+    int peek();
+    size_t write(uint8_t data);
+    void flush();
+    uint32_t getReadingCount();
+    uint32_t getAcknowledgedCount();
+    uint32_t getLostCount();
+    using Print::write;
+  private:
+    void generate();
+    void sendReading();
+    void queueFrame(uint8_t type, const void* payload, uint8_t payloadLength, uint8_t sentLength);
+    WixelScenario _scenario;
+    bool _started;
+    uint8_t _buffer[WIXEL_SIMULATOR_BUFFER_SIZE];
+    uint8_t _bufferLength;
+    uint8_t _bufferPosition;
+    // Frame written by the bridge
+    uint8_t _received[WIXEL_MAX_FRAME_LENGTH];
+    uint8_t _receivedLength;
+    WixelDataPayload _reading;
+    bool _waitingAck;
+    uint8_t _sendCount;
+    unsigned long _nextReadingMillis;
+    unsigned long _lastSendMillis;
+    uint32_t _readingCount;
+    uint32_t _acknowledgedCount;
+    uint32_t _lostCount;
+};
+
+#endif
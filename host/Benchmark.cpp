@@ -0,0 +1,329 @@
+/*
+ * Benchmark of the bridge hot paths, run on the host build.
+ * Each operation is repeated and its time and heap allocations per call are reported, with the
+ * Profiler report of the same run. The clock is the real one, the file system is in memory.
+ * The saved wifi table is compared with the LinkedList<WifiData*> it replaced (host/LinkedList.h) at 1, 10 and
+ * 50 networks: indexed get in a non sequential order, and lookup of the last SSID. The table keeps at most
+ * CONFIGURATION_MAX_WIFI networks, the row tells how many it holds.
+ * HttpClient is measured on a Nightscout POST: writing the request, then whole requests on a keep-alive
+ * connection to a HostServer answering with a Content-Length or a chunked body.
+ *
+ * usage: xbridge_benchmark [iterations]
+ */
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <EEPROM.h>
+#include <LittleFS.h>
+#include "Firmware.h"
+#include "LinkedList.h"
+#include "Profiler.h"
+
+// Transmitter ID of the first Wixel, "03AXD"
+#define BENCHMARK_TRANSMITTER_ID 0x1ABCD
+#define BENCHMARK_SERVER_HOST "nightscout.example"
+#define BENCHMARK_SERVER_ADDRESS IPAddress(10, 0, 0, 2)
+// Headers and body of a typical Nightscout upload
+#define BENCHMARK_HEADERS "Content-Type: application/json\r\napi-secret: e5e9fa1ba31ecd1ae84f75caaa474f3a663f05f4\r\n"
+#define BENCHMARK_BODY "[{\"device\":\"wifi-xBridge\",\"type\":\"raw\",\"date\":1767232860680,\"unfiltered\":100000," \
+                       "\"filtered\":99500,\"battery\":214,\"uploaderBattery\":90,\"transmitterId\":\"03AXD\"}]"
+
+/*
+ * Print writing to the standard output
+ */
+class StandardOutput : public Print {
+  public:
+    size_t write(uint8_t data) {
+      return fputc(data, stdout) == EOF ? 0 : 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) {
+      return fwrite(buffer, 1, size, stdout);
+    }
+    using Print::write;
+};
+
+/*
+ * Saved wifi as kept by the LinkedList before the inline table
+ */
+struct LegacyWifiData {
+  String ssid = "wifi-xBridge";
+  String password = "";
+};
+
+/*
+ * Server of the HttpClient cases, answers /chunked with a chunked body and the other paths with a Content-Length
+ */
+class BenchmarkServer : public HostServer {
+  public:
+    void onReceive(HostConnection &connection, const uint8_t* data, size_t length) {
+      // The server is not the firmware, its heap use is not counted
+      HostHeapExclusion exclusion;
+      connection.request.append((const char*)data, length);
+      size_t end = connection.request.find("\r\n\r\n");
+      size_t contentLength = connection.request.find("Content-Length: ");
+      if (end == std::string::npos || contentLength == std::string::npos ||
+          connection.request.size() < end + 4 + strtoul(connection.request.c_str() + contentLength + 16, NULL, 10)) {
+        return;
+      }
+      bool chunked = connection.request.compare(0, 14, "POST /chunked ") == 0;
+      connection.request.clear();
+      if (chunked) {
+        // The body split in 3 chunks
+        connection.reply("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n"
+                         "1c\r\n[{\"_id\":\"5f1e7c3b9a0d\",\"ok\":\r\n2\r\n1}\r\n1\r\n]\r\n0\r\n\r\n");
+      }
+      else {
+        connection.reply("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 31\r\n\r\n"
+                         "[{\"_id\":\"5f1e7c3b9a0d\",\"ok\":1}]");
+      }
+    }
+};
+
+static unsigned long _readingNumber = 0;
+// Results of the lookups, so the compiler keeps them
+static volatile int _lookupSink = 0;
+
+/*
+ * BuildDataFrame
+ * --------------
+ * This function will write a data packet frame of the first Wixel, a new reading at each call
+ * frame: Where the frame is written, WIXEL_FRAME_HEADER_LENGTH + sizeof(WixelDataPayload) bytes
+ * returns: The frame length
+ */
+static unsigned int BuildDataFrame(uint8_t* frame) {
+  WixelDataPayload payload;
+  // Readings only differ by their value, the duplicate filter must not drop them
+  payload.raw = 100000 + _readingNumber * 16;
+  payload.filtered = payload.raw - 500;
+  payload.dexBattery = 214;
+  payload.bridgeBattery = 90;
+  payload.dexSrcId = BENCHMARK_TRANSMITTER_ID;
+  payload.function = 0;
+  _readingNumber++;
+  frame[0] = WIXEL_FRAME_HEADER_LENGTH + sizeof(payload);
+  frame[1] = WIXEL_COMM_RX_DATA_PACKET;
+  memcpy(&frame[WIXEL_FRAME_HEADER_LENGTH], &payload, sizeof(payload));
+  return frame[0];
+}
+
+/*
+ * Measure
+ * -------
+ * This function will call operation iterations times and print its time and heap use per call
+ */
+template<typename Operation> static void Measure(const char* name, unsigned long iterations, Operation operation) {
+  uint64_t allocations = HostHeap::getAllocationCount();
+  uint64_t allocatedBytes = HostHeap::getAllocatedBytes();
+  int64_t liveBytes = HostHeap::getLiveBytes();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++) {
+    operation();
+  }
+  double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  printf("%-32s %10lu %12.0f %12.2f %12.1f %10lld\n", name, iterations, nanos / iterations,
+         (double)(HostHeap::getAllocationCount() - allocations) / iterations,
+         (double)(HostHeap::getAllocatedBytes() - allocatedBytes) / iterations,
+         (long long)(HostHeap::getLiveBytes() - liveBytes));
+}
+
+/*
+ * BenchmarkWifiTable
+ * ------------------
+ * This function will measure get and findSSID of the saved wifi table against the previous LinkedList
+ * iterations: Number of calls of each operation
+ */
+static void BenchmarkWifiTable(unsigned long iterations) {
+  const int sizes[] = { 1, 10, 50 };
+  for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    int count = sizes[s];
+    int tableCount = count < CONFIGURATION_MAX_WIFI ? count : CONFIGURATION_MAX_WIFI;
+    char name[48];
+    char ssid[CONFIGURATION_MAX_SSID_LENGTH + 1];
+
+    LinkedList<LegacyWifiData*> list;
+    for (int i = 0; i < count; i++) {
+      LegacyWifiData* wifiData = new LegacyWifiData();
+      snprintf(ssid, sizeof(ssid), "network-%d", i);
+      wifiData->ssid = ssid;
+      wifiData->password = "password";
+      list.add(wifiData);
+    }
+    Configuration configuration;
+    configuration.begin();
+    while (configuration.getWifiCount() > 0) {
+      strcpy(ssid, configuration.getWifiData(0)->ssid);
+      configuration.deleteSSID(ssid);
+    }
+    for (int i = 0; i < tableCount; i++) {
+      snprintf(ssid, sizeof(ssid), "network-%d", i);
+      configuration.saveSSID(ssid, "password");
+    }
+
+    // Stride 7 so the LinkedList can't use the node it got last
+    int listIndex = 0;
+    snprintf(name, sizeof(name), "LinkedList get n=%d", count);
+    Measure(name, iterations, [&list, &listIndex, count]() {
+      listIndex = (listIndex + 7) % count;
+      _lookupSink = _lookupSink + list.get(listIndex)->password.length();
+    });
+    int tableIndex = 0;
+    snprintf(name, sizeof(name), "wifi table get n=%d kept=%d", count, tableCount);
+    Measure(name, iterations, [&configuration, &tableIndex, tableCount]() {
+      tableIndex = (tableIndex + 7) % tableCount;
+      _lookupSink = _lookupSink + configuration.getWifiData(tableIndex)->password[0];
+    });
+    snprintf(ssid, sizeof(ssid), "network-%d", count - 1);
+    snprintf(name, sizeof(name), "LinkedList find n=%d", count);
+    Measure(name, iterations, [&list, &ssid]() {
+      // How the saved wifi were looked up before findSSID
+      int position = -1;
+      for (int i = 0; i < list.size() && position < 0; i++) {
+        if (list.get(i)->ssid == ssid) {
+          position = i;
+        }
+      }
+      _lookupSink = _lookupSink + position;
+    });
+    snprintf(ssid, sizeof(ssid), "network-%d", tableCount - 1);
+    snprintf(name, sizeof(name), "wifi table findSSID n=%d kept=%d", count, tableCount);
+    Measure(name, iterations, [&configuration, &ssid]() {
+      _lookupSink = _lookupSink + configuration.findSSID(ssid);
+    });
+    while (list.size() > 0) {
+      delete list.pop();
+    }
+  }
+}
+
+/*
+ * RunRequest
+ * ----------
+ * This function will send one request and read its response, the server answers at once
+ */
+static void RunRequest(HttpClient &client, const char* path) {
+  if (!client.begin(BENCHMARK_SERVER_HOST, HTTP_PORT, "POST", path, BENCHMARK_HEADERS, BENCHMARK_BODY)) {
+    fprintf(stderr, "HttpClient::begin refused the request\n");
+    exit(1);
+  }
+  while (client.loop(true) != HTTP_DONE) {
+    if (client.getState() == HTTP_FAILED) {
+      fprintf(stderr, "HttpClient request to %s failed\n", path);
+      exit(1);
+    }
+  }
+  if (client.getStatus() != 200) {
+    fprintf(stderr, "HttpClient got %d from %s\n", client.getStatus(), path);
+    exit(1);
+  }
+  client.finish();
+}
+
+/*
+ * BenchmarkHttpClient
+ * -------------------
+ * This function will measure the request formatting and whole requests with both kinds of response body
+ * iterations: Number of calls of each operation
+ */
+static void BenchmarkHttpClient(unsigned long iterations) {
+  static BenchmarkServer server;
+  HostNetwork::addAccessPoint("home");
+  HostNetwork::addHost(BENCHMARK_SERVER_HOST, BENCHMARK_SERVER_ADDRESS);
+  HostNetwork::addServer(BENCHMARK_SERVER_ADDRESS, HTTP_PORT, &server);
+  HostNetwork::setJoinLatency(0);
+  WiFi.begin("home", "password");
+  if (WiFi.status() != WL_CONNECTED) {
+    fprintf(stderr, "wifi not joined\n");
+    exit(1);
+  }
+  HttpClient client;
+  Measure("HttpClient::begin", iterations, [&client]() {
+    client.begin(BENCHMARK_SERVER_HOST, HTTP_PORT, "POST", "/api/v1/entries", BENCHMARK_HEADERS, BENCHMARK_BODY);
+    client.finish();
+  });
+  // The connection is opened once, the requests then reuse it
+  RunRequest(client, "/api/v1/entries");
+  Measure("HttpClient Content-Length", iterations, [&client]() {
+    RunRequest(client, "/api/v1/entries");
+  });
+  Measure("HttpClient chunked", iterations, [&client]() {
+    RunRequest(client, "/chunked");
+  });
+  if (client.getReconnectCount() != 1) {
+    fprintf(stderr, "HttpClient opened %u connections, the keep-alive one must be reused\n",
+            (unsigned int)client.getReconnectCount());
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv) {
+  unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+  if (iterations == 0) {
+    iterations = 1;
+  }
+  HostClock::useRealTime(true);
+  HostHeap::startTracking();
+  setup();
+  _configuration.setTransmitterId(0, BENCHMARK_TRANSMITTER_ID);
+  _configuration.setAppEngineAddress("parakeet.example.com");
+  _configuration.saveSSID("home", "password");
+  _configuration.SaveConfig();
+  // The ACKs are not kept, so the serial port does not allocate
+  Serial.setWriteListener([](const uint8_t* data, size_t length) {});
+
+  printf("%-32s %10s %12s %12s %12s %10s\n", "operation", "iterations", "ns/op", "allocs/op", "bytes/op", "retained");
+  Measure("ManageConnectionStarted", iterations, []() {
+    uint8_t frame[WIXEL_MAX_FRAME_LENGTH];
+    unsigned int length = BuildDataFrame(frame);
+    Serial.inject(frame, length);
+    ManageConnectionStarted();
+  });
+  Measure("ProcessWixelMessage", iterations, []() {
+    uint8_t frame[WIXEL_MAX_FRAME_LENGTH];
+    unsigned int length = BuildDataFrame(frame);
+    ProcessWixelMessage(_wixelPorts[0], frame, length);
+  });
+  Measure("Configuration::LoadConfig", iterations, []() {
+    // begin loads the configuration of a configuration not loaded yet
+    Configuration configuration;
+    configuration.begin();
+  });
+  bool isDebug = false;
+  Measure("Configuration::SaveConfig", iterations, [&isDebug]() {
+    isDebug = !isDebug;
+    _configuration.setIsDebug(isDebug);
+    _configuration.SaveConfig();
+  });
+  _configuration.setIsDebug(false);
+  _configuration.SaveConfig();
+  Measure("WebServer::handleRoot", iterations, []() {
+    HostResponse response = ESP8266WebServer::hostRequest(80, HTTP_GET, "/");
+    if (response.code != 200) {
+      fprintf(stderr, "handleRoot answered %d\n", response.code);
+      exit(1);
+    }
+  });
+  Measure("WebServer::handleSetConfig", iterations, []() {
+    HostResponse response = ESP8266WebServer::hostRequest(80, HTTP_POST, "/api/config", "{\"debug\":false,\"debugAddress\":\"\"}");
+    if (response.code != 200) {
+      fprintf(stderr, "handleSetConfig answered %d\n", response.code);
+      exit(1);
+    }
+  });
+  char transmitterId[DEXCOM_ID_LENGTH + 1];
+  uint32_t src = 0;
+  Measure("DexcomHelper::DexcomSrcToAscii", iterations, [&transmitterId, &src]() {
+    _dexcomHelper.DexcomSrcToAscii(src++ & DEXCOM_SRC_MASK, transmitterId);
+  });
+  Measure("DexcomHelper::DexcomAsciiToSrc", iterations, [&transmitterId, &src]() {
+    if (_dexcomHelper.DexcomAsciiToSrc("6ABCD", &src) != DEXCOM_ID_VALID) {
+      fprintf(stderr, "6ABCD not decoded\n");
+      exit(1);
+    }
+  });
+  BenchmarkWifiTable(iterations * 100);
+  BenchmarkHttpClient(iterations * 10);
+  printf("\n");
+  StandardOutput output;
+  Profiler::printReport(output);
+  return 0;
+}
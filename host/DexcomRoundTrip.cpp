@@ -0,0 +1,183 @@
+/*
+ * Exhaustive test of the Dexcom transmitter ID codec, run on the host build.
+ * Every one of the 2^25 src values is encoded then decoded back, with the single and the batch API,
+ * and the decoding of the lower case ID is checked too. Every character is tried at every position so
+ * only the 32 Dexcom characters (and their lower case) are accepted. The throughput of both directions
+ * is reported, and the heap must not be used.
+ *
+ * usage: xbridge_dexcom_round_trip
+ */
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "DexcomHelper.h"
+
+// Number of IDs converted by one batch call
+#define ROUND_TRIP_BATCH_SIZE 4096
+// Number of src values, 5 bits for each of the 5 characters
+#define ROUND_TRIP_SRC_COUNT (DEXCOM_SRC_MASK + 1UL)
+// Characters used by Dexcom, in the order of their 5 bits value
+#define ROUND_TRIP_ALPHABET "0123456789ABCDEFGHJKLMNPQRSTUWXY"
+
+static DexcomHelper _dexcomHelper;
+static uint32_t _srcs[ROUND_TRIP_BATCH_SIZE];
+static uint32_t _decoded[ROUND_TRIP_BATCH_SIZE];
+static char _ids[ROUND_TRIP_BATCH_SIZE][DEXCOM_ID_LENGTH + 1];
+static unsigned long _failureCount = 0;
+
+/*
+ * Fail
+ * ----
+ * This function will print a failed check, only the first ones so a broken table does not flood the output
+ */
+static void Fail(const char* check, uint32_t src, const char* transmitterId) {
+  _failureCount++;
+  if (_failureCount <= 10) {
+    printf("FAIL %s: src 0x%07X id \"%s\"\n", check, (unsigned int)src, transmitterId);
+  }
+}
+
+/*
+ * ExpectedId
+ * ----------
+ * This function will write the transmitter ID of a src value, computed without the codec tables
+ */
+static void ExpectedId(uint32_t src, char* transmitterId) {
+  for (int i = 0; i < DEXCOM_ID_LENGTH; i++) {
+    transmitterId[i] = ROUND_TRIP_ALPHABET[(src >> (5 * (DEXCOM_ID_LENGTH - 1 - i))) & 0x1F];
+  }
+  transmitterId[DEXCOM_ID_LENGTH] = '\0';
+}
+
+/*
+ * CheckSingleApi
+ * --------------
+ * This function will round trip every src value through the profiled single ID methods
+ */
+static void CheckSingleApi() {
+  char transmitterId[DEXCOM_ID_LENGTH + 1];
+  char expected[DEXCOM_ID_LENGTH + 1];
+  for (uint32_t src = 0; src < ROUND_TRIP_SRC_COUNT; src++) {
+    _dexcomHelper.DexcomSrcToAscii(src, transmitterId);
+    if ((src & 0xFFF) == 0) {
+      // The characters themselves, on a sample so the check stays cheap
+      ExpectedId(src, expected);
+      if (strcmp(transmitterId, expected) != 0) {
+        Fail("encode", src, transmitterId);
+      }
+    }
+    uint32_t decoded = 0xFFFFFFFF;
+    if (_dexcomHelper.DexcomAsciiToSrc(transmitterId, &decoded) != DEXCOM_ID_VALID || decoded != src) {
+      Fail("single round trip", src, transmitterId);
+    }
+  }
+  // Only the 25 low bits are used
+  _dexcomHelper.DexcomSrcToAscii(0xFE000000UL | 0x1ABCD, transmitterId);
+  if (strcmp(transmitterId, "03AXD") != 0) {
+    Fail("high bits ignored", 0x1ABCD, transmitterId);
+  }
+}
+
+/*
+ * CheckBatchApi
+ * -------------
+ * This function will round trip every src value through the batch methods, upper then lower case,
+ * and measure the encoding and decoding time
+ * encodeNanos: Where the time spent encoding is added
+ * decodeNanos: Where the time spent decoding is added
+ */
+static void CheckBatchApi(double* encodeNanos, double* decodeNanos) {
+  for (uint32_t first = 0; first < ROUND_TRIP_SRC_COUNT; first += ROUND_TRIP_BATCH_SIZE) {
+    for (unsigned int i = 0; i < ROUND_TRIP_BATCH_SIZE; i++) {
+      _srcs[i] = first + i;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    _dexcomHelper.DexcomSrcToAscii(_srcs, _ids, ROUND_TRIP_BATCH_SIZE);
+    std::chrono::steady_clock::time_point encoded = std::chrono::steady_clock::now();
+    unsigned int count = _dexcomHelper.DexcomAsciiToSrc(_ids, _decoded, ROUND_TRIP_BATCH_SIZE);
+    std::chrono::steady_clock::time_point decoded = std::chrono::steady_clock::now();
+    *encodeNanos += std::chrono::duration<double, std::nano>(encoded - start).count();
+    *decodeNanos += std::chrono::duration<double, std::nano>(decoded - encoded).count();
+    if (count != ROUND_TRIP_BATCH_SIZE) {
+      Fail("batch decode count", _srcs[count], _ids[count]);
+    }
+    if (memcmp(_srcs, _decoded, sizeof(_srcs)) != 0) {
+      for (unsigned int i = 0; i < ROUND_TRIP_BATCH_SIZE; i++) {
+        if (_decoded[i] != _srcs[i]) {
+          Fail("batch round trip", _srcs[i], _ids[i]);
+        }
+      }
+    }
+    for (unsigned int i = 0; i < ROUND_TRIP_BATCH_SIZE; i++) {
+      for (int j = 0; j < DEXCOM_ID_LENGTH; j++) {
+        _ids[i][j] = tolower(_ids[i][j]);
+      }
+    }
+    if (_dexcomHelper.DexcomAsciiToSrc(_ids, _decoded, ROUND_TRIP_BATCH_SIZE) != ROUND_TRIP_BATCH_SIZE ||
+        memcmp(_srcs, _decoded, sizeof(_srcs)) != 0) {
+      Fail("lower case round trip", first, _ids[0]);
+    }
+  }
+}
+
+/*
+ * CheckInvalidIds
+ * ---------------
+ * This function will check that every character outside the Dexcom ones is rejected at every position,
+ * and that IDs of the wrong length are rejected
+ */
+static void CheckInvalidIds() {
+  char transmitterId[DEXCOM_ID_LENGTH + 2];
+  for (int position = 0; position < DEXCOM_ID_LENGTH; position++) {
+    for (int character = 1; character < 256; character++) {
+      strcpy(transmitterId, "6ABCD");
+      transmitterId[position] = (char)character;
+      bool allowed = strchr(ROUND_TRIP_ALPHABET, toupper(character)) != NULL;
+      uint32_t src = 0x1234567;
+      DexcomIdStatus status = _dexcomHelper.DexcomAsciiToSrc(transmitterId, &src);
+      if (allowed != (status == DEXCOM_ID_VALID) || (!allowed && status != DEXCOM_ID_BAD_CHARACTER)) {
+        Fail("character check", character, transmitterId);
+      }
+      if (!allowed && src != 0x1234567) {
+        Fail("src written for an invalid ID", src, transmitterId);
+      }
+      if (allowed != (_dexcomHelper.TransmitterIdCharacterNumber((char)character) >= 0)) {
+        Fail("character number", character, transmitterId);
+      }
+    }
+  }
+  const char* badLengths[] = { "", "6", "6ABC", "6ABCD0" };
+  for (unsigned int i = 0; i < sizeof(badLengths) / sizeof(badLengths[0]); i++) {
+    uint32_t src = 0;
+    if (_dexcomHelper.DexcomAsciiToSrc(badLengths[i], &src) != DEXCOM_ID_BAD_LENGTH) {
+      Fail("length check", 0, badLengths[i]);
+    }
+  }
+}
+
+int main() {
+  HostHeap::startTracking();
+  uint64_t allocations = HostHeap::getAllocationCount();
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  CheckSingleApi();
+  double singleNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  double encodeNanos = 0;
+  double decodeNanos = 0;
+  CheckBatchApi(&encodeNanos, &decodeNanos);
+  CheckInvalidIds();
+
+  if (HostHeap::getAllocationCount() != allocations) {
+    printf("FAIL the codec allocated %llu blocks\n", (unsigned long long)(HostHeap::getAllocationCount() - allocations));
+    _failureCount++;
+  }
+  printf("%-32s %12s %12s\n", "operation", "ns/id", "Mid/s");
+  printf("%-32s %12.2f %12.1f\n", "single encode + decode", singleNanos / ROUND_TRIP_SRC_COUNT,
+         ROUND_TRIP_SRC_COUNT * 1000.0 / singleNanos);
+  printf("%-32s %12.2f %12.1f\n", "batch encode", encodeNanos / ROUND_TRIP_SRC_COUNT,
+         ROUND_TRIP_SRC_COUNT * 1000.0 / encodeNanos);
+  printf("%-32s %12.2f %12.1f\n", "batch decode", decodeNanos / ROUND_TRIP_SRC_COUNT,
+         ROUND_TRIP_SRC_COUNT * 1000.0 / decodeNanos);
+  printf("%lu src values, %lu failures\n", ROUND_TRIP_SRC_COUNT, _failureCount);
+  return _failureCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
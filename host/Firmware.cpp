@@ -0,0 +1,5 @@
+/*
+ * The sketch compiled as a C++ file for the host build
+ */
+#include "Firmware.h"
+#include "../wifi-xBridge.ino"
@@ -0,0 +1,34 @@
+#ifndef Firmware_h
+#define Firmware_h
+
+/*
+ * The sketch as seen by the host programs: its functions and the globals they drive
+ */
+#include <SoftwareSerial.h>
+#include "Configuration.h"
+#include "DexcomHelper.h"
+#include "RadioScheduler.h"
+#include "Uploader.h"
+#include "WebServer.h"
+#include "WifiManager.h"
+#include "WixelPort.h"
+#include "WixelSimulator.h"
+
+void setup();
+void loop();
+void ManageConnectionStarted();
+void ProcessWixelMessage(WixelPort &port, const unsigned char* message, unsigned int messageLength);
+
+extern WifiManager _wifiManager;
+extern RadioScheduler _radioScheduler;
+extern WixelPort _wixelPorts[WIXEL_PORT_COUNT];
+extern SoftwareSerial _secondWixelSerial;
+#if WIXEL_SIMULATOR_PERIOD > 0
+extern WixelSimulator _wixelSimulator;
+#endif
+extern Uploader _uploader;
+extern WebServer _webServer;
+extern Configuration _configuration;
+extern DexcomHelper _dexcomHelper;
+
+#endif
@@ -0,0 +1,550 @@
+/*
+ * End to end harness of the bridge, run on the host build on the virtual clock.
+ *
+ * Each scenario runs the whole sketch (setup and loop) for hours of virtual time:
+ * - HarnessWixel plays a Wixel on each serial port: a data packet each period, with beacons, garbage before the
+ *   frame and truncated frames at the scenario rates, sent again after WIXEL_SIMULATOR_RESEND_TIMEOUT until
+ *   acknowledged, like the real one. It can also replay a recorded byte stream.
+ * - HarnessReceiver is the receiver.cgi the readings are uploaded to, with injected latency, server errors,
+ *   connections closed without an answer and outages.
+ * The report of each scenario gives the throughput, the ACK latency (last byte of the frame to the ACK written),
+ * the upload latency (first send by the Wixel to the receiver answer) percentiles and the lost readings, then the
+ * radio scheduler report (learned cadences, radio on duty cycle, missed deadlines), for the recorded streams too.
+ * Only the blocking calls of the sketch (name lookup, connection) move the virtual clock, so the ACK latency is
+ * the time a frame waited for the loop, not the processing time.
+ * A scenario fails when the bridge loses a reading: a readable frame never acknowledged, or a reading acknowledged
+ * and never uploaded, other than the ones the reading queues report dropped when full. Readings whose every send
+ * was cut short or taken by noise are lost on the line, they are only counted.
+ * Each scenario runs in its own process, the sketch keeps its state in globals.
+ *
+ * usage: xbridge_harness [scenario...]     all the scenarios when none is given
+ *        xbridge_harness --replay file     one Wixel stream per line: <millis> <port> <frame bytes in hex>
+ */
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <StreamString.h>
+#include "Firmware.h"
+
+// Milliseconds of virtual time between two loop calls when no frame comes before
+#define HARNESS_LOOP_STEP 10
+// The Wixels stop sending this many milliseconds before the end so the last readings can be uploaded
+#define HARNESS_DRAIN_TIME 1800000UL
+// A Wixel sends its first reading this many milliseconds after boot, the wifi is joined by then
+#define HARNESS_FIRST_READING 30000UL
+#define HARNESS_RECEIVER_HOST "receiver.example"
+#define HARNESS_RECEIVER_ADDRESS IPAddress(10, 0, 0, 1)
+#define HARNESS_FIRST_RAW 100000
+
+/*
+ * Traffic and faults of one run
+ */
+struct Scenario {
+  const char* name;
+  unsigned long hours;
+  unsigned long period; // Milliseconds between two readings of each Wixel
+  uint8_t wixelCount;
+  uint8_t garbagePercent; // Sends with a few random bytes before the frame
+  uint8_t truncatedPercent; // Sends cut short, the bridge must drop them
+  uint8_t beaconPercent; // New readings with a beacon before them
+  uint32_t serverLatency; // Milliseconds before the receiver answers
+  uint8_t errorPercent; // Requests answered 503
+  uint8_t disconnectPercent; // Requests closed without an answer
+  unsigned long outageStart; // Milliseconds after boot when the receiver goes down, 0 for never
+  unsigned long outageLength;
+};
+
+static const Scenario SCENARIOS[] = {
+  // name              hours  period  wixels garbage truncated beacon latency errors disconnects outage
+  { "nominal",           24, 300000, 1,      0,      0,        10,    150,    0,     0,          0,       0 },
+  { "two_wixels_noisy",  24, 300000, 2,      10,     10,       10,    150,    0,     0,          0,       0 },
+  { "slow_receiver",     12, 300000, 2,      0,      0,        10,    4000,   0,     0,          0,       0 },
+  { "server_errors",     12, 300000, 2,      0,      0,        10,    150,    30,    0,          0,       0 },
+  { "disconnects",       12, 300000, 2,      0,      0,        10,    150,    0,     20,         0,       0 },
+  { "outage",            12, 300000, 2,      0,      0,        10,    150,    0,     0,          7200000, 7200000 },
+  { "fast_rate",          2, 10000,  2,      5,      5,        10,    150,    5,     5,          0,       0 },
+  // The queue overflows during the outage, the connections tried meanwhile hold frames in the serial port
+  { "fast_rate_outage",   3, 10000,  2,      0,      0,        10,    150,    0,     0,          3600000, 3600000 }
+};
+
+static const uint32_t TRANSMITTER_IDS[WIXEL_PORT_COUNT] = { 0x1ABCD, 0x0BCDE };
+
+/*
+ * What happened to one reading, by its raw value
+ */
+struct ReadingTrace {
+  uint64_t firstSendMicros = 0;
+  bool received = false; // At least one send was complete and readable
+  bool acknowledged = false;
+  bool uploaded = false;
+};
+
+/*
+ * One frame of a recorded stream
+ */
+struct ReplayFrame {
+  unsigned long millis;
+  std::vector<uint8_t> bytes;
+};
+
+static std::map<uint32_t, ReadingTrace> _readings;
+static std::vector<uint64_t> _ackLatencies;
+static std::vector<uint64_t> _uploadLatencies;
+static uint32_t _duplicateUploadCount = 0;
+
+/*
+ * Wixel on one serial port of the bridge, synthetic or replayed
+ */
+class HarnessWixel {
+  public:
+    void begin(uint8_t port, HostSerialPort* serial, const Scenario &scenario, unsigned long endMillis) {
+      _port = port;
+      _serial = serial;
+      _scenario = scenario;
+      _endMillis = endMillis;
+      _random.seed(1000 + port);
+      // The Wixels are not in phase
+      _nextReadingMillis = HARNESS_FIRST_READING + port * (scenario.period / WIXEL_PORT_COUNT);
+      _serial->setWriteListener([this](const uint8_t* data, size_t length) { onWritten(data, length); });
+    }
+
+    void setReplay(const std::vector<ReplayFrame> &frames) {
+      _replay = frames;
+      _replayPosition = 0;
+    }
+
+    /*
+     * Sends what is due at now: the next recorded frame, a resend or a new reading
+     */
+    void update(unsigned long now) {
+      if (!_replay.empty()) {
+        while (_replayPosition < _replay.size() && (long)(now - _replay[_replayPosition].millis) >= 0) {
+          const ReplayFrame &frame = _replay[_replayPosition++];
+          uint64_t sendMicros = (uint64_t)frame.millis * 1000;
+          if (frame.bytes.size() == WixelFrameLength(WIXEL_COMM_RX_DATA_PACKET) &&
+              frame.bytes[1] == WIXEL_COMM_RX_DATA_PACKET) {
+            memcpy(&_reading, &frame.bytes[WIXEL_FRAME_HEADER_LENGTH], sizeof(_reading));
+            trackSend(true, sendMicros);
+          }
+          _serial->inject(frame.bytes.data(), frame.bytes.size(), sendMicros);
+        }
+        return;
+      }
+      if (_waitingAck && now - _lastSendMillis >= WIXEL_SIMULATOR_RESEND_TIMEOUT) {
+        if (_sendCount < WIXEL_SIMULATOR_MAX_SENDS) {
+          send(false, _lastSendMillis + WIXEL_SIMULATOR_RESEND_TIMEOUT);
+          return;
+        }
+        // Given up, like the real Wixel
+        _waitingAck = false;
+      }
+      if (!_waitingAck && (long)(now - _nextReadingMillis) >= 0 && now < _endMillis - HARNESS_DRAIN_TIME) {
+        unsigned long sendMillis = _nextReadingMillis;
+        _nextReadingMillis += _scenario.period;
+        _reading.raw = HARNESS_FIRST_RAW + _readingCount * WIXEL_PORT_COUNT + _port;
+        _reading.filtered = _reading.raw - 100;
+        _reading.dexBattery = 214;
+        _reading.bridgeBattery = 100;
+        _reading.dexSrcId = TRANSMITTER_IDS[_port];
+        _reading.function = DEXBRIDGE_PROTO_LEVEL;
+        _readingCount++;
+        _sendCount = 0;
+        send(true, sendMillis);
+      }
+    }
+
+    /*
+     * returns: When update has something to send, if sooner than limit
+     */
+    unsigned long getNextEventMillis(unsigned long now, unsigned long limit) {
+      unsigned long next = limit;
+      if (!_replay.empty()) {
+        if (_replayPosition < _replay.size() && (long)(_replay[_replayPosition].millis - next) < 0) {
+          next = _replay[_replayPosition].millis;
+        }
+        return next;
+      }
+      if (_waitingAck && (long)(_lastSendMillis + WIXEL_SIMULATOR_RESEND_TIMEOUT - next) < 0) {
+        next = _lastSendMillis + WIXEL_SIMULATOR_RESEND_TIMEOUT;
+      }
+      if (!_waitingAck && (long)(_nextReadingMillis - next) < 0) {
+        next = _nextReadingMillis;
+      }
+      return (long)(next - now) > 0 ? next : now;
+    }
+
+  private:
+    /*
+     * Sends the current reading. The bytes are due at sendMillis even when the loop was blocked past it,
+     * like on the wire
+     */
+    void send(bool newReading, unsigned long sendMillis) {
+      std::vector<uint8_t> bytes;
+      if (newReading && percent() < _scenario.beaconPercent) {
+        WixelBeaconPayload beacon;
+        beacon.dexSrcId = TRANSMITTER_IDS[_port];
+        beacon.protocolLevel = DEXBRIDGE_PROTO_LEVEL;
+        appendFrame(bytes, WIXEL_COMM_RX_SEND_BEACON, &beacon, sizeof(beacon), sizeof(beacon));
+      }
+      // The frames have no sync byte, noise which looks like a length byte takes the frame with it
+      bool garbled = false;
+      if (percent() < _scenario.garbagePercent) {
+        for (unsigned int i = 1 + _random() % 4; i > 0; i--) {
+          uint8_t noise = _random() % 256;
+          garbled = garbled || (noise >= WIXEL_FRAME_HEADER_LENGTH && noise <= WIXEL_MAX_FRAME_LENGTH);
+          bytes.push_back(noise);
+        }
+      }
+      bool truncated = percent() < _scenario.truncatedPercent;
+      appendFrame(bytes, WIXEL_COMM_RX_DATA_PACKET, &_reading, sizeof(_reading),
+                  truncated ? _random() % sizeof(_reading) : sizeof(_reading));
+      uint64_t sendMicros = (uint64_t)sendMillis * 1000;
+      _serial->inject(bytes.data(), bytes.size(), sendMicros);
+      _sendCount++;
+      _lastSendMillis = sendMillis;
+      trackSend(!truncated && !garbled, sendMicros);
+    }
+
+    void trackSend(bool complete, uint64_t sendMicros) {
+      ReadingTrace &trace = _readings[_reading.raw];
+      if (trace.firstSendMicros == 0) {
+        trace.firstSendMicros = sendMicros;
+      }
+      trace.received = trace.received || complete;
+      _lastCompleteMicros = complete ? sendMicros : 0;
+      _waitingAck = true;
+    }
+
+    void appendFrame(std::vector<uint8_t> &bytes, uint8_t type, const void* payload, uint8_t length, uint8_t sentLength) {
+      bytes.push_back(WIXEL_FRAME_HEADER_LENGTH + length);
+      bytes.push_back(type);
+      bytes.insert(bytes.end(), (const uint8_t*)payload, (const uint8_t*)payload + sentLength);
+    }
+
+    uint8_t percent() {
+      return _random() % 100;
+    }
+
+    /*
+     * Frames written by the bridge, an ACK ends the resends of the reading
+     */
+    void onWritten(const uint8_t* data, size_t length) {
+      for (size_t i = 0; i < length; i++) {
+        _received.push_back(data[i]);
+        if (_received[0] < WIXEL_FRAME_HEADER_LENGTH) {
+          _received.clear();
+          continue;
+        }
+        if (_received.size() < _received[0]) {
+          continue;
+        }
+        if (_received[1] == WIXEL_COMM_TX_ACKNOWLEDGE_DATA_PACKET && _waitingAck) {
+          _waitingAck = false;
+          ReadingTrace &trace = _readings[_reading.raw];
+          trace.acknowledged = true;
+          if (_lastCompleteMicros != 0) {
+            _ackLatencies.push_back(HostClock::getMicros() - _lastCompleteMicros);
+          }
+        }
+        _received.clear();
+      }
+    }
+
+    uint8_t _port = 0;
+    HostSerialPort* _serial = NULL;
+    Scenario _scenario = {};
+    unsigned long _endMillis = 0;
+    std::mt19937 _random;
+    std::vector<ReplayFrame> _replay;
+    size_t _replayPosition = 0;
+    WixelDataPayload _reading = {};
+    uint32_t _readingCount = 0;
+    uint8_t _sendCount = 0;
+    bool _waitingAck = false;
+    unsigned long _nextReadingMillis = 0;
+    unsigned long _lastSendMillis = 0;
+    uint64_t _lastCompleteMicros = 0;
+    std::vector<uint8_t> _received;
+};
+
+/*
+ * receiver.cgi with injected latency, errors and disconnects
+ */
+class HarnessReceiver : public HostServer {
+  public:
+    explicit HarnessReceiver(const Scenario &scenario) : _scenario(scenario) {
+      _random.seed(7);
+    }
+
+    /*
+     * A server which is down takes no new connection and does not answer on the opened ones
+     */
+    void setDown(bool down) {
+      _down = down;
+      HostNetwork::setHostDown(HARNESS_RECEIVER_ADDRESS, down);
+    }
+
+    void onReceive(HostConnection &connection, const uint8_t* data, size_t length) {
+      if (_down) {
+        return;
+      }
+      connection.request.append((const char*)data, length);
+      size_t end;
+      while ((end = connection.request.find("\r\n\r\n")) != std::string::npos) {
+        std::string request = connection.request.substr(0, end);
+        connection.request.erase(0, end + 4);
+        uint64_t delayMicros = (uint64_t)_scenario.serverLatency * 1000;
+        uint8_t fault = _random() % 100;
+        if (fault < _scenario.disconnectPercent) {
+          connection.close(delayMicros);
+          return;
+        }
+        if (fault < _scenario.disconnectPercent + _scenario.errorPercent) {
+          connection.reply("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n", delayMicros);
+          continue;
+        }
+        size_t position = request.find("&lv=");
+        if (request.compare(0, 18, "GET /receiver.cgi?") == 0 && position != std::string::npos) {
+          uint32_t raw = strtoul(request.c_str() + position + 4, NULL, 10);
+          ReadingTrace &trace = _readings[raw];
+          if (trace.uploaded) {
+            _duplicateUploadCount++;
+          }
+          else if (trace.firstSendMicros != 0) {
+            trace.uploaded = true;
+            _uploadLatencies.push_back(HostClock::getMicros() + delayMicros - trace.firstSendMicros);
+          }
+        }
+        connection.reply("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n!1", delayMicros);
+      }
+    }
+
+  private:
+    Scenario _scenario;
+    std::mt19937 _random;
+    bool _down = false;
+};
+
+/*
+ * Percentile
+ * ----------
+ * returns: The value under which percent of the sorted values are, 0 when there is none
+ */
+static uint64_t Percentile(const std::vector<uint64_t> &sorted, unsigned int percent) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t position = (sorted.size() * percent + 99) / 100;
+  return sorted[position > 0 ? position - 1 : 0];
+}
+
+/*
+ * RunScenario
+ * -----------
+ * This function will run the sketch through a scenario and print its report
+ * returns: true if the bridge lost no reading but the ones dropped by a full queue
+ */
+static bool RunScenario(const Scenario &scenario, const std::vector<ReplayFrame>* replays) {
+  HarnessReceiver receiver(scenario);
+  HostNetwork::addAccessPoint("home");
+  HostNetwork::addHost(HARNESS_RECEIVER_HOST, HARNESS_RECEIVER_ADDRESS);
+  HostNetwork::addServer(HARNESS_RECEIVER_ADDRESS, HTTP_PORT, &receiver);
+  setup();
+  for (uint8_t port = 0; port < WIXEL_PORT_COUNT; port++) {
+    _configuration.setTransmitterId(port, TRANSMITTER_IDS[port]);
+  }
+  _configuration.setAppEngineAddress(HARNESS_RECEIVER_HOST);
+  _configuration.saveSSID("home", "password");
+  _configuration.SaveConfig();
+
+  unsigned long endMillis = millis() + scenario.hours * 3600000UL;
+  HostSerialPort* serials[WIXEL_PORT_COUNT] = { &Serial, &_secondWixelSerial };
+  HarnessWixel wixels[WIXEL_PORT_COUNT];
+  for (uint8_t port = 0; port < scenario.wixelCount; port++) {
+    wixels[port].begin(port, serials[port], scenario, endMillis);
+    if (replays != NULL) {
+      wixels[port].setReplay(replays[port]);
+    }
+  }
+
+  uint64_t loopCount = 0;
+  bool outage = false;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while ((long)(endMillis - millis()) > 0) {
+    unsigned long now = millis();
+    if (scenario.outageStart > 0 && !outage && now >= scenario.outageStart &&
+        now < scenario.outageStart + scenario.outageLength) {
+      outage = true;
+      receiver.setDown(true);
+    }
+    else if (outage && now >= scenario.outageStart + scenario.outageLength) {
+      outage = false;
+      receiver.setDown(false);
+    }
+    for (uint8_t port = 0; port < scenario.wixelCount; port++) {
+      wixels[port].update(now);
+    }
+    loop();
+    loopCount++;
+    // Blocking calls of the sketch moved the clock already, a frame due meanwhile waited in the serial port
+    now = millis();
+    unsigned long next = now + HARNESS_LOOP_STEP;
+    for (uint8_t port = 0; port < scenario.wixelCount; port++) {
+      next = wixels[port].getNextEventMillis(now, next);
+    }
+    HostClock::advanceMillis(next > now ? next - now : 1);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  uint32_t readingCount = _readings.size();
+  uint32_t acknowledgedCount = 0;
+  uint32_t uploadedCount = 0;
+  uint32_t bridgeLostCount = 0;
+  for (std::map<uint32_t, ReadingTrace>::const_iterator i = _readings.begin(); i != _readings.end(); i++) {
+    const ReadingTrace &trace = i->second;
+    acknowledgedCount += trace.acknowledged ? 1 : 0;
+    uploadedCount += trace.uploaded ? 1 : 0;
+    bridgeLostCount += trace.received && !trace.uploaded ? 1 : 0;
+  }
+  uint32_t lostCount = readingCount - uploadedCount;
+  uint32_t queueDroppedCount = 0;
+  for (uint8_t port = 0; port < WIXEL_PORT_COUNT; port++) {
+    queueDroppedCount += _wixelPorts[port].getReadingQueue()->getDroppedCount();
+  }
+  uint32_t unexplainedCount = bridgeLostCount > queueDroppedCount ? bridgeLostCount - queueDroppedCount : 0;
+  std::sort(_ackLatencies.begin(), _ackLatencies.end());
+  std::sort(_uploadLatencies.begin(), _uploadLatencies.end());
+  uint32_t slowAckCount = _ackLatencies.end() -
+                          std::upper_bound(_ackLatencies.begin(), _ackLatencies.end(), (uint64_t)WIXEL_ACK_TARGET_MICROS);
+
+  printf("scenario %s\n", scenario.name);
+  printf("  traffic: %u wixels, one reading every %lu s, %lu h, garbage %u%%, truncated %u%%, beacons %u%%\n",
+         scenario.wixelCount, scenario.period / 1000, scenario.hours, scenario.garbagePercent,
+         scenario.truncatedPercent, scenario.beaconPercent);
+  printf("  receiver: %u ms, errors %u%%, disconnects %u%%, outage %lu min\n", scenario.serverLatency,
+         scenario.errorPercent, scenario.disconnectPercent, scenario.outageLength / 60000);
+  printf("  readings %u, acknowledged %u, uploaded %u, duplicate uploads %u\n",
+         readingCount, acknowledgedCount, uploadedCount, _duplicateUploadCount);
+  printf("  lost %u: by the bridge %u (queue full %u), every send unreadable %u\n", lostCount, bridgeLostCount,
+         queueDroppedCount, lostCount - bridgeLostCount);
+  printf("  throughput: %.1f uploads per hour, %.0f virtual hours per second, %.0f loop calls per second\n",
+         uploadedCount / (double)scenario.hours, scenario.hours / seconds, loopCount / seconds);
+  printf("  ack latency ms: p50 %.1f, p90 %.1f, p99 %.1f, max %.1f, over %u ms: %u\n",
+         Percentile(_ackLatencies, 50) / 1000.0, Percentile(_ackLatencies, 90) / 1000.0,
+         Percentile(_ackLatencies, 99) / 1000.0, Percentile(_ackLatencies, 100) / 1000.0,
+         WIXEL_ACK_TARGET_MICROS / 1000, slowAckCount);
+  printf("  upload latency s: p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+         Percentile(_uploadLatencies, 50) / 1e6, Percentile(_uploadLatencies, 90) / 1e6,
+         Percentile(_uploadLatencies, 99) / 1e6, Percentile(_uploadLatencies, 100) / 1e6);
+  StreamString radioReport;
+  _radioScheduler.printReport(radioReport);
+  printf("  radio scheduler:\n");
+  for (const char* line = radioReport.c_str(); *line != '\0';) {
+    size_t length = strcspn(line, "\n");
+    printf("    %.*s\n", (int)length, line);
+    line += line[length] == '\n' ? length + 1 : length;
+  }
+  printf("  %s\n", unexplainedCount == 0 ? "PASS" : "FAIL readings lost by the bridge");
+  return unexplainedCount == 0;
+}
+
+/*
+ * LoadReplay
+ * ----------
+ * This function will read a recorded stream, one frame per line: <millis> <port> <bytes in hex>
+ * returns: false if the file can't be read
+ */
+static bool LoadReplay(const char* path, std::vector<ReplayFrame>* replays, Scenario* scenario) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return false;
+  }
+  char line[512];
+  unsigned long lastMillis = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    char* position = line;
+    ReplayFrame frame;
+    frame.millis = strtoul(position, &position, 10);
+    unsigned long port = strtoul(position, &position, 10);
+    if (port >= WIXEL_PORT_COUNT) {
+      continue;
+    }
+    char* end;
+    unsigned long value;
+    while ((value = strtoul(position, &end, 16)) <= 0xFF && end != position) {
+      frame.bytes.push_back(value);
+      position = end;
+    }
+    if (!frame.bytes.empty()) {
+      lastMillis = std::max(lastMillis, frame.millis);
+      if (port + 1 > scenario->wixelCount) {
+        scenario->wixelCount = port + 1;
+      }
+      replays[port].push_back(frame);
+    }
+  }
+  fclose(file);
+  scenario->hours = (lastMillis + HARNESS_DRAIN_TIME) / 3600000UL + 1;
+  return true;
+}
+
+/*
+ * RunInChild
+ * ----------
+ * This function will run a scenario in a process of its own, the sketch starts from a fresh state
+ * returns: true if the scenario passed
+ */
+static bool RunInChild(const Scenario &scenario, const std::vector<ReplayFrame>* replays) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    bool passed = RunScenario(scenario, replays);
+    fflush(stdout);
+    _exit(passed ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+    return false;
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+  const unsigned int scenarioCount = sizeof(SCENARIOS) / sizeof(SCENARIOS[0]);
+  if (argc == 3 && strcmp(argv[1], "--replay") == 0) {
+    Scenario scenario = { "replay", 0, 0, 0, 0, 0, 0, 150, 0, 0, 0, 0 };
+    std::vector<ReplayFrame> replays[WIXEL_PORT_COUNT];
+    if (!LoadReplay(argv[2], replays, &scenario)) {
+      fprintf(stderr, "Can't read %s\n", argv[2]);
+      return EXIT_FAILURE;
+    }
+    return RunInChild(scenario, replays) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  unsigned int failedCount = 0;
+  unsigned int runCount = 0;
+  for (unsigned int i = 0; i < scenarioCount; i++) {
+    bool selected = argc == 1;
+    for (int j = 1; j < argc; j++) {
+      selected = selected || strcmp(argv[j], SCENARIOS[i].name) == 0;
+    }
+    if (selected) {
+      runCount++;
+      failedCount += RunInChild(SCENARIOS[i], NULL) ? 0 : 1;
+    }
+  }
+  if (runCount == 0) {
+    fprintf(stderr, "Unknown scenario, the scenarios are:");
+    for (unsigned int i = 0; i < scenarioCount; i++) {
+      fprintf(stderr, " %s", SCENARIOS[i].name);
+    }
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+  }
+  printf("%u scenarios, %u failed\n", runCount, failedCount);
+  return failedCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
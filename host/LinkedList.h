@@ -7,6 +7,9 @@
 
 	Created by Ivan Seidel Gomes, March, 2013.
 	Released into the public domain.
+
+	Kept for host/Benchmark.cpp, as the comparison point of the saved wifi table of Configuration.
+	Only change: the null pointers are NULL instead of false, the host build has no -fpermissive.
 */
 
 
@@ -98,8 +101,8 @@ public:
 template<typename T>
 LinkedList<T>::LinkedList()
 {
-	root=false;
-	last=false;
+	root = NULL;
+	last = NULL;
 	_size=0;
 
 	lastNodeGot = root;
@@ -112,13 +115,13 @@ template<typename T>
 LinkedList<T>::~LinkedList()
 {
 	ListNode<T>* tmp;
-	while(root!=false)
+	while(root!=NULL)
 	{
 		tmp=root;
 		root=root->next;
 		delete tmp;
 	}
-	last = false;
+	last = NULL;
 	_size=0;
 	isCached = false;
 }
@@ -155,7 +158,7 @@ ListNode<T>* LinkedList<T>::getNode(int index){
 		return current;
 	}
 
-	return false;
+	return NULL;
 }
 
 template<typename T>
@@ -189,7 +192,7 @@ bool LinkedList<T>::add(T _t){
 
 	ListNode<T> *tmp = new ListNode<T>();
 	tmp->data = _t;
-	tmp->next = false;
+	tmp->next = NULL;
 	
 	if(root){
 		// Already have elements inserted
@@ -245,7 +248,7 @@ T LinkedList<T>::pop(){
 		ListNode<T> *tmp = getNode(_size - 2);
 		T ret = tmp->next->data;
 		delete(tmp->next);
-		tmp->next = false;
+		tmp->next = NULL;
 		last = tmp;
 		_size--;
 		return ret;
@@ -253,8 +256,8 @@ T LinkedList<T>::pop(){
 		// Only one element left on the list
 		T ret = root->data;
 		delete(root);
-		root = false;
-		last = false;
+		root = NULL;
+		last = NULL;
 		_size = 0;
 		return ret;
 	}
@@ -0,0 +1,294 @@
+/*
+ * Fan-out test of the upload sinks, run on the host build.
+ * App Engine, Nightscout and the local receiver are three HTTP stand-ins answering after different delays.
+ * The Wixel sends a reading every period, then a burst of readings back to back. Every sink must get every
+ * reading, the Nightscout and the local receiver must get the same JSON body, and the time to upload a reading
+ * (or to drain the burst) must be close to the one of the slowest sink, not to the sum of the three.
+ * The local receiver listens on another port than 80 so its Host header must carry it, and the addresses
+ * the plain HTTP client can't reach (https://...) must be refused.
+ *
+ * usage: xbridge_upload_fan_out [readings]
+ */
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Firmware.h"
+
+#define FAN_OUT_TRANSMITTER 0x1ABCD
+#define FAN_OUT_PERIOD 300000UL
+// Milliseconds of virtual time for each loop call
+#define FAN_OUT_LOOP_STEP 10
+// Readings sent back to back after the periodic ones, and the time between two of them
+#define FAN_OUT_BURST_READINGS 8
+#define FAN_OUT_BURST_INTERVAL 200
+#define FAN_OUT_FIRST_RAW 100000
+#define FAN_OUT_BURST_FIRST_RAW 200000
+#define FAN_OUT_LOCAL_PORT 1337
+
+/*
+ * HTTP stand-in of one sink, keeps what it got for each reading by its raw value
+ */
+class FanOutServer : public HostServer {
+  public:
+    FanOutServer(const char* name, const char* rawKey, uint32_t latency) {
+      this->name = name;
+      _rawKey = rawKey;
+      this->latency = latency;
+    }
+
+    void onReceive(HostConnection &connection, const uint8_t* data, size_t length) {
+      connection.request.append((const char*)data, length);
+      for (;;) {
+        size_t end = connection.request.find("\r\n\r\n");
+        if (end == std::string::npos) {
+          return;
+        }
+        size_t bodyLength = 0;
+        size_t contentLength = connection.request.find("Content-Length: ");
+        if (contentLength != std::string::npos && contentLength < end) {
+          bodyLength = strtoul(connection.request.c_str() + contentLength + 16, NULL, 10);
+        }
+        if (connection.request.size() < end + 4 + bodyLength) {
+          return;
+        }
+        std::string head = connection.request.substr(0, end + 4);
+        std::string body = connection.request.substr(end + 4, bodyLength);
+        connection.request.erase(0, end + 4 + bodyLength);
+        size_t host = head.find("\r\nHost: ");
+        hostHeader = head.substr(host + 8, head.find("\r\n", host + 2) - host - 8);
+        std::string text = head + body;
+        size_t raw = text.find(_rawKey);
+        if (raw != std::string::npos) {
+          uint32_t value = strtoul(text.c_str() + raw + strlen(_rawKey), NULL, 10);
+          if (readings.count(value) == 0) {
+            readings[value] = HostClock::getMicros() + latency * 1000ULL;
+            bodies[value] = body;
+          }
+        }
+        connection.reply("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nOK", latency * 1000ULL);
+      }
+    }
+
+    const char* name;
+    uint32_t latency;
+    std::string hostHeader;
+    // Time the answer reached the bridge, by raw value
+    std::map<uint32_t, uint64_t> readings;
+    std::map<uint32_t, std::string> bodies;
+  private:
+    const char* _rawKey;
+};
+
+/*
+ * Print giving its bytes to the serial port of the bridge at a later time
+ */
+class DelayedInput : public Print {
+  public:
+    DelayedInput(HostSerialPort &port, uint64_t deliveryMicros) : _port(port), _deliveryMicros(deliveryMicros) {}
+    size_t write(uint8_t data) {
+      return write(&data, 1);
+    }
+    size_t write(const uint8_t* buffer, size_t size) {
+      _port.inject(buffer, size, _deliveryMicros);
+      return size;
+    }
+    using Print::write;
+  private:
+    HostSerialPort &_port;
+    uint64_t _deliveryMicros;
+};
+
+/*
+ * SendReading
+ * -----------
+ * This function will give one reading of the Wixel to the bridge at its time
+ */
+static void SendReading(uint32_t raw, unsigned long frameMillis) {
+  WixelDataPayload reading;
+  reading.raw = raw;
+  reading.filtered = raw - 500;
+  reading.dexBattery = 214;
+  reading.bridgeBattery = 90;
+  reading.dexSrcId = FAN_OUT_TRANSMITTER;
+  reading.function = 0;
+  DelayedInput input(Serial, (uint64_t)frameMillis * 1000);
+  WixelSend(input, reading);
+}
+
+/*
+ * RunUntil
+ * --------
+ * This function will call the loop of the sketch until the virtual time endMillis
+ */
+static void RunUntil(unsigned long endMillis) {
+  while ((long)(endMillis - millis()) > 0) {
+    loop();
+    HostClock::advanceMillis(FAN_OUT_LOOP_STEP);
+  }
+}
+
+/*
+ * UploadMicros
+ * ------------
+ * returns: The time the last sink got the answer for a reading, 0 if one of them never did
+ */
+static uint64_t UploadMicros(FanOutServer* const* servers, uint32_t raw) {
+  uint64_t last = 0;
+  for (int i = 0; i < UPLOAD_SINK_COUNT; i++) {
+    std::map<uint32_t, uint64_t>::const_iterator reading = servers[i]->readings.find(raw);
+    if (reading == servers[i]->readings.end()) {
+      return 0;
+    }
+    last = reading->second > last ? reading->second : last;
+  }
+  return last;
+}
+
+/*
+ * CheckAddresses
+ * --------------
+ * This function will check which sink addresses are taken and what host and port they give
+ * returns: true if every address gives what is expected
+ */
+static bool CheckAddresses() {
+  struct {
+    const char* address;
+    bool valid;
+    const char* host;
+    uint16_t port;
+  } cases[] = {
+    { "", true, "", HTTP_PORT },
+    { "my.site", true, "my.site", HTTP_PORT },
+    { "http://my.site:1337/api", true, "my.site", 1337 },
+    { "https://my.site", false, "", HTTP_PORT },
+    { "ftp://my.site", false, "", HTTP_PORT },
+    { "my.site:0", false, "", HTTP_PORT },
+    { "my.site:65536", false, "", HTTP_PORT },
+    { "my.site:13ab", false, "", HTTP_PORT },
+    { ":80", false, "", HTTP_PORT }
+  };
+  bool passed = true;
+  for (unsigned int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    char host[HTTP_CLIENT_MAX_HOST_LENGTH];
+    uint16_t port;
+    bool valid = UploadSink::parseAddress(cases[i].address, host, &port);
+    if (valid != cases[i].valid || (valid && (strcmp(host, cases[i].host) != 0 || port != cases[i].port))) {
+      printf("FAIL address \"%s\" gives %d \"%s\" %u\n", cases[i].address, valid, host, port);
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+int main(int argc, char** argv) {
+  unsigned long readingCount = argc > 1 ? strtoul(argv[1], NULL, 10) : 24;
+  FanOutServer appEngine("appEngine", "&lv=", 300);
+  FanOutServer nightscout("nightscout", "\"unfiltered\":", 1200);
+  FanOutServer local("local", "\"unfiltered\":", 2500);
+  FanOutServer* servers[UPLOAD_SINK_COUNT] = { &appEngine, &nightscout, &local };
+  uint32_t slowest = 0;
+  uint32_t sum = 0;
+  for (int i = 0; i < UPLOAD_SINK_COUNT; i++) {
+    slowest = servers[i]->latency > slowest ? servers[i]->latency : slowest;
+    sum += servers[i]->latency;
+  }
+  HostNetwork::addAccessPoint("home");
+  HostNetwork::addHost("appengine.example", IPAddress(10, 0, 0, 1));
+  HostNetwork::addHost("nightscout.example", IPAddress(10, 0, 0, 2));
+  HostNetwork::addHost("local.example", IPAddress(10, 0, 0, 3));
+  HostNetwork::addServer(IPAddress(10, 0, 0, 1), HTTP_PORT, &appEngine);
+  HostNetwork::addServer(IPAddress(10, 0, 0, 2), HTTP_PORT, &nightscout);
+  HostNetwork::addServer(IPAddress(10, 0, 0, 3), FAN_OUT_LOCAL_PORT, &local);
+  setup();
+  _configuration.setTransmitterId(0, FAN_OUT_TRANSMITTER);
+  _configuration.setAppEngineAddress("appengine.example");
+  _configuration.setNightscoutAddress("http://nightscout.example");
+  _configuration.setNightscoutSecret("secret");
+  _configuration.setLocalAddress("http://local.example:1337");
+  _configuration.saveSSID("home", "password");
+  _configuration.SaveConfig();
+
+  // One reading each period, uploaded before the next one comes
+  unsigned long firstMillis = millis() + 60000;
+  for (unsigned long i = 0; i < readingCount; i++) {
+    SendReading(FAN_OUT_FIRST_RAW + i, firstMillis + i * FAN_OUT_PERIOD);
+  }
+  RunUntil(firstMillis + readingCount * FAN_OUT_PERIOD);
+  uint64_t worstMicros = 0;
+  uint64_t totalMicros = 0;
+  unsigned long uploadedCount = 0;
+  for (unsigned long i = 0; i < readingCount; i++) {
+    uint64_t upload = UploadMicros(servers, FAN_OUT_FIRST_RAW + i);
+    if (upload != 0) {
+      uint64_t elapsed = upload - (uint64_t)(firstMillis + i * FAN_OUT_PERIOD) * 1000;
+      worstMicros = elapsed > worstMicros ? elapsed : worstMicros;
+      totalMicros += elapsed;
+      uploadedCount++;
+    }
+  }
+
+  // Burst: the sinks have a backlog, each one drains it on its own connection
+  unsigned long burstMillis = millis() + 1000;
+  for (unsigned long i = 0; i < FAN_OUT_BURST_READINGS; i++) {
+    SendReading(FAN_OUT_BURST_FIRST_RAW + i, burstMillis + i * FAN_OUT_BURST_INTERVAL);
+  }
+  RunUntil(burstMillis + FAN_OUT_PERIOD);
+  uint64_t drainMicros = 0;
+  for (unsigned long i = 0; i < FAN_OUT_BURST_READINGS; i++) {
+    uint64_t upload = UploadMicros(servers, FAN_OUT_BURST_FIRST_RAW + i);
+    drainMicros = upload == 0 ? UINT64_MAX : (upload > drainMicros ? upload : drainMicros);
+  }
+  if (drainMicros != UINT64_MAX) {
+    drainMicros -= (uint64_t)burstMillis * 1000;
+  }
+
+  bool passed = CheckAddresses();
+  unsigned long expectedCount = readingCount + FAN_OUT_BURST_READINGS;
+  for (int i = 0; i < UPLOAD_SINK_COUNT; i++) {
+    printf("%-10s latency_ms %u readings %zu host %s\n", servers[i]->name, servers[i]->latency,
+           servers[i]->readings.size(), servers[i]->hostHeader.c_str());
+    if (servers[i]->readings.size() != expectedCount) {
+      printf("FAIL %s got %zu readings of %lu\n", servers[i]->name, servers[i]->readings.size(), expectedCount);
+      passed = false;
+    }
+  }
+  if (local.hostHeader != "local.example:1337" || nightscout.hostHeader != "nightscout.example") {
+    printf("FAIL the Host header carries the port only when it is not 80\n");
+    passed = false;
+  }
+  unsigned long differentCount = 0;
+  for (std::map<uint32_t, std::string>::const_iterator i = nightscout.bodies.begin(); i != nightscout.bodies.end(); i++) {
+    std::map<uint32_t, std::string>::const_iterator other = local.bodies.find(i->first);
+    if (other == local.bodies.end() || other->second != i->second) {
+      if (differentCount == 0) {
+        printf("nightscout body %s\nlocal body      %s\n", i->second.c_str(),
+               other == local.bodies.end() ? "(none)" : other->second.c_str());
+      }
+      differentCount++;
+    }
+  }
+  if (differentCount > 0) {
+    printf("FAIL %lu readings have a different JSON body for Nightscout and the local receiver\n", differentCount);
+    passed = false;
+  }
+
+  printf("slowest_sink_ms %u\nsum_of_sinks_ms %u\n", slowest, sum);
+  printf("upload_mean_ms %.0f\nupload_worst_ms %.0f\n", uploadedCount > 0 ? totalMicros / 1000.0 / uploadedCount : 0.0,
+         worstMicros / 1000.0);
+  // A new connection per sink, then one request after the other on it
+  printf("burst_drain_ms %.0f\nburst_slowest_sink_ms %u\nburst_sum_of_sinks_ms %u\n",
+         drainMicros == UINT64_MAX ? -1.0 : drainMicros / 1000.0, FAN_OUT_BURST_READINGS * slowest,
+         FAN_OUT_BURST_READINGS * sum);
+  // Room for the lookup, the connection and the loop steps, well below the sum
+  if (uploadedCount == 0 || worstMicros > (slowest + (sum - slowest) / 2) * 1000ULL) {
+    printf("FAIL uploading a reading takes longer than the slowest sink\n");
+    passed = false;
+  }
+  uint32_t burstSlowest = FAN_OUT_BURST_READINGS * slowest;
+  uint32_t burstSum = FAN_OUT_BURST_READINGS * sum;
+  if (drainMicros > (burstSlowest + (burstSum - burstSlowest) / 2) * 1000ULL) {
+    printf("FAIL draining the burst takes longer than the slowest sink\n");
+    passed = false;
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
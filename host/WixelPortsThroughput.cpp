@@ -0,0 +1,232 @@
+/*
+ * Throughput test of two Wixels sending at the same time, run on the host build.
+ * Each Wixel has its own transmitter, the second one sends its readings half a period after the first one,
+ * so the frames of the two ports are interleaved. Every reading must be acknowledged and uploaded, and once
+ * the cadences of both ports are learned the radio must be turned off between the frames without missing one.
+ * The clock is virtual, the time spent per loop call is reported.
+ * Then both Wixels send a burst of readings back to back, the frames per second acknowledged and queued is reported.
+ *
+ * usage: xbridge_wixel_ports_throughput [hours] [burst readings per Wixel]
+ */
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <StreamString.h>
+#include "Firmware.h"
+
+#define THROUGHPUT_TRANSMITTER_1 0x1ABCD
+#define THROUGHPUT_TRANSMITTER_2 0x0BCDE
+#define THROUGHPUT_PERIOD 300000UL
+// The second Wixel sends half a period after the first one
+#define THROUGHPUT_OFFSET 150000UL
+// Milliseconds of virtual time for each loop call
+#define THROUGHPUT_LOOP_STEP 20
+// Milliseconds the receiver takes to answer
+#define THROUGHPUT_SERVER_LATENCY 150
+#define THROUGHPUT_SERVER_ADDRESS IPAddress(10, 0, 0, 1)
+// Readings sent by each Wixel in the burst
+#define THROUGHPUT_BURST_READINGS 2000
+
+/*
+ * receiver.cgi of the test, counts the readings of each transmitter
+ */
+class ReceiverServer : public HostServer {
+  public:
+    uint32_t readingCounts[WIXEL_PORT_COUNT] = {};
+    void onReceive(HostConnection &connection, const uint8_t* data, size_t length) {
+      connection.request.append((const char*)data, length);
+      size_t end = connection.request.find("\r\n\r\n");
+      if (end == std::string::npos) {
+        return;
+      }
+      if (connection.request.find("zi=" + std::to_string(THROUGHPUT_TRANSMITTER_1) + "&") != std::string::npos) {
+        readingCounts[0]++;
+      }
+      else if (connection.request.find("zi=" + std::to_string(THROUGHPUT_TRANSMITTER_2) + "&") != std::string::npos) {
+        readingCounts[1]++;
+      }
+      connection.request.erase(0, end + 4);
+      connection.reply("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nOK", THROUGHPUT_SERVER_LATENCY * 1000);
+    }
+};
+
+/*
+ * Print giving its bytes to a serial port of the bridge at a later time
+ */
+class DelayedInput : public Print {
+  public:
+    DelayedInput(HostSerialPort &port, uint64_t deliveryMicros) : _port(port), _deliveryMicros(deliveryMicros) {}
+    size_t write(uint8_t data) {
+      return write(&data, 1);
+    }
+    size_t write(const uint8_t* buffer, size_t size) {
+      _port.inject(buffer, size, _deliveryMicros);
+      return size;
+    }
+    using Print::write;
+  private:
+    HostSerialPort &_port;
+    uint64_t _deliveryMicros;
+};
+
+/*
+ * CountAcks
+ * ---------
+ * This function will count the ACK frames written by the bridge on a serial port
+ */
+static uint32_t CountAcks(HostSerialPort &port) {
+  std::vector<uint8_t> written = port.takeWritten();
+  uint32_t count = 0;
+  size_t position = 0;
+  while (position + 1 < written.size() && written[position] > 0) {
+    if (written[position + 1] == WIXEL_COMM_TX_ACKNOWLEDGE_DATA_PACKET) {
+      count++;
+    }
+    position += written[position];
+  }
+  return count;
+}
+
+/*
+ * GetReportValue
+ * --------------
+ * returns: The value of a key of the radio scheduler report
+ */
+static unsigned long GetReportValue(const std::string &report, const char* key) {
+  size_t position = report.find(std::string(key) + " ");
+  return position == std::string::npos ? 0 : strtoul(report.c_str() + position + strlen(key) + 1, NULL, 10);
+}
+
+int main(int argc, char** argv) {
+  unsigned long hours = argc > 1 ? strtoul(argv[1], NULL, 10) : 24;
+  if (hours == 0) {
+    hours = 1;
+  }
+  unsigned long burstReadings = argc > 2 ? strtoul(argv[2], NULL, 10) : THROUGHPUT_BURST_READINGS;
+  ReceiverServer server;
+  HostNetwork::addAccessPoint("home");
+  HostNetwork::addHost("receiver.example", THROUGHPUT_SERVER_ADDRESS);
+  HostNetwork::addServer(THROUGHPUT_SERVER_ADDRESS, HTTP_PORT, &server);
+  setup();
+  _configuration.setTransmitterId(0, THROUGHPUT_TRANSMITTER_1);
+  _configuration.setTransmitterId(1, THROUGHPUT_TRANSMITTER_2);
+  _configuration.setAppEngineAddress("receiver.example");
+  _configuration.saveSSID("home", "password");
+  _configuration.SaveConfig();
+
+  // Every frame is given to the serial ports at once, each one is read by the bridge at its time
+  HostSerialPort* serials[WIXEL_PORT_COUNT] = { &Serial, &_secondWixelSerial };
+  const uint32_t transmitterIds[WIXEL_PORT_COUNT] = { THROUGHPUT_TRANSMITTER_1, THROUGHPUT_TRANSMITTER_2 };
+  unsigned long endMillis = millis() + hours * 3600000UL;
+  uint32_t readingCount = 0;
+  for (int port = 0; port < WIXEL_PORT_COUNT; port++) {
+    unsigned long firstMillis = millis() + 60000 + port * THROUGHPUT_OFFSET;
+    for (unsigned long frameMillis = firstMillis; frameMillis < endMillis - THROUGHPUT_PERIOD; frameMillis += THROUGHPUT_PERIOD) {
+      uint32_t number = (frameMillis - firstMillis) / THROUGHPUT_PERIOD;
+      if (number % 12 == 0) {
+        // A beacon each hour, like a Wixel waking up
+        WixelBeaconPayload beacon;
+        beacon.dexSrcId = transmitterIds[port];
+        beacon.protocolLevel = 1;
+        DelayedInput beaconInput(*serials[port], (uint64_t)(frameMillis - 2000) * 1000);
+        WixelSend(beaconInput, beacon);
+      }
+      WixelDataPayload reading;
+      reading.raw = 100000 + number * 16 + port;
+      reading.filtered = reading.raw - 500;
+      reading.dexBattery = 214;
+      reading.bridgeBattery = 90;
+      reading.dexSrcId = transmitterIds[port];
+      reading.function = 0;
+      DelayedInput readingInput(*serials[port], (uint64_t)frameMillis * 1000);
+      WixelSend(readingInput, reading);
+      readingCount++;
+    }
+  }
+
+  uint64_t loopCount = 0;
+  uint32_t ackCounts[WIXEL_PORT_COUNT] = {};
+  unsigned long learnedMillis = 0;
+  unsigned long learnedMissedDeadlines = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while ((long)(endMillis - millis()) > 0) {
+    loop();
+    loopCount++;
+    HostClock::advanceMillis(THROUGHPUT_LOOP_STEP);
+    if (learnedMillis == 0 && !_radioScheduler.isRadioOn()) {
+      // First sleep, both cadences are learned
+      StreamString report;
+      _radioScheduler.printReport(report);
+      learnedMillis = millis();
+      learnedMissedDeadlines = GetReportValue(report.c_str(), "missed_deadlines");
+    }
+    if (loopCount % 1000 == 0) {
+      for (int port = 0; port < WIXEL_PORT_COUNT; port++) {
+        ackCounts[port] += CountAcks(*serials[port]);
+      }
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  for (int port = 0; port < WIXEL_PORT_COUNT; port++) {
+    ackCounts[port] += CountAcks(*serials[port]);
+  }
+
+  StreamString report;
+  _radioScheduler.printReport(report);
+  std::string text = report.c_str();
+  unsigned long missedDeadlines = GetReportValue(text, "missed_deadlines") - learnedMissedDeadlines;
+  uint32_t ackCount = ackCounts[0] + ackCounts[1];
+  uint32_t uploadCount = server.readingCounts[0] + server.readingCounts[1];
+  printf("%s", text.c_str());
+  printf("virtual_hours %lu\nreadings %u\nacks %u %u\nuploads %u %u\n", hours, readingCount, ackCounts[0], ackCounts[1],
+         server.readingCounts[0], server.readingCounts[1]);
+  printf("learned_after_s %lu\nmissed_deadlines_after_learning %lu\n", learnedMillis / 1000, missedDeadlines);
+  printf("wall_s %.3f\nloop_calls_per_s %.0f\nns_per_loop %.0f\n", seconds, loopCount / seconds, seconds * 1e9 / loopCount);
+
+  bool passed = true;
+  if (ackCount != readingCount || uploadCount != readingCount) {
+    printf("FAIL every reading must be acknowledged and uploaded once\n");
+    passed = false;
+  }
+  if (learnedMillis == 0 || GetReportValue(text, "sleeps") == 0) {
+    printf("FAIL the radio was never turned off\n");
+    passed = false;
+  }
+  if (missedDeadlines > 0) {
+    printf("FAIL frames came while the radio was off\n");
+    passed = false;
+  }
+
+  // Burst: the frames of both Wixels are all waiting, one frame of each port is read in turn
+  uint64_t nowMicros = HostClock::getMicros();
+  for (unsigned long i = 0; i < burstReadings; i++) {
+    for (int port = 0; port < WIXEL_PORT_COUNT; port++) {
+      WixelDataPayload reading;
+      reading.raw = 200000 + i * 16 + port;
+      reading.filtered = reading.raw - 500;
+      reading.dexBattery = 214;
+      reading.bridgeBattery = 90;
+      reading.dexSrcId = transmitterIds[port];
+      reading.function = 0;
+      DelayedInput readingInput(*serials[port], nowMicros);
+      WixelSend(readingInput, reading);
+    }
+  }
+  uint32_t burstAcks[WIXEL_PORT_COUNT] = {};
+  start = std::chrono::steady_clock::now();
+  while (serials[0]->getPendingCount() > 0 || serials[1]->getPendingCount() > 0) {
+    ManageConnectionStarted();
+    for (int port = 0; port < WIXEL_PORT_COUNT; port++) {
+      burstAcks[port] += CountAcks(*serials[port]);
+    }
+  }
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("burst_readings %lu %lu\nburst_acks %u %u\nburst_wall_s %.3f\nburst_frames_per_s %.0f\nburst_us_per_frame %.2f\n",
+         burstReadings, burstReadings, burstAcks[0], burstAcks[1], seconds, (burstAcks[0] + burstAcks[1]) / seconds,
+         seconds * 1e6 / (burstAcks[0] + burstAcks[1]));
+  if (burstAcks[0] != burstReadings || burstAcks[1] != burstReadings) {
+    printf("FAIL every reading of the burst must be acknowledged\n");
+    passed = false;
+  }
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
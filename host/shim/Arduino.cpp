@@ -0,0 +1,432 @@
+/*
+ * Host implementation of the Arduino core: clock, heap accounting, serial ports, Print and Stream
+ */
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include <stdarg.h>
+#include <malloc.h>
+#include <random>
+
+bool HostClock::_realTime = false;
+uint64_t HostClock::_virtualMicros = 0;
+
+static uint64_t MonotonicMicros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint64_t _realTimeStartMicros = MonotonicMicros();
+
+void HostClock::useRealTime(bool realTime) {
+  if (realTime && !_realTime) {
+    _realTimeStartMicros = MonotonicMicros() - _virtualMicros;
+  }
+  else if (!realTime && _realTime) {
+    _virtualMicros = MonotonicMicros() - _realTimeStartMicros;
+  }
+  _realTime = realTime;
+}
+
+bool HostClock::isRealTime() {
+  return _realTime;
+}
+
+uint64_t HostClock::getMicros() {
+  return _realTime ? MonotonicMicros() - _realTimeStartMicros : _virtualMicros;
+}
+
+void HostClock::advanceMicros(uint64_t micros) {
+  if (_realTime) {
+    struct timespec duration;
+    duration.tv_sec = micros / 1000000;
+    duration.tv_nsec = (micros % 1000000) * 1000;
+    nanosleep(&duration, NULL);
+  }
+  else {
+    _virtualMicros += micros;
+  }
+}
+
+void HostClock::advanceMillis(uint64_t millis) {
+  advanceMicros(millis * 1000);
+}
+
+void HostClock::setMillis(uint64_t millis) {
+  if (!_realTime && millis * 1000 > _virtualMicros) {
+    _virtualMicros = millis * 1000;
+  }
+}
+
+// 32 bits like on the ESP8266, so the wrap around is exercised
+unsigned long millis() {
+  return (uint32_t)(HostClock::getMicros() / 1000);
+}
+
+unsigned long micros() {
+  return (uint32_t)HostClock::getMicros();
+}
+
+void delay(unsigned long ms) {
+  HostClock::advanceMillis(ms);
+}
+
+void delayMicroseconds(unsigned int us) {
+  HostClock::advanceMicros(us);
+}
+
+void yield() {
+}
+
+/*
+ * Heap accounting: every allocation of the process goes through these, new included.
+ * Counted blocks are kept in a table without allocation, so freeing a block of the shim changes nothing
+ */
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+extern "C" void __libc_free(void* pointer);
+
+// Blocks of the firmware alive at the same time, a power of 2
+#define HOST_HEAP_TABLE_SIZE 65536
+
+struct HeapBlock {
+  void* pointer;
+  size_t size;
+};
+
+static HeapBlock _blocks[HOST_HEAP_TABLE_SIZE];
+static uint64_t _allocationCount = 0;
+static uint64_t _allocatedBytes = 0;
+static int64_t _liveBytes = 0;
+// Nothing is counted until startTracking
+static int _exclusionDepth = 1;
+
+static size_t BlockSlot(void* pointer) {
+  return ((uintptr_t)pointer >> 4) * 2654435761u & (HOST_HEAP_TABLE_SIZE - 1);
+}
+
+static void InsertBlock(void* pointer, size_t size) {
+  size_t slot = BlockSlot(pointer);
+  for (size_t probe = 0; probe < HOST_HEAP_TABLE_SIZE; probe++, slot = (slot + 1) & (HOST_HEAP_TABLE_SIZE - 1)) {
+    if (_blocks[slot].pointer == NULL) {
+      _blocks[slot].pointer = pointer;
+      _blocks[slot].size = size;
+      _liveBytes += size;
+      return;
+    }
+  }
+}
+
+static void TrackBlock(void* pointer) {
+  if (pointer == NULL || _exclusionDepth > 0) {
+    return;
+  }
+  size_t size = malloc_usable_size(pointer);
+  _allocationCount++;
+  _allocatedBytes += size;
+  InsertBlock(pointer, size);
+}
+
+static bool ForgetBlock(void* pointer) {
+  if (pointer == NULL) {
+    return false;
+  }
+  size_t slot = BlockSlot(pointer);
+  while (_blocks[slot].pointer != pointer) {
+    if (_blocks[slot].pointer == NULL) {
+      return false;
+    }
+    slot = (slot + 1) & (HOST_HEAP_TABLE_SIZE - 1);
+  }
+  _liveBytes -= _blocks[slot].size;
+  _blocks[slot].pointer = NULL;
+  // Moves back the next blocks of the probe sequence into the hole
+  size_t hole = slot;
+  for (size_t next = (slot + 1) & (HOST_HEAP_TABLE_SIZE - 1); _blocks[next].pointer != NULL; next = (next + 1) & (HOST_HEAP_TABLE_SIZE - 1)) {
+    size_t home = BlockSlot(_blocks[next].pointer);
+    bool movable = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+    if (movable) {
+      _blocks[hole] = _blocks[next];
+      _blocks[next].pointer = NULL;
+      hole = next;
+    }
+  }
+  return true;
+}
+
+extern "C" void* malloc(size_t size) {
+  void* pointer = __libc_malloc(size);
+  TrackBlock(pointer);
+  return pointer;
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+  void* pointer = __libc_calloc(count, size);
+  TrackBlock(pointer);
+  return pointer;
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+  size_t previous = pointer != NULL ? malloc_usable_size(pointer) : 0;
+  bool tracked = ForgetBlock(pointer);
+  void* moved = __libc_realloc(pointer, size);
+  if (moved == NULL && size > 0 && tracked) {
+    // Failed, the block is unchanged
+    InsertBlock(pointer, previous);
+  }
+  else if (tracked || pointer == NULL) {
+    TrackBlock(moved);
+  }
+  return moved;
+}
+
+extern "C" void free(void* pointer) {
+  ForgetBlock(pointer);
+  __libc_free(pointer);
+}
+
+HostHeapExclusion::HostHeapExclusion() {
+  _exclusionDepth++;
+}
+
+HostHeapExclusion::~HostHeapExclusion() {
+  _exclusionDepth--;
+}
+
+void HostHeap::startTracking() {
+  if (_exclusionDepth > 0) {
+    _exclusionDepth--;
+  }
+}
+
+uint64_t HostHeap::getAllocationCount() {
+  return _allocationCount;
+}
+
+uint64_t HostHeap::getAllocatedBytes() {
+  return _allocatedBytes;
+}
+
+int64_t HostHeap::getLiveBytes() {
+  return _liveBytes;
+}
+
+/*
+ * Wall clock: known once SNTP answered, like time() on the ESP8266 which counts from 1970 until then
+ */
+// 2026-01-01, the wall clock time when the host clock is 0
+#define HOST_EPOCH_AT_BOOT 1767225600ULL
+// Time SNTP takes to answer after configTime
+#define HOST_SNTP_DELAY 2000
+
+static bool _sntpStarted = false;
+static unsigned long _sntpStartMillis = 0;
+
+void configTime(int timezone, int daylightOffset, const char* server1, const char* server2, const char* server3) {
+  _sntpStarted = true;
+  _sntpStartMillis = millis();
+}
+
+extern "C" time_t time(time_t* result) throw() {
+  uint64_t seconds = HostClock::getMicros() / 1000000;
+  bool synchronized = _sntpStarted && HostNetwork::isSntpAvailable() && WiFi.status() == WL_CONNECTED &&
+                      millis() - _sntpStartMillis > HOST_SNTP_DELAY;
+  static bool everSynchronized = false;
+  everSynchronized = everSynchronized || synchronized;
+  time_t now = everSynchronized ? (time_t)(HOST_EPOCH_AT_BOOT + seconds) : (time_t)seconds;
+  if (result != NULL) {
+    *result = now;
+  }
+  return now;
+}
+
+/*
+ * Same numbers at each run unless the test seeds them
+ */
+static std::mt19937 _random(1);
+
+long random(long howBig) {
+  return howBig <= 0 ? 0 : (long)(_random() % (unsigned long)howBig);
+}
+
+long random(long howSmall, long howBig) {
+  return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+  _random.seed(seed);
+}
+
+uint32_t EspClass::getFreeHeap() {
+  int64_t free = HOST_HEAP_SIZE - HostHeap::getLiveBytes();
+  return free < 0 ? 0 : (uint32_t)free;
+}
+
+uint32_t EspClass::random() {
+  return _random();
+}
+
+void EspClass::restart() {
+  exit(0);
+}
+
+EspClass ESP;
+
+/*
+ * Serial ports
+ */
+HostSerialPort::HostSerialPort() {
+}
+
+void HostSerialPort::begin(unsigned long baud) {
+}
+
+void HostSerialPort::end() {
+}
+
+int HostSerialPort::available() {
+  uint64_t now = HostClock::getMicros();
+  int count = 0;
+  for (size_t i = 0; i < _received.size() && _received[i].deliveryMicros <= now; i++) {
+    count++;
+  }
+  return count;
+}
+
+int HostSerialPort::read() {
+  if (_received.empty() || _received.front().deliveryMicros > HostClock::getMicros()) {
+    return -1;
+  }
+  uint8_t value = _received.front().value;
+  _received.pop_front();
+  return value;
+}
+
+int HostSerialPort::peek() {
+  if (_received.empty() || _received.front().deliveryMicros > HostClock::getMicros()) {
+    return -1;
+  }
+  return _received.front().value;
+}
+
+void HostSerialPort::flush() {
+}
+
+size_t HostSerialPort::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+size_t HostSerialPort::write(const uint8_t* buffer, size_t size) {
+  HostHeapExclusion exclusion;
+  if (_writeListener) {
+    _writeListener(buffer, size);
+  }
+  else {
+    _written.insert(_written.end(), buffer, buffer + size);
+  }
+  return size;
+}
+
+void HostSerialPort::inject(const uint8_t* data, size_t length, uint64_t deliveryMicros) {
+  HostHeapExclusion exclusion;
+  for (size_t i = 0; i < length; i++) {
+    PendingByte pending;
+    pending.value = data[i];
+    pending.deliveryMicros = deliveryMicros;
+    _received.push_back(pending);
+  }
+}
+
+size_t HostSerialPort::getPendingCount() {
+  return _received.size();
+}
+
+std::vector<uint8_t> HostSerialPort::takeWritten() {
+  HostHeapExclusion exclusion;
+  std::vector<uint8_t> written;
+  written.swap(_written);
+  return written;
+}
+
+void HostSerialPort::setWriteListener(std::function<void(const uint8_t*, size_t)> listener) {
+  _writeListener = listener;
+}
+
+HardwareSerial Serial;
+
+/*
+ * Print and Stream
+ */
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t written = 0;
+  while (written < size && write(buffer[written]) == 1) {
+    written++;
+  }
+  return written;
+}
+
+size_t Print::print(long long value, int base) {
+  if (value < 0 && base == 10) {
+    return write('-') + print((unsigned long long)-value, base);
+  }
+  return print((unsigned long long)value, base);
+}
+
+size_t Print::print(unsigned long long value, int base) {
+  char text[65];
+  char* position = &text[sizeof(text) - 1];
+  *position = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    int digit = value % base;
+    *--position = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    value /= base;
+  } while (value > 0);
+  return write(position);
+}
+
+size_t Print::print(double value, int digits) {
+  char text[64];
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return write(text);
+}
+
+size_t Print::printf(const char* format, ...) {
+  char text[256];
+  va_list arguments;
+  va_start(arguments, format);
+  int length = vsnprintf(text, sizeof(text), format, arguments);
+  va_end(arguments);
+  if (length < 0) {
+    return 0;
+  }
+  return write((const uint8_t*)text, (size_t)length < sizeof(text) ? (size_t)length : sizeof(text) - 1);
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int value = read();
+    if (value >= 0) {
+      return value;
+    }
+    // Waits for the bytes to arrive, on the virtual clock too
+    HostClock::advanceMicros(100);
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int value = timedRead();
+    if (value < 0) {
+      break;
+    }
+    buffer[count++] = (char)value;
+  }
+  return count;
+}
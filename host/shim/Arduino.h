@@ -0,0 +1,137 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+/*
+ * Host shim of the ESP8266 Arduino core, only what the bridge uses.
+ * millis() and micros() come from HostClock: virtual time moved forward by the tests, or the real clock
+ * for the benchmarks. Heap use is counted by HostHeap so ESP.getFreeHeap() goes down when memory is kept.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <functional>
+#include <string>
+#include <deque>
+#include <vector>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(text) (text)
+#define F(text) (text)
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define strlen_P strlen
+#define memcpy_P memcpy
+#define strncpy_P strncpy
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+void configTime(int timezone, int daylightOffset, const char* server1, const char* server2 = NULL, const char* server3 = NULL);
+
+/*
+ * Time seen by the firmware. Virtual unless useRealTime is called, so a day of readings runs in a few seconds
+ */
+class HostClock {
+  public:
+    static void useRealTime(bool realTime);
+    static bool isRealTime();
+    static uint64_t getMicros();
+    static void advanceMicros(uint64_t micros);
+    static void advanceMillis(uint64_t millis);
+    static void setMillis(uint64_t millis);
+  private:
+    static bool _realTime;
+    static uint64_t _virtualMicros;
+};
+
+/*
+ * Heap use of the firmware, malloc and new included. What the shim allocates for its own bookkeeping
+ * (responses kept for the tests, bytes in flight, file contents) is left out with HostHeapExclusion
+ */
+class HostHeap {
+  public:
+    // Counts from now on, the blocks allocated before (C++ runtime, test data) are left out
+    static void startTracking();
+    static uint64_t getAllocationCount();
+    static uint64_t getAllocatedBytes();
+    static int64_t getLiveBytes();
+};
+
+class HostHeapExclusion {
+  public:
+    HostHeapExclusion();
+    ~HostHeapExclusion();
+};
+
+/*
+ * Serial port of the host build. Bytes given to inject are read by the firmware after their delivery time,
+ * bytes written by the firmware are kept until takeWritten
+ */
+class HostSerialPort : public Stream {
+  public:
+    HostSerialPort();
+    void begin(unsigned long baud);
+    void end();
+    int available();
+    int read();
+    int peek();
+    void flush();
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* buffer, size_t size);
+    using Print::write;
+    void inject(const uint8_t* data, size_t length, uint64_t deliveryMicros = 0);
+    size_t getPendingCount();
+    std::vector<uint8_t> takeWritten();
+    void setWriteListener(std::function<void(const uint8_t*, size_t)> listener);
+    operator bool() { return true; }
+  private:
+    struct PendingByte {
+      uint8_t value;
+      uint64_t deliveryMicros;
+    };
+    std::deque<PendingByte> _received;
+    std::vector<uint8_t> _written;
+    std::function<void(const uint8_t*, size_t)> _writeListener;
+};
+
+class HardwareSerial : public HostSerialPort {
+};
+
+extern HardwareSerial Serial;
+
+/*
+ * ESP8266 system functions
+ */
+class EspClass {
+  public:
+    uint32_t getFreeHeap();
+    uint32_t random();
+    void restart();
+};
+
+extern EspClass ESP;
+
+// Heap left to the sketch by the SDK of an ESP8266, before the sketch allocates anything
+#define HOST_HEAP_SIZE 50000
+
+#endif
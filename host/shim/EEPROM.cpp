@@ -0,0 +1,50 @@
+/*
+ * Host implementation of the emulated EEPROM
+ */
+#include "EEPROM.h"
+
+EEPROMClass::EEPROMClass() {
+  erase();
+}
+
+void EEPROMClass::begin(size_t size) {
+  _size = size < HOST_EEPROM_SIZE ? size : HOST_EEPROM_SIZE;
+}
+
+uint8_t EEPROMClass::read(int address) {
+  return address >= 0 && (size_t)address < _size ? _data[address] : 0;
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  if (address >= 0 && (size_t)address < _size) {
+    _data[address] = value;
+  }
+}
+
+bool EEPROMClass::commit() {
+  return _size > 0;
+}
+
+bool EEPROMClass::end() {
+  _size = 0;
+  return true;
+}
+
+uint8_t* EEPROMClass::getDataPtr() {
+  return _data;
+}
+
+const uint8_t* EEPROMClass::getConstDataPtr() const {
+  return _data;
+}
+
+size_t EEPROMClass::length() {
+  return _size;
+}
+
+void EEPROMClass::erase() {
+  memset(_data, 0xFF, sizeof(_data));
+  _size = 0;
+}
+
+EEPROMClass EEPROM;
@@ -0,0 +1,31 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+/*
+ * Emulated EEPROM of the host build, erased (0xFF) until a test writes in it
+ */
+#include "Arduino.h"
+
+#define HOST_EEPROM_SIZE 4096
+
+class EEPROMClass {
+  public:
+    EEPROMClass();
+    void begin(size_t size);
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    bool commit();
+    bool end();
+    uint8_t* getDataPtr();
+    const uint8_t* getConstDataPtr() const;
+    size_t length();
+    // Host build only
+    void erase();
+  private:
+    uint8_t _data[HOST_EEPROM_SIZE];
+    size_t _size;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
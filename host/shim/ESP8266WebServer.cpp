@@ -0,0 +1,190 @@
+/*
+ * Host implementation of the web server: requests are given by hostRequest, responses collected in memory
+ */
+#include "ESP8266WebServer.h"
+
+// Built at first use, servers are constructed by the static initializers of the firmware
+static std::map<int, ESP8266WebServer*> &Servers() {
+  static std::map<int, ESP8266WebServer*> servers;
+  return servers;
+}
+
+ESP8266WebServer::ESP8266WebServer(int port) {
+  _port = port;
+  _method = HTTP_GET;
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+  _chunked = false;
+  Servers()[port] = this;
+}
+
+ESP8266WebServer::~ESP8266WebServer() {
+  Servers().erase(_port);
+}
+
+void ESP8266WebServer::on(const String &uri, THandlerFunction handler) {
+  on(uri, HTTP_ANY, handler);
+}
+
+void ESP8266WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler) {
+  Route route;
+  route.uri = uri.c_str();
+  route.method = method;
+  route.handler = handler;
+  _routes.push_back(route);
+}
+
+void ESP8266WebServer::onNotFound(THandlerFunction handler) {
+  _notFoundHandler = handler;
+}
+
+void ESP8266WebServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+  _collectedHeaders.assign(headerKeys, headerKeys + headerKeysCount);
+}
+
+String ESP8266WebServer::uri() {
+  return String(_uri);
+}
+
+HTTPMethod ESP8266WebServer::method() {
+  return _method;
+}
+
+const String& ESP8266WebServer::arg(const String &name) {
+  static const String empty;
+  std::map<std::string, String>::iterator value = _args.find(name.c_str());
+  return value == _args.end() ? empty : value->second;
+}
+
+bool ESP8266WebServer::hasArg(const String &name) {
+  return _args.count(name.c_str()) > 0;
+}
+
+String ESP8266WebServer::header(const String &name) {
+  std::map<std::string, std::string>::iterator value = _requestHeaders.find(name.c_str());
+  return value == _requestHeaders.end() ? String() : String(value->second);
+}
+
+bool ESP8266WebServer::hasHeader(const String &name) {
+  return _requestHeaders.count(name.c_str()) > 0;
+}
+
+void ESP8266WebServer::sendHeader(const String &name, const String &value, bool first) {
+  HostHeapExclusion exclusion;
+  std::pair<std::string, std::string> header(name.c_str(), value.c_str());
+  if (first) {
+    _pendingHeaders.insert(_pendingHeaders.begin(), header);
+  }
+  else {
+    _pendingHeaders.push_back(header);
+  }
+}
+
+void ESP8266WebServer::setContentLength(size_t contentLength) {
+  _contentLength = contentLength;
+}
+
+void ESP8266WebServer::send(int code, const char* contentType, const String &content) {
+  HostHeapExclusion exclusion;
+  _response.code = code;
+  _response.contentType = contentType != NULL ? contentType : "";
+  _response.headers = _pendingHeaders;
+  _pendingHeaders.clear();
+  _chunked = _contentLength == CONTENT_LENGTH_UNKNOWN;
+  _response.body.append(content.c_str(), content.length());
+  _response.writeCount++;
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+}
+
+void ESP8266WebServer::send_P(int code, PGM_P contentType, PGM_P content) {
+  send(code, contentType, String(content));
+}
+
+void ESP8266WebServer::sendContent(const String &content) {
+  sendContent(content.c_str());
+}
+
+void ESP8266WebServer::sendContent(const char* content) {
+  HostHeapExclusion exclusion;
+  _response.body.append(content);
+  _response.writeCount++;
+}
+
+void ESP8266WebServer::sendContent_P(PGM_P content) {
+  sendContent(content);
+}
+
+HostResponse ESP8266WebServer::handle(HTTPMethod method, const char* uri, const char* body, const std::map<std::string, std::string> &headers) {
+  std::string path = parseRequest(method, uri, body, headers);
+  for (size_t i = 0; i < _routes.size(); i++) {
+    if (_routes[i].uri == path && (_routes[i].method == HTTP_ANY || _routes[i].method == method)) {
+      _routes[i].handler();
+      HostHeapExclusion exclusion;
+      return _response;
+    }
+  }
+  if (_notFoundHandler) {
+    _notFoundHandler();
+  }
+  else {
+    send(404, "text/plain", String("Not found: ") + uri);
+  }
+  HostHeapExclusion exclusion;
+  return _response;
+}
+
+/*
+ * Keeps the arguments and collected headers of the request, like handleClient before calling the handler
+ */
+std::string ESP8266WebServer::parseRequest(HTTPMethod method, const char* uri, const char* body, const std::map<std::string, std::string> &headers) {
+  HostHeapExclusion exclusion;
+  _response = HostResponse();
+  _response.code = 0;
+  _response.writeCount = 0;
+  _method = method;
+  _args.clear();
+  _requestHeaders.clear();
+  _pendingHeaders.clear();
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+  std::string path = uri;
+  size_t query = path.find('?');
+  if (query != std::string::npos) {
+    std::string arguments = path.substr(query + 1);
+    path = path.substr(0, query);
+    size_t start = 0;
+    while (start <= arguments.size()) {
+      size_t end = arguments.find('&', start);
+      std::string argument = arguments.substr(start, end == std::string::npos ? std::string::npos : end - start);
+      size_t equal = argument.find('=');
+      if (!argument.empty()) {
+        _args[argument.substr(0, equal)] = String(equal == std::string::npos ? std::string() : argument.substr(equal + 1));
+      }
+      if (end == std::string::npos) {
+        break;
+      }
+      start = end + 1;
+    }
+  }
+  _uri = path;
+  if (body != NULL) {
+    _args["plain"] = String(body);
+  }
+  for (size_t i = 0; i < _collectedHeaders.size(); i++) {
+    std::map<std::string, std::string>::const_iterator value = headers.find(_collectedHeaders[i]);
+    if (value != headers.end()) {
+      _requestHeaders[value->first] = value->second;
+    }
+  }
+  return path;
+}
+
+HostResponse ESP8266WebServer::hostRequest(int port, HTTPMethod method, const char* uri, const char* body,
+                                           const std::map<std::string, std::string> &headers) {
+  std::map<int, ESP8266WebServer*>::iterator server = Servers().find(port);
+  if (server == Servers().end()) {
+    HostResponse refused;
+    refused.code = 0;
+    refused.writeCount = 0;
+    return refused;
+  }
+  return server->second->handle(method, uri, body, headers);
+}
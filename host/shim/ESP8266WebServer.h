@@ -0,0 +1,89 @@
+#ifndef ESP8266WebServer_h
+#define ESP8266WebServer_h
+
+/*
+ * Web server of the host build. A test sends a request with hostRequest and gets the whole response back,
+ * the handler runs in the call like it would in handleClient
+ */
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+
+enum HTTPMethod {
+  HTTP_ANY,
+  HTTP_GET,
+  HTTP_HEAD,
+  HTTP_POST,
+  HTTP_PUT,
+  HTTP_PATCH,
+  HTTP_DELETE,
+  HTTP_OPTIONS
+};
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+struct HostResponse {
+  int code;
+  std::string contentType;
+  std::vector<std::pair<std::string, std::string> > headers;
+  std::string body;
+  // Calls of send, sendContent and sendContent_P, each one a packet on the ESP8266
+  uint32_t writeCount;
+};
+
+class ESP8266WebServer {
+  public:
+    typedef std::function<void(void)> THandlerFunction;
+    ESP8266WebServer(int port = 80);
+    ~ESP8266WebServer();
+    void begin() {}
+    void handleClient() {}
+    void on(const String &uri, THandlerFunction handler);
+    void on(const String &uri, HTTPMethod method, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String uri();
+    HTTPMethod method();
+    // Returns a reference like the 3.x core, the argument is not copied
+    const String& arg(const String &name);
+    bool hasArg(const String &name);
+    String header(const String &name);
+    bool hasHeader(const String &name);
+    void sendHeader(const String &name, const String &value, bool first = false);
+    void setContentLength(size_t contentLength);
+    void send(int code, const char* contentType = NULL, const String &content = String(""));
+    void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content); }
+    void send_P(int code, PGM_P contentType, PGM_P content);
+    void sendContent(const String &content);
+    void sendContent(const char* content);
+    void sendContent_P(PGM_P content);
+    // Host build only
+    static HostResponse hostRequest(int port, HTTPMethod method, const char* uri, const char* body = NULL,
+                                    const std::map<std::string, std::string> &headers = std::map<std::string, std::string>());
+  private:
+    struct Route {
+      std::string uri;
+      HTTPMethod method;
+      THandlerFunction handler;
+    };
+    std::string parseRequest(HTTPMethod method, const char* uri, const char* body, const std::map<std::string, std::string> &headers);
+    HostResponse handle(HTTPMethod method, const char* uri, const char* body, const std::map<std::string, std::string> &headers);
+    int _port;
+    std::vector<Route> _routes;
+    THandlerFunction _notFoundHandler;
+    std::vector<std::string> _collectedHeaders;
+    std::string _uri;
+    HTTPMethod _method;
+    std::map<std::string, String> _args;
+    std::map<std::string, std::string> _requestHeaders;
+    std::vector<std::pair<std::string, std::string> > _pendingHeaders;
+    size_t _contentLength;
+    bool _chunked;
+    HostResponse _response;
+};
+
+#endif
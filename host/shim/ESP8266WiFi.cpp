@@ -0,0 +1,501 @@
+/*
+ * Host implementation of the station, hotspot and TCP client, on the fake network of HostNetwork
+ */
+#include "ESP8266WiFi.h"
+
+#define HOST_NO_DELIVERY UINT64_MAX
+// Time a scan takes
+#define HOST_SCAN_DURATION 2000
+
+/*
+ * HostConnection
+ */
+HostConnection::HostConnection(HostServer* server) {
+  _server = server;
+  _lastDeliveryMicros = 0;
+  _closeMicros = HOST_NO_DELIVERY;
+  _closedByClient = false;
+  openMicros = HostClock::getMicros();
+}
+
+void HostConnection::reply(const uint8_t* data, size_t length, uint64_t delayMicros) {
+  HostHeapExclusion exclusion;
+  uint64_t deliveryMicros = HostClock::getMicros() + delayMicros;
+  // Bytes reach the client in the order they were sent
+  if (deliveryMicros < _lastDeliveryMicros) {
+    deliveryMicros = _lastDeliveryMicros;
+  }
+  _lastDeliveryMicros = deliveryMicros;
+  for (size_t i = 0; i < length; i++) {
+    PendingByte pending;
+    pending.value = data[i];
+    pending.deliveryMicros = deliveryMicros;
+    _toClient.push_back(pending);
+  }
+}
+
+void HostConnection::reply(const char* text, uint64_t delayMicros) {
+  reply((const uint8_t*)text, strlen(text), delayMicros);
+}
+
+void HostConnection::close(uint64_t delayMicros) {
+  uint64_t closeMicros = HostClock::getMicros() + delayMicros;
+  if (closeMicros < _lastDeliveryMicros) {
+    closeMicros = _lastDeliveryMicros;
+  }
+  if (closeMicros < _closeMicros) {
+    _closeMicros = closeMicros;
+  }
+}
+
+bool HostConnection::isClosedByClient() {
+  return _closedByClient;
+}
+
+/*
+ * HostNetwork
+ */
+std::vector<HostNetwork::AccessPoint> HostNetwork::_accessPoints;
+std::map<std::string, uint32_t> HostNetwork::_hosts;
+std::map<uint64_t, HostServer*> HostNetwork::_servers;
+std::map<uint32_t, bool> HostNetwork::_downHosts;
+bool HostNetwork::_wifiAvailable = true;
+bool HostNetwork::_sntpAvailable = true;
+uint32_t HostNetwork::_connectLatency = 20;
+uint32_t HostNetwork::_dnsLatency = 10;
+uint32_t HostNetwork::_joinLatency = 1500;
+uint32_t HostNetwork::_connectCount = 0;
+uint32_t HostNetwork::_failedConnectCount = 0;
+uint32_t HostNetwork::_dnsLookupCount = 0;
+uint64_t HostNetwork::_blockedMicros = 0;
+
+void HostNetwork::reset() {
+  _accessPoints.clear();
+  _hosts.clear();
+  _servers.clear();
+  _downHosts.clear();
+  _wifiAvailable = true;
+  _sntpAvailable = true;
+  _connectCount = 0;
+  _failedConnectCount = 0;
+  _dnsLookupCount = 0;
+  _blockedMicros = 0;
+}
+
+void HostNetwork::addAccessPoint(const char* ssid, int32_t rssi) {
+  AccessPoint accessPoint;
+  accessPoint.ssid = ssid;
+  accessPoint.rssi = rssi;
+  _accessPoints.push_back(accessPoint);
+}
+
+void HostNetwork::setWifiAvailable(bool available) {
+  _wifiAvailable = available;
+}
+
+bool HostNetwork::isWifiAvailable() {
+  return _wifiAvailable;
+}
+
+void HostNetwork::addHost(const char* name, IPAddress address) {
+  _hosts[name] = address;
+}
+
+void HostNetwork::addServer(IPAddress address, uint16_t port, HostServer* server) {
+  _servers[((uint64_t)(uint32_t)address << 16) | port] = server;
+}
+
+void HostNetwork::setHostDown(IPAddress address, bool down) {
+  _downHosts[address] = down;
+}
+
+void HostNetwork::setSntpAvailable(bool available) {
+  _sntpAvailable = available;
+}
+
+bool HostNetwork::isSntpAvailable() {
+  return _sntpAvailable;
+}
+
+void HostNetwork::setConnectLatency(uint32_t millis) {
+  _connectLatency = millis;
+}
+
+void HostNetwork::setDnsLatency(uint32_t millis) {
+  _dnsLatency = millis;
+}
+
+void HostNetwork::setJoinLatency(uint32_t millis) {
+  _joinLatency = millis;
+}
+
+uint32_t HostNetwork::getJoinLatency() {
+  return _joinLatency;
+}
+
+/*
+ * Blocks like the SDK: the lookup takes the DNS latency, or the whole timeout for an unknown name
+ */
+bool HostNetwork::resolve(const char* name, IPAddress &address, uint32_t timeout) {
+  HostHeapExclusion exclusion;
+  if (address.fromString(name)) {
+    return true;
+  }
+  _dnsLookupCount++;
+  std::map<std::string, uint32_t>::iterator host = _hosts.find(name);
+  if (host == _hosts.end() || WiFi.status() != WL_CONNECTED) {
+    HostClock::advanceMillis(timeout);
+    _blockedMicros += (uint64_t)timeout * 1000;
+    return false;
+  }
+  HostClock::advanceMillis(_dnsLatency);
+  _blockedMicros += (uint64_t)_dnsLatency * 1000;
+  address = IPAddress(host->second);
+  return true;
+}
+
+/*
+ * Blocks like lwIP: the handshake takes the connect latency, a host which is down takes the whole timeout
+ * and a host without server on the port refuses at once
+ */
+std::shared_ptr<HostConnection> HostNetwork::connect(IPAddress address, uint16_t port, uint32_t timeout) {
+  HostHeapExclusion exclusion;
+  _connectCount++;
+  if (WiFi.status() != WL_CONNECTED || _downHosts[address]) {
+    _failedConnectCount++;
+    HostClock::advanceMillis(timeout);
+    _blockedMicros += (uint64_t)timeout * 1000;
+    return std::shared_ptr<HostConnection>();
+  }
+  HostClock::advanceMillis(_connectLatency);
+  _blockedMicros += (uint64_t)_connectLatency * 1000;
+  std::map<uint64_t, HostServer*>::iterator server = _servers.find(((uint64_t)(uint32_t)address << 16) | port);
+  if (server == _servers.end()) {
+    _failedConnectCount++;
+    return std::shared_ptr<HostConnection>();
+  }
+  std::shared_ptr<HostConnection> connection(new HostConnection(server->second));
+  server->second->onConnect(*connection);
+  return connection;
+}
+
+bool HostNetwork::hasAccessPoint(const char* ssid, int32_t* rssi) {
+  HostHeapExclusion exclusion;
+  for (size_t i = 0; i < _accessPoints.size(); i++) {
+    if (_accessPoints[i].ssid == ssid) {
+      if (rssi != NULL) {
+        *rssi = _accessPoints[i].rssi;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t HostNetwork::getConnectCount() {
+  return _connectCount;
+}
+
+uint32_t HostNetwork::getFailedConnectCount() {
+  return _failedConnectCount;
+}
+
+uint32_t HostNetwork::getDnsLookupCount() {
+  return _dnsLookupCount;
+}
+
+uint64_t HostNetwork::getBlockedMicros() {
+  return _blockedMicros;
+}
+
+/*
+ * WiFiClient
+ */
+WiFiClient::WiFiClient() {
+  // Connect timeout of the ESP8266 core
+  _timeout = 5000;
+}
+
+int WiFiClient::connect(IPAddress address, uint16_t port) {
+  stop();
+  _connection = HostNetwork::connect(address, port, _timeout);
+  return _connection != NULL ? 1 : 0;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  IPAddress address;
+  if (!WiFi.hostByName(host, address, _timeout)) {
+    stop();
+    return 0;
+  }
+  return connect(address, port);
+}
+
+uint8_t WiFiClient::connected() {
+  if (_connection == NULL) {
+    return 0;
+  }
+  // Still connected while received bytes are waiting, like lwIP
+  return HostClock::getMicros() < _connection->_closeMicros || available() > 0;
+}
+
+void WiFiClient::stop() {
+  HostHeapExclusion exclusion;
+  if (_connection != NULL) {
+    _connection->_closedByClient = true;
+    _connection->_server->onClose(*_connection);
+    _connection.reset();
+  }
+}
+
+void WiFiClient::setNoDelay(bool noDelay) {
+}
+
+size_t WiFiClient::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+  HostHeapExclusion exclusion;
+  if (_connection == NULL || HostClock::getMicros() >= _connection->_closeMicros) {
+    return 0;
+  }
+  _connection->_server->onReceive(*_connection, buffer, size);
+  return size;
+}
+
+int WiFiClient::availableForWrite() {
+  return _connection != NULL && HostClock::getMicros() < _connection->_closeMicros ? 1460 : 0;
+}
+
+int WiFiClient::available() {
+  if (_connection == NULL) {
+    return 0;
+  }
+  uint64_t now = HostClock::getMicros();
+  int count = 0;
+  for (size_t i = 0; i < _connection->_toClient.size() && _connection->_toClient[i].deliveryMicros <= now; i++) {
+    count++;
+  }
+  return count;
+}
+
+int WiFiClient::read() {
+  uint8_t value;
+  return read(&value, 1) == 1 ? value : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+  HostHeapExclusion exclusion;
+  if (_connection == NULL) {
+    return -1;
+  }
+  uint64_t now = HostClock::getMicros();
+  size_t count = 0;
+  while (count < size && !_connection->_toClient.empty() && _connection->_toClient.front().deliveryMicros <= now) {
+    buffer[count++] = _connection->_toClient.front().value;
+    _connection->_toClient.pop_front();
+  }
+  return count;
+}
+
+int WiFiClient::peek() {
+  if (_connection == NULL || _connection->_toClient.empty() ||
+      _connection->_toClient.front().deliveryMicros > HostClock::getMicros()) {
+    return -1;
+  }
+  return _connection->_toClient.front().value;
+}
+
+void WiFiClient::flush() {
+}
+
+/*
+ * ESP8266WiFiClass
+ */
+ESP8266WiFiClass::ESP8266WiFiClass() {
+  _joining = false;
+  _joined = false;
+  _sleeping = false;
+  _staticAddress = false;
+  _joinStartMillis = 0;
+  memset(_bssid, 0, sizeof(_bssid));
+  _channel = 0;
+  _scanning = false;
+  _scanStartMillis = 0;
+  _stationCount = 0;
+  _staticJoinCount = 0;
+  _dhcpJoinCount = 0;
+}
+
+wl_status_t ESP8266WiFiClass::status() {
+  if (_sleeping) {
+    return WL_DISCONNECTED;
+  }
+  if (_joining && millis() - _joinStartMillis >= HostNetwork::getJoinLatency()) {
+    _joining = false;
+    _joined = HostNetwork::isWifiAvailable() && HostNetwork::hasAccessPoint(_ssid.c_str());
+    if (_joined) {
+      if (_staticAddress) {
+        _staticJoinCount++;
+      }
+      else {
+        _dhcpJoinCount++;
+        _localIp = IPAddress(192, 168, 1, 50);
+        _gateway = IPAddress(192, 168, 1, 1);
+        _subnetMask = IPAddress(255, 255, 255, 0);
+        _dns = IPAddress(192, 168, 1, 1);
+      }
+    }
+    else {
+      _ssid.clear();
+    }
+  }
+  if (_joining) {
+    return WL_DISCONNECTED;
+  }
+  if (_joined && !HostNetwork::isWifiAvailable()) {
+    _joined = false;
+  }
+  if (_joined) {
+    return WL_CONNECTED;
+  }
+  return _ssid.empty() ? WL_NO_SSID_AVAIL : WL_DISCONNECTED;
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* bssid, bool connect) {
+  _ssid = ssid;
+  _channel = channel != 0 ? channel : 6;
+  static const uint8_t DEFAULT_BSSID[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  memcpy(_bssid, bssid != NULL ? bssid : DEFAULT_BSSID, sizeof(_bssid));
+  _joined = false;
+  _joining = true;
+  _joinStartMillis = millis();
+  return WL_DISCONNECTED;
+}
+
+bool ESP8266WiFiClass::config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+  _staticAddress = localIp.isSet();
+  _localIp = localIp;
+  _gateway = gateway;
+  _subnetMask = subnet;
+  _dns = dns1;
+  return true;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifiOff) {
+  _joined = false;
+  _joining = false;
+  return true;
+}
+
+uint8_t* ESP8266WiFiClass::BSSID() {
+  return _bssid;
+}
+
+int32_t ESP8266WiFiClass::channel() {
+  return _channel;
+}
+
+int32_t ESP8266WiFiClass::RSSI() {
+  int32_t rssi = 0;
+  return status() == WL_CONNECTED && HostNetwork::hasAccessPoint(_ssid.c_str(), &rssi) ? rssi : 31;
+}
+
+IPAddress ESP8266WiFiClass::localIP() {
+  return status() == WL_CONNECTED ? _localIp : IPAddress();
+}
+
+IPAddress ESP8266WiFiClass::gatewayIP() {
+  return status() == WL_CONNECTED ? _gateway : IPAddress();
+}
+
+IPAddress ESP8266WiFiClass::subnetMask() {
+  return status() == WL_CONNECTED ? _subnetMask : IPAddress();
+}
+
+IPAddress ESP8266WiFiClass::dnsIP(uint8_t index) {
+  return status() == WL_CONNECTED ? _dns : IPAddress();
+}
+
+int8_t ESP8266WiFiClass::scanNetworks(bool async, bool showHidden) {
+  _scanning = true;
+  _scanStartMillis = millis();
+  if (!async) {
+    HostClock::advanceMillis(HOST_SCAN_DURATION);
+    return scanComplete();
+  }
+  return WIFI_SCAN_RUNNING;
+}
+
+int8_t ESP8266WiFiClass::scanComplete() {
+  if (!_scanning) {
+    return WIFI_SCAN_FAILED;
+  }
+  if (millis() - _scanStartMillis < HOST_SCAN_DURATION) {
+    return WIFI_SCAN_RUNNING;
+  }
+  return HostNetwork::isWifiAvailable() ? 1 : 0;
+}
+
+void ESP8266WiFiClass::scanDelete() {
+  _scanning = false;
+}
+
+String ESP8266WiFiClass::SSID(uint8_t index) {
+  return String(_ssid.c_str());
+}
+
+int32_t ESP8266WiFiClass::RSSI(uint8_t index) {
+  return -60;
+}
+
+uint8_t ESP8266WiFiClass::encryptionType(uint8_t index) {
+  return ENC_TYPE_CCMP;
+}
+
+bool ESP8266WiFiClass::softAP(const char* ssid, const char* passphrase) {
+  return true;
+}
+
+IPAddress ESP8266WiFiClass::softAPIP() {
+  return IPAddress(192, 168, 4, 1);
+}
+
+uint8_t ESP8266WiFiClass::softAPgetStationNum() {
+  return _stationCount;
+}
+
+bool ESP8266WiFiClass::forceSleepBegin(uint32_t sleepMicros) {
+  _sleeping = true;
+  _joined = false;
+  _joining = false;
+  return true;
+}
+
+bool ESP8266WiFiClass::forceSleepWake() {
+  _sleeping = false;
+  return true;
+}
+
+int ESP8266WiFiClass::hostByName(const char* host, IPAddress &address, uint32_t timeout) {
+  return HostNetwork::resolve(host, address, timeout) ? 1 : 0;
+}
+
+bool ESP8266WiFiClass::isStaticAddress() {
+  return _staticAddress;
+}
+
+uint32_t ESP8266WiFiClass::getStaticJoinCount() {
+  return _staticJoinCount;
+}
+
+uint32_t ESP8266WiFiClass::getDhcpJoinCount() {
+  return _dhcpJoinCount;
+}
+
+void ESP8266WiFiClass::setStationCount(uint8_t count) {
+  _stationCount = count;
+}
+
+ESP8266WiFiClass WiFi;
@@ -0,0 +1,197 @@
+#ifndef ESP8266WiFi_h
+#define ESP8266WiFi_h
+
+/*
+ * Station, hotspot and TCP client of the host build, connected to the fake network of HostNetwork.
+ * Like on the ESP8266 WiFiClient::connect blocks: the host clock moves forward by the connect latency,
+ * or by the client timeout when the host is down
+ */
+#include <memory>
+#include <map>
+#include <string>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_WRONG_PASSWORD = 6,
+  WL_DISCONNECTED = 7
+} wl_status_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+#define ENC_TYPE_WEP 5
+#define ENC_TYPE_TKIP 2
+#define ENC_TYPE_CCMP 4
+#define ENC_TYPE_NONE 7
+#define ENC_TYPE_AUTO 8
+
+class HostServer;
+
+/*
+ * One TCP connection of the fake network. The server side answers with reply and close,
+ * the bytes reach the client after their delay
+ */
+class HostConnection {
+  public:
+    HostConnection(HostServer* server);
+    void reply(const uint8_t* data, size_t length, uint64_t delayMicros = 0);
+    void reply(const char* text, uint64_t delayMicros = 0);
+    void close(uint64_t delayMicros = 0);
+    bool isClosedByClient();
+    // Free for the server, usually the part of the request received so far
+    std::string request;
+    uint64_t openMicros;
+  private:
+    friend class WiFiClient;
+    struct PendingByte {
+      uint8_t value;
+      uint64_t deliveryMicros;
+    };
+    HostServer* _server;
+    std::deque<PendingByte> _toClient;
+    uint64_t _lastDeliveryMicros;
+    uint64_t _closeMicros;
+    bool _closedByClient;
+};
+
+/*
+ * Server of the fake network, given the bytes written by the firmware as they are written
+ */
+class HostServer {
+  public:
+    virtual ~HostServer() {}
+    virtual void onConnect(HostConnection &connection) {}
+    virtual void onReceive(HostConnection &connection, const uint8_t* data, size_t length) = 0;
+    virtual void onClose(HostConnection &connection) {}
+};
+
+/*
+ * The network seen by the firmware: access points, names, servers and their failures
+ */
+class HostNetwork {
+  public:
+    static void reset();
+    static void addAccessPoint(const char* ssid, int32_t rssi = -60);
+    static void setWifiAvailable(bool available);
+    static bool isWifiAvailable();
+    static void addHost(const char* name, IPAddress address);
+    static void addServer(IPAddress address, uint16_t port, HostServer* server);
+    static void setHostDown(IPAddress address, bool down);
+    static void setSntpAvailable(bool available);
+    static bool isSntpAvailable();
+    static void setConnectLatency(uint32_t millis);
+    static void setDnsLatency(uint32_t millis);
+    static void setJoinLatency(uint32_t millis);
+    static bool resolve(const char* name, IPAddress &address, uint32_t timeout);
+    static std::shared_ptr<HostConnection> connect(IPAddress address, uint16_t port, uint32_t timeout);
+    static bool hasAccessPoint(const char* ssid, int32_t* rssi = NULL);
+    static uint32_t getJoinLatency();
+    static uint32_t getConnectCount();
+    static uint32_t getFailedConnectCount();
+    static uint32_t getDnsLookupCount();
+    static uint64_t getBlockedMicros();
+  private:
+    struct AccessPoint {
+      std::string ssid;
+      int32_t rssi;
+    };
+    static std::vector<AccessPoint> _accessPoints;
+    static std::map<std::string, uint32_t> _hosts;
+    static std::map<uint64_t, HostServer*> _servers;
+    static std::map<uint32_t, bool> _downHosts;
+    static bool _wifiAvailable;
+    static bool _sntpAvailable;
+    static uint32_t _connectLatency;
+    static uint32_t _dnsLatency;
+    static uint32_t _joinLatency;
+    static uint32_t _connectCount;
+    static uint32_t _failedConnectCount;
+    static uint32_t _dnsLookupCount;
+    static uint64_t _blockedMicros;
+};
+
+class WiFiClient : public Stream {
+  public:
+    WiFiClient();
+    int connect(IPAddress address, uint16_t port);
+    int connect(const char* host, uint16_t port);
+    uint8_t connected();
+    void stop();
+    void setNoDelay(bool noDelay);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* buffer, size_t size);
+    using Print::write;
+    int availableForWrite();
+    int available();
+    int read();
+    int read(uint8_t* buffer, size_t size);
+    int peek();
+    void flush();
+    operator bool() { return connected(); }
+  private:
+    void deliver();
+    std::shared_ptr<HostConnection> _connection;
+};
+
+class ESP8266WiFiClass {
+  public:
+    ESP8266WiFiClass();
+    wl_status_t status();
+    wl_status_t begin(const char* ssid, const char* passphrase = NULL, int32_t channel = 0, const uint8_t* bssid = NULL, bool connect = true);
+    bool config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    bool disconnect(bool wifiOff = false);
+    void persistent(bool persistent) {}
+    bool setAutoReconnect(bool autoReconnect) { return true; }
+    uint8_t* BSSID();
+    int32_t channel();
+    int32_t RSSI();
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t index = 0);
+    int8_t scanNetworks(bool async = false, bool showHidden = false);
+    int8_t scanComplete();
+    void scanDelete();
+    String SSID(uint8_t index);
+    int32_t RSSI(uint8_t index);
+    uint8_t encryptionType(uint8_t index);
+    bool softAP(const char* ssid, const char* passphrase = NULL);
+    IPAddress softAPIP();
+    uint8_t softAPgetStationNum();
+    bool forceSleepBegin(uint32_t sleepMicros = 0);
+    bool forceSleepWake();
+    int hostByName(const char* host, IPAddress &address, uint32_t timeout = 10000);
+    // Host build only
+    bool isStaticAddress();
+    uint32_t getStaticJoinCount();
+    uint32_t getDhcpJoinCount();
+    void setStationCount(uint8_t count);
+  private:
+    std::string _ssid;
+    bool _joining;
+    bool _joined;
+    bool _sleeping;
+    bool _staticAddress;
+    IPAddress _localIp;
+    IPAddress _gateway;
+    IPAddress _subnetMask;
+    IPAddress _dns;
+    unsigned long _joinStartMillis;
+    uint8_t _bssid[6];
+    int32_t _channel;
+    bool _scanning;
+    unsigned long _scanStartMillis;
+    uint8_t _stationCount;
+    uint32_t _staticJoinCount;
+    uint32_t _dhcpJoinCount;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif
@@ -0,0 +1 @@
+#include "LittleFS.h"
@@ -0,0 +1,76 @@
+/*
+ * SHA-1 of the host build, same result as the one of the ESP8266 core
+ */
+#include "Hash.h"
+#include <string.h>
+
+static uint32_t RotateLeft(uint32_t value, int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+static void Sha1Block(uint32_t state[5], const uint8_t block[64]) {
+  uint32_t words[80];
+  for (int i = 0; i < 16; i++) {
+    words[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+  }
+  for (int i = 16; i < 80; i++) {
+    words[i] = RotateLeft(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+  for (int i = 0; i < 80; i++) {
+    uint32_t f, k;
+    if (i < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    }
+    else if (i < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    }
+    else if (i < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    }
+    else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+    uint32_t temp = RotateLeft(a, 5) + f + e + k + words[i];
+    e = d;
+    d = c;
+    c = RotateLeft(b, 30);
+    b = a;
+    a = temp;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+void sha1(const uint8_t* data, uint32_t size, uint8_t hash[20]) {
+  uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+  uint32_t position = 0;
+  for (; position + 64 <= size; position += 64) {
+    Sha1Block(state, &data[position]);
+  }
+  uint8_t block[128];
+  uint32_t remaining = size - position;
+  memcpy(block, &data[position], remaining);
+  block[remaining] = 0x80;
+  uint32_t blockLength = remaining + 9 <= 64 ? 64 : 128;
+  memset(&block[remaining + 1], 0, blockLength - remaining - 1);
+  uint64_t bits = (uint64_t)size * 8;
+  for (int i = 0; i < 8; i++) {
+    block[blockLength - 1 - i] = (uint8_t)(bits >> (i * 8));
+  }
+  Sha1Block(state, block);
+  if (blockLength == 128) {
+    Sha1Block(state, &block[64]);
+  }
+  for (int i = 0; i < 20; i++) {
+    hash[i] = (uint8_t)(state[i / 4] >> (24 - (i % 4) * 8));
+  }
+}
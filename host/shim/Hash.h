@@ -0,0 +1,8 @@
+#ifndef Hash_h
+#define Hash_h
+
+#include <stdint.h>
+
+void sha1(const uint8_t* data, uint32_t size, uint8_t hash[20]);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include "WString.h"
+
+/*
+ * IPv4 address, first byte in the lowest bits like on the ESP8266
+ */
+class IPAddress {
+  public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint32_t address) : _address(address) {}
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+      : _address((uint32_t)first | ((uint32_t)second << 8) | ((uint32_t)third << 16) | ((uint32_t)fourth << 24)) {}
+    operator uint32_t() const { return _address; }
+    uint8_t operator[](int index) const { return (_address >> (index * 8)) & 0xFF; }
+    bool isSet() const { return _address != 0; }
+    bool fromString(const char* text) {
+      unsigned int bytes[4];
+      char end;
+      if (sscanf(text, "%u.%u.%u.%u%c", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &end) != 4 ||
+          bytes[0] > 255 || bytes[1] > 255 || bytes[2] > 255 || bytes[3] > 255) {
+        return false;
+      }
+      *this = IPAddress(bytes[0], bytes[1], bytes[2], bytes[3]);
+      return true;
+    }
+    String toString() const {
+      char text[16];
+      snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+      return String(text);
+    }
+  private:
+    uint32_t _address;
+};
+
+#endif
@@ -0,0 +1,216 @@
+/*
+ * Host implementation of LittleFS, kept in memory
+ */
+#include "LittleFS.h"
+
+/*
+ * File
+ */
+File::File() {
+  _position = 0;
+  _readable = false;
+  _writable = false;
+  _append = false;
+}
+
+File::File(std::shared_ptr<std::vector<uint8_t> > content, bool readable, bool writable, bool append) {
+  _content = content;
+  _position = 0;
+  _readable = readable;
+  _writable = writable;
+  _append = append;
+}
+
+size_t File::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  HostHeapExclusion exclusion;
+  if (_content == NULL || !_writable || LittleFS.isWriteFailing()) {
+    return 0;
+  }
+  if (_append) {
+    _position = _content->size();
+  }
+  if (_position + size > _content->size()) {
+    _content->resize(_position + size);
+  }
+  memcpy(&(*_content)[_position], buffer, size);
+  _position += size;
+  LittleFS.countWrite(size);
+  return size;
+}
+
+int File::available() {
+  return _content == NULL || !_readable ? 0 : (int)(_content->size() - _position);
+}
+
+int File::read() {
+  uint8_t value;
+  return read(&value, 1) == 1 ? value : -1;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+  if (_content == NULL || !_readable || _position >= _content->size()) {
+    return 0;
+  }
+  if (size > _content->size() - _position) {
+    size = _content->size() - _position;
+  }
+  memcpy(buffer, &(*_content)[_position], size);
+  _position += size;
+  return size;
+}
+
+int File::peek() {
+  return _content == NULL || !_readable || _position >= _content->size() ? -1 : (*_content)[_position];
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+  if (_content == NULL) {
+    return false;
+  }
+  size_t base = mode == SeekSet ? 0 : mode == SeekCur ? _position : _content->size();
+  if (base + position > _content->size()) {
+    return false;
+  }
+  _position = base + position;
+  return true;
+}
+
+size_t File::position() {
+  return _position;
+}
+
+size_t File::size() {
+  return _content == NULL ? 0 : _content->size();
+}
+
+bool File::truncate(uint32_t size) {
+  HostHeapExclusion exclusion;
+  if (_content == NULL || !_writable) {
+    return false;
+  }
+  _content->resize(size);
+  return true;
+}
+
+void File::close() {
+  _content.reset();
+}
+
+/*
+ * FS
+ */
+FS::FS() {
+  _mountable = true;
+  _mounted = false;
+  _writesBeforeFailure = -1;
+  _renameFails = false;
+  _writtenBytes = 0;
+  _renameCount = 0;
+}
+
+bool FS::begin() {
+  _mounted = _mountable;
+  return _mounted;
+}
+
+void FS::end() {
+  _mounted = false;
+}
+
+bool FS::format() {
+  _files.clear();
+  _mountable = true;
+  return true;
+}
+
+File FS::open(const char* path, const char* mode) {
+  HostHeapExclusion exclusion;
+  if (!_mounted) {
+    return File();
+  }
+  bool readable = mode[0] == 'r' || mode[1] == '+';
+  bool writable = mode[0] != 'r' || mode[1] == '+';
+  std::map<std::string, std::shared_ptr<std::vector<uint8_t> > >::iterator file = _files.find(path);
+  if (file == _files.end()) {
+    if (mode[0] == 'r') {
+      return File();
+    }
+    file = _files.insert(std::make_pair(std::string(path), std::make_shared<std::vector<uint8_t> >())).first;
+  }
+  else if (mode[0] == 'w') {
+    file->second->clear();
+  }
+  return File(file->second, readable, writable, mode[0] == 'a');
+}
+
+bool FS::exists(const char* path) {
+  HostHeapExclusion exclusion;
+  return _mounted && _files.count(path) > 0;
+}
+
+bool FS::remove(const char* path) {
+  HostHeapExclusion exclusion;
+  return _mounted && _files.erase(path) > 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+  HostHeapExclusion exclusion;
+  _renameCount++;
+  std::map<std::string, std::shared_ptr<std::vector<uint8_t> > >::iterator file = _files.find(pathFrom);
+  if (!_mounted || _renameFails || file == _files.end()) {
+    return false;
+  }
+  std::shared_ptr<std::vector<uint8_t> > content = file->second;
+  _files.erase(file);
+  _files[pathTo] = content;
+  return true;
+}
+
+void FS::reset() {
+  _files.clear();
+  _mountable = true;
+  _mounted = false;
+  _writesBeforeFailure = -1;
+  _renameFails = false;
+}
+
+void FS::setMounted(bool mountable) {
+  _mountable = mountable;
+  _mounted = _mounted && mountable;
+}
+
+/*
+ * Writes fail once bytes more are written, -1 never fails
+ */
+void FS::failWritesAfter(long bytes) {
+  _writesBeforeFailure = bytes;
+}
+
+void FS::setRenameFails(bool fails) {
+  _renameFails = fails;
+}
+
+bool FS::isWriteFailing() {
+  return _writesBeforeFailure == 0;
+}
+
+void FS::countWrite(size_t bytes) {
+  _writtenBytes += bytes;
+  if (_writesBeforeFailure > 0) {
+    _writesBeforeFailure = (long)bytes >= _writesBeforeFailure ? 0 : _writesBeforeFailure - bytes;
+  }
+}
+
+uint64_t FS::getWrittenBytes() {
+  return _writtenBytes;
+}
+
+uint32_t FS::getRenameCount() {
+  return _renameCount;
+}
+
+FS LittleFS;
@@ -0,0 +1,77 @@
+#ifndef LittleFS_h
+#define LittleFS_h
+
+/*
+ * File system of the host build, kept in memory. Writes and renames can be made to fail
+ * to exercise the recovery paths
+ */
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+enum SeekMode {
+  SeekSet = 0,
+  SeekCur = 1,
+  SeekEnd = 2
+};
+
+class File : public Stream {
+  public:
+    File();
+    File(std::shared_ptr<std::vector<uint8_t> > content, bool readable, bool writable, bool append);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* buffer, size_t size);
+    using Print::write;
+    int available();
+    int read();
+    size_t read(uint8_t* buffer, size_t size);
+    int peek();
+    void flush() {}
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position();
+    size_t size();
+    bool truncate(uint32_t size);
+    void close();
+    operator bool() const { return _content != NULL; }
+  private:
+    std::shared_ptr<std::vector<uint8_t> > _content;
+    size_t _position;
+    bool _readable;
+    bool _writable;
+    bool _append;
+};
+
+class FS {
+  public:
+    FS();
+    bool begin();
+    void end();
+    bool format();
+    File open(const char* path, const char* mode);
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* pathFrom, const char* pathTo);
+    // Host build only
+    void reset();
+    void setMounted(bool mountable);
+    void failWritesAfter(long bytes);
+    void setRenameFails(bool fails);
+    bool isWriteFailing();
+    void countWrite(size_t bytes);
+    uint64_t getWrittenBytes();
+    uint32_t getRenameCount();
+  private:
+    std::map<std::string, std::shared_ptr<std::vector<uint8_t> > > _files;
+    bool _mountable;
+    bool _mounted;
+    long _writesBeforeFailure;
+    bool _renameFails;
+    uint64_t _writtenBytes;
+    uint32_t _renameCount;
+};
+
+extern FS LittleFS;
+
+#endif
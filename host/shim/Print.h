@@ -0,0 +1,37 @@
+#ifndef Print_h
+#define Print_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "WString.h"
+
+/*
+ * Arduino Print of the host build, with the overloads the bridge uses
+ */
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t data) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* text) { return text == NULL ? 0 : write((const uint8_t*)text, strlen(text)); }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+    size_t print(const char* text) { return write(text); }
+    size_t print(const String &text) { return write((const uint8_t*)text.c_str(), text.length()); }
+    size_t print(char character) { return write((uint8_t)character); }
+    size_t print(unsigned char value, int base = 10) { return print((unsigned long long)value, base); }
+    size_t print(int value, int base = 10) { return print((long long)value, base); }
+    size_t print(unsigned int value, int base = 10) { return print((unsigned long long)value, base); }
+    size_t print(long value, int base = 10) { return print((long long)value, base); }
+    size_t print(unsigned long value, int base = 10) { return print((unsigned long long)value, base); }
+    size_t print(long long value, int base = 10);
+    size_t print(unsigned long long value, int base = 10);
+    size_t print(double value, int digits = 2);
+    size_t println() { return write("\r\n"); }
+    template<typename Value> size_t println(const Value &value) { size_t written = print(value); return written + println(); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef SoftwareSerial_h
+#define SoftwareSerial_h
+
+#include "Arduino.h"
+
+/*
+ * Second serial port of the host build, fed like Serial
+ */
+class SoftwareSerial : public HostSerialPort {
+  public:
+    SoftwareSerial(int receivePin, int transmitPin) {}
+};
+
+#endif
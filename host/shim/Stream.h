@@ -0,0 +1,24 @@
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+/*
+ * Arduino Stream of the host build. readBytes waits for the timeout like the real one, on the host clock
+ */
+class Stream : public Print {
+  public:
+    Stream() : _timeout(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout() { return _timeout; }
+    virtual size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+  protected:
+    int timedRead();
+    unsigned long _timeout;
+};
+
+#endif
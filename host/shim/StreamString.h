@@ -0,0 +1,26 @@
+#ifndef StreamString_h
+#define StreamString_h
+
+#include "Arduino.h"
+
+/*
+ * String which can be printed to and read from
+ */
+class StreamString : public String, public Stream {
+  public:
+    size_t write(uint8_t data) { _text += (char)data; return 1; }
+    size_t write(const uint8_t* buffer, size_t size) { _text.append((const char*)buffer, size); return size; }
+    using Print::write;
+    int available() { return _text.length(); }
+    int read() {
+      if (_text.empty()) {
+        return -1;
+      }
+      uint8_t data = _text[0];
+      _text.erase(0, 1);
+      return data;
+    }
+    int peek() { return _text.empty() ? -1 : (uint8_t)_text[0]; }
+};
+
+#endif
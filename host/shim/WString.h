@@ -0,0 +1,55 @@
+#ifndef WString_h
+#define WString_h
+
+#include <stddef.h>
+#include <string>
+
+/*
+ * Arduino String of the host build. Like the real one it keeps its text on the heap
+ */
+class String {
+  public:
+    String() {}
+    String(const char* text) : _text(text != NULL ? text : "") {}
+    String(const std::string &text) : _text(text) {}
+    String(char character) : _text(1, character) {}
+    String(int value) : _text(std::to_string(value)) {}
+    String(unsigned int value) : _text(std::to_string(value)) {}
+    String(long value) : _text(std::to_string(value)) {}
+    String(unsigned long value) : _text(std::to_string(value)) {}
+    const char* c_str() const { return _text.c_str(); }
+    unsigned int length() const { return _text.length(); }
+    char charAt(unsigned int index) const { return index < _text.length() ? _text[index] : '\0'; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    bool startsWith(const String &prefix) const { return _text.compare(0, prefix._text.length(), prefix._text) == 0; }
+    bool endsWith(const String &suffix) const {
+      return _text.length() >= suffix._text.length() &&
+             _text.compare(_text.length() - suffix._text.length(), suffix._text.length(), suffix._text) == 0;
+    }
+    int indexOf(char character) const { size_t found = _text.find(character); return found == std::string::npos ? -1 : (int)found; }
+    String substring(unsigned int from) const { return from < _text.length() ? String(_text.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const { return from < _text.length() && from < to ? String(_text.substr(from, to - from)) : String(); }
+    void toCharArray(char* buffer, unsigned int size) const {
+      if (size == 0) {
+        return;
+      }
+      size_t length = _text.copy(buffer, size - 1);
+      buffer[length] = '\0';
+    }
+    int toInt() const { return atoi(_text.c_str()); }
+    bool concat(const char* text, size_t length) { _text.append(text, length); return true; }
+    String &operator+=(const String &text) { _text += text._text; return *this; }
+    String &operator+=(const char* text) { _text += text; return *this; }
+    String &operator+=(char character) { _text += character; return *this; }
+    bool operator==(const String &text) const { return _text == text._text; }
+    bool operator==(const char* text) const { return _text == (text != NULL ? text : ""); }
+    bool operator!=(const String &text) const { return !(*this == text); }
+    bool operator!=(const char* text) const { return !(*this == text); }
+    friend String operator+(const String &left, const String &right) { return String(left._text + right._text); }
+    friend String operator+(const String &left, const char* right) { return String(left._text + right); }
+    friend String operator+(const char* left, const String &right) { return String(left + right._text); }
+  protected:
+    std::string _text;
+};
+
+#endif
@@ -11,31 +11,80 @@ function OpenSSIDPopup(ssid)
 	popup.style.opacity = 1;
 }
 
+function SendConfig(changes, onSaved) {
+	var xhttp = new XMLHttpRequest();
+	xhttp.open("POST", "api/config", true);
+	xhttp.setRequestHeader("Content-Type", "application/json");
+	xhttp.onreadystatechange = function () {
+		if(xhttp.readyState === XMLHttpRequest.DONE){
+			var response = xhttp.responseText ? JSON.parse(xhttp.responseText) : {error: "No answer"};
+			if (xhttp.status === 200) {
+				RenderConfiguredWifi(response.wifi);
+				if (onSaved) {
+					onSaved(response);
+				}
+			}
+			else {
+				alert("Not saved: " + response.error);
+			}
+		};
+	};
+	xhttp.send(JSON.stringify(changes));
+}
+
 function SaveTransmitterId() {
-	document.location.href='/savetransmitterid?TransmitterId=' + document.getElementById("TransmitterId").value;
+	var changes = {transmitterId: document.getElementById("txtTransmitterId").value};
+	for (var port = 2; document.getElementById("txtTransmitterId" + port); port++) {
+		changes["transmitterId" + port] = document.getElementById("txtTransmitterId" + port).value;
+	}
+	SendConfig(changes, function (config) {
+		alert("Dexcom ID saved");
+	});
 }
 
 function SaveAppEngineAddress() {
-	document.location.href='/saveappengineaddress?Address=' + document.getElementById("txtAppEngineAddress").value;
+	SendConfig({appEngineAddress: document.getElementById("txtAppEngineAddress").value}, function (config) {
+		alert("App Engine address saved");
+	});
+}
+
+function SaveNightscoutConfig() {
+	var changes = {nightscoutAddress: document.getElementById("txtNightscoutAddress").value};
+	var secret = document.getElementById("txtNightscoutSecret").value;
+	if (secret) {
+		changes.nightscoutSecret = secret;
+	}
+	SendConfig(changes, function (config) {
+		alert("Nightscout configuration saved");
+	});
+}
+
+function SaveLocalAddress() {
+	SendConfig({localAddress: document.getElementById("txtLocalAddress").value}, function (config) {
+		alert("Local receiver address saved");
+	});
 }
 
 function SaveHotSpotConfig() {
 	var hotspotName = document.getElementById("txtHotSpotName").value;
 	var hotspotPassword = document.getElementById("txtHotSpotPassword").value;
-	document.location.href='/savehotspotconfig?name=' + hotspotName + '&pass=' + hotspotPassword;
+	SendConfig({hotSpotName: hotspotName, hotSpotPassword: hotspotPassword}, function (config) {
+		alert("Hot spot saved, it restarts now");
+	});
 }
 
 function SaveDebugConfig() {
-	var debugEnabled = document.getElementById("chkDebug").checked ? "1" : "0";
+	var debugEnabled = document.getElementById("chkDebug").checked;
 	var debugAddress = document.getElementById("txtDebugAddress").value;
-	document.location.href='/savedebugconfig?enabled=' + debugEnabled + '&ip=' + debugAddress;
+	SendConfig({debug: debugEnabled, debugAddress: debugAddress}, function (config) {
+		alert("Debug configuration saved");
+	});
 }
 
 function SaveSSID() {
 	var ssid_name = document.getElementById("ssid_name");
 	var ssid_password = document.getElementById("ssid_password");
-	var frmSaveSSID = document.getElementById("frmSaveSSID");
-	frmSaveSSID.submit();
+	SendConfig({addSsid: ssid_name.value, addSsidPassword: ssid_password.value}, ClosePopup);
 }
 
 function ClosePopup() {
@@ -47,8 +96,38 @@ function ClosePopup() {
 function RemoveSSID(ssid)
 {
 	if (confirm("Do you really want to remove " + ssid)) {
-		document.location.href='remove?ssid=' + ssid;
+		SendConfig({removeSsid: ssid});
+	}
+}
+
+function RenderConfiguredWifi(wifi) {
+	var divConfiguredWifi = document.getElementById("configuredWifi");
+	if (wifi.length == 0) {
+		divConfiguredWifi.innerHTML = "No Wifi configured";
+		return;
 	}
+	var table = document.createElement("table");
+	table.innerHTML = "<tr><th align=\"left\">SSID</th><th></th></tr>";
+	for (var i = 0; i < wifi.length; i++) {
+		var row = table.insertRow(-1);
+		row.insertCell(-1).textContent = wifi[i];
+		var buttonCell = row.insertCell(-1);
+		buttonCell.align = "right";
+		var test = document.createElement("a");
+		test.className = "button";
+		test.href = "javascript:void(0)";
+		test.textContent = "Test";
+		test.onclick = TestSSID.bind(null, wifi[i]);
+		buttonCell.appendChild(test);
+		var remove = document.createElement("a");
+		remove.className = "button";
+		remove.href = "javascript:void(0)";
+		remove.textContent = "Delete";
+		remove.onclick = RemoveSSID.bind(null, wifi[i]);
+		buttonCell.appendChild(remove);
+	}
+	divConfiguredWifi.innerHTML = "";
+	divConfiguredWifi.appendChild(table);
 }
 
 function TestSSID(ssid) {
@@ -65,15 +144,60 @@ function TestSSID(ssid) {
 
 
 function ScanWifi() {
+	var divScannedWifi = document.getElementById("scannedWifi");
 	var xhttp = new XMLHttpRequest();
-	xhttp.open("GET", "scanwifi", true);
+	xhttp.open("GET", "api/scan", true);
 	xhttp.onreadystatechange = function () {
 		if(xhttp.readyState === XMLHttpRequest.DONE && xhttp.status === 200){
-			var divScannedWifi = document.getElementById("scannedWifi");
-			divScannedWifi.innerHTML = xhttp.responseText;
+			var scan = JSON.parse(xhttp.responseText);
+			if (scan.scanning && scan.networks.length == 0) {
+				divScannedWifi.innerHTML = "Scanning...";
+			}
+			else {
+				RenderScannedWifi(divScannedWifi, scan.networks);
+			}
+			if (scan.scanning) {
+				// Results are ready in a few seconds
+				setTimeout(ScanWifi, 1000);
+			}
 		};
 	};
 	xhttp.send();
 	location.hash = "#scannedWifi";
-	
+}
+
+function RenderScannedWifi(divScannedWifi, networks) {
+	if (networks.length == 0) {
+		divScannedWifi.innerHTML = "No network found...";
+		return;
+	}
+	var bars = ["first-bar", "second-bar", "third-bar", "fourth-bar", "fifth-bar"];
+	var table = document.createElement("table");
+	table.innerHTML = "<tr><th align=\"left\">SSID</th><th></th><th></th></tr>";
+	for (var i = 0; i < networks.length; i++) {
+		// [ssid, rssi, secure]
+		var ssid = networks[i][0];
+		var rssi = networks[i][1];
+		var barClass = rssi > -60 ? "good five-bars" : rssi > -70 ? "good four-bars" : rssi > -80 ? "ok three-bars" : rssi > -90 ? "bad two-bars" : "bad one-bar";
+		var row = table.insertRow(-1);
+		row.insertCell(-1).textContent = ssid + (networks[i][2] ? "*" : "");
+		var signal = document.createElement("div");
+		signal.className = "signal-bars mt1 sizing-box " + barClass;
+		for (var j = 0; j < bars.length; j++) {
+			var bar = document.createElement("div");
+			bar.className = bars[j] + " bar";
+			signal.appendChild(bar);
+		}
+		row.insertCell(-1).appendChild(signal);
+		var addCell = row.insertCell(-1);
+		addCell.align = "right";
+		var add = document.createElement("a");
+		add.className = "button";
+		add.href = "javascript:void(0)";
+		add.textContent = "Add";
+		add.onclick = OpenSSIDPopup.bind(null, ssid);
+		addCell.appendChild(add);
+	}
+	divScannedWifi.innerHTML = "";
+	divScannedWifi.appendChild(table);
 }
@@ -5,7 +5,7 @@
  * ---------------------------------------------
  * 
  * This software take the place of the "Bluetooth" portion of the xBridge2 system and
- * send all data by wifi to an AppEngine server like Parakeet does.
+ * send all data by wifi to an AppEngine server like Parakeet does, to Nightscout and to a receiver on the local network.
  * 
  * The Wixel won't even tell the difference between communicating with the HM-10 
  * Bluetooth module or this code which allow "Wifi" transmission.
@@ -19,6 +19,8 @@
  * or activate a cellphone plan while they are 90% of the time within wifi coverage. 
  * (I actually have two T1D kids so having TWO cellphone data plans make it expensive 
  * for the low amount of data needed. I intend to allow 3G connexion as a backup.
+ * One bridge serves WIXEL_PORT_COUNT Wixels: the first one on the hardware Serial and the
+ * next ones on SoftwareSerial, each one with its own transmitter ID and reading queue.
  * 
  * The xBridge2 is available at the following address:
  * https://github.com/jstevensog/wixel-sdk/tree/master/apps/xBridge2
@@ -43,27 +45,34 @@
 #include <SoftwareSerial.h>
 #include <ESP8266WiFi.h>
 #include "WebServer.h"
-#include <ESP8266WiFiMulti.h>
 #include <ESP8266WebServer.h>
 #include "Configuration.h"
 #include "DexcomHelper.h"
+#include "Profiler.h"
+#include "Metrics.h"
+#include "WixelProtocol.h"
+#include "WixelPort.h"
+#if WIXEL_SIMULATOR_PERIOD > 0
+#include "WixelSimulator.h"
+#endif
+#include "Uploader.h"
+#include "DebugLogger.h"
+#include "WifiManager.h"
+#include "RadioScheduler.h"
 
 /*
- * FUNCTION PROTOTYPES (Needed since ESP8266WiFiMulti.h was included...)
+ * FUNCTION PROTOTYPES
  */
-void StartWifiConnection();
-void OpenDebugConnection();
 void SendDebugText(String debugText);
 void SendDebugText(char debugText);
 void SendDebugText(char* debugText);
 void SendDebugText(uint32_t debugText);
 void SendDebugText(int debugText);
-void ManageConnectionStarted(int receivedValue);
-void ProcessWixelMessage(unsigned char* message);
-void SendMessage(unsigned int messageId);
-void SendMessage(unsigned int messageId, uint32_t messageContent);
-void SendMessage(unsigned int messageId, char* messageContent);
-void Sleep(int waitMillis);
+bool IsWixelDataAvailable();
+void ManageConnectionStarted();
+void ProcessWixelMessage(WixelPort &port, const unsigned char* message, unsigned int messageLength);
+void SendMessage(WixelPort &port, uint8_t messageId);
+void SendTransmitterId(WixelPort &port, uint32_t transmitterId);
 
 /*
  * Wixel Configuration
@@ -74,86 +83,21 @@ const String COMMUNICATION_STARTED_STRING = "AT+RESET";
  * Wifi Configuration
  */
 
-const char* DEBUG_HOST = "192.168.0.192";
-const int DEBUG_PORT = 8001;
-
-WiFiClient _debugClient;
-
-
-/*
- * Protocol descriptions:
-Data Packet - Bridge to App.  Sends the Dexcom transmitter data, and the bridge battery volts.
-  0x11  - length of packet.
-  0x00  - Packet type (00 means data packet)
-  uint32  - Dexcom Raw value.
-  uint32  - Dexcom Filtered value.
-  uint8 - Dexcom battery value.
-  uint16  - Bridge battery value.
-  uint32  - Dexcom encoded TXID the bridge is filtering on.
-  
-Data Acknowledge Packet - App to Bridge.  Sends an ack of the Data Packet and tells the wixel to go to sleep.
-  0x02  - length of packet.
-  0xF0  - Packet type (F0 means acknowleged, go to sleep)
-  
-TXID packet - App to Bridge.  Sends the TXID the App wants the bridge to filter on.  In response to a Data packet or beacon packet being wrong.
-  0x06  - Length of the packet.
-  0x01  - Packet Type (01 means TXID packet).
-  uint32  - Dexcom encoded TXID.
-  
-Beacon Packet - Bridge to App.  Sends the TXID it is filtering on to the app, so it can set it if it is wrong.
-                Sent when the wixel wakes up, or as acknowledgement of a TXID packet.
-  0x06  - Length of the packet.
-  0xF1  - Packet type (F1 means Beacon or TXID acknowledge)
-  uint32  - Dexcom encoded TXID.
- */
-// All RX Message (From Wixel)
-#define WIXEL_COMM_RX_DATA_PACKET 0x00 // The Wixel send this message when it receive Dexcom packet
-#define WIXEL_COMM_RX_SEND_BEACON 0xF1 // The Wixel send this message when it wants to know if the Transmitter ID is ok
-
-// All TX Message (To Wixel)
-#define WIXEL_COMM_TX_ACKNOWLEDGE_DATA_PACKET 0xF0 // This message send and acknowledge packet to allow Wixel to go in sleep mode
-#define WIXEL_COMM_TX_SEND_TRANSMITTER_ID 0x01 // This message send the Transmitter ID to the Wixel
-#define WIXEL_COMM_TX_SEND_DEBUG 0x64 // This message ask the Wixel to flip the Debug flag ON or OFF
-#define WIXEL_COMM_TX_SLEEP_BLE 0x42 // This message ask the Wixel to flip the BLE Sleeping flag ON or OFF
-#define WIXEL_COMM_TX_DO_LED 0x4C // This message ask the Wixel to flip the Led Sleeping flag ON or OFF
-
-#define DEXBRIDGE_PROTO_LEVEL 0x01
-
-
-#define HTTP_PORT 80
-typedef struct Dexcom_Packet_Struct
-{
-  uint8_t len;
-  uint32_t  dest_addr;
-  uint32_t  src_addr;
-  uint8_t port;
-  uint8_t device_info;
-  uint8_t txId;
-  uint16_t  raw;
-  uint16_t  filtered;
-  uint8_t battery;
-  uint8_t unknown;
-  uint8_t checksum;
-  int8_t  RSSI;
-  uint8_t LQI;
-} Dexcom_packet;
-
-// structure of a raw record we receive from the Wixel.
-typedef struct Wixel_RawRecord_Struct
-{
-  uint32_t  raw;  //"raw" BGL value.
-  uint32_t  filtered; //"filtered" BGL value 
-  uint8_t dex_battery;  //battery value
-  uint8_t my_battery; //xBridge battery value
-  uint32_t  dex_src_id;   //raw TXID of the Dexcom Transmitter
-  //int8  RSSI; //RSSI level of the transmitter, used to determine if it is in range.
-  //uint8 txid; //ID of this transmission.  Essentially a sequence from 0-63
-  uint8_t function; // Byte representing the xBridge code funcitonality.  01 = this level.
-} RawRecord;
-
-int _messageLength = 0;
-int _messagePosition = 0;
-unsigned char* _message;
+DebugLogger _debugLogger;
+WifiManager _wifiManager;
+RadioScheduler _radioScheduler;
+
+WixelPort _wixelPorts[WIXEL_PORT_COUNT];
+// Each Wixel after the first one needs its own SoftwareSerial, given to its port in setup
+static_assert(WIXEL_PORT_COUNT == 2, "One SoftwareSerial is declared for the second Wixel");
+SoftwareSerial _secondWixelSerial(WIXEL_PORT_2_RX_PIN, WIXEL_PORT_2_TX_PIN);
+#if WIXEL_SIMULATOR_PERIOD > 0
+// Takes the place of the second Wixel when the build sets WIXEL_SIMULATOR_PERIOD, to load test the bridge
+WixelSimulator _wixelSimulator;
+#endif
+// Port serviced first at the next call of ManageConnectionStarted
+uint8_t _nextWixelPort = 0;
+Uploader _uploader;
 
 WebServer _webServer;
 Configuration _configuration;
@@ -166,121 +110,49 @@ DexcomHelper _dexcomHelper;
 void setup() {
   // Open serial communications
   Serial.begin(9600);
-  EEPROM.begin(4096); // Use maximum allowed size
+  // Configuration and queued readings are saved on the file system
+  if (!LittleFS.begin()) {
+    LittleFS.format();
+    LittleFS.begin();
+  }
   /*while (!Serial) {
     ; // wait for serial port to connect. Needed for native USB port only
   }*/
-  //String.toCharArray(_configuration.getAppEngineAddress(), 
-  _webServer.setConfiguration(_configuration);
+  _configuration.begin();
+  _webServer.setConfiguration(&_configuration);
+  _debugLogger.setConfiguration(&_configuration);
+  _wifiManager.setConfiguration(&_configuration);
+  _webServer.setWifiManager(&_wifiManager);
+  _radioScheduler.setWifiManager(&_wifiManager);
+  _webServer.setRadioScheduler(&_radioScheduler);
   _webServer.start();
-  StartWifiConnection();
+  _wixelPorts[0].begin(0, &Serial);
+#if WIXEL_SIMULATOR_PERIOD > 0
+  // Load test build, see WixelSimulator.h
+  WixelScenario scenario;
+  scenario.transmitterId = _configuration.getTransmitterId(1);
+  _wixelSimulator.begin(scenario);
+  _wixelPorts[1].begin(1, &_wixelSimulator);
+#else
+  _secondWixelSerial.begin(9600);
+  _wixelPorts[1].begin(1, &_secondWixelSerial);
+#endif
+  _uploader.setConfiguration(&_configuration);
+  for (uint8_t i = 0; i < WIXEL_PORT_COUNT; i++) {
+    _uploader.addReadingQueue(_wixelPorts[i].getReadingQueue());
+  }
+  _uploader.setWifiManager(&_wifiManager);
+  _uploader.setDebugLogger(&_debugLogger);
+  _uploader.begin();
+  _webServer.setUploader(&_uploader);
+  // Joins the saved wifi in the background
+  _wifiManager.begin();
   if (_configuration.getIsDebug())
   {
-    OpenDebugConnection();
     SendDebugText("wifi-xBridge Started!\r\nDebugging mode ON\r\n");
   }
 }
 
-/*
- * StartWifiConnection
- * -------------------
- * This method starts the Wifi Connection
- * Todo: This should use a dynamic list of wifi
- */
-void StartWifiConnection(){
-  
-  ESP8266WiFiMulti wifiMulti;
-  //Serial.write("StartWifiConnection");
-  // Open WiFi connection
-  if (_configuration.getWifiCount() > 0)
-  {
-    //Serial.print(_configuration.getWifiCount());
-    //Serial.print("WiFi found\r\n");
-    for(int i = 0 ; i < _configuration.getWifiCount(); i++)
-    {
-      WifiData* data = _configuration.getWifiData(i);
-      int ssidLength = data->ssid.length() + 1;
-      int passwordLength = data->password.length() + 1;
-      char ssidChars[ssidLength + 1];
-      char passwordChars[passwordLength + 1];
-      /*Serial.print(_configuration.getWifiCount());
-      Serial.print("Adding Wifi:\r\n");
-      Serial.print(data->ssid);
-      Serial.print("|");
-      Serial.print(data->password);
-      Serial.print("\r\n");*/
-      data->ssid.toCharArray(ssidChars, ssidLength);
-      data->password.toCharArray(passwordChars, passwordLength);
-      wifiMulti.addAP(ssidChars, passwordChars);
-    }
-    int connectionTry = 0;
-    //Serial.print("Trying to connect");
-    
-    while (WiFi.status() != WL_CONNECTED && connectionTry < 120) {
-      connectionTry++;
-      if(wifiMulti.run() == WL_CONNECTED) {
-        //Serial.print("Connected\r\n");
-      }
-      else
-      {
-        //Serial.print("Failed\r\n");
-        if (connectionTry % 5 == 0)
-        {
-          //Serial.print("Not connected :(\r\n");
-        }
-        //Serial.print("Server Loop\r\n");
-        Sleep(500);
-      }
-    }
-  }
-}
-
-void Sleep(int waitMillis)
-{
-  int startMillis = millis();
-  while (millis() < waitMillis + startMillis)
-  {
-    // Still use webserver loop
-    _webServer.loop();
-  }
-  
-}
-
-/*
- * StopWifiConnection
- * ------------------
- * This method should stop the wifi connection
- */
-void StopWifiConnection() {
-  WiFi.disconnect(true);
-}
-
-/*
- * Function: OpenDebugConnection
- * -----------------------------
- * This method will open the connection with a dummy debug server
- */
-void OpenDebugConnection(){
-  if (WiFi.status() == WL_CONNECTED && _debugClient.status() == CLOSED)
-  {
-    // Open DEBUG connection
-    
-    _debugClient.connect(DEBUG_HOST, DEBUG_PORT);
-  }
-}
-
-/*
- * Function: CloseDebugConnection
- * ------------------------------
- * This method will close the connection with the debug server
- */
-void CloseDebugConnection() {
-  SendDebugText("Closing connection. Bye!\r\n");
-  // Close DEBUG connection
-  _debugClient.stop();
-}
-
-
 /*
  * Function: loop
  * --------------
@@ -288,23 +160,18 @@ void CloseDebugConnection() {
  */
 void loop() {
   _webServer.loop();
-  // Check is there is data on RX port from Wixel
-  while (Serial.available() > 0) {
-    int receivedValue = Serial.read();
-    // Display data for debugging
-    if (_configuration.getIsDebug()) {
-      SendDebugText("Received: ");
-    
-      char parsedText[5];
-      _dexcomHelper.IntToCharArray(receivedValue, parsedText);
-      SendDebugText(parsedText);
-      SendDebugText(" (");
-      SendDebugText(char(receivedValue));
-      SendDebugText(")");
-      SendDebugText("\r\n");
-    }
-    ManageConnectionStarted(receivedValue);
+  _configuration.loop();
+  _wifiManager.loop();
+  // Check is there is data on the RX port of a Wixel
+  if (IsWixelDataAvailable()) {
+    ManageConnectionStarted();
   }
+  // Upload new readings to every destination and backfill the readings missed while out of wifi coverage
+  _uploader.loop();
+  // Send the buffered debug text
+  _debugLogger.loop();
+  // Turn the radio off until the next reading once everything is uploaded
+  _radioScheduler.loop(_uploader.size() > 0 || _uploader.isBusy() || _configuration.getIsDebug());
 
   // If there is data comming from Serial port, send it back to the Wixel (For debugging purpose)
   /*while (Serial.available() > 0) {
@@ -318,119 +185,116 @@ void loop() {
 /*
  * Function SendDebugText
  * ----------------------
- * This method is used to send DEBUG text by Wifi or Serial
+ * This method is used to send DEBUG text by Wifi. The text is buffered and sent from the main loop
  * debugText: The text to be sent
  */
 void SendDebugText(String debugText){
-  if (_configuration.getIsDebug()) {
-    OpenDebugConnection();
-    if (WiFi.status() == WL_CONNECTED) {
-      _debugClient.print(debugText);
-    }
-    //Serial.print(debugText);
-    CloseDebugConnection();
+  if (_debugLogger.isEnabled()) {
+    _debugLogger.print(debugText);
   }
 }
 
 /*
  * Function SendDebugText
  * ----------------------
- * This method is used to send DEBUG text by Wifi or Serial
+ * This method is used to send DEBUG text by Wifi. The text is buffered and sent from the main loop
  * debugText: The text to be sent
  */
 void SendDebugText(char debugText){
-  if (_configuration.getIsDebug()) {
-    OpenDebugConnection();
-    if (WiFi.status() == WL_CONNECTED) {
-      _debugClient.print(debugText);
-    }
-    //Serial.write(debugText);
+  if (_debugLogger.isEnabled()) {
+    _debugLogger.print(debugText);
   }
 }
 
 /*
  * Function SendDebugText
  * ----------------------
- * This method is used to send DEBUG text by Wifi or Serial
+ * This method is used to send DEBUG text by Wifi. The text is buffered and sent from the main loop
  * debugText: The text to be sent
  */
 void SendDebugText(char* debugText){
-  if (_configuration.getIsDebug()) {
-    OpenDebugConnection();
-    if (WiFi.status() == WL_CONNECTED) {
-      _debugClient.print(debugText);
-    }
-    //Serial.write(debugText);
+  if (_debugLogger.isEnabled()) {
+    _debugLogger.print(debugText);
   }
 }
 
 void SendDebugText(uint32_t debugText){
-  if (_configuration.getIsDebug()) {
-    OpenDebugConnection();
-    if (WiFi.status() == WL_CONNECTED) {
-      _debugClient.print(debugText);
-    }
-    //Serial.write(debugText);
+  if (_debugLogger.isEnabled()) {
+    _debugLogger.print(debugText);
   }
 }
 
 void SendDebugText(int debugText){
-  if (_configuration.getIsDebug()) {
-    OpenDebugConnection();
-    if (WiFi.status() == WL_CONNECTED) {
-      _debugClient.print(debugText);
-    }
-    //Serial.write(debugText);
+  if (_debugLogger.isEnabled()) {
+    _debugLogger.print(debugText);
   }
 }
 
-long timeElapsedLastReception;
-// delay in milliseconds for maximum time between reception of message
-unsigned int maxIntervalBetweenReception = 2000;
+/*
+ * Function: IsWixelDataAvailable
+ * ------------------------------
+ * returns: true if bytes are waiting on the serial port of at least one Wixel
+ */
+bool IsWixelDataAvailable() {
+  for (uint8_t i = 0; i < WIXEL_PORT_COUNT; i++) {
+    if (_wixelPorts[i].isDataAvailable()) {
+      return true;
+    }
+  }
+  return false;
+}
 
 /*
  * Function: ManageConnectionStarted
  * ---------------------------------
- * We just received a byte from the Wixel and the real communication is already started
- * 
- * receivedValue: The value we just received on Serial Port
+ * We just received bytes from a Wixel and the real communication is already started.
+ * Every complete frame available is processed, one frame per Wixel in turn so a Wixel sending
+ * a lot of frames never delays the ACK of another one. The first Wixel serviced changes at each call
 */
-void ManageConnectionStarted(int receivedValue) {
-  long currentTimeElapsed = millis();
-  if (currentTimeElapsed > timeElapsedLastReception + maxIntervalBetweenReception) 
-  {
-    // Reset message reception
-    _messageLength = 0;
-    _messagePosition = 0;
-  }
-  if (_messageLength <= 0) {
-    if (receivedValue == 0) // 0 length message...impossible skip
-    {
-      return;
-    }
-    // First byte is to determine the message length
-    _messageLength = receivedValue;
-    _message = new unsigned char[_messageLength];
-    _messagePosition = 0;
-  }
-  _message[_messagePosition] = receivedValue;
-  _messagePosition++;
-  if (_messagePosition == _messageLength)
-  {
-    if (_configuration.getIsDebug()) {
-      // We have a complete messsage to process
-      SendDebugText("Looks like we have a full message to process! (");
-      char textNbChar [5];
-      _dexcomHelper.IntToCharArray((int)_message[0], textNbChar);
-      SendDebugText(textNbChar);
-      SendDebugText(" characters) \r\n");
+void ManageConnectionStarted() {
+  ProfilerScope profile(PROFILE_MANAGE_CONNECTION_STARTED);
+  MetricsScope metrics(METRIC_MANAGE_CONNECTION_STARTED);
+  uint8_t firstPort = _nextWixelPort;
+  _nextWixelPort = (_nextWixelPort + 1) % WIXEL_PORT_COUNT;
+  bool frameRead = true;
+  while (frameRead) {
+    frameRead = false;
+    for (uint8_t i = 0; i < WIXEL_PORT_COUNT; i++) {
+      WixelPort &port = _wixelPorts[(firstPort + i) % WIXEL_PORT_COUNT];
+      if (!port.readFrame()) {
+        continue;
+      }
+      frameRead = true;
+      const unsigned char* message = port.getFrame();
+      unsigned int messageLength = port.getFrameLength();
+      // The Wixel is waiting for the ACK to sleep, nothing else is done before
+      bool acknowledged = port.acknowledgeDataPacket();
+      Metrics::count(METRIC_FRAMES);
+      if (_configuration.getIsDebug()) {
+        // We have a complete messsage to process
+        SendDebugText("Looks like we have a full message to process from Wixel ");
+        SendDebugText((int)port.getNumber() + 1);
+        SendDebugText("! (");
+        char textNbChar [5];
+        _dexcomHelper.IntToCharArray(messageLength, textNbChar);
+        SendDebugText(textNbChar);
+        SendDebugText(" characters) \r\nReceived:");
+        for (unsigned int position = 0; position < messageLength; position++) {
+          SendDebugText(" ");
+          _dexcomHelper.IntToCharArray(message[position], textNbChar);
+          SendDebugText(textNbChar);
+        }
+        SendDebugText("\r\n");
+        if (acknowledged) {
+          SendDebugText("ACK sent in ");
+          SendDebugText((uint32_t)port.getAckDelay());
+          SendDebugText(" us\r\n");
+        }
+      }
+      // Process message
+      ProcessWixelMessage(port, message, messageLength);
     }
-    // Process message
-    ProcessWixelMessage(_message);
-    // Reset message vars
-    _messageLength = 0;
   }
-  timeElapsedLastReception = currentTimeElapsed;
 }
 
 /*
@@ -450,150 +314,65 @@ uint32_t CharArrayToInt32(char* array)
 }
 
 
-long lastTransmission;
-/*
- * Function: SendAppEngineData
- * ---------------------------
- * This function will send the Wixel Data to the Google App Engine
- * 
- * dexcomData: This is the Dexcom data to send to the AppEngine
- */
-void SendAppEngineData(struct Wixel_RawRecord_Struct dexcomData)
-{
-  uint32_t transmitterId = dexcomData.dex_src_id;
-  if (_configuration.getIsDebug()) {
-    SendDebugText("Preparing to send data to App Engine:\r\n");
-  }
-
-  String appEngineAddress = _configuration.getAppEngineAddress();
-  char appEngineCharArray[appEngineAddress.length() + 1];
-  appEngineAddress.toCharArray(appEngineCharArray, appEngineAddress.length() + 1);
-  char* appEngineHost = appEngineCharArray;
-  /*Serial.print("AppEngineHost: ");
-  Serial.print(appEngineHost);
-  Serial.print("\r\n");*/
-
-  WiFiClient client;
-  if (!client.connect(appEngineHost, HTTP_PORT)) {
-    if (_configuration.getIsDebug()) {
-      SendDebugText("Can't connect to App Engine :(\r\n");
-    }
-  }
-  else
-  {
-    if (_configuration.getIsDebug()) {
-      SendDebugText("Connected to App Engine :)\r\n\r\n");
-    }
-  }
-  if (_configuration.getIsDebug()) {
-    SendDebugText("Sending data to App Engine:\r\n");
-  }
-  String url = "/receiver.cgi?zi=";
-  url += transmitterId;
-  url += "&pc="; 
-  url += "0"; // Passcode
-  url += "&lv=";
-  url += dexcomData.raw; // Raw Data
-  url += "&lf=";
-  url += dexcomData.filtered; // Filtered Data
-  url += "&db=";
-  url += dexcomData.dex_battery; // Battery (Dexcom)
-  url += "&ts=";
-  url += millis() - lastTransmission; // Capture Date Time str(int(time.time()) - (int(data.ts) / 1000)) + "000"
-  url += "&bp=";
-  url += dexcomData.my_battery; // Uploader Battery Life
-  url += "&bm=";
-  url += 3755; // ?
-  url += "&ct=";
-  url += 22; // ?
-  url += "&gl="; 
-  url += 0; // Geolocation ?
-
-  if (_configuration.getIsDebug()) {
-    SendDebugText("Sending data: ");
-    SendDebugText(url);
-    SendDebugText("\r\n");
-  }
-  // This will send the request to the server
-  client.print(String("GET ") + url + " HTTP/1.1\r\n" +
-               "Host: " + appEngineHost + "\r\n" + 
-               "Connection: close\r\n\r\n");
-  unsigned long timeout = millis();
-  while (client.available() == 0) {
-    if (millis() - timeout > 5000) {
-      if (_configuration.getIsDebug()) {
-        SendDebugText(">>> Client Timeout !\r\n");
-      }
-      client.stop();
-      return;
-    }
-  }
-
-  if (_configuration.getIsDebug()) {
-    // Read all the lines of the reply from server and print them to Debug if available
-    while(client.available()){
-      String line = client.readStringUntil('\0');
-      SendDebugText(line);
-    }
-  }
-  SendDebugText("\r\nclosing connection\r\n");
-  client.stop();
-  lastTransmission = millis();
-}
-
 /*
  * Function: ProcessWixelMessage
  * -----------------------------
  * We now have a complete message and we need to process it
  * 
+ * port: The Wixel which sent the message
  * message: The message to process 
+ * messageLength: Number of bytes in the message, length byte included
  */
-void ProcessWixelMessage(unsigned char* message)
+void ProcessWixelMessage(WixelPort &port, const unsigned char* message, unsigned int messageLength)
 {
-  if (_configuration.getIsDebug()) {
-    OpenDebugConnection();
-  }
-  else
-  {
-    StartWifiConnection();
-  }
-  unsigned int messageLength = message[0];
-  unsigned int messageType = (int)message[1];
+  ProfilerScope profile(PROFILE_PROCESS_WIXEL_MESSAGE);
+  MetricsScope metrics(METRIC_PROCESS_WIXEL_MESSAGE);
+  unsigned int messageType = message[1];
   if (_configuration.getIsDebug()) {
     SendDebugText("Message type to process:");
-    SendDebugText(message[1]);
-    SendDebugText(":");
-    SendDebugText((unsigned int)message[1]);
+    SendDebugText((int)messageType);
+    SendDebugText(" (");
+    SendDebugText((char*)WixelMessageName(messageType));
+    SendDebugText(")\r\n");
   }
   switch(messageType)
   {
-    case WIXEL_COMM_RX_DATA_PACKET:
+    case WIXEL_COMM_RX_DATA_PACKET: {
+      WixelDataPayload data;
+      if (!WixelDecode(message, messageLength, &data)) {
+        Metrics::count(METRIC_BAD_FRAMES);
+        _debugLogger.beginLine(LOG_WARNING);
+        SendDebugText("Data packet with a wrong length\r\n");
+        break;
+      }
+      // Already acknowledged by WixelPort::acknowledgeDataPacket
       SendDebugText("We received a Dexcom Data Packet w00t!\r\n");
-      SendMessage(WIXEL_COMM_TX_ACKNOWLEDGE_DATA_PACKET);
-      struct Wixel_RawRecord_Struct dexcomData;
-      //memcpy(&dexcomData, &message[2], sizeof(dexcomData)); //messageLength - 2);
-      
-      dexcomData.raw = message[5];
-      dexcomData.raw = (dexcomData.raw << 8) + message[4];
-      dexcomData.raw = (dexcomData.raw << 8) + message[3];
-      dexcomData.raw = (dexcomData.raw << 8) + message[2];
-      
-      dexcomData.filtered = message[9];
-      dexcomData.filtered = (dexcomData.filtered << 8) + message[8];
-      dexcomData.filtered = (dexcomData.filtered << 8) + message[7];
-      dexcomData.filtered = (dexcomData.filtered << 8) + message[6];
-      
-      dexcomData.dex_battery = message[10];
-      
-      dexcomData.my_battery = message[11];
-      
-      dexcomData.dex_src_id = message[15];
-      dexcomData.dex_src_id = (dexcomData.dex_src_id << 8) + message[14];
-      dexcomData.dex_src_id = (dexcomData.dex_src_id << 8) + message[13];
-      dexcomData.dex_src_id = (dexcomData.dex_src_id << 8) + message[12];
+      // The queue keeps its own layout
+      RawRecord dexcomData;
+      dexcomData.raw = data.raw;
+      dexcomData.filtered = data.filtered;
+      dexcomData.dex_battery = data.dexBattery;
+      dexcomData.my_battery = data.bridgeBattery;
+      dexcomData.dex_src_id = data.dexSrcId;
+      dexcomData.function = data.function;
+      // Dropped before the radio scheduler learns from them, they are not on our transmitter cadence
+      ReadingFilterResult filterResult =
+        port.getReadingFilter()->check(dexcomData, _configuration.getTransmitterId(port.getNumber()));
+      if (filterResult == READING_FILTER_FOREIGN) {
+        _debugLogger.beginLine(LOG_WARNING);
+        SendDebugText("Reading of another transmitter dropped: ");
+        SendDebugText(dexcomData.dex_src_id);
+        SendDebugText("\r\n");
+        break;
+      }
+      if (filterResult == READING_FILTER_DUPLICATE) {
+        SendDebugText("Reading sent again by the Wixel, already queued (");
+        SendDebugText(port.getReadingFilter()->getDuplicateCount());
+        SendDebugText(" so far)\r\n");
+        break;
+      }
+      _radioScheduler.onDataPacket(port.getNumber());
 
-      dexcomData.function = message[16];
-      
       SendDebugText("\r\nraw: ");
       SendDebugText(dexcomData.raw);
       SendDebugText("\r\nfiltered: ");
@@ -606,132 +385,103 @@ void ProcessWixelMessage(unsigned char* message)
       SendDebugText(dexcomData.dex_src_id);
       SendDebugText("\r\nfunction: ");
       SendDebugText(dexcomData.function);
-      SendAppEngineData(dexcomData);
-    case WIXEL_COMM_RX_SEND_BEACON:
-      if(messageLength == 7){
-        // Spit the Wixel's Transmitter ID out of the message
-        uint32_t transmitterIdSrc;
-        memcpy(&transmitterIdSrc, &message[2], 4);
+      SendDebugText("\r\n");
+      if (port.getReadingQueue()->push(dexcomData)) {
+        // Uploaded from the main loop
+        _uploader.requestUpload();
+      }
+      else {
+        // Flash not available, try to send directly
+        _uploader.sendDirect(port.getNumber(), dexcomData);
+      }
+      break;
+    }
+    case WIXEL_COMM_RX_SEND_BEACON: {
+      WixelBeaconPayload beacon;
+      if (!WixelDecode(message, messageLength, &beacon)) {
+        Metrics::count(METRIC_BAD_FRAMES);
+        _debugLogger.beginLine(LOG_WARNING);
+        SendDebugText("Beacon with a wrong length\r\n");
+        break;
+      }
+      _radioScheduler.onBeacon(port.getNumber());
+      uint32_t transmitterIdSrc = beacon.dexSrcId;
 
-        if (_configuration.getIsDebug()) {
-          SendDebugText("Transmitter ID Src:");
-          SendDebugText(transmitterIdSrc);
-          SendDebugText("\r\n");
-        }
-        uint32_t configuredTransmitterId = _configuration.getTransmitterId();
-        char* configuredTransmitterIdAscii = _dexcomHelper.DexcomSrcToAscii(configuredTransmitterId);
-        char* transmitterIdAscii = _dexcomHelper.DexcomSrcToAscii(transmitterIdSrc);
-        if (_configuration.getIsDebug()) {
-          SendDebugText("Wixel thinks the transmitter ID is: ");
-          SendDebugText(transmitterIdAscii);
-          SendDebugText("\r\n");
-        }
-        // Check if it's the proper transmitter ID
-        
-        if (strcmp(transmitterIdAscii, configuredTransmitterIdAscii) == 0)
-        {
-          SendDebugText("Good, the Wixel has proper transmitter ID\r\n");
-        }
-        else
-        {
-          SendDebugText("Lol, send the proper Transmitter ID to the Wixel right now!\r\n");
-          SendMessage(WIXEL_COMM_TX_SEND_TRANSMITTER_ID, configuredTransmitterId);
-        }
-        free(transmitterIdAscii);
-        free(configuredTransmitterIdAscii);
+      if (_configuration.getIsDebug()) {
+        SendDebugText("Transmitter ID Src:");
+        SendDebugText(transmitterIdSrc);
+        SendDebugText("\r\n");
+      }
+      uint32_t configuredTransmitterId = _configuration.getTransmitterId(port.getNumber());
+      if (_configuration.getIsDebug()) {
+        char transmitterIdAscii[DEXCOM_ID_LENGTH + 1];
+        _dexcomHelper.DexcomSrcToAscii(transmitterIdSrc, transmitterIdAscii);
+        SendDebugText("Wixel thinks the transmitter ID is: ");
+        SendDebugText(transmitterIdAscii);
+        SendDebugText("\r\n");
+      }
+      // Check if it's the proper transmitter ID, same characters means same 25 low bits
+      if ((transmitterIdSrc & DEXCOM_SRC_MASK) == (configuredTransmitterId & DEXCOM_SRC_MASK))
+      {
+        SendDebugText("Good, the Wixel has proper transmitter ID\r\n");
+      }
+      else if (configuredTransmitterId == 0)
+      {
+        // Never send "00000", the Wixel would not find any transmitter
+        _debugLogger.beginLine(LOG_WARNING);
+        SendDebugText("No transmitter ID configured for this Wixel\r\n");
+      }
+      else
+      {
+        _debugLogger.beginLine(LOG_WARNING);
+        SendDebugText("Lol, send the proper Transmitter ID to the Wixel right now!\r\n");
+        SendTransmitterId(port, configuredTransmitterId);
       }
       break;
+    }
     default:
+      Metrics::count(METRIC_BAD_FRAMES);
+      _debugLogger.beginLine(LOG_WARNING);
       SendDebugText("Unkown message :/");
-      SendDebugText(messageType);
+      SendDebugText((int)messageType);
       SendDebugText("\r\n");
   }
-  if (_configuration.getIsDebug())
-  {
-    CloseDebugConnection();
-  }
-  else
-  {
-    StopWifiConnection();
-  }
-  
-}
-
-/*
- * Function: SendMessage
- * ---------------------
- * This method is used to send a message
- * messageId: The message ID to send
- */
-void SendMessage(unsigned int messageId)
-{
-  unsigned int messageLength = 2; // Message length byte + message id byte
-  char textNbChar [5];
-  _dexcomHelper.IntToCharArray(messageLength, textNbChar);
-  SendDebugText("Message Length: ");
-  SendDebugText(textNbChar);
-  SendDebugText("\r\n");
-  Serial.write(messageLength);
-  Serial.write(messageId);
-  SendDebugText("Message ID: ");
-  SendDebugText(messageId);
-  SendDebugText("\r\n");
 }
 
 /*
  * Function: SendMessage
  * ---------------------
- * This method is used to send a message
+ * This method is used to send a message without content, the frame is written at once
+ * port: The Wixel to send the message to
  * messageId: The message ID to send
- * messageContent: The message content in uint32_t format (Used for TransmitterId in Src format)
  */
-void SendMessage(unsigned int messageId, uint32_t messageContent)
+void SendMessage(WixelPort &port, uint8_t messageId)
 {
-  unsigned int messageLength = 6; // Message content (uint32_t = 4 bytes) + message length byte + message id byte
-  char textNbChar [5];
-  _dexcomHelper.IntToCharArray(messageLength, textNbChar);
-  SendDebugText("Message Length: ");
-  SendDebugText(textNbChar);
-  SendDebugText("\r\n");
-  Serial.write(messageLength);
-  Serial.write(messageId);
-  SendDebugText("Message ID: ");
-  SendDebugText(messageId);
-  SendDebugText("\r\n");
-  Serial.write( lowByte(messageContent) );
-  Serial.write( lowByte(messageContent >> 8) );
-  Serial.write( lowByte(messageContent >> 16) );
-  Serial.write( lowByte(messageContent >> 24) );
-  SendDebugText("Message Content: ");
-  SendDebugText(messageContent);
-  SendDebugText("\r\n");
-  SendDebugText( lowByte(messageContent) );
-  SendDebugText( lowByte(messageContent >> 8) );
-  SendDebugText( lowByte(messageContent >> 16) );
-  SendDebugText( lowByte(messageContent >> 24) );
-  SendDebugText("\r\n");
+  MetricsScope metrics(METRIC_SEND_MESSAGE);
+  bool sent = WixelSend(*port.getStream(), messageId);
+  if (_configuration.getIsDebug()) {
+    SendDebugText("Message sent: ");
+    SendDebugText((char*)WixelMessageName(messageId));
+    SendDebugText(sent ? "\r\n" : " (failed)\r\n");
+  }
 }
 
-// 
 /*
- * Function: SendMessage
- * ---------------------
- * This method is used to send a message
- * messageId: The message ID to send
- * messageContent: The message content when available
+ * Function: SendTransmitterId
+ * ---------------------------
+ * This method is used to send the Transmitter ID the Wixel should filter on, the frame is written at once
+ * port: The Wixel to send the Transmitter ID to
+ * transmitterId: The Transmitter ID in Src format
  */
-void SendMessage(unsigned int messageId, char* messageContent)
+void SendTransmitterId(WixelPort &port, uint32_t transmitterId)
 {
-  unsigned int messageLength = strlen(messageContent) + 2; // Message content + message length byte + message id byte
-  char textNbChar [5];
-  _dexcomHelper.IntToCharArray(messageLength, textNbChar);
-  SendDebugText("Message Length: ");
-  SendDebugText(textNbChar);
-  SendDebugText("\r\n");
-  Serial.write(messageLength);
-  
-  Serial.write(messageId);
-  Serial.write(messageContent);
+  MetricsScope metrics(METRIC_SEND_MESSAGE);
+  WixelTransmitterIdPayload payload;
+  payload.dexSrcId = transmitterId;
+  bool sent = WixelSend(*port.getStream(), payload);
+  if (_configuration.getIsDebug()) {
+    SendDebugText("Transmitter ID sent: ");
+    SendDebugText(transmitterId);
+    SendDebugText(sent ? "\r\n" : " (failed)\r\n");
+  }
 }
-
-